@@ -0,0 +1,65 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cases/bench_writer.h"
+#include "cases/bench_stream.h"
+#include "cases/bench_number.h"
+#include "cases/bench_escape.h"
+#include "cases/bench_builder.h"
+#include "cases/bench_format_text.h"
+#include "cases/bench_size.h"
+#include "cases/bench_layout.h"
+#include "cases/bench_packed.h"
+#include "cases/bench_columns.h"
+#include "cases/bench_shapes.h"
+#include "cases/bench_reclaim.h"
+#include "cases/bench_mutate.h"
+#include "cases/bench_clone.h"
+#include "cases/bench_msgpack.h"
+#include "cases/bench_snapshot.h"
+#include "cases/bench_hash.h"
+#include "cases/bench_doc_cache.h"
+#include "cases/bench_share.h"
+#include "cases/bench_publish.h"
+#include "cases/bench_patch.h"
+#include "cases/bench_raw.h"
+#include "cases/bench_projected.h"
+
+// usage: bench [max document size in MB, default 100]
+int main(int argc, char** argv) {
+    const char *CYAN = "\033[0;36m";
+    const char *RESET = "\033[0m";
+
+    double max_mb = argc > 1 ? atof(argv[1]) : 100.0;
+    size_t max_bytes = (size_t)(max_mb * BENCH_MB);
+
+    printf("%sRunning cerialize benchmarks (documents up to %.0f MB)...%s\n", CYAN, max_mb, RESET);
+
+    run_writer_bench(max_bytes);
+    run_stream_bench(max_bytes);
+    run_number_bench(max_bytes);
+    run_escape_bench(max_bytes);
+    run_builder_bench(max_bytes);
+    run_format_text_bench(max_bytes);
+    run_size_bench(max_bytes);
+    run_layout_bench(max_bytes);
+    run_packed_bench(max_bytes);
+    run_columns_bench(max_bytes);
+    run_shapes_bench(max_bytes);
+    run_reclaim_bench(max_bytes);
+    run_mutate_bench(max_bytes);
+    run_clone_bench(max_bytes);
+    run_msgpack_bench(max_bytes);
+    run_snapshot_bench(max_bytes);
+    run_hash_bench(max_bytes);
+    run_doc_cache_bench(max_bytes);
+    run_share_bench(max_bytes);
+    run_publish_bench(max_bytes);
+    run_patch_bench(max_bytes);
+    run_raw_bench(max_bytes);
+    run_projected_bench(max_bytes);
+
+    printf("All benchmarks completed.\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+#ifndef BENCH_BUILDER_H
+#define BENCH_BUILDER_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+static inline char* bench_strdup(const char* str) {
+    char* copy = (char*)malloc(strlen(str) + 1);
+    strcpy(copy, str);
+    return copy;
+}
+
+// Response generation the old way: build a json_object tree, serialize it, free it
+static inline char* bench_build_with_dom(cereal_size_t count) {
+    json doc = { .failure = FALSE, .error_text = NULL };
+    json_set_list(&doc.root, (json_object*)malloc(sizeof(json_object) * count), count);
+    for (cereal_size_t i = 0; i < count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "user_%u", i);
+        json_node* nodes = (json_node*)malloc(sizeof(json_node) * 4);
+        json_node_set_key(&nodes[0], bench_strdup("id"));
+        json_set_number(&nodes[0].value, (float)i);
+        json_node_set_key(&nodes[1], bench_strdup("name"));
+        json_set_string(&nodes[1].value, bench_strdup(name));
+        json_node_set_key(&nodes[2], bench_strdup("active"));
+        json_set_bool(&nodes[2].value, (bool_t)(i & 1));
+        json_node_set_key(&nodes[3], bench_strdup("tags"));
+        json_set_list(&nodes[3].value, (json_object*)malloc(sizeof(json_object) * 2), 2);
+        json_set_string(json_list_at(&nodes[3].value, 0), bench_strdup("alpha"));
+        json_set_string(json_list_at(&nodes[3].value, 1), bench_strdup("beta"));
+        json_set_object(json_list_at(&doc.root, i), nodes, 4);
+    }
+    char* out = serialize_json(&doc);
+    json_free(&doc);
+    return out;
+}
+
+// The same output written straight through the builder
+static inline char* bench_build_with_writer(cereal_size_t count) {
+    json_writer w;
+    json_writer_init(&w, NULL);
+    json_w_begin_array(&w);
+    for (cereal_size_t i = 0; i < count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "user_%u", i);
+        json_w_begin_object(&w);
+        json_w_key(&w, "id");
+        json_w_int(&w, i);
+        json_w_key(&w, "name");
+        json_w_string(&w, name);
+        json_w_key(&w, "active");
+        json_w_bool(&w, (bool_t)(i & 1));
+        json_w_key(&w, "tags");
+        json_w_begin_array(&w);
+        json_w_string(&w, "alpha");
+        json_w_string(&w, "beta");
+        json_w_end_array(&w);
+        json_w_end_object(&w);
+    }
+    json_w_end_array(&w);
+    return json_writer_finish(&w);
+}
+
+static inline void run_builder_bench(size_t max_bytes) {
+    cereal_size_t counts[] = { 1000, 100000, 1000000 };
+    size_t count = sizeof(counts) / sizeof(counts[0]);
+    test_row_t rows[6];
+    size_t num_rows = 0;
+
+    for (size_t i = 0; i < count && (size_t)counts[i] * 64 <= max_bytes; i++) {
+        char label[64];
+        double start = bench_now();
+        char* dom = bench_build_with_dom(counts[i]);
+        double elapsed = bench_now() - start;
+        snprintf(label, sizeof(label), "%u records, tree + serialize", counts[i]);
+        bench_fill_row(&rows[num_rows++], label, dom ? strlen(dom) : 0, elapsed);
+
+        start = bench_now();
+        char* streamed = bench_build_with_writer(counts[i]);
+        elapsed = bench_now() - start;
+        snprintf(label, sizeof(label), "%u records, json_w_*", counts[i]);
+        bench_fill_row(&rows[num_rows++], label, streamed ? strlen(streamed) : 0, elapsed);
+
+        if (!dom || !streamed || strcmp(dom, streamed) != 0) {
+            printf("builder output mismatch for %u records\n", counts[i]);
+        }
+        free(dom);
+        free(streamed);
+    }
+
+    const char *headers[] = {"Build", "Output", "ms/op", "MB/s"};
+    int col_widths[] = {36, 10, 12, 10};
+    print_test_table("Response generation", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef BENCH_CLONE_H
+#define BENCH_CLONE_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+#include "bench_layout.h"
+
+// Copying a record array: serializing and parsing it again against
+// json_clone_compact, then walking the scattered original against the
+// compacted copy. The original is built record by record, like a document
+// that has been edited, so its nodes are spread over the heap.
+static inline void run_clone_bench(size_t max_bytes) {
+    // no literals, whose parse scans the rest of the input and would dominate the reparse
+    const char* record = "{\"id\":12345,\"name\":\"user_12345\",\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}";
+    size_t sizes[] = { 1024 * 1024, 10 * 1024 * 1024 };
+    const int walks = 5;
+    test_row_t rows[8];
+    size_t num_rows = 0;
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]) && sizes[i] <= max_bytes; i++) {
+        char size_label[16];
+        bench_format_bytes(sizes[i], size_label, sizeof(size_label));
+        json doc = bench_make_records(record, sizes[i]);
+
+        bench_peak_ctx_t reparse_ctx = { 0, 0, 0 };
+        json_allocator reparse_alloc = { bench_peak_alloc, bench_peak_realloc, bench_peak_free, &reparse_ctx };
+        double start = bench_now();
+        char* text = serialize_json(&doc);
+        json copy = deserialize_json_with_allocator(text, (cereal_size_t)strlen(text), &reparse_alloc);
+        double reparse_time = bench_now() - start;
+        free(text);
+
+        bench_peak_ctx_t clone_ctx = { 0, 0, 0 };
+        json_allocator clone_alloc = { bench_peak_alloc, bench_peak_realloc, bench_peak_free, &clone_ctx };
+        start = bench_now();
+        json_object* clone = json_clone_compact_with_allocator(&doc.root, &clone_alloc);
+        double clone_time = bench_now() - start;
+
+        double walk_time[2] = { 0.0, 0.0 };
+        for (int w = 0; w < walks; w++) {
+            for (int k = 0; k < 2; k++) {
+                start = bench_now();
+                bench_sink = bench_count_values(k == 0 ? &doc.root : clone);
+                walk_time[k] += bench_now() - start;
+            }
+        }
+
+        const char* names[4] = { "serialize + parse", "json_clone_compact", "walk original", "walk compact clone" };
+        double times[4] = { reparse_time, clone_time, walk_time[0] / walks, walk_time[1] / walks };
+        size_t allocs[4] = { reparse_ctx.allocs, clone_ctx.allocs, 0, 0 };
+        for (int k = 0; k < 4; k++) {
+            snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s %s", size_label, names[k]);
+            if (k < 2) {
+                snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%zu", allocs[k]);
+            } else {
+                strcpy(rows[num_rows].expected, "-");
+            }
+            snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%.3f", times[k] * 1000.0);
+            snprintf(rows[num_rows].status, sizeof(rows[num_rows].status), "%.1f", times[k] > 0 ? (double)sizes[i] / BENCH_MB / times[k] : 0.0);
+            rows[num_rows].color = clone ? "\033[0;32m" : "\033[0;31m";
+            rows[num_rows].reset = "\033[0m";
+            num_rows++;
+        }
+
+        json_dealloc(&clone_alloc, clone);
+        json_free(&copy);
+        json_free(&doc);
+    }
+
+    const char *headers[] = {"Operation", "Allocs", "ms", "MB/s"};
+    int col_widths[] = {32, 10, 12, 12};
+    print_test_table("Compact clone", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef BENCH_COLUMNS_H
+#define BENCH_COLUMNS_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// Summing one field over record arrays: walking the tree with json_get_property
+// against pivoting once with json_to_columns and scanning the number column.
+static inline void run_columns_bench(size_t max_bytes) {
+    const char* record = "{\"id\":12345,\"name\":\"user_12345\",\"active\":true,\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}";
+    size_t sizes[] = { 1024, 100 * 1024, 10 * 1024 * 1024 };
+    size_t count = sizeof(sizes) / sizeof(sizes[0]);
+    test_row_t rows[9];
+    size_t num_rows = 0;
+
+    for (size_t i = 0; i < count && sizes[i] <= max_bytes; i++) {
+        json doc = bench_make_records(record, sizes[i]);
+        cereal_size_t records = json_list_count(&doc.root);
+        int reps = sizes[i] >= 10 * 1024 * 1024 ? 4 : (int)(64 * 1024 * 1024 / sizes[i]);
+        if (reps > 1000) reps = 1000;
+        char size_label[16];
+        char label[64];
+        bench_format_bytes(sizes[i], size_label, sizeof(size_label));
+
+        double sum = 0.0;
+        double start = bench_now();
+        for (int r = 0; r < reps; r++) {
+            for (cereal_size_t k = 0; k < records; k++) {
+                json_object score = json_get_property(*json_list_at(&doc.root, k), "score");
+                sum += json_number_value(&score);
+            }
+        }
+        double elapsed = (bench_now() - start) / reps;
+        snprintf(label, sizeof(label), "%s tree walk sum", size_label);
+        bench_fill_row(&rows[num_rows++], label, sizes[i], elapsed);
+
+        json_columns cols = json_to_columns(&doc.root, NULL);
+        start = bench_now();
+        for (int r = 0; r < reps; r++) {
+            json_columns_free(&cols);
+            cols = json_to_columns(&doc.root, NULL);
+        }
+        elapsed = (bench_now() - start) / reps;
+        snprintf(label, sizeof(label), "%s json_to_columns", size_label);
+        bench_fill_row(&rows[num_rows++], label, sizes[i], elapsed);
+
+        const json_column* column = json_columns_find(&cols, "score");
+        start = bench_now();
+        for (int r = 0; r < reps; r++) {
+            for (cereal_size_t k = 0; k < records; k++) {
+                sum += column->numbers[k];
+            }
+        }
+        elapsed = (bench_now() - start) / reps;
+        snprintf(label, sizeof(label), "%s column sum", size_label);
+        bench_fill_row(&rows[num_rows++], label, sizes[i], elapsed);
+
+        bench_sink += (size_t)sum;
+        json_columns_free(&cols);
+        json_free(&doc);
+    }
+
+    const char *headers[] = {"Operation", "Input", "ms/op", "MB/s"};
+    int col_widths[] = {32, 10, 12, 10};
+    print_test_table("Columnar aggregation", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef BENCH_DOC_CACHE_H
+#define BENCH_DOC_CACHE_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../../include/cerialize/doc_cache.h"
+#include "../helpers/bench_utils.h"
+
+// A stream of requests whose bodies repeat, like polling clients: parsing
+// every body against going through json_doc_cache_parse. Capacity is split
+// evenly over the shards, so the cache that fits every distinct body gets four
+// times their number to absorb uneven shard loads.
+static inline void run_doc_cache_bench(size_t max_bytes) {
+    (void)max_bytes;
+    // no literals, whose parse scans the rest of the input and would dominate
+    const char* record = "{\"id\":12345,\"name\":\"user_12345\",\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}";
+    const size_t distinct = 64;
+    const size_t requests = 20000;
+    const size_t body_bytes = 4096;
+    char* bodies[64];
+    size_t lengths[64];
+    for (size_t b = 0; b < distinct; b++) {
+        json doc = bench_make_records(record, body_bytes);
+        json_set_number(json_object_value_at(json_list_at(&doc.root, 0), 0), (float)b);
+        bodies[b] = serialize_json(&doc);
+        lengths[b] = strlen(bodies[b]);
+        json_free(&doc);
+    }
+
+    const char* methods[3] = { "deserialize_json", "doc cache, all fit", "doc cache, half fit" };
+    size_t capacities[3] = { 0, distinct * 4, distinct / 2 };
+    test_row_t rows[3];
+    for (int m = 0; m < 3; m++) {
+        json_doc_cache cache;
+        if (m > 0) json_doc_cache_init(&cache, capacities[m], NULL);
+        bool_t ok = TRUE;
+        // a fixed stride visits the bodies in a scattered but repeatable order
+        double start = bench_now();
+        for (size_t r = 0; r < requests; r++) {
+            size_t b = (r * 37) % distinct;
+            if (m == 0) {
+                json doc = deserialize_json(bodies[b], (cereal_size_t)lengths[b]);
+                if (doc.failure) ok = FALSE;
+                json_free(&doc);
+            } else {
+                json_cached_doc* entry = json_doc_cache_parse(&cache, bodies[b], lengths[b]);
+                if (!entry || json_cached_doc_json(entry)->failure) ok = FALSE;
+                json_doc_cache_release(&cache, entry);
+            }
+        }
+        double elapsed = bench_now() - start;
+        snprintf(rows[m].input_display, sizeof(rows[m].input_display), "%s", methods[m]);
+        snprintf(rows[m].result, sizeof(rows[m].result), "%.3f", elapsed * 1000.0);
+        if (m > 0) {
+            json_doc_cache_stats stats = json_doc_cache_get_stats(&cache);
+            snprintf(rows[m].expected, sizeof(rows[m].expected), "%.0f%%", 100.0 * (double)stats.hits / (double)(stats.hits + stats.misses));
+            json_doc_cache_destroy(&cache);
+        } else {
+            snprintf(rows[m].expected, sizeof(rows[m].expected), "-");
+        }
+        snprintf(rows[m].status, sizeof(rows[m].status), "%.2f", elapsed * 1e6 / (double)requests);
+        rows[m].color = ok ? "\033[0;32m" : "\033[0;31m";
+        rows[m].reset = "\033[0m";
+    }
+    for (size_t b = 0; b < distinct; b++) free(bodies[b]);
+
+    const char *headers[] = {"Method", "Hit rate", "Total ms", "us/request"};
+    int col_widths[] = {24, 10, 12, 12};
+    print_test_table("Repeated bodies, 20000 requests over 64 bodies of 4 KB", headers, 4, col_widths, rows, 3);
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef BENCH_ESCAPE_H
+#define BENCH_ESCAPE_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// Byte-at-a-time reference scan
+static inline size_t bench_escape_scan_bytewise(const char* str, size_t len) {
+    size_t i = 0;
+    while (i < len && !json_needs_escape((unsigned char)str[i])) i++;
+    return i;
+}
+
+// Walk the whole text the way json_write_escaped does, skipping one byte per hit
+static inline size_t bench_escape_walk(const char* text, size_t len, size_t (*scan)(const char*, size_t)) {
+    size_t i = 0, hits = 0;
+    while (i < len) {
+        i += scan(text + i, len - i);
+        if (i < len) {
+            hits++;
+            i++;
+        }
+    }
+    return hits;
+}
+
+// Escape-free prose vs escape-heavy text (quotes, paths and newlines every few bytes)
+static inline void run_escape_bench(size_t max_bytes) {
+    const char* kinds[] = { "escape-free", "escape-heavy" };
+    size_t len = 8 * 1024 * 1024;
+    if (len > max_bytes) len = max_bytes;
+    test_row_t rows[8];
+    size_t num_rows = 0;
+    char* text = (char*)malloc(len + 1);
+
+    for (int kind = 0; kind < 2; kind++) {
+        const char* pattern = kind == 0
+            ? "The quick brown fox jumps over the lazy dog while the servers log requests. "
+            : "{\"path\":\"C:\\\\logs\\\\app\"}\n\tline \"quoted\"\n";
+        size_t pattern_len = strlen(pattern);
+        for (size_t i = 0; i < len; i++) text[i] = pattern[i % pattern_len];
+        text[len] = '\0';
+
+        size_t (*scanners[])(const char*, size_t) = { bench_escape_scan_bytewise, json_escape_scan_scalar, json_escape_scan };
+        const char* names[] = { "bytewise", "scalar (SWAR)", "SIMD" };
+        for (int s = 0; s < 3; s++) {
+            double start = bench_now();
+            size_t hits = 0;
+            for (int r = 0; r < 10; r++) hits += bench_escape_walk(text, len, scanners[s]);
+            double elapsed = (bench_now() - start) / 10;
+            char label[64];
+            snprintf(label, sizeof(label), "%s, scan %s", kinds[kind], names[s]);
+            bench_sink = hits;
+            bench_fill_row(&rows[num_rows++], label, len, elapsed);
+        }
+
+        json doc = { .failure = FALSE, .error_text = NULL };
+        json_set_string(&doc.root, text);
+        double start = bench_now();
+        char* out = serialize_json(&doc);
+        double elapsed = bench_now() - start;
+        char label[64];
+        snprintf(label, sizeof(label), "%s, serialize_json", kinds[kind]);
+        bench_fill_row(&rows[num_rows++], label, len, elapsed);
+        free(out);
+    }
+    free(text);
+
+    const char *headers[] = {"Text", "Input", "ms/op", "MB/s"};
+    int col_widths[] = {36, 10, 12, 10};
+    print_test_table("String escaping", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef BENCH_FORMAT_TEXT_H
+#define BENCH_FORMAT_TEXT_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// Pretty printed input, so minify has whitespace to strip
+static inline char* bench_make_pretty_document(size_t target_bytes, size_t* out_len) {
+    json doc = bench_make_records("{\"id\":12345,\"name\":\"a reasonably long user name\",\"active\":true,\"tags\":[\"alpha\",\"beta\"]}", target_bytes);
+    char* compact = serialize_json(&doc);
+    json_free(&doc);
+    json_writer w;
+    json_writer_init(&w, NULL);
+    json_prettify(compact, strlen(compact), 2, &w);
+    free(compact);
+    char* pretty = json_writer_finish(&w);
+    *out_len = pretty ? strlen(pretty) : 0;
+    return pretty;
+}
+
+static inline void run_format_text_bench(size_t max_bytes) {
+    size_t sizes[] = { 1024 * 1024, 10 * 1024 * 1024, 100 * 1024 * 1024 };
+    size_t count = sizeof(sizes) / sizeof(sizes[0]);
+    test_row_t rows[12];
+    size_t num_rows = 0;
+
+    for (size_t i = 0; i < count && sizes[i] <= max_bytes; i++) {
+        size_t len;
+        char* pretty = bench_make_pretty_document(sizes[i], &len);
+        if (!pretty) continue;
+        char* out = (char*)malloc(len + 1);
+        char size_label[16];
+        char label[64];
+        bench_format_bytes(sizes[i], size_label, sizeof(size_label));
+
+        double start = bench_now();
+        memcpy(out, pretty, len);
+        double elapsed = bench_now() - start;
+        bench_sink += (size_t)out[len / 2];
+        snprintf(label, sizeof(label), "%s memcpy (bound)", size_label);
+        bench_fill_row(&rows[num_rows++], label, len, elapsed);
+
+        start = bench_now();
+        size_t minified = json_minify(pretty, len, out);
+        elapsed = bench_now() - start;
+        snprintf(label, sizeof(label), "%s json_minify", size_label);
+        bench_fill_row(&rows[num_rows++], label, len, elapsed);
+
+        // the tree round trip this replaces; the parser does not scale to the
+        // larger pretty printed inputs, so it only runs on the smallest one
+        if (i == 0) {
+            start = bench_now();
+            json parsed = deserialize_json(pretty, len);
+            char* reserialized = serialize_json(&parsed);
+            elapsed = bench_now() - start;
+            snprintf(label, sizeof(label), "%s parse + serialize", size_label);
+            bench_fill_row(&rows[num_rows++], label, len, elapsed);
+            if (!reserialized || strlen(reserialized) != minified || memcmp(reserialized, out, minified) != 0) {
+                printf("minify output mismatch for %s\n", size_label);
+            }
+            free(reserialized);
+            json_free(&parsed);
+        }
+
+        json_writer w;
+        json_writer_init(&w, NULL);
+        start = bench_now();
+        json_prettify(out, minified, 2, &w);
+        elapsed = bench_now() - start;
+        bench_sink += w.length;
+        json_writer_free(&w);
+        snprintf(label, sizeof(label), "%s json_prettify", size_label);
+        bench_fill_row(&rows[num_rows++], label, minified, elapsed);
+
+        free(out);
+        free(pretty);
+    }
+
+    const char *headers[] = {"Operation", "Input", "ms/op", "MB/s"};
+    int col_widths[] = {32, 10, 12, 10};
+    print_test_table("Minify / prettify", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef BENCH_HASH_H
+#define BENCH_HASH_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// Comparing two copies of a record array: serializing both and running strcmp
+// against json_equal, and json_equal_cached once its cache is warm. The
+// copies are equal, or differ in the last record's first field.
+static inline void run_hash_bench(size_t max_bytes) {
+    // no literals, whose parse scans the rest of the input and would dominate building the copy
+    const char* record = "{\"id\":12345,\"name\":\"user_12345\",\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}";
+    size_t target = 10 * 1024 * 1024;
+    if (target > max_bytes) target = max_bytes;
+    const int rounds = 5;
+    test_row_t rows[6];
+    size_t num_rows = 0;
+
+    json doc = bench_make_records(record, target);
+    char* text = serialize_json(&doc);
+    json copy = deserialize_json(text, (cereal_size_t)strlen(text));
+    free(text);
+    json_hash_cache cache;
+    json_hash_cache_init(&cache, NULL);
+
+    for (int differ = 0; differ < 2; differ++) {
+        if (differ) {
+            // edits change no container storage, so the cache is rebuilt by hand
+            json_object* last = json_list_at(&copy.root, json_list_count(&copy.root) - 1);
+            json_set_number(json_object_value_at(last, 0), 54321.0f);
+            json_hash_cache_clear(&cache);
+        }
+        const char* methods[3] = { "serialize + strcmp", "json_equal", "json_equal_cached warm" };
+        double times[3] = { 0.0, 0.0, 0.0 };
+        bool_t results[3] = { FALSE, FALSE, FALSE };
+        json_equal_cached(&doc.root, &copy.root, &cache);
+        for (int r = 0; r < rounds; r++) {
+            double start = bench_now();
+            char* a = serialize_json(&doc);
+            char* b = serialize_json(&copy);
+            results[0] = strcmp(a, b) == 0;
+            times[0] += bench_now() - start;
+            free(a);
+            free(b);
+
+            start = bench_now();
+            results[1] = json_equal(&doc.root, &copy.root);
+            times[1] += bench_now() - start;
+
+            start = bench_now();
+            results[2] = json_equal_cached(&doc.root, &copy.root, &cache);
+            times[2] += bench_now() - start;
+        }
+        for (int m = 0; m < 3; m++) {
+            snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s", differ ? "last record differs" : "equal");
+            snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%s", methods[m]);
+            snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%.3f", times[m] / rounds * 1000.0);
+            snprintf(rows[num_rows].status, sizeof(rows[num_rows].status), "%s", results[m] ? "equal" : "different");
+            rows[num_rows].color = (results[m] ? 0 : 1) == differ ? "\033[0;32m" : "\033[0;31m";
+            rows[num_rows].reset = "\033[0m";
+            num_rows++;
+        }
+    }
+
+    json_hash_cache_free(&cache);
+    json_free(&copy);
+    json_free(&doc);
+
+    const char *headers[] = {"Pair", "Method", "ms", "Result"};
+    int col_widths[] = {22, 24, 12, 12};
+    print_test_table("Deep equality", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef BENCH_LAYOUT_H
+#define BENCH_LAYOUT_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// number of json_object values in the tree, containers included
+static inline size_t bench_count_values(const json_object* obj) {
+    size_t total = 1;
+    if (json_list_packing(obj) != JSON_PACKED_NONE) {
+        // packed elements count as values even without a json_object each
+        total += json_list_count(obj);
+    } else if (json_typeof(obj) == JSON_LIST) {
+        for (cereal_size_t i = 0; i < json_list_count(obj); i++) {
+            total += bench_count_values(json_list_at(obj, i));
+        }
+    } else if (json_typeof(obj) == JSON_OBJECT) {
+        for (cereal_size_t i = 0; i < json_node_count(obj); i++) {
+            total += bench_count_values(json_object_value_at(obj, i));
+        }
+    }
+    return total;
+}
+
+// Heap blocks and live bytes of parsed record arrays. Build with -DCERIALIZE_COMPACT
+// (the bench_compact target) to compare the two layouts.
+static inline void run_layout_bench(size_t max_bytes) {
+    const char* records[] = {
+        "{\"id\":12345,\"name\":\"user_12345\",\"active\":true,\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}",
+        "[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16]",
+        "{\"first_name\":\"Ada\",\"last_name\":\"Lovelace\",\"city\":\"London\",\"role\":\"analyst\"}",
+    };
+    const char* kinds[] = { "records", "numbers", "short strings" };
+    size_t target = 10 * 1024 * 1024;
+    if (target > max_bytes) target = max_bytes;
+    test_row_t rows[3];
+    size_t num_rows = 0;
+
+#ifdef CERIALIZE_COMPACT
+    const char* layout = "compact";
+#else
+    const char* layout = "default";
+#endif
+    printf("\njson_object layout: %s, sizeof(json_object) = %zu, sizeof(json_node) = %zu\n",
+        layout, sizeof(json_object), sizeof(json_node));
+
+    for (size_t k = 0; k < 3; k++) {
+        // one document made of repeated records, parsed through the tracking allocator
+        size_t record_len = strlen(records[k]);
+        size_t count = target / (record_len + 1);
+        if (count == 0) count = 1;
+        char* text = (char*)malloc(count * (record_len + 1) + 2);
+        size_t len = 0;
+        text[len++] = '[';
+        for (size_t i = 0; i < count; i++) {
+            if (i > 0) text[len++] = ',';
+            memcpy(text + len, records[k], record_len);
+            len += record_len;
+        }
+        text[len++] = ']';
+
+        bench_peak_ctx_t peak = { 0, 0, 0 };
+        json_allocator alloc = { bench_peak_alloc, bench_peak_realloc, bench_peak_free, &peak };
+        json doc = deserialize_json_with_allocator(text, (cereal_size_t)len, &alloc);
+        size_t values = doc.failure ? 0 : bench_count_values(&doc.root);
+        size_t live = peak.live;
+        json_free(&doc);
+        free(text);
+
+        char label[64];
+        snprintf(label, sizeof(label), "%s, %s", kinds[k], layout);
+        snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s", label);
+        snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%zu", peak.allocs);
+        bench_format_bytes(live, rows[num_rows].result, sizeof(rows[num_rows].result));
+        snprintf(rows[num_rows].status, sizeof(rows[num_rows].status), "%.1f", values ? (double)live / (double)values : 0.0);
+        rows[num_rows].color = "\033[0;32m";
+        rows[num_rows].reset = "\033[0m";
+        num_rows++;
+    }
+
+    const char *headers[] = {"Document", "Allocations", "Live heap", "B/value"};
+    int col_widths[] = {24, 10, 12, 10};
+    print_test_table("Memory per parsed value", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef BENCH_MSGPACK_H
+#define BENCH_MSGPACK_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../../include/cerialize/msgpack.h"
+#include "../helpers/bench_utils.h"
+
+// Encoded size and encode/decode time of MessagePack against JSON text for
+// the same trees.
+static inline void run_msgpack_bench(size_t max_bytes) {
+    const char* records[] = {
+        // no literals, whose parse scans the rest of the input and would dominate the text decode
+        "{\"id\":12345,\"name\":\"user_12345\",\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}",
+        "[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16]",
+        "{\"first_name\":\"Ada\",\"last_name\":\"Lovelace\",\"city\":\"London\",\"role\":\"analyst\"}",
+    };
+    const char* kinds[] = { "records", "numbers", "short strings" };
+    size_t target = 10 * 1024 * 1024;
+    if (target > max_bytes) target = max_bytes;
+    test_row_t rows[6];
+    size_t num_rows = 0;
+
+    for (size_t k = 0; k < 3; k++) {
+        json doc = bench_make_records(records[k], target);
+
+        double start = bench_now();
+        char* text = serialize_json(&doc);
+        double text_encode = bench_now() - start;
+        size_t text_size = text ? strlen(text) : 0;
+        start = bench_now();
+        json from_text = deserialize_json(text, (cereal_size_t)text_size);
+        double text_decode = bench_now() - start;
+
+        size_t packed_size = 0;
+        start = bench_now();
+        unsigned char* packed = json_to_msgpack(&doc, &packed_size);
+        double packed_encode = bench_now() - start;
+        start = bench_now();
+        json from_packed = json_from_msgpack(packed, packed_size);
+        double packed_decode = bench_now() - start;
+
+        const char* formats[2] = { "json text", "msgpack" };
+        size_t sizes[2] = { text_size, packed_size };
+        double encode[2] = { text_encode, packed_encode };
+        double decode[2] = { text_decode, packed_decode };
+        bool_t ok[2] = { !from_text.failure, !from_packed.failure };
+        for (int f = 0; f < 2; f++) {
+            snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s %s", kinds[k], formats[f]);
+            bench_format_bytes(sizes[f], rows[num_rows].expected, sizeof(rows[num_rows].expected));
+            snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%.3f", encode[f] * 1000.0);
+            snprintf(rows[num_rows].status, sizeof(rows[num_rows].status), "%.3f", decode[f] * 1000.0);
+            rows[num_rows].color = ok[f] ? "\033[0;32m" : "\033[0;31m";
+            rows[num_rows].reset = "\033[0m";
+            num_rows++;
+        }
+
+        json_free(&from_packed);
+        free(packed);
+        json_free(&from_text);
+        free(text);
+        json_free(&doc);
+    }
+
+    const char *headers[] = {"Corpus", "Size", "Encode ms", "Decode ms"};
+    int col_widths[] = {28, 10, 12, 12};
+    print_test_table("MessagePack vs JSON text", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef BENCH_MUTATE_H
+#define BENCH_MUTATE_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// Building a list one element at a time: growing the items array by exactly
+// one slot per append, json_list_append with geometric growth, and
+// json_list_reserve up front followed by appends.
+static size_t bench_mutate_reallocs;
+
+static void* bench_mutate_alloc(void* ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void* bench_mutate_realloc(void* ctx, void* ptr, size_t size) {
+    (void)ctx;
+    bench_mutate_reallocs++;
+    return realloc(ptr, size);
+}
+
+static void bench_mutate_free(void* ctx, void* ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+static inline void run_mutate_bench(size_t max_bytes) {
+    cereal_size_t counts[] = { 10000, 100000, 1000000 };
+    const char* methods[] = { "exact realloc", "json_list_append", "reserve + append" };
+    json_allocator alloc = { bench_mutate_alloc, bench_mutate_realloc, bench_mutate_free, NULL };
+    test_row_t rows[9];
+    size_t num_rows = 0;
+
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        // the exact variant copies the whole list on most appends, keep it bounded too
+        if ((size_t)counts[i] * sizeof(json_object) > max_bytes) break;
+        for (int method = 0; method < 3; method++) {
+            json_object list;
+            json_set_list(&list, NULL, 0);
+            bench_mutate_reallocs = 0;
+            double start = bench_now();
+            if (method == 2) json_list_reserve(&list, counts[i], &alloc);
+            for (cereal_size_t k = 0; k < counts[i]; k++) {
+                json_object item;
+                json_set_number(&item, (float)k);
+                if (method == 0) {
+                    json_object* items = (json_object*)json_realloc(&alloc, json_list_items(&list), sizeof(json_object) * (k + 1));
+                    if (!items) break;
+                    items[k] = item;
+                    json_set_list(&list, items, k + 1);
+                } else if (!json_list_append(&list, item, &alloc)) {
+                    break;
+                }
+            }
+            double elapsed = bench_now() - start;
+            int complete = json_list_count(&list) == counts[i];
+            json_object_free_with_allocator(&list, &alloc);
+
+            snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%u x %s", counts[i], methods[method]);
+            snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%zu", bench_mutate_reallocs);
+            snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%.3f", elapsed * 1000.0);
+            snprintf(rows[num_rows].status, sizeof(rows[num_rows].status), "%.1f", elapsed * 1e9 / counts[i]);
+            rows[num_rows].color = complete ? "\033[0;32m" : "\033[0;31m";
+            rows[num_rows].reset = "\033[0m";
+            num_rows++;
+        }
+    }
+
+    const char *headers[] = {"Build", "Reallocs", "ms", "ns/append"};
+    int col_widths[] = {32, 10, 12, 12};
+    print_test_table("List building", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
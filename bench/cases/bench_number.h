@@ -0,0 +1,72 @@
+#ifndef BENCH_NUMBER_H
+#define BENCH_NUMBER_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// The pre-Grisu path: malloc 32 bytes and snprintf("%f") for every number
+static inline char* bench_legacy_serialize_numbers(const json_object* list) {
+    json_writer w;
+    json_writer_init(&w, NULL);
+    json_writer_putc(&w, '[');
+    for (cereal_size_t i = 0; i < json_list_count(list); i++) {
+        if (i > 0) json_writer_putc(&w, ',');
+        char* text = (char*)malloc(32);
+        snprintf(text, 32, "%f", json_number_value(json_list_at(list, i)));
+        json_writer_puts(&w, text);
+        free(text);
+    }
+    json_writer_putc(&w, ']');
+    return json_writer_finish(&w);
+}
+
+// Number-heavy documents: integers, short decimals and full precision samples
+static inline void run_number_bench(size_t max_bytes) {
+    const char* kinds[] = { "integers", "decimals", "samples" };
+    cereal_size_t count = 1000000;
+    if ((size_t)count * 12 > max_bytes) count = (cereal_size_t)(max_bytes / 12);
+    if (count == 0) count = 1;
+    test_row_t rows[6];
+    size_t num_rows = 0;
+
+    for (int kind = 0; kind < 3; kind++) {
+        json doc = { .failure = FALSE, .error_text = NULL };
+        json_set_list(&doc.root, (json_object*)malloc(sizeof(json_object) * count), count);
+        uint32_t state = 2463534242u;
+        for (cereal_size_t i = 0; i < count; i++) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            float value;
+            if (kind == 0) value = (float)(state % 100000);
+            else if (kind == 1) value = (float)(state % 100000) / 100.0f;
+            else value = (float)state / 4294967296.0f * 360.0f - 180.0f;
+            json_set_number(json_list_at(&doc.root, i), value);
+        }
+
+        char label[64];
+        double start = bench_now();
+        char* legacy = bench_legacy_serialize_numbers(&doc.root);
+        double elapsed = bench_now() - start;
+        snprintf(label, sizeof(label), "%s, snprintf %%f", kinds[kind]);
+        bench_fill_row(&rows[num_rows++], label, legacy ? strlen(legacy) : 0, elapsed);
+        free(legacy);
+
+        start = bench_now();
+        char* shortest = serialize_json(&doc);
+        elapsed = bench_now() - start;
+        snprintf(label, sizeof(label), "%s, shortest", kinds[kind]);
+        bench_fill_row(&rows[num_rows++], label, shortest ? strlen(shortest) : 0, elapsed);
+        free(shortest);
+
+        json_free(&doc);
+    }
+
+    char title[64];
+    snprintf(title, sizeof(title), "serialize_number, %u numbers", count);
+    const char *headers[] = {"Numbers", "Output", "ms/op", "MB/s"};
+    int col_widths[] = {28, 10, 12, 10};
+    print_test_table(title, headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
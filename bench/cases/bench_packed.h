@@ -0,0 +1,64 @@
+#ifndef BENCH_PACKED_H
+#define BENCH_PACKED_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+#include "bench_layout.h"
+
+// Live heap and parse time of numeric and boolean arrays with pack_arrays off and on.
+static inline void run_packed_bench(size_t max_bytes) {
+    const char* records[] = {
+        "[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16]",
+        "[0.25,1.5,-3.75,12.125,100.5,-0.5,7.75,2.5]",
+        "[true,false,true,true,false,true,false,false]",
+        "[[12.5,-3.25],[7.75,44.5],[0.125,9.5],[-1.5,2.25]]",
+    };
+    const char* kinds[] = { "integers", "doubles", "bools", "coordinates" };
+    size_t target = 1024 * 1024; // the generic bool parse rescans the input
+    if (target > max_bytes) target = max_bytes;
+    test_row_t rows[8];
+    size_t num_rows = 0;
+
+    for (size_t k = 0; k < 4; k++) {
+        // one list made of the repeated record's elements
+        size_t record_len = strlen(records[k]) - 2;
+        size_t count = target / (record_len + 1);
+        if (count == 0) count = 1;
+        char* text = (char*)malloc(count * (record_len + 1) + 2);
+        size_t len = 0;
+        text[len++] = '[';
+        for (size_t i = 0; i < count; i++) {
+            if (i > 0) text[len++] = ',';
+            memcpy(text + len, records[k] + 1, record_len);
+            len += record_len;
+        }
+        text[len++] = ']';
+
+        for (int pack = 0; pack <= 1; pack++) {
+            bench_peak_ctx_t peak = { 0, 0, 0 };
+            json_allocator alloc = { bench_peak_alloc, bench_peak_realloc, bench_peak_free, &peak };
+            json_parse_options options = { &alloc, pack ? TRUE : FALSE, FALSE, 0, NULL, 0 };
+            double start = bench_now();
+            json doc = deserialize_json_with_options(text, (cereal_size_t)len, &options);
+            double elapsed = bench_now() - start;
+            size_t values = doc.failure ? 0 : bench_count_values(&doc.root);
+            size_t live = peak.live;
+            json_free(&doc);
+
+            snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s, %s", kinds[k], pack ? "packed" : "generic");
+            bench_format_bytes(live, rows[num_rows].expected, sizeof(rows[num_rows].expected));
+            snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%.1f", values ? (double)live / (double)values : 0.0);
+            snprintf(rows[num_rows].status, sizeof(rows[num_rows].status), "%.1f MB/s", elapsed > 0 ? (double)len / BENCH_MB / elapsed : 0.0);
+            rows[num_rows].color = "\033[0;32m";
+            rows[num_rows].reset = "\033[0m";
+            num_rows++;
+        }
+        free(text);
+    }
+
+    const char *headers[] = {"Document", "Live heap", "B/value", "Parse"};
+    int col_widths[] = {24, 12, 10, 14};
+    print_test_table("Packed arrays", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef BENCH_PATCH_H
+#define BENCH_PATCH_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// Two versions of {"config":{...},"records":[...]} that differ in one record's
+// score. Finding the change: serializing both and comparing the text, json_diff
+// of two separately built trees, and json_diff of versions made with
+// json_share_set, which skips every container the versions still share.
+// Applying it: parsing the new version in full against json_patch_apply and
+// json_merge_patch on the old one.
+static inline void run_patch_bench(size_t max_bytes) {
+    const char* record = "{\"id\":12345,\"name\":\"user_12345\",\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}";
+    size_t target = 10 * 1024 * 1024;
+    if (target > max_bytes) target = max_bytes;
+    const int rounds = 5;
+    test_row_t rows[6];
+    size_t num_rows = 0;
+
+    json records = bench_make_records(record, target);
+    cereal_size_t count = json_list_count(&records.root);
+    const char* config = "{\"config\":{\"version\":0,\"mode\":\"fast\"}}";
+    json a = deserialize_json(config, strlen(config));
+    json_object_set(&a.root, "records", records.root, NULL);
+    json_set_null(&records.root);
+    json_free(&records);
+
+    char pointer[64];
+    snprintf(pointer, sizeof(pointer), "/records/%u/score", (unsigned)(count / 2));
+    json b = { .root = a.root, .error_text = NULL, .error_length = 0, .failure = FALSE, .allocator = NULL, .block = NULL };
+    json_object_copy(&b.root, &a.root, NULL);
+    json_set_number(json_pointer_get(&b.root, pointer), 99.0f);
+    char* b_text = serialize_json(&b);
+    size_t b_length = strlen(b_text);
+
+    bool_t ok = TRUE;
+    double start = bench_now();
+    for (int r = 0; r < rounds; r++) {
+        char* a_text = serialize_json(&a);
+        char* again = serialize_json(&b);
+        size_t at = 0;
+        while (a_text[at] && a_text[at] == again[at]) at++;
+        if (!a_text[at]) ok = FALSE;
+        free(a_text);
+        free(again);
+    }
+    double text_ms = (bench_now() - start) / rounds * 1000.0;
+
+    json patch = json_diff(&a.root, &b.root);
+    start = bench_now();
+    for (int r = 0; r < rounds; r++) {
+        json again = json_diff(&a.root, &b.root);
+        if (again.failure || json_list_count(&again.root) != 1) ok = FALSE;
+        json_free(&again);
+    }
+    double diff_ms = (bench_now() - start) / rounds * 1000.0;
+
+    // the same change between shared versions
+    json shared = b;
+    json_object_copy(&shared.root, &a.root, NULL);
+    json_share(&shared);
+    json_object next, value;
+    json_set_number(&value, 99.0f);
+    json_share_set(&next, &shared.root, pointer, &value, NULL);
+    start = bench_now();
+    for (int r = 0; r < rounds; r++) {
+        json again = json_diff(&shared.root, &next);
+        if (again.failure || json_list_count(&again.root) != 1) ok = FALSE;
+        json_free(&again);
+    }
+    double shared_ms = (bench_now() - start) / rounds * 1000.0;
+    json_object_free(&next);
+    json_free(&shared);
+
+    start = bench_now();
+    for (int r = 0; r < rounds; r++) {
+        json again = deserialize_json(b_text, (cereal_size_t)b_length);
+        if (again.failure) ok = FALSE;
+        json_free(&again);
+    }
+    double parse_ms = (bench_now() - start) / rounds * 1000.0;
+
+    // a and its changed value swap on every round, so each one applies a change
+    json revert = json_diff(&b.root, &a.root);
+    start = bench_now();
+    for (int r = 0; r < rounds * 100; r++) {
+        if (!json_patch_apply(&a, r % 2 == 0 ? &patch.root : &revert.root)) ok = FALSE;
+    }
+    double apply_ms = (bench_now() - start) / (rounds * 100) * 1000.0;
+
+    // records is a list, which a merge patch replaces whole, so these touch config
+    const char* merge_texts[2] = { "{\"config\":{\"version\":1,\"mode\":null}}", "{\"config\":{\"version\":0,\"mode\":\"fast\"}}" };
+    json merges[2];
+    for (int m = 0; m < 2; m++) merges[m] = deserialize_json(merge_texts[m], strlen(merge_texts[m]));
+    start = bench_now();
+    for (int r = 0; r < rounds * 100; r++) {
+        if (!json_merge_patch(&a, &merges[r % 2].root)) ok = FALSE;
+    }
+    double merge_ms = (bench_now() - start) / (rounds * 100) * 1000.0;
+
+    const char* tasks[6] = { "find change", "find change", "find change", "apply change", "apply change", "apply change" };
+    const char* methods[6] = { "text compare", "json_diff", "json_diff, shared", "parse new version", "json_patch_apply", "json_merge_patch" };
+    double times[6] = { text_ms, diff_ms, shared_ms, parse_ms, apply_ms, merge_ms };
+    for (int m = 0; m < 6; m++) {
+        snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s", tasks[m]);
+        snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%s", methods[m]);
+        snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%.4f", times[m]);
+        snprintf(rows[num_rows].status, sizeof(rows[num_rows].status), "%s", ok ? "ok" : "failed");
+        rows[num_rows].color = ok ? "\033[0;32m" : "\033[0;31m";
+        rows[num_rows].reset = "\033[0m";
+        num_rows++;
+    }
+    json_free(&merges[0]);
+    json_free(&merges[1]);
+    json_free(&revert);
+    json_free(&patch);
+    free(b_text);
+    json_free(&b);
+    json_free(&a);
+
+    const char *headers[] = {"Task", "Method", "ms", "Status"};
+    int col_widths[] = {22, 24, 12, 12};
+    print_test_table("Diff and patch", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
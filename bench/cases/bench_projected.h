@@ -0,0 +1,55 @@
+#ifndef BENCH_PROJECTED_H
+#define BENCH_PROJECTED_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// Reading two fields of {"meta":{...},"records":[...]}: the whole document
+// parsed and looked up with json_get_property, against a projection on the
+// two paths that checks and skips the records, and one allowed to stop once
+// both paths were found.
+static inline void run_projected_bench(size_t max_bytes) {
+    const char* record = "{\"id\":12345,\"name\":\"user_12345\",\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}";
+    size_t target = 10 * 1024 * 1024;
+    if (target > max_bytes) target = max_bytes;
+    const int rounds = 5;
+    test_row_t rows[3];
+    size_t num_rows = 0;
+
+    size_t count = target / (strlen(record) + 1);
+    if (count == 0) count = 1;
+    const char* head = "{\"meta\":{\"version\":3,\"source\":\"export\",\"count\":0},\"records\":[";
+    size_t length = strlen(head) + count * (strlen(record) + 1) + 2;
+    char* text = (char*)malloc(length + 1);
+    size_t at = 0;
+    at += (size_t)sprintf(text + at, "%s", head);
+    for (size_t r = 0; r < count; r++) at += (size_t)sprintf(text + at, "%s%s", r ? "," : "", record);
+    at += (size_t)sprintf(text + at, "]}");
+
+    const char* paths[2] = { "/meta/version", "/meta/source" };
+    const char* methods[3] = { "deserialize_json", "projected", "projected, stop early" };
+    for (int m = 0; m < 3; m++) {
+        size_t found = 0;
+        double start = bench_now();
+        for (int r = 0; r < rounds; r++) {
+            json doc = m == 0 ? deserialize_json(text, (cereal_size_t)at)
+                : deserialize_json_projected_with_options(text, (cereal_size_t)at, paths, 2, NULL, m == 2);
+            json_object meta = json_get_property(doc.root, "meta");
+            json_object version = json_get_property(meta, "version");
+            json_object source = json_get_property(meta, "source");
+            if (!doc.failure && json_typeof(&version) == JSON_NUMBER && json_typeof(&source) == JSON_STRING) found++;
+            json_free(&doc);
+        }
+        double seconds = (bench_now() - start) / rounds;
+        bench_fill_row(&rows[num_rows], methods[m], at, seconds);
+        if (found != (size_t)rounds) snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "failed");
+        num_rows++;
+    }
+    free(text);
+
+    const char *headers[] = {"Reading 2 fields", "Size", "ms", "MB/s"};
+    int col_widths[] = {22, 12, 12, 12};
+    print_test_table("Projected parse", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
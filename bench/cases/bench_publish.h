@@ -0,0 +1,118 @@
+#ifndef BENCH_PUBLISH_H
+#define BENCH_PUBLISH_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../../include/cerialize/publish.h"
+#include "../helpers/bench_utils.h"
+
+// Reader threads looking up one key of a live config while the calling thread
+// keeps replacing it: a mutex held around each lookup, a read-write lock, and
+// json_reader_enter/exit on a json_publisher. Replaced configs are freed on
+// the writer in every method.
+#define BENCH_PUBLISH_READERS 4
+#define BENCH_PUBLISH_READS 200000
+
+typedef struct {
+    int method; // 0 mutex, 1 rwlock, 2 publisher
+    pthread_mutex_t mutex;
+    pthread_rwlock_t rwlock;
+    json locked; // config behind the mutex or rwlock
+    json_publisher publisher;
+    int done; // readers finished
+} bench_publish_state;
+
+static inline json bench_publish_config(int version) {
+    char text[128];
+    snprintf(text, sizeof(text), "{\"version\":%d,\"limit\":100,\"mode\":\"fast\",\"hosts\":[\"a\",\"b\"]}", version);
+    return deserialize_json(text, (cereal_size_t)strlen(text));
+}
+
+static inline void* bench_publish_reader(void* arg) {
+    bench_publish_state* state = (bench_publish_state*)arg;
+    json_publish_reader reader = { NULL, NULL };
+    if (state->method == 2) json_publisher_register(&state->publisher, &reader);
+    size_t sum = 0;
+    for (int r = 0; r < BENCH_PUBLISH_READS; r++) {
+        if (state->method == 0) {
+            pthread_mutex_lock(&state->mutex);
+            json_object limit = json_get_property(state->locked.root, "limit");
+            sum += (size_t)json_number_value(&limit);
+            pthread_mutex_unlock(&state->mutex);
+        } else if (state->method == 1) {
+            pthread_rwlock_rdlock(&state->rwlock);
+            json_object limit = json_get_property(state->locked.root, "limit");
+            sum += (size_t)json_number_value(&limit);
+            pthread_rwlock_unlock(&state->rwlock);
+        } else {
+            const json* config = json_reader_enter(&reader);
+            json_object limit = json_get_property(config->root, "limit");
+            sum += (size_t)json_number_value(&limit);
+            json_reader_exit(&reader);
+        }
+    }
+    if (state->method == 2) json_publisher_unregister(&reader);
+    bench_sink += sum;
+    __atomic_add_fetch(&state->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static inline void run_publish_bench(size_t max_bytes) {
+    (void)max_bytes;
+    const char* methods[3] = { "mutex", "rwlock", "json_publisher" };
+    test_row_t rows[3];
+    size_t num_rows = 0;
+
+    for (int m = 0; m < 3; m++) {
+        bench_publish_state state;
+        memset(&state, 0, sizeof(state));
+        state.method = m;
+        pthread_mutex_init(&state.mutex, NULL);
+        pthread_rwlock_init(&state.rwlock, NULL);
+        json first = bench_publish_config(0);
+        if (m == 2) json_publisher_init(&state.publisher, &first);
+        else state.locked = first;
+
+        pthread_t ids[BENCH_PUBLISH_READERS];
+        double start = bench_now();
+        for (int t = 0; t < BENCH_PUBLISH_READERS; t++) pthread_create(&ids[t], NULL, bench_publish_reader, &state);
+        // the writer replaces the config until the readers are done
+        size_t reloads = 0;
+        while (__atomic_load_n(&state.done, __ATOMIC_ACQUIRE) < BENCH_PUBLISH_READERS) {
+            json next = bench_publish_config((int)++reloads);
+            if (m == 2) {
+                json_publish(&state.publisher, &next);
+            } else {
+                json old;
+                if (m == 0) pthread_mutex_lock(&state.mutex);
+                else pthread_rwlock_wrlock(&state.rwlock);
+                old = state.locked;
+                state.locked = next;
+                if (m == 0) pthread_mutex_unlock(&state.mutex);
+                else pthread_rwlock_unlock(&state.rwlock);
+                json_free(&old);
+            }
+            sched_yield();
+        }
+        for (int t = 0; t < BENCH_PUBLISH_READERS; t++) pthread_join(ids[t], NULL);
+        double elapsed = bench_now() - start;
+        if (m == 2) json_publisher_destroy(&state.publisher);
+        else json_free(&state.locked);
+        pthread_rwlock_destroy(&state.rwlock);
+        pthread_mutex_destroy(&state.mutex);
+
+        size_t reads = (size_t)BENCH_PUBLISH_READERS * BENCH_PUBLISH_READS;
+        snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s", methods[m]);
+        snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%zu", reloads);
+        snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%.1f", elapsed / (double)reads * 1e9);
+        snprintf(rows[num_rows].status, sizeof(rows[num_rows].status), "%.1f", (double)reads / elapsed / 1e6);
+        rows[num_rows].color = "\033[0;32m";
+        rows[num_rows].reset = "\033[0m";
+        num_rows++;
+    }
+
+    const char *headers[] = {"Readers use", "Reloads", "ns/read", "M reads/s"};
+    int col_widths[] = {22, 12, 12, 12};
+    print_test_table("Reads of a live config", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef BENCH_RAW_H
+#define BENCH_RAW_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// A proxy reading {"to":...,"id":...,"payload":[...]} and forwarding it: the
+// whole message parsed and serialized again, against the payload kept as a
+// JSON_RAW through raw_depth or raw_paths. Output is checked against the input,
+// which only a raw payload reproduces byte for byte.
+static inline void run_raw_bench(size_t max_bytes) {
+    const char* record = "{\"id\":12345,\"name\":\"user_12345\",\"score\":12.3456789,\"tags\":[\"alpha\",\"beta\"]}";
+    size_t target = 10 * 1024 * 1024;
+    if (target > max_bytes) target = max_bytes;
+    const int rounds = 5;
+    test_row_t rows[3];
+    size_t num_rows = 0;
+
+    // the message text, written by hand so it is not already in our output format
+    size_t count = target / (strlen(record) + 1);
+    if (count == 0) count = 1;
+    const char* head = "{\"to\":\"agent-7\",\"id\":42,\"payload\":[";
+    size_t length = strlen(head) + count * (strlen(record) + 1) + 2;
+    char* message = (char*)malloc(length + 1);
+    size_t at = 0;
+    at += (size_t)sprintf(message + at, "%s", head);
+    for (size_t r = 0; r < count; r++) at += (size_t)sprintf(message + at, "%s%s", r ? "," : "", record);
+    at += (size_t)sprintf(message + at, "]}");
+
+    const char* paths[1] = { "/payload" };
+    json_parse_options options[3] = {
+        { NULL, FALSE, FALSE, 0, NULL, 0 },
+        { NULL, FALSE, FALSE, 1, NULL, 0 },
+        { NULL, FALSE, FALSE, 0, paths, 1 },
+    };
+    const char* methods[3] = { "parse + serialize", "raw_depth 1", "raw_paths /payload" };
+    for (int m = 0; m < 3; m++) {
+        bool_t ok = TRUE, identical = TRUE;
+        double start = bench_now();
+        for (int r = 0; r < rounds; r++) {
+            json doc = deserialize_json_with_options(message, (cereal_size_t)at, &options[m]);
+            char* out = doc.failure ? NULL : serialize_json(&doc);
+            if (!out) ok = FALSE;
+            else if (strcmp(out, message) != 0) identical = FALSE;
+            free(out);
+            json_free(&doc);
+        }
+        double seconds = (bench_now() - start) / rounds;
+        bench_fill_row(&rows[num_rows], methods[m], at, seconds);
+        snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%s", !ok ? "failed" : identical ? "identical" : "rewritten");
+        num_rows++;
+    }
+    free(message);
+
+    const char *headers[] = {"Forwarding", "Output", "ms", "MB/s"};
+    int col_widths[] = {22, 12, 12, 12};
+    print_test_table("Raw passthrough", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef BENCH_RECLAIM_H
+#define BENCH_RECLAIM_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../../include/cerialize/reclaim.h"
+#include "../helpers/bench_utils.h"
+
+// Time the calling thread spends releasing documents: json_free on the caller
+// against handing them to a reclaimer thread with json_free_deferred_to.
+static inline void run_reclaim_bench(size_t max_bytes) {
+    const char* record = "{\"id\":12345,\"name\":\"user_12345\",\"active\":true,\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}";
+    size_t sizes[] = { 100 * 1024, 1024 * 1024, 10 * 1024 * 1024 };
+    size_t count = sizeof(sizes) / sizeof(sizes[0]);
+    const int documents = 8;
+    test_row_t rows[6];
+    size_t num_rows = 0;
+
+    for (size_t i = 0; i < count && sizes[i] <= max_bytes; i++) {
+        char size_label[16];
+        bench_format_bytes(sizes[i], size_label, sizeof(size_label));
+
+        for (int deferred = 0; deferred <= 1; deferred++) {
+            json_reclaimer reclaimer;
+            if (deferred && !json_reclaimer_start(&reclaimer, (size_t)documents, NULL)) continue;
+            double total = 0.0;
+            double worst = 0.0;
+            for (int d = 0; d < documents; d++) {
+                json doc = bench_make_records(record, sizes[i]);
+                double start = bench_now();
+                if (deferred) {
+                    json_free_deferred_to(&reclaimer, &doc);
+                } else {
+                    json_free(&doc);
+                }
+                double elapsed = bench_now() - start;
+                total += elapsed;
+                if (elapsed > worst) worst = elapsed;
+            }
+            if (deferred) json_reclaimer_stop(&reclaimer);
+
+            snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s %s", size_label,
+                deferred ? "json_free_deferred_to" : "json_free");
+            snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%d", documents);
+            snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%.3f", total / documents * 1000.0);
+            snprintf(rows[num_rows].status, sizeof(rows[num_rows].status), "%.3f", worst * 1000.0);
+            rows[num_rows].color = "\033[0;32m";
+            rows[num_rows].reset = "\033[0m";
+            num_rows++;
+        }
+    }
+
+    const char *headers[] = {"Operation", "Documents", "Avg ms", "Max ms"};
+    int col_widths[] = {32, 10, 12, 12};
+    print_test_table("Caller time to free", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
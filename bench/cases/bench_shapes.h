@@ -0,0 +1,74 @@
+#ifndef BENCH_SHAPES_H
+#define BENCH_SHAPES_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// Record arrays parsed with and without share_shapes: allocations, live heap,
+// parse throughput, and the time to read one field from every record.
+static inline void run_shapes_bench(size_t max_bytes) {
+    const char* records[] = {
+        "{\"id\":12345,\"name\":\"user_12345\",\"active\":true,\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}",
+        "{\"first_name\":\"Ada\",\"last_name\":\"Lovelace\",\"city\":\"London\",\"role\":\"analyst\",\"team\":\"engines\"}",
+        "{\"order\":1,\"customer\":{\"id\":7,\"region\":\"eu\"},\"total\":99.5,\"currency\":\"EUR\"}",
+    };
+    const char* kinds[] = { "records", "string records", "nested records" };
+    const char* fields[] = { "score", "city", "total" };
+    size_t target = 10 * 1024 * 1024;
+    if (target > max_bytes) target = max_bytes;
+    test_row_t rows[6];
+    size_t num_rows = 0;
+
+    for (size_t k = 0; k < 3; k++) {
+        size_t record_len = strlen(records[k]);
+        size_t count = target / (record_len + 1);
+        if (count == 0) count = 1;
+        char* text = (char*)malloc(count * (record_len + 1) + 2);
+        size_t len = 0;
+        text[len++] = '[';
+        for (size_t i = 0; i < count; i++) {
+            if (i > 0) text[len++] = ',';
+            memcpy(text + len, records[k], record_len);
+            len += record_len;
+        }
+        text[len++] = ']';
+
+        for (int shared = 0; shared <= 1; shared++) {
+            bench_peak_ctx_t peak = { 0, 0, 0 };
+            json_allocator alloc = { bench_peak_alloc, bench_peak_realloc, bench_peak_free, &peak };
+            json_parse_options options = { &alloc, FALSE, shared ? TRUE : FALSE, 0, NULL, 0 };
+            double start = bench_now();
+            json doc = deserialize_json_with_options(text, (cereal_size_t)len, &options);
+            double parse = bench_now() - start;
+
+            json_field field = json_field_init(fields[k]);
+            double sum = 0.0;
+            start = bench_now();
+            for (cereal_size_t r = 0; r < json_list_count(&doc.root); r++) {
+                const json_object* value = json_get_field(json_list_at(&doc.root, r), &field);
+                if (value) sum += (double)json_number_value(value);
+            }
+            double lookup = bench_now() - start;
+            bench_sink += (size_t)sum;
+            size_t live = peak.live;
+            size_t allocs = peak.allocs;
+            json_free(&doc);
+
+            snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s, %s", kinds[k], shared ? "shared" : "own keys");
+            snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%zu", allocs);
+            bench_format_bytes(live, rows[num_rows].result, sizeof(rows[num_rows].result));
+            snprintf(rows[num_rows].status, sizeof(rows[num_rows].status), "%.0f MB/s, %.2f ms",
+                parse > 0 ? (double)len / BENCH_MB / parse : 0.0, lookup * 1000.0);
+            rows[num_rows].color = "\033[0;32m";
+            rows[num_rows].reset = "\033[0m";
+            num_rows++;
+        }
+        free(text);
+    }
+
+    const char *headers[] = {"Document", "Allocations", "Live heap", "Parse, field scan"};
+    int col_widths[] = {28, 11, 10, 26};
+    print_test_table("Shape sharing", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef BENCH_SHARE_H
+#define BENCH_SHARE_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// Deriving a new version of {"config":{...},"records":[...]} that differs in
+// one value: a full json_clone_compact edited in place against
+// json_share_set, which copies only the containers on the path. A record's
+// field sits under the wide records list, whose items are copied too.
+static inline void run_share_bench(size_t max_bytes) {
+    // no literals, whose parse scans the rest of the input and would dominate building the tree
+    const char* record = "{\"id\":12345,\"name\":\"user_12345\",\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}";
+    size_t target = 10 * 1024 * 1024;
+    if (target > max_bytes) target = max_bytes;
+    const int updates = 20;
+    test_row_t rows[4];
+    size_t num_rows = 0;
+
+    json records = bench_make_records(record, target);
+    cereal_size_t count = json_list_count(&records.root);
+    const char* config = "{\"config\":{\"version\":0,\"mode\":\"fast\"}}";
+    json doc = deserialize_json(config, strlen(config));
+    json_object_set(&doc.root, "records", records.root, NULL);
+    json_set_null(&records.root);
+    json_free(&records);
+    json_share(&doc);
+
+    char middle[64];
+    snprintf(middle, sizeof(middle), "/records/%u/score", (unsigned)(count / 2));
+    const char* paths[2] = { "/config/version", middle };
+    for (int p = 0; p < 2; p++) {
+        // the clone is edited through the pointer, as the update would be
+        double start = bench_now();
+        bool_t ok = TRUE;
+        for (int u = 0; u < updates; u++) {
+            json_object* copy = json_clone_compact(&doc.root);
+            json_object* target_value = copy ? json_pointer_get(copy, paths[p]) : NULL;
+            if (target_value) json_set_number(target_value, (float)u);
+            else ok = FALSE;
+            free(copy);
+        }
+        double clone_ms = (bench_now() - start) / updates * 1000.0;
+
+        json_object current;
+        json_share_retain(&current, &doc.root, NULL);
+        start = bench_now();
+        for (int u = 0; u < updates; u++) {
+            json_object value, next;
+            json_set_number(&value, (float)u);
+            if (!json_share_set(&next, &current, paths[p], &value, NULL)) {
+                ok = FALSE;
+                break;
+            }
+            json_object_free(&current);
+            current = next;
+        }
+        double share_ms = (bench_now() - start) / updates * 1000.0;
+        json_object_free(&current);
+
+        const char* methods[2] = { "clone + edit", "json_share_set" };
+        double times[2] = { clone_ms, share_ms };
+        for (int m = 0; m < 2; m++) {
+            snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s", p == 0 ? "config field" : "record field");
+            snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%s", methods[m]);
+            snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%.4f", times[m]);
+            snprintf(rows[num_rows].status, sizeof(rows[num_rows].status), "%s", ok ? "ok" : "failed");
+            rows[num_rows].color = ok ? "\033[0;32m" : "\033[0;31m";
+            rows[num_rows].reset = "\033[0m";
+            num_rows++;
+        }
+    }
+    json_free(&doc);
+
+    const char *headers[] = {"Update", "Method", "ms/update", "Status"};
+    int col_widths[] = {22, 24, 12, 12};
+    print_test_table("Shared versions", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
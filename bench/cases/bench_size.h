@@ -0,0 +1,61 @@
+#ifndef BENCH_SIZE_H
+#define BENCH_SIZE_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// serialize_json against sizing once and serializing into a reused send buffer
+static inline void run_size_bench(size_t max_bytes) {
+    const char* record = "{\"id\":12345,\"name\":\"user_12345\",\"active\":true,\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}";
+    size_t sizes[] = { 1024, 100 * 1024, 10 * 1024 * 1024, 100 * 1024 * 1024 };
+    size_t count = sizeof(sizes) / sizeof(sizes[0]);
+    test_row_t rows[12];
+    size_t num_rows = 0;
+
+    for (size_t i = 0; i < count && sizes[i] <= max_bytes; i++) {
+        json doc = bench_make_records(record, sizes[i]);
+        int reps = sizes[i] >= 10 * 1024 * 1024 ? 1 : (int)(64 * 1024 * 1024 / sizes[i]);
+        if (reps > 1000) reps = 1000;
+        char size_label[16];
+        char label[64];
+        bench_format_bytes(sizes[i], size_label, sizeof(size_label));
+
+        size_t out_len = 0;
+        double start = bench_now();
+        for (int r = 0; r < reps; r++) {
+            char* out = serialize_json(&doc);
+            out_len = out ? strlen(out) : 0;
+            free(out);
+        }
+        double elapsed = (bench_now() - start) / reps;
+        snprintf(label, sizeof(label), "%s serialize_json", size_label);
+        bench_fill_row(&rows[num_rows++], label, out_len, elapsed);
+
+        size_t size = 0;
+        start = bench_now();
+        for (int r = 0; r < reps; r++) {
+            size = json_serialized_size(&doc);
+        }
+        elapsed = (bench_now() - start) / reps;
+        snprintf(label, sizeof(label), "%s json_serialized_size", size_label);
+        bench_fill_row(&rows[num_rows++], label, size, elapsed);
+
+        char* buffer = (char*)malloc(size);
+        start = bench_now();
+        for (int r = 0; r < reps; r++) {
+            bench_sink += serialize_json_into(&doc, buffer, size);
+        }
+        elapsed = (bench_now() - start) / reps;
+        snprintf(label, sizeof(label), "%s serialize_json_into", size_label);
+        bench_fill_row(&rows[num_rows++], label, size, elapsed);
+
+        free(buffer);
+        json_free(&doc);
+    }
+
+    const char *headers[] = {"Operation", "Output", "ms/op", "MB/s"};
+    int col_widths[] = {32, 10, 12, 10};
+    print_test_table("Pre-sized serialization", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef BENCH_SNAPSHOT_H
+#define BENCH_SNAPSHOT_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../../include/cerialize/snapshot.h"
+#include "../helpers/bench_utils.h"
+
+// Time until a document is readable: parsing its JSON text against mapping a
+// snapshot of it, then one keyed lookup in the middle record.
+static inline void run_snapshot_bench(size_t max_bytes) {
+    const char* records[] = {
+        // no literals, whose parse scans the rest of the input and would dominate the text load
+        "{\"id\":12345,\"name\":\"user_12345\",\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}",
+        "{\"first_name\":\"Ada\",\"last_name\":\"Lovelace\",\"city\":\"London\",\"role\":\"analyst\"}",
+    };
+    const char* kinds[] = { "records", "short strings" };
+    const char* keys[] = { "name", "city" };
+    size_t target = 10 * 1024 * 1024;
+    if (target > max_bytes) target = max_bytes;
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/cerialize_bench_%ld.snap", (long)getpid());
+    test_row_t rows[4];
+    size_t num_rows = 0;
+
+    for (size_t k = 0; k < 2; k++) {
+        json doc = bench_make_records(records[k], target);
+        char* text = serialize_json(&doc);
+        size_t text_size = text ? strlen(text) : 0;
+        bool_t written = json_snapshot_write(&doc, path);
+        json_free(&doc);
+
+        double start = bench_now();
+        json parsed = deserialize_json(text, (cereal_size_t)text_size);
+        double text_load = bench_now() - start;
+        start = bench_now();
+        cereal_size_t middle = json_list_count(&parsed.root) / 2;
+        json_object found = json_get_property(*json_list_at(&parsed.root, middle), keys[k]);
+        double text_lookup = bench_now() - start;
+
+        json_snapshot snap;
+        start = bench_now();
+        bool_t opened = written && json_snapshot_open(path, &snap);
+        double snap_load = bench_now() - start;
+        const json_snapshot_value* snap_found = NULL;
+        start = bench_now();
+        if (opened) {
+            const json_snapshot_value* root = json_snapshot_root(&snap);
+            const json_snapshot_value* record = json_snapshot_at(&snap, root, json_snapshot_count(root) / 2);
+            snap_found = json_snapshot_find(&snap, record, keys[k], strlen(keys[k]));
+        }
+        double snap_lookup = bench_now() - start;
+
+        const char* formats[2] = { "parse", "snapshot" };
+        size_t sizes[2] = { text_size, opened ? snap.size : 0 };
+        double load[2] = { text_load, snap_load };
+        double lookup[2] = { text_lookup, snap_lookup };
+        bool_t ok[2] = { !parsed.failure && json_typeof(&found) == JSON_STRING, snap_found != NULL };
+        for (int f = 0; f < 2; f++) {
+            snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s %s", kinds[k], formats[f]);
+            bench_format_bytes(sizes[f], rows[num_rows].expected, sizeof(rows[num_rows].expected));
+            snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%.3f", load[f] * 1000.0);
+            snprintf(rows[num_rows].status, sizeof(rows[num_rows].status), "%.4f", lookup[f] * 1000.0);
+            rows[num_rows].color = ok[f] ? "\033[0;32m" : "\033[0;31m";
+            rows[num_rows].reset = "\033[0m";
+            num_rows++;
+        }
+
+        if (opened) json_snapshot_close(&snap);
+        json_free(&parsed);
+        free(text);
+        remove(path);
+    }
+
+    const char *headers[] = {"Corpus", "Size", "Load ms", "Lookup ms"};
+    int col_widths[] = {28, 10, 12, 12};
+    print_test_table("Snapshot open vs parse", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
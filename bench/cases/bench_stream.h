@@ -0,0 +1,54 @@
+#ifndef BENCH_STREAM_H
+#define BENCH_STREAM_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+#include <fcntl.h>
+
+// serialize_json + write vs serialize_json_to_fd, both into /dev/null
+static inline void run_stream_bench(size_t max_bytes) {
+    const char* record = "{\"id\":12345,\"name\":\"user_12345\",\"active\":true,\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}";
+    size_t sizes[] = { 1024 * 1024, 10 * 1024 * 1024, 100 * 1024 * 1024 };
+    size_t count = sizeof(sizes) / sizeof(sizes[0]);
+    test_row_t rows[sizeof(sizes) / sizeof(sizes[0]) * 2];
+    size_t num_rows = 0;
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd < 0) return;
+
+    for (size_t i = 0; i < count && sizes[i] <= max_bytes; i++) {
+        json doc = bench_make_records(record, sizes[i]);
+        char name[32];
+        char label[64];
+        bench_peak_ctx_t peak = { 0, 0, 0 };
+        json_allocator alloc = { bench_peak_alloc, bench_peak_realloc, bench_peak_free, &peak };
+        doc.allocator = &alloc;
+
+        double start = bench_now();
+        char* out = serialize_json(&doc);
+        size_t out_len = out ? strlen(out) : 0;
+        if (out && write(fd, out, out_len) < 0) out_len = 0;
+        json_dealloc(&alloc, out);
+        double elapsed = bench_now() - start;
+        bench_format_bytes(peak.peak, name, sizeof(name));
+        snprintf(label, sizeof(label), "in-memory, peak %s", name);
+        bench_fill_row(&rows[num_rows++], label, out_len, elapsed);
+
+        peak.peak = 0;
+        start = bench_now();
+        serialize_json_to_fd(&doc, fd);
+        elapsed = bench_now() - start;
+        bench_format_bytes(peak.peak, name, sizeof(name));
+        snprintf(label, sizeof(label), "streamed, peak %s", name);
+        bench_fill_row(&rows[num_rows++], label, out_len, elapsed);
+
+        doc.allocator = NULL;
+        json_free(&doc);
+    }
+    close(fd);
+
+    const char *headers[] = {"Mode", "Output", "ms/op", "MB/s"};
+    int col_widths[] = {28, 10, 12, 10};
+    print_test_table("serialize_json vs serialize_json_to_fd", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
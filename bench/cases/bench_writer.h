@@ -0,0 +1,40 @@
+#ifndef BENCH_WRITER_H
+#define BENCH_WRITER_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/bench_utils.h"
+
+// serialize_json throughput for documents from 1 KB up to max_bytes
+static inline void run_writer_bench(size_t max_bytes) {
+    const char* record = "{\"id\":12345,\"name\":\"user_12345\",\"active\":true,\"score\":12.5,\"tags\":[\"alpha\",\"beta\"]}";
+    size_t sizes[] = { 1024, 10 * 1024, 100 * 1024, 1024 * 1024, 10 * 1024 * 1024, 100 * 1024 * 1024 };
+    size_t count = sizeof(sizes) / sizeof(sizes[0]);
+    test_row_t rows[sizeof(sizes) / sizeof(sizes[0])];
+    size_t num_rows = 0;
+
+    for (size_t i = 0; i < count && sizes[i] <= max_bytes; i++) {
+        json doc = bench_make_records(record, sizes[i]);
+        int reps = sizes[i] >= 10 * 1024 * 1024 ? 1 : (int)(64 * 1024 * 1024 / sizes[i]);
+        if (reps > 1000) reps = 1000;
+        size_t out_len = 0;
+
+        double start = bench_now();
+        for (int r = 0; r < reps; r++) {
+            char* out = serialize_json(&doc);
+            out_len = out ? strlen(out) : 0;
+            free(out);
+        }
+        double elapsed = (bench_now() - start) / reps;
+
+        char name[32];
+        bench_format_bytes(sizes[i], name, sizeof(name));
+        bench_fill_row(&rows[num_rows++], name, out_len, elapsed);
+        json_free(&doc);
+    }
+
+    const char *headers[] = {"Document", "Output", "ms/op", "MB/s"};
+    int col_widths[] = {12, 10, 12, 10};
+    print_test_table("serialize_json (json_writer)", headers, 4, col_widths, rows, num_rows);
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef BENCH_UTILS_H
+#define BENCH_UTILS_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+#include "../../test/helpers/test_output_helper.h"
+
+#define BENCH_MB (1024.0 * 1024.0)
+
+// results are stored here so the compiler cannot drop the measured work
+static volatile size_t bench_sink;
+
+static inline double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Human readable byte count, e.g. "1 KB", "100 MB"
+static inline void bench_format_bytes(size_t bytes, char* out, size_t out_size) {
+    if (bytes >= 1024 * 1024) {
+        snprintf(out, out_size, "%.0f MB", (double)bytes / BENCH_MB);
+    } else if (bytes >= 1024) {
+        snprintf(out, out_size, "%.0f KB", (double)bytes / 1024.0);
+    } else {
+        snprintf(out, out_size, "%zu B", bytes);
+    }
+}
+
+// Fill a 4-column row: name | bytes | milliseconds | MB/s
+static inline void bench_fill_row(test_row_t* row, const char* name, size_t bytes, double seconds) {
+    snprintf(row->input_display, sizeof(row->input_display), "%s", name);
+    bench_format_bytes(bytes, row->expected, sizeof(row->expected));
+    snprintf(row->result, sizeof(row->result), "%.3f", seconds * 1000.0);
+    snprintf(row->status, sizeof(row->status), "%.1f", seconds > 0 ? (double)bytes / BENCH_MB / seconds : 0.0);
+    row->color = "\033[0;32m";
+    row->reset = "\033[0m";
+}
+
+// Build a list of repeated records whose serialized size is roughly target_bytes
+static inline json bench_make_records(const char* record, size_t target_bytes) {
+    size_t record_len = strlen(record) + 1;
+    cereal_size_t count = (cereal_size_t)(target_bytes / record_len);
+    if (count == 0) count = 1;
+
+    json doc = { .failure = FALSE, .error_text = NULL };
+    json_set_list(&doc.root, (json_object*)malloc(sizeof(json_object) * count), count);
+    for (cereal_size_t i = 0; i < count; i++) {
+        json parsed = deserialize_json(record, strlen(record));
+        *json_list_at(&doc.root, i) = parsed.root;
+        free(parsed.error_text);
+    }
+    return doc;
+}
+
+// Allocator that prefixes each block with its size so peak live bytes can be tracked
+typedef struct {
+    size_t live;
+    size_t peak;
+    size_t allocs;
+} bench_peak_ctx_t;
+
+static inline void* bench_peak_alloc(void* ctx, size_t size) {
+    bench_peak_ctx_t* c = (bench_peak_ctx_t*)ctx;
+    size_t* block = (size_t*)malloc(size + sizeof(size_t));
+    if (!block) return NULL;
+    block[0] = size;
+    c->allocs++;
+    c->live += size;
+    if (c->live > c->peak) c->peak = c->live;
+    return block + 1;
+}
+
+static inline void* bench_peak_realloc(void* ctx, void* ptr, size_t size) {
+    bench_peak_ctx_t* c = (bench_peak_ctx_t*)ctx;
+    if (!ptr) return bench_peak_alloc(ctx, size);
+    size_t* block = (size_t*)ptr - 1;
+    size_t old = block[0];
+    block = (size_t*)realloc(block, size + sizeof(size_t));
+    if (!block) return NULL;
+    block[0] = size;
+    c->live = c->live - old + size;
+    if (c->live > c->peak) c->peak = c->live;
+    return block + 1;
+}
+
+static inline void bench_peak_free(void* ctx, void* ptr) {
+    if (!ptr) return;
+    size_t* block = (size_t*)ptr - 1;
+    ((bench_peak_ctx_t*)ctx)->live -= block[0];
+    free(block);
+}
+
+#endif
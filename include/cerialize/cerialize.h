@@ -4,7 +4,25 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <stddef.h>
 
+// vectorized scanning, define CERIALIZE_NO_SIMD to force the portable paths
+#if !defined(CERIALIZE_NO_SIMD) && defined(__GNUC__) && defined(__SSE2__)
+#define CERIALIZE_SSE2 1
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define CERIALIZE_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CERIALIZE_POSIX 1
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
 
 typedef unsigned int cereal_size_t;
 typedef unsigned int cereal_uint_t;
@@ -22,7 +40,8 @@ typedef enum json_type {
     JSON_NUMBER,
     JSON_BOOL,
     JSON_NULL,
-    JSON_LIST
+    JSON_LIST,
+    JSON_RAW // JSON text kept unparsed, see raw_depth in json_parse_options
 } json_type;
 
 typedef struct json_list {
@@ -35,6 +54,83 @@ typedef struct json_body {
     cereal_size_t node_count;
 } json_body;
 
+// element storage of a JSON_LIST. Packed lists keep raw values in one array
+// instead of a json_object per element, see json_list_packed.
+typedef enum json_packing {
+    JSON_PACKED_NONE,
+    JSON_PACKED_DOUBLE, // double[count]
+    JSON_PACKED_INT64,  // int64_t[count]
+    JSON_PACKED_BOOL    // bitset, element i is bit i % 8 of byte i / 8
+} json_packing;
+
+#define JSON_FLAG_SHAPED 2 // object values are in a json_shaped, keys in its shape
+
+// key sequence shared by every object that lists the same keys in the same
+// order, see share_shapes in json_parse_options. Keys live in the same block.
+typedef struct json_shape_key {
+    const char* text; // null terminated
+    size_t length;
+} json_shape_key;
+
+typedef struct json_shape {
+    cereal_size_t count;
+    cereal_size_t refs; // objects using the shape, plus the parser while it runs
+    uint64_t hash;
+    json_shape_key keys[];
+} json_shape;
+
+#ifdef CERIALIZE_COMPACT
+// compact layout, 16 bytes per value on 64 bit targets: a one byte tag, the
+// list/object count hoisted into the padding next to it, and an 8 byte payload.
+// Strings of up to JSON_INLINE_STRING_MAX bytes are stored in the value itself.
+// Lists, objects and strings are only reachable through the accessors below.
+typedef union json_value {
+        char* heap_string; // JSON_STRING without JSON_FLAG_INLINE
+        float number;
+        bool_t boolean;
+        bool_t is_null;
+        struct json_object* items; // JSON_LIST
+        struct json_node* nodes;   // JSON_OBJECT
+        struct json_shaped* shaped; // JSON_OBJECT with JSON_FLAG_SHAPED
+} json_value;
+
+#define JSON_FLAG_INLINE 1 // string bytes start at inline_head
+
+typedef struct json_object {
+    unsigned char type; // json_type
+    unsigned char flags; // JSON_FLAG_INLINE for strings, json_packing for lists, JSON_FLAG_SHAPED for objects
+    unsigned char inline_length; // inline strings; capacity code for lists and objects, see json_capacity_code
+    char inline_head; // inline strings continue over count and value
+    cereal_size_t count; // list items, object nodes or heap string length
+    json_value value;
+} json_object;
+
+#define JSON_INLINE_STRING_MAX (sizeof(json_object) - offsetof(json_object, inline_head) - 1)
+
+typedef char json_object_layout_check[sizeof(json_object) == 8 + sizeof(void*) ? 1 : -1];
+
+// object keys of up to JSON_INLINE_KEY_MAX bytes live in the pointer slot. The
+// byte that holds the low bits of a pointer is odd for inline keys, which never
+// happens for heap keys since allocations are at least 2 byte aligned.
+typedef union json_key {
+    char* heap;
+    unsigned char bytes[sizeof(char*)];
+} json_key;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define JSON_KEY_TAG (sizeof(char*) - 1)
+#define JSON_KEY_TEXT 0
+#else
+#define JSON_KEY_TAG 0
+#define JSON_KEY_TEXT 1
+#endif
+#define JSON_INLINE_KEY_MAX (sizeof(char*) - 2)
+
+typedef struct json_node {
+    json_key key;
+    json_object value;
+} json_node;
+#else
 typedef union json_value {
         char* string;
         float number;
@@ -42,11 +138,14 @@ typedef union json_value {
         bool_t is_null;
         json_list list; // pointer to json_list
         json_body object;
+        struct json_shaped* shaped; // shares the nodes slot, count stays in object
 } json_value; 
 
 // need to define json_object that tracks the type, and then moodify the lexer to return this
 typedef struct json_object {
     json_type type;
+    unsigned char flags; // json_packing for lists, JSON_FLAG_SHAPED for objects, sits in padding
+    unsigned char capacity; // lists and objects, see json_capacity_code, also in padding
     json_value value;
 } json_object;
 
@@ -54,20 +153,757 @@ typedef struct json_node {
     char* key;
     json_object value;
 } json_node;
+#endif
+
+// values of a shaped object, value i belongs to shape->keys[i]
+typedef struct json_shaped {
+    json_shape* shape;
+    json_object values[];
+} json_shaped;
+
+// accessors, the same code works with either layout
+static inline json_type json_typeof(const json_object* obj) {
+    return (json_type)obj->type;
+}
+
+static inline float json_number_value(const json_object* obj) {
+    return obj->value.number;
+}
+
+static inline bool_t json_bool_value(const json_object* obj) {
+    return obj->value.boolean;
+}
+
+#ifdef CERIALIZE_COMPACT
+// string contents and length, NULL for a string that was never set
+static inline const char* json_string_get(const json_object* obj, size_t* length) {
+    if (obj->flags & JSON_FLAG_INLINE) {
+        if (length) *length = obj->inline_length;
+        return (const char*)obj + offsetof(json_object, inline_head);
+    }
+    if (length) *length = obj->count;
+    return obj->value.heap_string;
+}
+
+// the heap block owned by a string value, NULL when it is stored inline
+static inline char* json_string_heap(const json_object* obj) {
+    return obj->flags & JSON_FLAG_INLINE ? NULL : obj->value.heap_string;
+}
+
+// take ownership of a null terminated heap string
+static inline void json_set_string(json_object* obj, char* string) {
+    obj->type = JSON_STRING;
+    obj->flags = 0;
+    obj->count = string ? (cereal_size_t)strlen(string) : 0;
+    obj->value.heap_string = string;
+}
+
+static inline cereal_size_t json_list_count(const json_object* obj) {
+    return obj->count;
+}
+
+static inline json_object* json_list_items(const json_object* obj) {
+    return obj->flags == JSON_PACKED_NONE ? obj->value.items : NULL;
+}
+
+static inline void* json_list_data(const json_object* obj) {
+    return obj->value.items;
+}
+
+static inline cereal_size_t json_node_count(const json_object* obj) {
+    return obj->count;
+}
+
+static inline json_node* json_nodes(const json_object* obj) {
+    return obj->flags & JSON_FLAG_SHAPED ? NULL : obj->value.nodes;
+}
+
+// 0 when a list or object holds exactly count elements, else log2(capacity) + 1
+static inline unsigned char json_capacity_code(const json_object* obj) {
+    return obj->inline_length;
+}
+
+static inline void json_set_capacity_code(json_object* obj, unsigned char code) {
+    obj->inline_length = code;
+}
+
+static inline void json_set_list(json_object* obj, json_object* items, cereal_size_t count) {
+    obj->type = JSON_LIST;
+    obj->flags = JSON_PACKED_NONE;
+    obj->inline_length = 0;
+    obj->count = count;
+    obj->value.items = items;
+}
+
+static inline void json_set_packed_list(json_object* obj, json_packing packing, void* data, cereal_size_t count) {
+    obj->type = JSON_LIST;
+    obj->flags = (unsigned char)packing;
+    obj->inline_length = 0;
+    obj->count = count;
+    obj->value.items = (json_object*)data;
+}
+
+static inline void json_set_object(json_object* obj, json_node* nodes, cereal_size_t count) {
+    obj->type = JSON_OBJECT;
+    obj->flags = 0;
+    obj->inline_length = 0;
+    obj->count = count;
+    obj->value.nodes = nodes;
+}
+
+// take ownership of shaped, its count comes from the shape
+static inline void json_set_shaped_object(json_object* obj, json_shaped* shaped) {
+    obj->type = JSON_OBJECT;
+    obj->flags = JSON_FLAG_SHAPED;
+    obj->inline_length = 0;
+    obj->count = shaped->shape->count;
+    obj->value.shaped = shaped;
+}
+
+static inline bool_t json_node_key_is_inline(const json_node* node) {
+    return (bool_t)(node->key.bytes[JSON_KEY_TAG] & 1);
+}
+
+// key contents and length, always null terminated
+static inline const char* json_node_key(const json_node* node, size_t* length) {
+    if (json_node_key_is_inline(node)) {
+        if (length) *length = node->key.bytes[JSON_KEY_TAG] >> 1;
+        return (const char*)&node->key.bytes[JSON_KEY_TEXT];
+    }
+    if (length) *length = node->key.heap ? strlen(node->key.heap) : 0;
+    return node->key.heap;
+}
+
+// the heap block owned by a key, NULL when it is stored inline
+static inline char* json_node_key_heap(const json_node* node) {
+    return json_node_key_is_inline(node) ? NULL : node->key.heap;
+}
+
+// take ownership of a null terminated heap key. FALSE, leaving node and key
+// untouched, for a key at an odd address, which would read as an inline key.
+static inline bool_t json_node_set_key(json_node* node, char* key) {
+    if ((uintptr_t)key & 1) return FALSE;
+    node->key.heap = key;
+    return TRUE;
+}
+#else
+static inline const char* json_string_get(const json_object* obj, size_t* length) {
+    if (length) *length = obj->value.string ? strlen(obj->value.string) : 0;
+    return obj->value.string;
+}
+
+static inline char* json_string_heap(const json_object* obj) {
+    return obj->value.string;
+}
+
+static inline void json_set_string(json_object* obj, char* string) {
+    obj->type = JSON_STRING;
+    obj->value.string = string;
+}
+
+static inline cereal_size_t json_list_count(const json_object* obj) {
+    return obj->value.list.count;
+}
+
+static inline json_object* json_list_items(const json_object* obj) {
+    return obj->flags == JSON_PACKED_NONE ? obj->value.list.items : NULL;
+}
+
+static inline void* json_list_data(const json_object* obj) {
+    return obj->value.list.items;
+}
+
+static inline cereal_size_t json_node_count(const json_object* obj) {
+    return obj->value.object.node_count;
+}
+
+static inline json_node* json_nodes(const json_object* obj) {
+    return obj->flags & JSON_FLAG_SHAPED ? NULL : obj->value.object.nodes;
+}
+
+// 0 when a list or object holds exactly count elements, else log2(capacity) + 1
+static inline unsigned char json_capacity_code(const json_object* obj) {
+    return obj->capacity;
+}
+
+static inline void json_set_capacity_code(json_object* obj, unsigned char code) {
+    obj->capacity = code;
+}
+
+static inline void json_set_list(json_object* obj, json_object* items, cereal_size_t count) {
+    obj->type = JSON_LIST;
+    obj->flags = JSON_PACKED_NONE;
+    obj->capacity = 0;
+    obj->value.list.count = count;
+    obj->value.list.items = items;
+}
+
+static inline void json_set_packed_list(json_object* obj, json_packing packing, void* data, cereal_size_t count) {
+    obj->type = JSON_LIST;
+    obj->flags = (unsigned char)packing;
+    obj->capacity = 0;
+    obj->value.list.count = count;
+    obj->value.list.items = (json_object*)data;
+}
+
+static inline void json_set_object(json_object* obj, json_node* nodes, cereal_size_t count) {
+    obj->type = JSON_OBJECT;
+    obj->flags = 0;
+    obj->capacity = 0;
+    obj->value.object.nodes = nodes;
+    obj->value.object.node_count = count;
+}
+
+// take ownership of shaped, its count comes from the shape
+static inline void json_set_shaped_object(json_object* obj, json_shaped* shaped) {
+    obj->type = JSON_OBJECT;
+    obj->flags = JSON_FLAG_SHAPED;
+    obj->capacity = 0;
+    obj->value.shaped = shaped;
+    obj->value.object.node_count = shaped->shape->count;
+}
+
+static inline const char* json_node_key(const json_node* node, size_t* length) {
+    if (length) *length = node->key ? strlen(node->key) : 0;
+    return node->key;
+}
+
+static inline char* json_node_key_heap(const json_node* node) {
+    return node->key;
+}
+
+static inline bool_t json_node_set_key(json_node* node, char* key) {
+    node->key = key;
+    return TRUE;
+}
+#endif
+
+// null terminated string contents, NULL for a string that was never set
+static inline const char* json_string_value(const json_object* obj) {
+    return json_string_get(obj, NULL);
+}
+
+// element pointer of an unpacked list, use json_list_get for any list
+static inline json_object* json_list_at(const json_object* obj, cereal_size_t index) {
+    json_object* items = json_list_items(obj);
+    return items ? &items[index] : NULL;
+}
+
+// Lists and objects made shareable by json_share keep this header in front of
+// their storage and JSON_CAPACITY_SHARED as their capacity code. They are read
+// only and freed when the last tree holding them lets go.
+#define JSON_CAPACITY_SHARED 0xFF
+
+typedef struct json_share_header {
+    size_t refs;
+    size_t reserved; // keeps the storage after it 16 byte aligned
+} json_share_header;
+
+static inline bool_t json_is_shared(const json_object* obj) {
+    return (obj->type == JSON_LIST || obj->type == JSON_OBJECT) && json_capacity_code(obj) == JSON_CAPACITY_SHARED;
+}
+
+// Lists and objects inside a json_clone_compact or json_compact block. Their
+// storage is part of the block, so they are read only as well.
+#define JSON_CAPACITY_BLOCK 0xFE
+
+// shared or in a compact block, refused by every mutation function
+static inline bool_t json_is_read_only(const json_object* obj) {
+    unsigned char code = json_capacity_code(obj);
+    return (obj->type == JSON_LIST || obj->type == JSON_OBJECT) && (code == JSON_CAPACITY_SHARED || code == JSON_CAPACITY_BLOCK);
+}
+
+// items, packed data, nodes or shaped block of a list or object
+static inline void* json_container_storage(const json_object* obj) {
+    if (obj->type == JSON_LIST) return json_list_data(obj);
+    return (obj->flags & JSON_FLAG_SHAPED) ? (void*)obj->value.shaped : (void*)json_nodes(obj);
+}
+
+// the allocation holding a container's storage
+static inline void* json_container_block(const json_object* obj, void* storage) {
+    return storage && json_is_shared(obj) ? (void*)((json_share_header*)storage - 1) : storage;
+}
+
+// shape of an object parsed with share_shapes, NULL for one with its own nodes
+static inline const json_shape* json_object_shape(const json_object* obj) {
+    return obj->type == JSON_OBJECT && (obj->flags & JSON_FLAG_SHAPED) ? obj->value.shaped->shape : NULL;
+}
+
+// key of member i of any object, shaped or not
+static inline const char* json_object_key_at(const json_object* obj, cereal_size_t index, size_t* length) {
+    if (obj->flags & JSON_FLAG_SHAPED) {
+        const json_shape_key* key = &obj->value.shaped->shape->keys[index];
+        if (length) *length = key->length;
+        return key->text;
+    }
+    return json_node_key(&json_nodes(obj)[index], length);
+}
+
+static inline json_object* json_object_value_at(const json_object* obj, cereal_size_t index) {
+    if (obj->flags & JSON_FLAG_SHAPED) return &obj->value.shaped->values[index];
+    return &json_nodes(obj)[index].value;
+}
+
+// index of key in shape, shape->count when it is not there
+static inline cereal_size_t json_shape_index(const json_shape* shape, const char* key, size_t length) {
+    for (cereal_size_t i = 0; i < shape->count; i++) {
+        if (shape->keys[i].length == length && memcmp(shape->keys[i].text, key, length) == 0) return i;
+    }
+    return shape->count;
+}
+
+// Field lookup with a one entry cache. The index found in one shaped object is
+// reused for every later object with the same shape, so reading a field from
+// each record of a list costs one pointer compare per record.
+typedef struct json_field {
+    const char* key;
+    size_t length;
+    const json_shape* shape; // shape the cached index belongs to
+    cereal_size_t index;
+} json_field;
+
+static inline json_field json_field_init(const char* key) {
+    json_field field = { key, strlen(key), NULL, 0 };
+    return field;
+}
+
+// value of field in obj, NULL when obj is not an object or lacks the key
+static inline json_object* json_get_field(const json_object* obj, json_field* field) {
+    if (obj->type != JSON_OBJECT) return NULL;
+    const json_shape* shape = json_object_shape(obj);
+    if (shape) {
+        if (shape != field->shape) {
+            field->shape = shape;
+            field->index = json_shape_index(shape, field->key, field->length);
+        }
+        return field->index < shape->count ? &obj->value.shaped->values[field->index] : NULL;
+    }
+    json_node* nodes = json_nodes(obj);
+    for (cereal_size_t i = 0; i < json_node_count(obj); i++) {
+        size_t len;
+        const char* key = json_node_key(&nodes[i], &len);
+        if (key && len == field->length && memcmp(key, field->key, len) == 0) return &nodes[i].value;
+    }
+    return NULL;
+}
+
+static inline json_packing json_list_packing(const json_object* obj) {
+    return obj->type == JSON_LIST ? (json_packing)obj->flags : JSON_PACKED_NONE;
+}
+
+// raw view of a packed list, data can be copied as is with memcpy(dst, data, size)
+typedef struct json_packed_view {
+    json_packing packing;
+    cereal_size_t count;
+    const void* data;
+    size_t size; // bytes
+} json_packed_view;
+
+static inline size_t json_packed_size(json_packing packing, cereal_size_t count) {
+    switch (packing) {
+        case JSON_PACKED_DOUBLE: return (size_t)count * sizeof(double);
+        case JSON_PACKED_INT64: return (size_t)count * sizeof(int64_t);
+        case JSON_PACKED_BOOL: return ((size_t)count + 7) / 8;
+        default: return 0;
+    }
+}
+
+static inline json_packed_view json_list_packed(const json_object* obj) {
+    json_packed_view view = { JSON_PACKED_NONE, 0, NULL, 0 };
+    view.packing = json_list_packing(obj);
+    if (view.packing == JSON_PACKED_NONE) return view;
+    view.count = json_list_count(obj);
+    view.data = json_list_data(obj);
+    view.size = json_packed_size(view.packing, view.count);
+    return view;
+}
+
+static inline const double* json_list_doubles(const json_object* obj) {
+    return json_list_packing(obj) == JSON_PACKED_DOUBLE ? (const double*)json_list_data(obj) : NULL;
+}
+
+static inline const int64_t* json_list_int64s(const json_object* obj) {
+    return json_list_packing(obj) == JSON_PACKED_INT64 ? (const int64_t*)json_list_data(obj) : NULL;
+}
+
+static inline bool_t json_packed_bit(const void* bits, cereal_size_t index) {
+    return (bool_t)((((const unsigned char*)bits)[index >> 3] >> (index & 7)) & 1);
+}
+
+static inline void json_set_number(json_object* obj, float number) {
+    obj->type = JSON_NUMBER;
+    obj->value.number = number;
+}
+
+static inline void json_set_bool(json_object* obj, bool_t value) {
+    obj->type = JSON_BOOL;
+    obj->value.boolean = value;
+}
+
+static inline void json_set_null(json_object* obj) {
+    obj->type = JSON_NULL;
+    obj->value.is_null = TRUE;
+}
+
+// element of any list by value, packed elements come back as numbers or bools
+static inline json_object json_list_get(const json_object* obj, cereal_size_t index) {
+    json_object item = { .type = JSON_NULL };
+    const void* data = json_list_data(obj);
+    switch (json_list_packing(obj)) {
+        case JSON_PACKED_DOUBLE:
+            json_set_number(&item, (float)((const double*)data)[index]);
+            return item;
+        case JSON_PACKED_INT64:
+            json_set_number(&item, (float)((const int64_t*)data)[index]);
+            return item;
+        case JSON_PACKED_BOOL:
+            json_set_bool(&item, json_packed_bit(data, index));
+            return item;
+        default:
+            return *json_list_at(obj, index);
+    }
+}
+
+// allocator hooks, every allocation made by cerialize goes through one of these.
+// ctx is handed back to each function so allocations can be attributed per caller.
+// Blocks must be at least 2 byte aligned: the compact layout tells inline keys
+// from heap keys by the low pointer bit, and refuses a key at an odd address,
+// so a byte granular arena makes parses with long keys fail.
+typedef struct json_allocator {
+    void* (*alloc_fn)(void* ctx, size_t size);
+    void* (*realloc_fn)(void* ctx, void* ptr, size_t size);
+    void (*free_fn)(void* ctx, void* ptr);
+    void* ctx;
+} json_allocator;
 
 typedef struct {
     json_object root;
     char* error_text;
     cereal_size_t error_length;
     bool_t failure;
+    const json_allocator* allocator; // NULL means libc malloc/realloc/free
+    void* block; // set by json_compact, the tree lives in this one allocation
 } json;
 
+typedef struct json_parse_options {
+    const json_allocator* allocator; // NULL means libc malloc/realloc/free
+    bool_t pack_arrays; // store all-number and all-bool lists packed, see json_packing
+    bool_t share_shapes; // objects with the same key sequence share one json_shape
+    // Values kept as JSON_RAW: checked but not built, and written back byte for
+    // byte. raw_depth keeps every list and object nested that deep, 1 being the
+    // root's children; 0 keeps none. raw_paths are JSON Pointers whose values
+    // are kept whatever their type.
+    cereal_size_t raw_depth;
+    const char* const* raw_paths;
+    cereal_size_t raw_path_count;
+} json_parse_options;
+
+// one chunk of output handed to a json_writev_fn
+typedef struct json_iovec {
+    const char* data;
+    size_t length;
+} json_iovec;
+
+// output sinks, both return TRUE when every byte was written
+typedef bool_t (*json_write_fn)(void* user, const char* data, size_t length);
+typedef bool_t (*json_writev_fn)(void* user, const json_iovec* chunks, int count);
+
+#define JSON_WRITER_MAX_DEPTH 64
+
+// output buffer used by the serializer. Without a sink it grows geometrically
+// and becomes the result, with a sink it stays at JSON_WRITER_FLUSH_SIZE and is
+// flushed whenever it fills up.
+typedef struct json_writer {
+    char* data;
+    size_t length;
+    size_t capacity;
+    const json_allocator* allocator;
+    bool_t failure;
+    json_write_fn sink;
+    json_writev_fn sink_v; // optional, batches the buffer with large chunks
+    void* sink_user;
+    bool_t fixed; // data is a caller owned buffer that never grows or gets freed
+    // nesting state for the json_w_* builder calls, scopes[0] is the top level
+    cereal_size_t depth;
+    unsigned char scopes[JSON_WRITER_MAX_DEPTH + 1];
+} json_writer;
+
 static inline char* serialize_json(const json* j);
+static inline char* serialize_json_with_allocator(const json* j, const json_allocator* alloc);
+static inline bool_t serialize_json_to(const json* j, json_write_fn write_fn, void* user);
+static inline bool_t serialize_json_to_sink(const json* j, json_write_fn write_fn, json_writev_fn writev_fn, void* user);
+static inline bool_t serialize_json_to_file(const json* j, FILE* file);
+static inline size_t json_serialized_size(const json* j);
+static inline size_t serialize_json_into(const json* j, char* buffer, size_t capacity);
+static inline size_t json_minify(const char* input, size_t length, char* output);
+static inline size_t json_minify_inplace(char* buffer, size_t length);
+static inline bool_t json_prettify(const char* input, size_t length, cereal_size_t indent, json_writer* output);
+#ifdef CERIALIZE_POSIX
+static inline bool_t serialize_json_to_fd(const json* j, int fd);
+#endif
 static inline json deserialize_json(const char* json_string, cereal_size_t length);
+static inline json deserialize_json_with_allocator(const char* json_string, cereal_size_t length, const json_allocator* alloc);
+static inline json deserialize_json_with_options(const char* json_string, cereal_size_t length, const json_parse_options* options);
+static inline json deserialize_json_projected(const char* json_string, cereal_size_t length, const char* const* paths, cereal_size_t path_count);
+static inline json deserialize_json_projected_with_options(const char* json_string, cereal_size_t length, const char* const* paths, cereal_size_t path_count, const json_parse_options* options, bool_t stop_early);
 
 // Memory management functions
 static inline void json_free(json* j);
 static inline void json_object_free(json_object* obj);
+static inline void json_object_free_with_allocator(json_object* obj, const json_allocator* alloc);
+
+static inline void* json_default_alloc(void* ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static inline void* json_default_realloc(void* ctx, void* ptr, size_t size) {
+    (void)ctx;
+    return realloc(ptr, size);
+}
+
+static inline void json_default_free(void* ctx, void* ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+// libc backed allocator, used whenever a NULL allocator is passed
+static inline const json_allocator* json_default_allocator(void) {
+    static const json_allocator default_allocator = {
+        json_default_alloc,
+        json_default_realloc,
+        json_default_free,
+        NULL
+    };
+    return &default_allocator;
+}
+
+static inline void* json_alloc(const json_allocator* alloc, size_t size) {
+    if (!alloc) return malloc(size);
+    return alloc->alloc_fn(alloc->ctx, size);
+}
+
+static inline void* json_realloc(const json_allocator* alloc, void* ptr, size_t size) {
+    if (!alloc) return realloc(ptr, size);
+    return alloc->realloc_fn(alloc->ctx, ptr, size);
+}
+
+static inline void json_dealloc(const json_allocator* alloc, void* ptr) {
+    if (!ptr) return;
+    if (!alloc) {
+        free(ptr);
+        return;
+    }
+    alloc->free_fn(alloc->ctx, ptr);
+}
+
+// reference counts that may be dropped from several threads at once, see json_share
+#if defined(__GNUC__)
+#define JSON_REF_INC(ref) __atomic_add_fetch(&(ref), 1, __ATOMIC_RELAXED)
+#define JSON_REF_DEC(ref) __atomic_sub_fetch(&(ref), 1, __ATOMIC_ACQ_REL)
+#else
+#define JSON_REF_INC(ref) (++(ref))
+#define JSON_REF_DEC(ref) (--(ref))
+#endif
+
+// drop one reference, the last one frees the shape and its keys
+static inline void json_shape_release(json_shape* shape, const json_allocator* alloc) {
+    if (shape && JSON_REF_DEC(shape->refs) == 0) {
+        json_dealloc(alloc, shape);
+    }
+}
+
+// copy len bytes of str into obj, stored inline when the layout allows it
+static inline bool_t json_set_string_copy(json_object* obj, const char* str, size_t len, const json_allocator* alloc) {
+#ifdef CERIALIZE_COMPACT
+    if (len <= JSON_INLINE_STRING_MAX) {
+        char* text = (char*)obj + offsetof(json_object, inline_head);
+        obj->type = JSON_STRING;
+        obj->flags = JSON_FLAG_INLINE;
+        obj->inline_length = (unsigned char)len;
+        memcpy(text, str, len);
+        text[len] = '\0';
+        return TRUE;
+    }
+#endif
+    char* copy = (char*)json_alloc(alloc, len + 1);
+    if (copy == NULL) return FALSE;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    json_set_string(obj, copy);
+    return TRUE;
+}
+
+// Raw values hold the text of one JSON value and are stored like strings. The
+// serializer writes the bytes back unchanged, so they must be valid JSON.
+static inline bool_t json_set_raw_copy(json_object* obj, const char* text, size_t len, const json_allocator* alloc) {
+    if (!json_set_string_copy(obj, text, len, alloc)) return FALSE;
+    obj->type = JSON_RAW;
+    return TRUE;
+}
+
+// text and length of a raw value
+static inline const char* json_raw_get(const json_object* obj, size_t* length) {
+    return json_string_get(obj, length);
+}
+
+// copy len bytes of key into node, stored inline when the layout allows it
+static inline bool_t json_node_set_key_copy(json_node* node, const char* key, size_t len, const json_allocator* alloc) {
+#ifdef CERIALIZE_COMPACT
+    if (len <= JSON_INLINE_KEY_MAX) {
+        memset(node->key.bytes, 0, sizeof(node->key.bytes));
+        node->key.bytes[JSON_KEY_TAG] = (unsigned char)((len << 1) | 1);
+        memcpy(&node->key.bytes[JSON_KEY_TEXT], key, len);
+        return TRUE;
+    }
+#endif
+    char* copy = (char*)json_alloc(alloc, len + 1);
+    if (copy == NULL) return FALSE;
+    memcpy(copy, key, len);
+    copy[len] = '\0';
+    if (!json_node_set_key(node, copy)) {
+        json_dealloc(alloc, copy);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Escapes. String bodies stay as they appear in the input while parsing and
+// are decoded when a value or key is stored, so the tree holds the text itself
+// and the serializer escapes it again on the way out.
+
+// value of the four hex digits at p, -1 when one is not a hex digit
+static inline long json_hex4(const char* p) {
+    long value = 0;
+    for (int k = 0; k < 4; k++) {
+        char c = p[k];
+        int digit = c >= '0' && c <= '9' ? c - '0' : (c >= 'a' && c <= 'f' ? c - 'a' + 10 : (c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1));
+        if (digit < 0) return -1;
+        value = value * 16 + digit;
+    }
+    return value;
+}
+
+// input bytes taken by the escape at s, a backslash followed by avail - 1
+// bytes, or 0 when it is not valid. \u0000 is refused since strings are null
+// terminated, and surrogates must come in pairs.
+static inline size_t json_escape_length(const char* s, size_t avail) {
+    if (avail < 2) return 0;
+    switch (s[1]) {
+        case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+            return 2;
+        case 'u':
+            break;
+        default:
+            return 0;
+    }
+    long cp = avail >= 6 ? json_hex4(s + 2) : -1;
+    if (cp <= 0 || (cp >= 0xDC00 && cp <= 0xDFFF)) return 0;
+    if (cp < 0xD800 || cp > 0xDBFF) return 6;
+    if (avail < 12 || s[6] != '\\' || s[7] != 'u') return 0;
+    long low = json_hex4(s + 8);
+    return low >= 0xDC00 && low <= 0xDFFF ? 12 : 0;
+}
+
+static inline size_t json_utf8_encode(unsigned long cp, char* out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// decode the escape at body[*pos], already checked by json_escape_length, into
+// out as UTF-8 and step past it; returns the 1 to 4 bytes written
+static inline size_t json_unescape_at(const char* body, size_t* pos, char* out) {
+    char c = body[*pos + 1];
+    *pos += 2;
+    switch (c) {
+        case 'b': *out = '\b'; return 1;
+        case 'f': *out = '\f'; return 1;
+        case 'n': *out = '\n'; return 1;
+        case 'r': *out = '\r'; return 1;
+        case 't': *out = '\t'; return 1;
+        case 'u': break;
+        default: *out = c; return 1;
+    }
+    unsigned long cp = (unsigned long)json_hex4(body + *pos);
+    *pos += 4;
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        cp = 0x10000 + ((cp - 0xD800) << 10) + ((unsigned long)json_hex4(body + *pos + 2) - 0xDC00);
+        *pos += 6;
+    }
+    return json_utf8_encode(cp, out);
+}
+
+// decode a string body checked by json_scan_string into out, which needs len
+// bytes; returns the decoded length, never more than len
+static inline size_t json_unescape(const char* body, size_t len, char* out) {
+    size_t n = 0;
+    size_t pos = 0;
+    while (pos < len) {
+        const char* slash = (const char*)memchr(body + pos, '\\', len - pos);
+        size_t run = slash ? (size_t)(slash - (body + pos)) : len - pos;
+        memcpy(out + n, body + pos, run);
+        n += run;
+        pos += run;
+        if (pos < len) n += json_unescape_at(body, &pos, out + n);
+    }
+    return n;
+}
+
+// decoded text equals text[0, text_len)
+static inline bool_t json_unescaped_equal(const char* text, size_t text_len, const char* body, size_t len) {
+    if (!memchr(body, '\\', len)) return text_len == len && memcmp(text, body, len) == 0;
+    size_t at = 0;
+    size_t pos = 0;
+    while (pos < len) {
+        char decoded[4];
+        size_t n = 1;
+        if (body[pos] == '\\') n = json_unescape_at(body, &pos, decoded);
+        else decoded[0] = body[pos++];
+        if (at + n > text_len || memcmp(text + at, decoded, n) != 0) return FALSE;
+        at += n;
+    }
+    return at == text_len;
+}
+
+// json_set_string_copy of a string body with its escapes decoded
+static inline bool_t json_set_string_unescaped(json_object* obj, const char* body, size_t len, const json_allocator* alloc) {
+    if (!memchr(body, '\\', len)) return json_set_string_copy(obj, body, len, alloc);
+    char local[64];
+    char* text = len < sizeof(local) ? local : (char*)json_alloc(alloc, len);
+    if (text == NULL) return FALSE;
+    bool_t ok = json_set_string_copy(obj, text, json_unescape(body, len, text), alloc);
+    if (text != local) json_dealloc(alloc, text);
+    return ok;
+}
+
+// json_node_set_key_copy of a key body with its escapes decoded
+static inline bool_t json_node_set_key_unescaped(json_node* node, const char* body, size_t len, const json_allocator* alloc) {
+    if (!memchr(body, '\\', len)) return json_node_set_key_copy(node, body, len, alloc);
+    char local[64];
+    char* text = len < sizeof(local) ? local : (char*)json_alloc(alloc, len);
+    if (text == NULL) return FALSE;
+    bool_t ok = json_node_set_key_copy(node, text, json_unescape(body, len, text), alloc);
+    if (text != local) json_dealloc(alloc, text);
+    return ok;
+}
 
 #define JSON_MAX_ERROR_LENGTH 512
 
@@ -106,24 +942,26 @@ static inline void skip_whitespace(const char* json_string, cereal_size_t length
     }
 }
 
-// string     : array of lex tokens representing string
-// length     : length of string given
-// i          : current parser index
-// failure    : track whether parsing failed
-// error_text : error text to append to if the parsing fails
-// TODO: add parameter to store key length, maybe return a struct that gives this?  not sure.
-static inline char* json_parse_string(const char* json_string, cereal_size_t length, cereal_uint_t* i, bool_t* failure, char* error_text) {
+// validate the string token at *i and step past it
+// json_string : text being parsed
+// length      : length of json_string
+// i           : current parser index, left after the closing quote
+// failure     : track whether parsing failed
+// error_text  : error text to append to if the parsing fails
+// start       : index of the first byte of the contents
+// str_size    : length of the contents, escapes still encoded
+static inline bool_t json_scan_string(const char* json_string, cereal_size_t length, cereal_uint_t* i, bool_t* failure, char* error_text, cereal_uint_t* start, cereal_size_t* str_size) {
 
     // opening "'"
     if (json_string[*i] != LEX_QUOTE) {
         strcat(error_text, "cerialize ERROR: Expected quote to open JSON string.\n");
         *failure = TRUE;
-        return NULL;
+        return FALSE;
     }
     (*i)++;
 
-    // find length of string so we allocate the proper size
-    cereal_size_t str_size = 0;
+    // find length of string so we allocate the proper size, escapes included
+    *str_size = 0;
     bool_t found_end = FALSE;
     bool_t found_newline = FALSE;
     cereal_uint_t j = *i;
@@ -131,48 +969,71 @@ static inline char* json_parse_string(const char* json_string, cereal_size_t len
         if (j >= length) {
             strcat(error_text, "cerialize ERROR: Expecting closing quote to close JSON string.\n");
             *failure = TRUE;
-            return NULL;
+            return FALSE;
         }
         if (json_string[j] == '\n' || json_string[j] == '\r') {
             found_newline = TRUE;
             break;
         }
-        if (json_string[j] == LEX_QUOTE) {
+        if (json_string[j] == '\\') {
+            size_t escape = json_escape_length(json_string + j, length - j);
+            if (escape == 0) {
+                strcat(error_text, "cerialize ERROR: Invalid escape in JSON string.\n");
+                *failure = TRUE;
+                return FALSE;
+            }
+            *str_size += escape;
+            j += escape;
+        } else if (json_string[j] == LEX_QUOTE) {
             found_end = TRUE;
         } else {
-            str_size++;
+            (*str_size)++;
+            j++;
         }
-    } while(!found_end && j++ < length);
+    } while (!found_end);
 
     // Reject empty string
-    if (str_size == 0) {
+    if (*str_size == 0) {
         strcat(error_text, "cerialize ERROR: Empty string not allowed.\n");
         *failure = TRUE;
-        return NULL;
+        return FALSE;
     }
     // Reject string with newline inside
     if (found_newline) {
         strcat(error_text, "cerialize ERROR: Newline in string not allowed.\n");
         *failure = TRUE;
-        return NULL;
+        return FALSE;
     }
 
-    char* str = (char*)malloc(str_size + 1);  // +1 for null terminator
-    for (cereal_uint_t j = 0; j < str_size; j++) {
-        str[j] = json_string[*i];
-        (*i)++;
-    }
-    str[str_size] = '\0';  // Add null terminator
+    *start = *i;
+    *i += *str_size;
 
     // closing "'"
     if (json_string[*i] != LEX_QUOTE) {
         strcat(error_text, "cerialize ERROR: Expected closing quote to close JSON string.\n");
         *failure = TRUE;
-        return NULL;
+        return FALSE;
     }
     (*i)++;
 
-    return str;
+    return TRUE;
+}
+
+static inline char* json_parse_string(const char* json_string, cereal_size_t length, cereal_uint_t* i, bool_t* failure, char* error_text, const json_allocator* alloc) {
+    cereal_uint_t start;
+    cereal_size_t str_size;
+    if (!json_scan_string(json_string, length, i, failure, error_text, &start, &str_size)) {
+        return NULL;
+    }
+
+    char* str = (char*)json_alloc(alloc, str_size + 1);  // +1 for null terminator
+    if (str == NULL) {
+        strcat(error_text, "cerialize ERROR: Failed to allocate memory for JSON string.\n");
+        *failure = TRUE;
+        return NULL;
+    }
+    str[json_unescape(json_string + start, str_size, str)] = '\0';  // Add null terminator
+    return str;
 }
 
 static inline bool_t json_parse_null(const char* json_string, cereal_uint_t* i, bool_t* failure, char* error_text) {
@@ -202,7 +1063,8 @@ static inline bool_t json_parse_null(const char* json_string, cereal_uint_t* i,
     }
 }
 
-static inline float json_parse_number(const char* json_string, cereal_size_t length, cereal_uint_t* i, bool_t* failure, char* error_text) {
+// validate the number token at *i and step past it
+static inline bool_t json_scan_number(const char* json_string, cereal_size_t length, cereal_uint_t* i, bool_t* failure, char* error_text) {
     // check for valid number format
     cereal_uint_t start = *i;
     // Accept optional sign at the start
@@ -212,7 +1074,7 @@ static inline float json_parse_number(const char* json_string, cereal_size_t len
         if (*i < length && (json_string[*i] == '-' || json_string[*i] == '+')) {
             strcat(error_text, "cerialize ERROR: Multiple consecutive signs in number.\n");
             *failure = TRUE;
-            return 0.0f;
+            return FALSE;
         }
     }
     bool_t found_digit = 0;
@@ -229,7 +1091,7 @@ static inline float json_parse_number(const char* json_string, cereal_size_t len
             if (period_count > 1) {
                 strcat(error_text, "cerialize ERROR: Multiple decimal points in number.\n");
                 *failure = TRUE;
-                return 0.0f;
+                return FALSE;
             }
         }
         if (json_string[*i] == 'e' || json_string[*i] == 'E') {
@@ -239,7 +1101,7 @@ static inline float json_parse_number(const char* json_string, cereal_size_t len
             if (e_count > 1) {
                 strcat(error_text, "cerialize ERROR: Multiple exponents in number.\n");
                 *failure = TRUE;
-                return 0.0f;
+                return FALSE;
             }
         }
         // If after 'e', next must be digit or sign
@@ -247,7 +1109,7 @@ static inline float json_parse_number(const char* json_string, cereal_size_t len
             if (!(is_number(json_string[*i]) || json_string[*i] == '-' || json_string[*i] == '+')) {
                 strcat(error_text, "cerialize ERROR: Invalid exponent format in number.\n");
                 *failure = TRUE;
-                return 0.0f;
+                return FALSE;
             }
             after_e = FALSE;
         }
@@ -257,12 +1119,20 @@ static inline float json_parse_number(const char* json_string, cereal_size_t len
     if (!found_digit) {
         strcat(error_text, "cerialize ERROR: Expected number.\n");
         *failure = TRUE;
-        return 0.0f;
+        return FALSE;
     }
     // If last char was 'e' or 'E', fail (incomplete exponent)
     if (*i > start && (json_string[*i-1] == 'e' || json_string[*i-1] == 'E')) {
         strcat(error_text, "cerialize ERROR: Incomplete exponent in number.\n");
         *failure = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static inline float json_parse_number(const char* json_string, cereal_size_t length, cereal_uint_t* i, bool_t* failure, char* error_text) {
+    cereal_uint_t start = *i;
+    if (!json_scan_number(json_string, length, i, failure, error_text)) {
         return 0.0f;
     }
     // extract number substring 
@@ -327,20 +1197,613 @@ static inline bool_t json_parse_boolean(const char* json_string, cereal_uint_t*
     }
 }
 
-static inline json_object parse_json_object(const char* json_string, cereal_size_t length, cereal_uint_t* i, char* error_text, bool_t* failure);
+#define JSON_SKIP_MAX_DEPTH 1024
+
+// Check the value at *i and step past it without building anything or
+// allocating: strings, numbers and literals follow the parser's own rules,
+// containers are matched with a bit per nesting level.
+static inline bool_t json_skip_value(const char* json_string, cereal_size_t length, cereal_uint_t* i, bool_t* failure, char* error_text) {
+    unsigned char objects[JSON_SKIP_MAX_DEPTH / 8]; // bit set when the level is an object
+    size_t depth = 0;
+    cereal_uint_t start;
+    cereal_size_t size;
+    for (;;) {
+        // one value
+        skip_whitespace(json_string, length, i);
+        char cur = *i < length ? json_string[*i] : '\0';
+        if (cur == LEX_OPEN_BRACE || cur == LEX_OPEN_SQUARE) {
+            if (depth == JSON_SKIP_MAX_DEPTH) {
+                strcat(error_text, "cerialize ERROR: JSON value nested too deeply to skip.\n");
+                *failure = TRUE;
+                return FALSE;
+            }
+            bool_t object = cur == LEX_OPEN_BRACE;
+            if (object) objects[depth / 8] |= (unsigned char)(1u << (depth % 8));
+            else objects[depth / 8] &= (unsigned char)~(1u << (depth % 8));
+            depth++;
+            (*i)++;
+            skip_whitespace(json_string, length, i);
+            if (*i < length && json_string[*i] == (object ? LEX_CLOSE_BRACE : LEX_CLOSE_SQUARE)) {
+                (*i)++;
+                depth--;
+            } else {
+                if (object) {
+                    if (!json_scan_string(json_string, length, i, failure, error_text, &start, &size)) return FALSE;
+                    skip_whitespace(json_string, length, i);
+                    if (*i >= length || json_string[*i] != LEX_COLON) {
+                        strcat(error_text, "cerialize ERROR: Expected ':' after key in JSON object.\n");
+                        *failure = TRUE;
+                        return FALSE;
+                    }
+                    (*i)++;
+                }
+                continue;
+            }
+        } else if (cur == LEX_QUOTE) {
+            if (!json_scan_string(json_string, length, i, failure, error_text, &start, &size)) return FALSE;
+        } else if (is_number_start(cur) || cur == LEX_PERIOD) {
+            if (!json_scan_number(json_string, length, i, failure, error_text)) return FALSE;
+        } else if (cur == LEX_N) {
+            if (!json_parse_null(json_string, i, failure, error_text)) return FALSE;
+        } else if (cur == LEX_T || cur == LEX_F) {
+            json_parse_boolean(json_string, i, failure, error_text);
+            if (*failure) return FALSE;
+        } else {
+            strcat(error_text, "cerialize ERROR: Expected a JSON value.\n");
+            *failure = TRUE;
+            return FALSE;
+        }
+
+        // what follows a value: close containers until a ',' leads to the next one
+        for (;;) {
+            if (depth == 0) return TRUE;
+            bool_t object = (objects[(depth - 1) / 8] >> ((depth - 1) % 8)) & 1;
+            char close = object ? LEX_CLOSE_BRACE : LEX_CLOSE_SQUARE;
+            skip_whitespace(json_string, length, i);
+            cur = *i < length ? json_string[*i] : '\0';
+            if (cur == close) {
+                (*i)++;
+                depth--;
+                continue;
+            }
+            if (cur != LEX_COMMA) {
+                strcat(error_text, object ? "cerialize ERROR: Expected ',' or '}' after key-value pair in JSON object.\n"
+                                          : "cerialize ERROR: Expected ',' or ']' after value in JSON list.\n");
+                *failure = TRUE;
+                return FALSE;
+            }
+            (*i)++;
+            skip_whitespace(json_string, length, i);
+            // a trailing comma is accepted, as the parser does
+            if (*i < length && json_string[*i] == close) continue;
+            if (object) {
+                if (!json_scan_string(json_string, length, i, failure, error_text, &start, &size)) return FALSE;
+                skip_whitespace(json_string, length, i);
+                if (*i >= length || json_string[*i] != LEX_COLON) {
+                    strcat(error_text, "cerialize ERROR: Expected ':' after key in JSON object.\n");
+                    *failure = TRUE;
+                    return FALSE;
+                }
+                (*i)++;
+            }
+            break;
+        }
+    }
+}
+
+#define JSON_SHAPE_TABLE_MAX 64 // distinct shapes per parse, later key sets keep their own nodes
+#define JSON_SHAPE_DEPTHS 8
+#define JSON_RAW_PATH_MAX 256 // longest raw path that can match, with its terminator
+
+// mutable parser state alongside the caller's options
+typedef struct json_parse_state {
+    const json_parse_options* options;
+    json_shape* shapes[JSON_SHAPE_TABLE_MAX];
+    cereal_size_t shape_count;
+    json_shape* expected[JSON_SHAPE_DEPTHS]; // last shape seen at each nesting depth
+    cereal_size_t depth;
+    // raw values and projections, only followed when asked for
+    bool_t raw_tracking;
+    const char* const* paths; // raw_paths, or the paths of a projection
+    cereal_size_t path_count;
+    cereal_size_t level; // nesting of the value about to be parsed, 0 for the root
+    bool_t raw_here; // that value's pointer is one of paths
+    bool_t path_live; // some path starts with path
+    char path[JSON_RAW_PATH_MAX]; // JSON Pointer of that value while path_live
+    size_t path_length;
+    // projection state, see deserialize_json_projected
+    bool_t projecting;
+    bool_t selected; // inside a value at one of paths, kept whole
+    unsigned char* found_paths; // with stop_early, one bit per path set on its first match
+    cereal_size_t found; // paths kept so far, each counted once
+    bool_t stop_early;
+    bool_t done; // every path was found and the rest of the input is left unread
+} json_parse_state;
+
+// what json_raw_enter changed, restored by json_raw_leave
+typedef struct json_raw_mark {
+    size_t path_length;
+    bool_t path_live;
+    bool_t raw_here;
+    bool_t selected;
+} json_raw_mark;
+
+// compare the current path with every followed path
+static inline void json_raw_match(json_parse_state* state) {
+    size_t n = state->path_length;
+    for (cereal_size_t p = 0; p < state->path_count; p++) {
+        const char* raw = state->paths[p];
+        if (strncmp(raw, state->path, n) != 0) continue;
+        if (raw[n] == '\0') state->raw_here = TRUE;
+        else if (raw[n] == '/') state->path_live = TRUE;
+    }
+}
+
+// the current value is kept whole, along with every path below it
+static inline void json_project_select(json_parse_state* state) {
+    size_t n = state->path_length;
+    for (cereal_size_t p = 0; p < state->path_count; p++) {
+        const char* wanted = state->paths[p];
+        if (strncmp(wanted, state->path, n) != 0 || (wanted[n] != '\0' && wanted[n] != '/')) continue;
+        // a repeated key matches the same path again
+        unsigned char bit = (unsigned char)(1u << (p % 8));
+        if (state->found_paths && !(state->found_paths[p / 8] & bit)) {
+            state->found_paths[p / 8] |= bit;
+            state->found++;
+        }
+    }
+    state->selected = TRUE;
+    state->path_live = FALSE;
+}
+
+// step down to member key, or to item index when key is NULL
+static inline json_raw_mark json_raw_enter(json_parse_state* state, const char* key, size_t key_length, cereal_size_t index) {
+    json_raw_mark mark = { state->path_length, state->path_live, state->raw_here, state->selected };
+    state->level++;
+    state->raw_here = FALSE;
+    if (!state->path_live) return mark;
+    state->path_live = FALSE;
+    char digits[24];
+    if (!key) {
+        key_length = (size_t)snprintf(digits, sizeof(digits), "%lu", (unsigned long)index);
+        key = digits;
+    }
+    // paths that do not fit the buffer never match
+    size_t n = state->path_length;
+    if (n + 1 + 2 * key_length >= JSON_RAW_PATH_MAX) return mark;
+    state->path[n++] = '/';
+    // keys are matched by their decoded text, which is never longer
+    for (size_t k = 0; k < key_length;) {
+        char decoded[4];
+        size_t d = 1;
+        if (key[k] == '\\') d = json_unescape_at(key, &k, decoded);
+        else decoded[0] = key[k++];
+        for (size_t b = 0; b < d; b++) {
+            if (decoded[b] == '~' || decoded[b] == '/') {
+                state->path[n++] = '~';
+                state->path[n++] = decoded[b] == '~' ? '0' : '1';
+            } else {
+                state->path[n++] = decoded[b];
+            }
+        }
+    }
+    state->path[n] = '\0';
+    state->path_length = n;
+    json_raw_match(state);
+    if (state->projecting && state->raw_here) json_project_select(state);
+    return mark;
+}
+
+static inline void json_raw_leave(json_parse_state* state, json_raw_mark mark) {
+    // leaving a projected value, which may have been the last one wanted
+    if (state->selected && !mark.selected && state->stop_early && state->found >= state->path_count) state->done = TRUE;
+    state->level--;
+    state->path_length = mark.path_length;
+    state->path[mark.path_length] = '\0';
+    state->path_live = mark.path_live;
+    state->raw_here = mark.raw_here;
+    state->selected = mark.selected;
+}
+
+// In a projection, skip the value at *i when no path leads to it, or when a
+// path leads through it but it is not a list or object. TRUE when skipped.
+static inline bool_t json_project_skip(const char* json_string, cereal_size_t length, cereal_uint_t* i, bool_t* failure, char* error_text, const json_parse_state* state) {
+    if (!state->projecting || state->selected) return FALSE;
+    char cur = json_string[*i];
+    if (state->path_live && (cur == LEX_OPEN_BRACE || cur == LEX_OPEN_SQUARE)) return FALSE;
+    json_skip_value(json_string, length, i, failure, error_text);
+    return TRUE;
+}
+
+// the value starting with cur is to be kept raw
+static inline bool_t json_raw_wanted(const json_parse_state* state, char cur) {
+    if (state->raw_here && !state->projecting) return TRUE;
+    cereal_size_t depth = state->options->raw_depth;
+    return depth > 0 && state->level >= depth && (cur == LEX_OPEN_BRACE || cur == LEX_OPEN_SQUARE);
+}
+
+// check the value at *i and keep its text
+static inline json_object json_parse_raw(const char* json_string, cereal_size_t length, cereal_uint_t* i, char* error_text, bool_t* failure, json_parse_state* state) {
+    json_object obj;
+    cereal_uint_t start = *i;
+    if (!json_skip_value(json_string, length, i, failure, error_text)) return (json_object){0};
+    if (!json_set_raw_copy(&obj, json_string + start, *i - start, state->options->allocator)) {
+        strcat(error_text, "cerialize ERROR: Failed to allocate memory for raw JSON value.\n");
+        *failure = TRUE;
+        return (json_object){0};
+    }
+    return obj;
+}
+
+static inline json_object parse_json_object(const char* json_string, cereal_size_t length, cereal_uint_t* i, char* error_text, bool_t* failure, json_parse_state* state);
+
+// key position in the input while a shaped object is being parsed
+typedef struct json_key_span {
+    cereal_uint_t start;
+    cereal_size_t size;
+} json_key_span;
+
+static inline uint64_t json_shape_hash(const char* json_string, const json_key_span* spans, cereal_size_t count) {
+    uint64_t hash = 14695981039346656037ULL; // FNV-1a
+    for (cereal_size_t k = 0; k < count; k++) {
+        for (cereal_size_t b = 0; b < spans[k].size; b++) {
+            hash = (hash ^ (unsigned char)json_string[spans[k].start + b]) * 1099511628211ULL;
+        }
+        hash = (hash ^ 0xFF) * 1099511628211ULL; // keys cannot run into each other
+    }
+    return hash;
+}
+
+static inline bool_t json_shape_matches(const json_shape* shape, uint64_t hash, const char* json_string, const json_key_span* spans, cereal_size_t count) {
+    if (shape->hash != hash || shape->count != count) return FALSE;
+    for (cereal_size_t k = 0; k < count; k++) {
+        if (!json_unescaped_equal(shape->keys[k].text, shape->keys[k].length, json_string + spans[k].start, spans[k].size)) return FALSE;
+    }
+    return TRUE;
+}
+
+// one block holding the shape, its key table and the key bytes
+static inline json_shape* json_shape_create(const json_allocator* alloc, uint64_t hash, const char* json_string, const json_key_span* spans, cereal_size_t count) {
+    size_t size = sizeof(json_shape) + sizeof(json_shape_key) * count;
+    for (cereal_size_t k = 0; k < count; k++) size += spans[k].size + 1;
+    json_shape* shape = (json_shape*)json_alloc(alloc, size);
+    if (!shape) return NULL;
+    shape->count = count;
+    shape->refs = 0;
+    shape->hash = hash;
+    char* text = (char*)&shape->keys[count];
+    for (cereal_size_t k = 0; k < count; k++) {
+        size_t key_length = json_unescape(json_string + spans[k].start, spans[k].size, text);
+        text[key_length] = '\0';
+        shape->keys[k].text = text;
+        shape->keys[k].length = key_length;
+        text += key_length + 1;
+    }
+    return shape;
+}
+
+// shape for the keys just parsed: the one last seen at this depth when every
+// key matched it in order, else a table lookup, else a new entry. NULL once the
+// table is full.
+static inline json_shape* json_shape_resolve(json_parse_state* state, json_shape* expected, const char* json_string, const json_key_span* spans, cereal_size_t count) {
+    if (expected && expected->count == count) return expected;
+    uint64_t hash = json_shape_hash(json_string, spans, count);
+    for (cereal_size_t k = 0; k < state->shape_count; k++) {
+        if (json_shape_matches(state->shapes[k], hash, json_string, spans, count)) return state->shapes[k];
+    }
+    if (state->shape_count == JSON_SHAPE_TABLE_MAX) return NULL;
+    json_shape* shape = json_shape_create(state->options->allocator, hash, json_string, spans, count);
+    if (!shape) return NULL;
+    shape->refs = 1; // the table's reference, dropped when the parse ends
+    state->shapes[state->shape_count++] = shape;
+    return shape;
+}
+
+// object body after '{' with share_shapes set. Values go straight into a
+// json_shaped block and keys are only remembered as positions in the input;
+// the next key is checked against the shape last seen at this depth first.
+static inline json_object json_parse_shaped_object(const char* json_string, cereal_size_t length, cereal_uint_t* i, char* error_text, bool_t* failure, json_parse_state* state) {
+    const json_allocator* alloc = state->options->allocator;
+    json_object obj;
+    json_key_span local_spans[16];
+    json_key_span* spans = local_spans;
+    cereal_size_t span_capacity = 16;
+    json_shaped* body = NULL;
+    cereal_size_t value_capacity = 0;
+    cereal_size_t count = 0;
+    cereal_size_t saved_depth = state->depth;
+    cereal_size_t depth = saved_depth < JSON_SHAPE_DEPTHS ? saved_depth : JSON_SHAPE_DEPTHS - 1;
+    json_shape* expected = state->expected[depth];
+    bool_t found_closing_brace = FALSE;
+    state->depth++;
+
+    while (*i < length) {
+        skip_whitespace(json_string, length, i);
+        if (json_string[*i] == LEX_CLOSE_BRACE) {
+            (*i)++; // move past '}'
+            found_closing_brace = TRUE;
+            break;
+        }
+
+        cereal_uint_t key_start;
+        cereal_size_t key_size;
+        if (!json_scan_string(json_string, length, i, failure, error_text, &key_start, &key_size)) {
+            strcat(error_text, "cerialize ERROR: Failed to parse key in JSON object.\n");
+            goto fail;
+        }
+        if (expected && (count >= expected->count
+            || !json_unescaped_equal(expected->keys[count].text, expected->keys[count].length, json_string + key_start, key_size))) {
+            expected = NULL;
+        }
+        if (count == span_capacity) {
+            json_key_span* grown = (json_key_span*)json_alloc(alloc, sizeof(json_key_span) * span_capacity * 2);
+            if (!grown) {
+                strcat(error_text, "cerialize ERROR: Failed to allocate memory for JSON object.\n");
+                goto fail;
+            }
+            memcpy(grown, spans, sizeof(json_key_span) * count);
+            if (spans != local_spans) json_dealloc(alloc, spans);
+            spans = grown;
+            span_capacity *= 2;
+        }
+        spans[count].start = key_start;
+        spans[count].size = key_size;
+
+        skip_whitespace(json_string, length, i);
+        if (json_string[*i] != LEX_COLON) {
+            strcat(error_text, "cerialize ERROR: Expected ':' after key in JSON object.\n");
+            goto fail;
+        }
+        (*i)++; // move past ':'
+        skip_whitespace(json_string, length, i);
+
+        json_raw_mark mark;
+        if (state->raw_tracking) mark = json_raw_enter(state, json_string + key_start, key_size, 0);
+        bool_t kept = !json_project_skip(json_string, length, i, failure, error_text, state);
+        json_object value = (json_object){0};
+        if (kept) value = parse_json_object(json_string, length, i, error_text, failure, state);
+        if (state->raw_tracking) json_raw_leave(state, mark);
+        if (*failure) {
+            strcat(error_text, "cerialize ERROR: Failed to parse value in JSON object.\n");
+            goto fail;
+        }
+        // a skipped member leaves no value, its span is reused by the next key
+        if (kept && count == value_capacity) {
+            cereal_size_t grown_capacity = value_capacity ? value_capacity * 2 : 4;
+            json_shaped* grown = (json_shaped*)json_realloc(alloc, body, sizeof(json_shaped) + sizeof(json_object) * grown_capacity);
+            if (!grown) {
+                json_object_free_with_allocator(&value, alloc);
+                strcat(error_text, "cerialize ERROR: Failed to allocate memory for JSON object.\n");
+                goto fail;
+            }
+            body = grown;
+            value_capacity = grown_capacity;
+        }
+        if (kept) body->values[count++] = value;
+        if (state->done) {
+            found_closing_brace = TRUE;
+            break;
+        }
+
+        skip_whitespace(json_string, length, i);
+        char cur = json_string[*i];
+        bool_t is_valid_delimiter = (cur == LEX_COMMA || cur == LEX_CLOSE_BRACE || cur == LEX_CLOSE_SQUARE || *i == length);
+        if (!is_valid_delimiter) {
+            strcat(error_text, "cerialize ERROR: Expected ',' or '}' after key-value pair in JSON object.\n");
+            goto fail;
+        }
+        if (cur == LEX_CLOSE_BRACE) {
+            (*i)++; // move past '}'
+            found_closing_brace = TRUE;
+            break;
+        }
+        if (cur == LEX_COMMA) {
+            (*i)++; // move past ','
+        }
+    }
+    state->depth = saved_depth;
+
+    if (!found_closing_brace) {
+        strcat(error_text, "cerialize ERROR: Expected closing brace '}' for JSON object.\n");
+        goto fail;
+    }
+    if (count == 0) {
+        json_set_object(&obj, NULL, 0);
+        json_dealloc(alloc, body);
+        return obj;
+    }
+
+    json_shape* shape = json_shape_resolve(state, expected, json_string, spans, count);
+    if (shape) {
+        if (count < value_capacity) {
+            json_shaped* fitted = (json_shaped*)json_realloc(alloc, body, sizeof(json_shaped) + sizeof(json_object) * count);
+            if (fitted) body = fitted;
+        }
+        body->shape = shape;
+        shape->refs++;
+        json_set_shaped_object(&obj, body);
+        state->expected[depth] = shape;
+    } else {
+        // too many distinct key sets, this object keeps its own keys
+        json_node* nodes = (json_node*)json_alloc(alloc, sizeof(json_node) * count);
+        cereal_size_t copied = 0;
+        while (nodes && copied < count && json_node_set_key_unescaped(&nodes[copied], json_string + spans[copied].start, spans[copied].size, alloc)) {
+            nodes[copied].value = body->values[copied];
+            copied++;
+        }
+        if (copied < count) {
+            for (cereal_size_t k = 0; nodes && k < copied; k++) json_dealloc(alloc, json_node_key_heap(&nodes[k]));
+            json_dealloc(alloc, nodes);
+            strcat(error_text, "cerialize ERROR: Failed to allocate memory for JSON object.\n");
+            goto fail;
+        }
+        json_dealloc(alloc, body);
+        json_set_object(&obj, nodes, count);
+    }
+    if (spans != local_spans) json_dealloc(alloc, spans);
+    return obj;
+
+fail:
+    state->depth = saved_depth;
+    *failure = TRUE;
+    for (cereal_size_t k = 0; k < count; k++) {
+        json_object_free_with_allocator(&body->values[k], alloc);
+    }
+    json_dealloc(alloc, body);
+    if (spans != local_spans) json_dealloc(alloc, spans);
+    return (json_object){0};
+}
+
+// value of an integer token without fraction or exponent, FALSE if it may not fit
+static inline bool_t json_packed_int(const char* token, size_t len, int64_t* value) {
+    size_t k = 0;
+    bool_t negative = FALSE;
+    if (token[0] == '-' || token[0] == '+') {
+        negative = token[0] == '-';
+        k = 1;
+    }
+    if (len - k == 0 || len - k > 18) return FALSE;
+    int64_t result = 0;
+    for (; k < len; k++) {
+        if (token[k] < '0' || token[k] > '9') return FALSE;
+        result = result * 10 + (token[k] - '0');
+    }
+    *value = negative ? -result : result;
+    return TRUE;
+}
+
+// Try to read the rest of a list (*i just past '[') as a packed array. Gives up
+// without side effects on the first element that does not fit, or on anything
+// malformed, so the generic path can take over and report errors.
+static inline bool_t json_parse_packed_list(const char* json_string, cereal_size_t length, cereal_uint_t* i, char* error_text, const json_allocator* alloc, json_object* out) {
+    cereal_uint_t pos = *i;
+    skip_whitespace(json_string, length, &pos);
+    if (pos >= length) return FALSE;
 
-static inline json_list json_parse_list(const char* json_string, cereal_size_t length, cereal_uint_t* i, bool_t* failure, char* error_text) {
+    json_packing packing;
+    char first = json_string[pos];
+    if (first == LEX_T || first == LEX_F) {
+        packing = JSON_PACKED_BOOL;
+    } else if (is_number_start(first) || first == LEX_PERIOD) {
+        packing = JSON_PACKED_INT64; // widened to doubles on the first non-integer
+    } else {
+        return FALSE;
+    }
+
+    size_t error_length = strlen(error_text);
+    unsigned char* data = NULL;
+    size_t capacity = 0; // elements
+    cereal_size_t count = 0;
+    bool_t closed = FALSE;
+    while (pos < length) {
+        skip_whitespace(json_string, length, &pos);
+        if (pos >= length) break;
+        if (json_string[pos] == LEX_CLOSE_SQUARE && count > 0) {
+            // trailing comma
+            pos++;
+            closed = TRUE;
+            break;
+        }
+
+        if (count == capacity) {
+            size_t grown = capacity ? capacity * 2 : 8;
+            size_t bytes = packing == JSON_PACKED_BOOL ? (grown + 7) / 8 : grown * 8;
+            unsigned char* resized = (unsigned char*)json_realloc(alloc, data, bytes);
+            if (resized == NULL) break;
+            if (packing == JSON_PACKED_BOOL) memset(resized + (capacity + 7) / 8, 0, bytes - (capacity + 7) / 8);
+            data = resized;
+            capacity = grown;
+        }
+
+        if (packing == JSON_PACKED_BOOL) {
+            bool_t value;
+            if (pos + 4 <= length && strncmp(json_string + pos, "true", 4) == 0) {
+                value = TRUE;
+                pos += 4;
+            } else if (pos + 5 <= length && strncmp(json_string + pos, "false", 5) == 0) {
+                value = FALSE;
+                pos += 5;
+            } else {
+                break;
+            }
+            if (value) data[count >> 3] |= (unsigned char)(1u << (count & 7));
+        } else {
+            cereal_uint_t start = pos;
+            bool_t failure = FALSE;
+            if (!is_number_start(json_string[pos]) && json_string[pos] != LEX_PERIOD) break;
+            if (!json_scan_number(json_string, length, &pos, &failure, error_text)) break;
+            const char* token = json_string + start;
+            size_t token_length = pos - start;
+            int64_t integer;
+            if (packing == JSON_PACKED_INT64 && json_packed_int(token, token_length, &integer)) {
+                ((int64_t*)data)[count] = integer;
+            } else {
+                if (packing == JSON_PACKED_INT64) {
+                    // widen what was read so far in place, both are 8 bytes
+                    for (cereal_size_t k = 0; k < count; k++) {
+                        int64_t widened = ((int64_t*)data)[k];
+                        ((double*)data)[k] = (double)widened;
+                    }
+                    packing = JSON_PACKED_DOUBLE;
+                }
+                char number[64];
+                if (token_length >= sizeof(number)) break;
+                memcpy(number, token, token_length);
+                number[token_length] = '\0';
+                ((double*)data)[count] = strtod(number, NULL);
+            }
+        }
+        count++;
+
+        skip_whitespace(json_string, length, &pos);
+        if (pos < length && json_string[pos] == LEX_COMMA) {
+            pos++;
+            continue;
+        }
+        if (pos < length && json_string[pos] == LEX_CLOSE_SQUARE) {
+            pos++;
+            closed = TRUE;
+        }
+        break;
+    }
+
+    if (!closed) {
+        // not a packable list, leave it and its errors to the generic path
+        error_text[error_length] = '\0';
+        json_dealloc(alloc, data);
+        return FALSE;
+    }
+
+    // give back the unused growth
+    size_t bytes = json_packed_size(packing, count);
+    unsigned char* fitted = (unsigned char*)json_realloc(alloc, data, bytes);
+    if (fitted != NULL) data = fitted;
+    json_set_packed_list(out, packing, data, count);
+    *i = pos;
+    return TRUE;
+}
+
+static inline json_object json_parse_list(const char* json_string, cereal_size_t length, cereal_uint_t* i, bool_t* failure, char* error_text, json_parse_state* state) {
+    const json_allocator* alloc = state->options->allocator;
+    json_object result;
+    json_set_list(&result, NULL, 0);
     skip_whitespace(json_string, length, i);
 
     if (json_string[*i] != LEX_OPEN_SQUARE) {
         strcat(error_text, "cerialize ERROR: Expected opening square '[' for JSON list.\n");
         *failure = TRUE;
-        return (json_list){0, NULL}; // return empty list on error
+        return result; // return empty list on error
     }
     (*i)++; // move past '['
 
+    // a raw path into the list needs its items one by one
+    if (state->options->pack_arrays && !state->path_live && json_parse_packed_list(json_string, length, i, error_text, alloc, &result)) {
+        return result;
+    }
+
     // count number of elements in the list
     cereal_size_t count = 0;
+    cereal_size_t skipped = 0; // projected out since the last kept item
     bool_t found_closing_square = FALSE;
     json_object* list = NULL;
     while (*i < length) {
@@ -353,27 +1816,41 @@ static inline json_list json_parse_list(const char* json_string, cereal_size_t l
         }
 
         // json_object* value = malloc(sizeof(json_object));
-        json_object value = parse_json_object(json_string, length, i, error_text, failure);
+        json_raw_mark mark;
+        if (state->raw_tracking) mark = json_raw_enter(state, NULL, 0, count + skipped);
+        bool_t kept = !json_project_skip(json_string, length, i, failure, error_text, state);
+        json_object value = (json_object){0};
+        if (kept) value = parse_json_object(json_string, length, i, error_text, failure, state);
+        if (state->raw_tracking) json_raw_leave(state, mark);
         if (*failure) {
             strcat(error_text, "cerialize ERROR: Failed to parse value in JSON list.\n");
-            return (json_list){0, NULL};
+            return result;
         }
-        // add value to list
-        list = realloc(list, sizeof(json_object) * (count + 1));
-        if (list == NULL) {
-            strcat(error_text, "cerialize ERROR: Failed to allocate memory for JSON list.\n");
-            *failure = TRUE;
-            return (json_list){0, NULL};
+        if (kept) {
+            // add value to list, items skipped before it stay as nulls so indexes hold
+            list = json_realloc(alloc, list, sizeof(json_object) * (count + skipped + 1));
+            if (list == NULL) {
+                strcat(error_text, "cerialize ERROR: Failed to allocate memory for JSON list.\n");
+                *failure = TRUE;
+                return result;
+            }
+            for (; skipped > 0; skipped--) json_set_null(&list[count++]);
+            list[count] = value;
+            count++;
+        } else {
+            skipped++;
+        }
+        if (state->done) {
+            found_closing_square = TRUE;
+            break;
         }
-        list[count] = value;
-        count++;
 
         skip_whitespace(json_string, length, i);
     
         if (json_string[*i] != LEX_COMMA && json_string[*i] != LEX_CLOSE_SQUARE && *i != length) {
             strcat(error_text, "cerialize ERROR: Expected ',' or ']' after value in JSON list.\n");
             *failure = TRUE;
-            return (json_list){0, NULL};
+            return result;
         }
 
         if (json_string[*i] == LEX_COMMA) {
@@ -394,27 +1871,38 @@ static inline json_list json_parse_list(const char* json_string, cereal_size_t l
     if (!found_closing_square) {
         strcat(error_text, "cerialize ERROR: Expected closing square ']' for JSON list.\n");
         *failure = TRUE;
-        if (list) free(list);
-        return (json_list){0, NULL}; // return NULL on error
+        json_dealloc(alloc, list);
+        return result; // return empty list on error
     }
 
-    json_list result = {
-        .count = count,
-        .items = list // assign the array of json_object
-    };
+    json_set_list(&result, list, count);
     return result;
 }
 
-static inline json_object parse_json_object(const char* json_string, cereal_size_t length, cereal_uint_t* i, char* error_text, bool_t* failure) {
+static inline json_object parse_json_object(const char* json_string, cereal_size_t length, cereal_uint_t* i, char* error_text, bool_t* failure, json_parse_state* state) {
+    const json_allocator* alloc = state->options->allocator;
     skip_whitespace(json_string, length, i);
 
     json_object obj;
     // obj.type = JSON_OBJECT;
 
     char cur = json_string[*i];
+    if (state->raw_tracking && json_raw_wanted(state, cur)) {
+        return json_parse_raw(json_string, length, i, error_text, failure, state);
+    }
     if (cur == LEX_QUOTE) {
-        obj.value.string = json_parse_string(json_string, length, i,failure, error_text);
-        obj.type = JSON_STRING;
+        cereal_uint_t start;
+        cereal_size_t str_size;
+        if (!json_scan_string(json_string, length, i, failure, error_text, &start, &str_size)) {
+            json_set_string(&obj, NULL);
+            return obj;
+        }
+        // short strings are stored inline by the compact layout
+        if (!json_set_string_unescaped(&obj, json_string + start, str_size, alloc)) {
+            strcat(error_text, "cerialize ERROR: Failed to allocate memory for JSON string.\n");
+            *failure = TRUE;
+            json_set_string(&obj, NULL);
+        }
         return obj;
     }
 
@@ -437,9 +1925,7 @@ static inline json_object parse_json_object(const char* json_string, cereal_size
     }
     
     if (cur == LEX_OPEN_SQUARE) {
-        obj.value.list = json_parse_list(json_string, length, i, failure, error_text);
-        obj.type = JSON_LIST;
-        return obj;
+        return json_parse_list(json_string, length, i, failure, error_text, state);
     }
 
     // parse build object
@@ -450,6 +1936,10 @@ static inline json_object parse_json_object(const char* json_string, cereal_size
     }
     (*i)++; // move past '{'
 
+    if (state->options->share_shapes) {
+        return json_parse_shaped_object(json_string, length, i, error_text, failure, state);
+    }
+
     skip_whitespace(json_string, length, i);
 
     json_node* head = NULL;
@@ -466,8 +1956,10 @@ static inline json_object parse_json_object(const char* json_string, cereal_size
             break; // end of object
         }
 
-        char* key = json_parse_string(json_string, length, i, failure, error_text);
-        if (key == NULL) {
+        json_node new_node;
+        cereal_uint_t key_start;
+        cereal_size_t key_size;
+        if (!json_scan_string(json_string, length, i, failure, error_text, &key_start, &key_size)) {
             strcat(error_text, "cerialize ERROR: Failed to parse key in JSON object.\n");
             *failure = TRUE;
             return (json_object){0}; // return empty value on error
@@ -477,35 +1969,49 @@ static inline json_object parse_json_object(const char* json_string, cereal_size
         if (json_string[*i] != LEX_COLON) {
             strcat(error_text, "cerialize ERROR: Expected ':' after key in JSON object.\n");
             *failure = TRUE;
-            free(key);
             return (json_object){0}; // return empty value on error
         }
         (*i)++; // move past ':'
 
         skip_whitespace(json_string, length, i);
 
-        json_object value = parse_json_object(json_string, length, i, error_text, failure);
+        json_raw_mark mark;
+        if (state->raw_tracking) mark = json_raw_enter(state, json_string + key_start, key_size, 0);
+        bool_t kept = !json_project_skip(json_string, length, i, failure, error_text, state);
+        json_object value = (json_object){0};
+        if (kept) value = parse_json_object(json_string, length, i, error_text, failure, state);
+        if (state->raw_tracking) json_raw_leave(state, mark);
         if (*failure) {
             strcat(error_text, "cerialize ERROR: Failed to parse value in JSON object.\n");
-            free(key);
             return (json_object){0}; // return empty value on error
         }
 
-        // create new node
-        json_node* new_node = (json_node*)malloc(sizeof(json_node));
-        new_node->key = key;
-        new_node->value = value; // copy the value
-
-        node_count++;
-        head = realloc(head, sizeof(json_node) * node_count);
-        if (head == NULL) {
-            strcat(error_text, "cerialize ERROR: Failed to allocate memory for JSON object.\n");
+        // the key is copied once its value is kept, short keys are stored
+        // inline by the compact layout
+        memset(&new_node, 0, sizeof(new_node));
+        if (kept && !json_node_set_key_unescaped(&new_node, json_string + key_start, key_size, alloc)) {
+            strcat(error_text, "cerialize ERROR: Failed to parse key in JSON object.\n");
             *failure = TRUE;
-            free(key);
+            json_object_free_with_allocator(&value, alloc);
             return (json_object){0}; // return empty value on error
         }
-        head[node_count - 1] = *new_node;
-        free(new_node);
+        if (kept) {
+            new_node.value = value;
+
+            node_count++;
+            head = json_realloc(alloc, head, sizeof(json_node) * node_count);
+            if (head == NULL) {
+                strcat(error_text, "cerialize ERROR: Failed to allocate memory for JSON object.\n");
+                *failure = TRUE;
+                json_dealloc(alloc, json_node_key_heap(&new_node));
+                return (json_object){0}; // return empty value on error
+            }
+            head[node_count - 1] = new_node;
+        }
+        if (state->done) {
+            found_closing_brace = TRUE;
+            break;
+        }
 
         skip_whitespace(json_string, length, i);
         cur = json_string[*i];
@@ -513,7 +2019,7 @@ static inline json_object parse_json_object(const char* json_string, cereal_size
         if (!is_valid_delimiter) {
             strcat(error_text, "cerialize ERROR: Expected ',' or '}' after key-value pair in JSON object.\n");
             *failure = TRUE;
-            free(key);
+            json_dealloc(alloc, json_node_key_heap(&new_node));
             return (json_object){0}; // return empty value on error
         }
         if (json_string[*i] == LEX_CLOSE_BRACE) {
@@ -535,238 +2041,3725 @@ static inline json_object parse_json_object(const char* json_string, cereal_size
     if (!found_closing_brace) {
         strcat(error_text, "cerialize ERROR: Expected closing brace '}' for JSON object.\n");
         *failure = TRUE;
-        if (head) free(head);
+        json_dealloc(alloc, head);
         return (json_object){0};
     }
 
     // create the json_object
-    obj.value.object.nodes = head; // assign the linked list of nodes
-    obj.value.object.node_count = node_count; // store the number of nodes
-    obj.type = JSON_OBJECT;
+    json_set_object(&obj, head, node_count);
 
     return obj;
 }
 
+// static error text used when the error buffer itself cannot be allocated, never freed
+static inline char* json_alloc_error_text(void) {
+    static char text[] = "cerialize ERROR: Failed to allocate memory for error text.\n";
+    return text;
+}
+
 // parse json
 static inline json deserialize_json(const char* json_string, cereal_size_t length) {
+    return deserialize_json_with_allocator(json_string, length, NULL);
+}
+
+// parse json, routing every allocation (including error text) through alloc
+static inline json deserialize_json_with_allocator(const char* json_string, cereal_size_t length, const json_allocator* alloc) {
+    json_parse_options options = { alloc, FALSE, FALSE, 0, NULL, 0 };
+    return deserialize_json_with_options(json_string, length, &options);
+}
+
+static inline json json_parse_document(const char* json_string, cereal_size_t length, json_parse_state* state);
+
+static inline json deserialize_json_with_options(const char* json_string, cereal_size_t length, const json_parse_options* options) {
+    json_parse_options defaults = { NULL, FALSE, FALSE, 0, NULL, 0 };
+    if (!options) options = &defaults;
+    json_parse_state state;
+    memset(&state, 0, sizeof(state));
+    state.options = options;
+    state.raw_tracking = options->raw_depth > 0 || options->raw_path_count > 0;
+    state.paths = options->raw_paths;
+    state.path_count = options->raw_path_count;
+    if (options->raw_path_count > 0) json_raw_match(&state);
+    return json_parse_document(json_string, length, &state);
+}
+
+// Parse only the values at paths, a list of JSON Pointers. The result is an
+// ordinary document holding those values and the objects and lists leading to
+// them; every other value is checked by json_skip_value and dropped. List
+// items left out before a kept one become nulls so indexes do not move, items
+// after the last kept one are dropped. A path through a value that is not a
+// list or object, or that is longer than JSON_RAW_PATH_MAX, keeps nothing.
+static inline json deserialize_json_projected(const char* json_string, cereal_size_t length, const char* const* paths, cereal_size_t path_count) {
+    return deserialize_json_projected_with_options(json_string, length, paths, path_count, NULL, FALSE);
+}
+
+// options as for deserialize_json_with_options, NULL for the defaults; its
+// raw_paths are ignored. With stop_early the parse returns as soon as every
+// path was found, leaving the rest of the input unread and unchecked.
+static inline json deserialize_json_projected_with_options(const char* json_string, cereal_size_t length, const char* const* paths, cereal_size_t path_count, const json_parse_options* options, bool_t stop_early) {
+    json_parse_options defaults = { NULL, FALSE, FALSE, 0, NULL, 0 };
+    if (!options) options = &defaults;
+    json_parse_state state;
+    memset(&state, 0, sizeof(state));
+    state.options = options;
+    state.raw_tracking = TRUE;
+    state.paths = paths;
+    state.path_count = path_count;
+    state.projecting = TRUE;
+    unsigned char found_small[8];
+    if (stop_early) {
+        size_t bytes = ((size_t)path_count + 7) / 8;
+        state.found_paths = bytes <= sizeof(found_small) ? found_small : (unsigned char*)json_alloc(options->allocator, bytes);
+        if (state.found_paths) memset(state.found_paths, 0, bytes);
+    }
+    // without room for the found bits the whole input is read
+    state.stop_early = state.found_paths != NULL;
+    // the root always leads to the paths; "" keeps all of it
+    json_raw_match(&state);
+    state.path_live = TRUE;
+    if (state.raw_here) json_project_select(&state);
+    json result = json_parse_document(json_string, length, &state);
+    if (state.found_paths != found_small) json_dealloc(options->allocator, state.found_paths);
+    return result;
+}
 
+static inline json json_parse_document(const char* json_string, cereal_size_t length, json_parse_state* state) {
+    const json_allocator* alloc = state->options->allocator;
     bool_t failure = FALSE;
-    char* error_text = malloc(JSON_MAX_ERROR_LENGTH);
+    char* error_text = json_alloc(alloc, JSON_MAX_ERROR_LENGTH);
     if (error_text == NULL) {
         json result = {
             .root = {0},
             .failure = TRUE,
-            .error_text = "cerialize ERROR: Failed to allocate memory for error text.\n",
-            .error_length = strlen("cerialize ERROR: Failed to allocate memory for error text.\n")
+            .error_text = json_alloc_error_text(),
+            .error_length = strlen(json_alloc_error_text()),
+            .allocator = alloc
         };
         return result;
     }
+    error_text[0] = '\0';
 
     // TODO: parse json object
     cereal_uint_t i = 0;
-    json_object root_value = parse_json_object(json_string, length, &i, error_text, &failure);
+    json_object root_value = parse_json_object(json_string, length, &i, error_text, &failure, state);
+    // objects hold their own references to the shapes they use
+    for (cereal_size_t k = 0; k < state->shape_count; k++) {
+        json_shape_release(state->shapes[k], alloc);
+    }
 
     json result = {
         .root = root_value,
         .failure = failure,
-        .error_text = error_text
+        .error_text = error_text,
+        .allocator = alloc
     };
 
     return result;
 }
 
 
-static inline char* serialize_string(const char* str) {
-    if (!str) return NULL;
-    size_t len = strlen(str);
-    char* result = (char*)malloc(len + 1);
-    if (!result) return NULL;
-    strcpy(result, str);
-    return result;
+// number formatting, shortest round-trip output for float and double (Grisu2).
+// Integral values take a plain integer fast path, everything else produces the
+// shortest digit string that parses back to the same value in almost all cases
+// and always round-trips.
+#define JSON_NUMBER_BUFFER_SIZE 32
+
+typedef struct json_diyfp {
+    uint64_t f;
+    int e;
+} json_diyfp;
+
+typedef struct json_cached_power {
+    uint64_t f;
+    int e;
+    int k;
+} json_cached_power;
+
+static inline json_diyfp json_diyfp_sub(json_diyfp x, json_diyfp y) {
+    json_diyfp r = { x.f - y.f, x.e };
+    return r;
 }
 
-static inline char* serialize_null() {
-    char* result = (char*)malloc(5);
-    if (!result) return NULL;
-    strcpy(result, "null");
-    return result;
+// upper 64 bits of the 128 bit product, rounded
+static inline json_diyfp json_diyfp_mul(json_diyfp x, json_diyfp y) {
+    uint64_t u_lo = x.f & 0xFFFFFFFFu;
+    uint64_t u_hi = x.f >> 32;
+    uint64_t v_lo = y.f & 0xFFFFFFFFu;
+    uint64_t v_hi = y.f >> 32;
+
+    uint64_t p0 = u_lo * v_lo;
+    uint64_t p1 = u_lo * v_hi;
+    uint64_t p2 = u_hi * v_lo;
+    uint64_t p3 = u_hi * v_hi;
+
+    uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+    q += (uint64_t)1 << 31; // round
+
+    json_diyfp r = { p3 + (p1 >> 32) + (p2 >> 32) + (q >> 32), x.e + y.e + 64 };
+    return r;
 }
 
-static inline char* serialize_number(float number) { 
-    char* result = malloc(32);
-    if (!result) return NULL; // handle memory allocation failure
-    snprintf(result, 32, "%f", number);
-    return result;
+static inline json_diyfp json_diyfp_normalize(json_diyfp x) {
+    while ((x.f >> 63) == 0) {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
 }
 
-static inline char* serialize_bool(bool_t value) {
-    const char* src = value ? "true" : "false";
-    char* result = (char*)malloc(strlen(src) + 1);
-    if (!result) return NULL;
-    strcpy(result, src);
-    return result;
+static inline json_diyfp json_diyfp_normalize_to(json_diyfp x, int e) {
+    x.f <<= (x.e - e);
+    x.e = e;
+    return x;
 }
 
-static inline char* serialize_list(json_list list) { 
-    char* result = malloc(JSON_MAX_STRING_LENGTH);
-    if (!result) return NULL; // handle memory allocation failure
-    strcpy(result, "[");
-    for (cereal_uint_t i = 0; i < list.count; i++) {
-        // serialize each item in the list
-        json item = {
-            .root = list.items[i],
-            .failure = 0,
-            .error_text = NULL
-        };
-        char* item_str = serialize_json(&item);
-        if (item_str) {
-            strcat(result, item_str);
-            free(item_str);
-        }
-        if (i < list.count - 1) {
-            strcat(result, ",");
-        }
-    }
-    strcat(result, "]");
-    return result;
+// normalized 10^k for k = -300, -292, ..., 324
+static const json_cached_power json_cached_powers[] = {
+    { 0xAB70FE17C79AC6CAULL, -1060, -300 },
+    { 0xFF77B1FCBEBCDC4FULL, -1034, -292 },
+    { 0xBE5691EF416BD60CULL, -1007, -284 },
+    { 0x8DD01FAD907FFC3CULL, -980, -276 },
+    { 0xD3515C2831559A83ULL, -954, -268 },
+    { 0x9D71AC8FADA6C9B5ULL, -927, -260 },
+    { 0xEA9C227723EE8BCBULL, -901, -252 },
+    { 0xAECC49914078536DULL, -874, -244 },
+    { 0x823C12795DB6CE57ULL, -847, -236 },
+    { 0xC21094364DFB5637ULL, -821, -228 },
+    { 0x9096EA6F3848984FULL, -794, -220 },
+    { 0xD77485CB25823AC7ULL, -768, -212 },
+    { 0xA086CFCD97BF97F4ULL, -741, -204 },
+    { 0xEF340A98172AACE5ULL, -715, -196 },
+    { 0xB23867FB2A35B28EULL, -688, -188 },
+    { 0x84C8D4DFD2C63F3BULL, -661, -180 },
+    { 0xC5DD44271AD3CDBAULL, -635, -172 },
+    { 0x936B9FCEBB25C996ULL, -608, -164 },
+    { 0xDBAC6C247D62A584ULL, -582, -156 },
+    { 0xA3AB66580D5FDAF6ULL, -555, -148 },
+    { 0xF3E2F893DEC3F126ULL, -529, -140 },
+    { 0xB5B5ADA8AAFF80B8ULL, -502, -132 },
+    { 0x87625F056C7C4A8BULL, -475, -124 },
+    { 0xC9BCFF6034C13053ULL, -449, -116 },
+    { 0x964E858C91BA2655ULL, -422, -108 },
+    { 0xDFF9772470297EBDULL, -396, -100 },
+    { 0xA6DFBD9FB8E5B88FULL, -369, -92 },
+    { 0xF8A95FCF88747D94ULL, -343, -84 },
+    { 0xB94470938FA89BCFULL, -316, -76 },
+    { 0x8A08F0F8BF0F156BULL, -289, -68 },
+    { 0xCDB02555653131B6ULL, -263, -60 },
+    { 0x993FE2C6D07B7FACULL, -236, -52 },
+    { 0xE45C10C42A2B3B06ULL, -210, -44 },
+    { 0xAA242499697392D3ULL, -183, -36 },
+    { 0xFD87B5F28300CA0EULL, -157, -28 },
+    { 0xBCE5086492111AEBULL, -130, -20 },
+    { 0x8CBCCC096F5088CCULL, -103, -12 },
+    { 0xD1B71758E219652CULL, -77, -4 },
+    { 0x9C40000000000000ULL, -50, 4 },
+    { 0xE8D4A51000000000ULL, -24, 12 },
+    { 0xAD78EBC5AC620000ULL, 3, 20 },
+    { 0x813F3978F8940984ULL, 30, 28 },
+    { 0xC097CE7BC90715B3ULL, 56, 36 },
+    { 0x8F7E32CE7BEA5C70ULL, 83, 44 },
+    { 0xD5D238A4ABE98068ULL, 109, 52 },
+    { 0x9F4F2726179A2245ULL, 136, 60 },
+    { 0xED63A231D4C4FB27ULL, 162, 68 },
+    { 0xB0DE65388CC8ADA8ULL, 189, 76 },
+    { 0x83C7088E1AAB65DBULL, 216, 84 },
+    { 0xC45D1DF942711D9AULL, 242, 92 },
+    { 0x924D692CA61BE758ULL, 269, 100 },
+    { 0xDA01EE641A708DEAULL, 295, 108 },
+    { 0xA26DA3999AEF774AULL, 322, 116 },
+    { 0xF209787BB47D6B85ULL, 348, 124 },
+    { 0xB454E4A179DD1877ULL, 375, 132 },
+    { 0x865B86925B9BC5C2ULL, 402, 140 },
+    { 0xC83553C5C8965D3DULL, 428, 148 },
+    { 0x952AB45CFA97A0B3ULL, 455, 156 },
+    { 0xDE469FBD99A05FE3ULL, 481, 164 },
+    { 0xA59BC234DB398C25ULL, 508, 172 },
+    { 0xF6C69A72A3989F5CULL, 534, 180 },
+    { 0xB7DCBF5354E9BECEULL, 561, 188 },
+    { 0x88FCF317F22241E2ULL, 588, 196 },
+    { 0xCC20CE9BD35C78A5ULL, 614, 204 },
+    { 0x98165AF37B2153DFULL, 641, 212 },
+    { 0xE2A0B5DC971F303AULL, 667, 220 },
+    { 0xA8D9D1535CE3B396ULL, 694, 228 },
+    { 0xFB9B7CD9A4A7443CULL, 720, 236 },
+    { 0xBB764C4CA7A44410ULL, 747, 244 },
+    { 0x8BAB8EEFB6409C1AULL, 774, 252 },
+    { 0xD01FEF10A657842CULL, 800, 260 },
+    { 0x9B10A4E5E9913129ULL, 827, 268 },
+    { 0xE7109BFBA19C0C9DULL, 853, 276 },
+    { 0xAC2820D9623BF429ULL, 880, 284 },
+    { 0x80444B5E7AA7CF85ULL, 907, 292 },
+    { 0xBF21E44003ACDD2DULL, 933, 300 },
+    { 0x8E679C2F5E44FF8FULL, 960, 308 },
+    { 0xD433179D9C8CB841ULL, 986, 316 },
+    { 0x9E19DB92B4E31BA9ULL, 1013, 324 },
+};
+
+static inline json_cached_power json_cached_power_for(int e) {
+    // pick c = 10^-k so that the scaled exponent lands in [-60, -32]
+    int f = -60 - e - 1;
+    int k = (f * 78913) / (1 << 18) + (f > 0);
+    int index = (300 + k + 7) / 8;
+    return json_cached_powers[index];
 }
 
-static inline char* serialize_object(const json_object* obj) { 
-    char* result = malloc(JSON_MAX_STRING_LENGTH);
-    if (!result) return NULL; // handle memory allocation failure
-    // Defensive: handle empty or malformed objects
-    if (obj->value.object.node_count == 0) {
-        strcpy(result, "{}");
-        return result;
+static inline int json_largest_pow10(uint32_t n, uint32_t* pow10) {
+    static const uint32_t powers[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+    int digits = 10;
+    while (digits > 1 && n < powers[digits - 1]) {
+        digits--;
     }
+    *pow10 = powers[digits - 1];
+    return digits;
+}
 
-    strcpy(result, "{");
-    for (cereal_size_t i = 0; i < obj->value.object.node_count; i++) {
-        json_node node = obj->value.object.nodes[i];
-        char* key_str = serialize_string(node.key);
-        json value = {
-            .root = { .type = node.value.type, .value = node.value.value },
-            .failure = 0,
-            .error_text = NULL
-        };
-        char* value_str = serialize_json(&value);
-        if (key_str && value_str) {
-            strcat(result, key_str);
-            strcat(result, ":");
-            strcat(result, value_str);
-            free(key_str);
-            free(value_str);
-        }
-        if (i < obj->value.object.node_count - 1) {
-            strcat(result, ",");
-        }
+static inline void json_grisu2_round(char* buffer, int length, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k) {
+    while (rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+        buffer[length - 1]--;
+        rest += ten_k;
     }
-    strcat(result, "}");
-    return result;
 }
 
-static inline char* serialize_json(const json* j) { 
-    if (!j) return NULL;
+// generate the digits of w, as few as needed to stay inside [m_minus, m_plus]
+static inline int json_grisu2_digits(char* buffer, int* decimal_exponent, json_diyfp m_minus, json_diyfp w, json_diyfp m_plus) {
+    uint64_t delta = json_diyfp_sub(m_plus, m_minus).f;
+    uint64_t dist = json_diyfp_sub(m_plus, w).f;
+    json_diyfp one = { (uint64_t)1 << -m_plus.e, m_plus.e };
 
-    json_object root = j->root;
-    switch (root.type) {
-        case JSON_STRING:
-            return serialize_string(root.value.string);
+    uint32_t p1 = (uint32_t)(m_plus.f >> -one.e);
+    uint64_t p2 = m_plus.f & (one.f - 1);
+    int length = 0;
+
+    uint32_t pow10;
+    int n = json_largest_pow10(p1, &pow10);
+    while (n > 0) {
+        buffer[length++] = (char)('0' + p1 / pow10);
+        p1 %= pow10;
+        n--;
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest <= delta) {
+            *decimal_exponent += n;
+            json_grisu2_round(buffer, length, dist, delta, rest, (uint64_t)pow10 << -one.e);
+            return length;
+        }
+        pow10 /= 10;
+    }
+
+    int m = 0;
+    for (;;) {
+        p2 *= 10;
+        buffer[length++] = (char)('0' + (p2 >> -one.e));
+        p2 &= one.f - 1;
+        m++;
+        delta *= 10;
+        dist *= 10;
+        if (p2 <= delta) break;
+    }
+    *decimal_exponent -= m;
+    json_grisu2_round(buffer, length, dist, delta, p2, one.f);
+    return length;
+}
+
+// bits of a positive finite value with the given mantissa precision and exponent bias
+static inline int json_grisu2(char* buffer, int* decimal_exponent, uint64_t bits, int precision, int bias) {
+    uint64_t hidden_bit = (uint64_t)1 << (precision - 1);
+    uint64_t exponent_bits = bits >> (precision - 1);
+    uint64_t fraction = bits & (hidden_bit - 1);
+    int min_exp = 1 - bias;
+
+    json_diyfp v;
+    if (exponent_bits == 0) {
+        v.f = fraction;
+        v.e = min_exp;
+    } else {
+        v.f = fraction + hidden_bit;
+        v.e = (int)exponent_bits - bias;
+    }
+
+    // boundaries halfway to the neighbouring values, the lower one is closer at powers of two
+    bool_t lower_closer = fraction == 0 && exponent_bits > 1;
+    json_diyfp m_plus = { 2 * v.f + 1, v.e - 1 };
+    json_diyfp m_minus;
+    if (lower_closer) {
+        m_minus.f = 4 * v.f - 1;
+        m_minus.e = v.e - 2;
+    } else {
+        m_minus.f = 2 * v.f - 1;
+        m_minus.e = v.e - 1;
+    }
+    m_plus = json_diyfp_normalize(m_plus);
+    m_minus = json_diyfp_normalize_to(m_minus, m_plus.e);
+    v = json_diyfp_normalize(v);
+
+    json_cached_power cached = json_cached_power_for(m_plus.e);
+    json_diyfp c = { cached.f, cached.e };
+    json_diyfp w = json_diyfp_mul(v, c);
+    json_diyfp w_minus = json_diyfp_mul(m_minus, c);
+    json_diyfp w_plus = json_diyfp_mul(m_plus, c);
+    w_minus.f += 1;
+    w_plus.f -= 1;
+
+    *decimal_exponent = -cached.k;
+    return json_grisu2_digits(buffer, decimal_exponent, w_minus, w, w_plus);
+}
+
+static inline int json_format_uint(uint64_t value, char* out) {
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    for (int i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+// lay out length digits scaled by 10^decimal_exponent as plain or exponent notation
+static inline int json_format_digits(char* buf, int length, int decimal_exponent, int max_exp) {
+    int n = length + decimal_exponent;
+
+    if (length <= n && n <= max_exp) {
+        // digits000
+        memset(buf + length, '0', (size_t)(n - length));
+        return n;
+    }
+    if (0 < n && n <= max_exp) {
+        // dig.its
+        memmove(buf + n + 1, buf + n, (size_t)(length - n));
+        buf[n] = '.';
+        return length + 1;
+    }
+    if (-4 < n && n <= 0) {
+        // 0.000digits
+        memmove(buf + 2 - n, buf, (size_t)length);
+        buf[0] = '0';
+        buf[1] = '.';
+        memset(buf + 2, '0', (size_t)-n);
+        return 2 - n + length;
+    }
+
+    // d.igitse-12
+    int pos = 1;
+    if (length > 1) {
+        memmove(buf + 2, buf + 1, (size_t)(length - 1));
+        buf[1] = '.';
+        pos = length + 1;
+    }
+    buf[pos++] = 'e';
+    int exponent = n - 1;
+    if (exponent < 0) {
+        buf[pos++] = '-';
+        exponent = -exponent;
+    }
+    return pos + json_format_uint((uint64_t)exponent, buf + pos);
+}
+
+// write the shortest round-trip form of value into out, at least
+// JSON_NUMBER_BUFFER_SIZE bytes, not null terminated. NaN and infinity
+// have no JSON form and are written as null.
+static inline int json_format_double(double value, char* out) {
+    if (value != value || value - value != 0) {
+        memcpy(out, "null", 4);
+        return 4;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int pos = 0;
+    if (bits >> 63) {
+        out[pos++] = '-';
+        value = -value;
+        bits &= ~((uint64_t)1 << 63);
+    }
+    if (value == 0) {
+        out[pos++] = '0';
+        return pos;
+    }
+    // integer fast path, exact below 2^53
+    if (value < 9007199254740992.0 && value == (double)(uint64_t)value) {
+        return pos + json_format_uint((uint64_t)value, out + pos);
+    }
+
+    int decimal_exponent;
+    int length = json_grisu2(out + pos, &decimal_exponent, bits, 53, 1075);
+    return pos + json_format_digits(out + pos, length, decimal_exponent, 15);
+}
+
+static inline int json_format_float(float value, char* out) {
+    if (value != value || value - value != 0) {
+        memcpy(out, "null", 4);
+        return 4;
+    }
+
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int pos = 0;
+    if (bits >> 31) {
+        out[pos++] = '-';
+        value = -value;
+        bits &= ~((uint32_t)1 << 31);
+    }
+    if (value == 0) {
+        out[pos++] = '0';
+        return pos;
+    }
+    // integer fast path, exact below 2^24
+    if (value < 16777216.0f && value == (float)(uint32_t)value) {
+        return pos + json_format_uint((uint64_t)value, out + pos);
+    }
+
+    int decimal_exponent;
+    int length = json_grisu2(out + pos, &decimal_exponent, bits, 24, 150);
+    return pos + json_format_digits(out + pos, length, decimal_exponent, 7);
+}
+
+// output writer, a geometrically growing buffer the whole tree is appended to
+#define JSON_WRITER_INITIAL_CAPACITY 256
+// buffer size of a writer with a sink, chunks of half this size or more bypass the buffer
+#define JSON_WRITER_FLUSH_SIZE (64 * 1024)
+
+static inline void json_writer_init(json_writer* w, const json_allocator* alloc) {
+    w->data = NULL;
+    w->length = 0;
+    w->capacity = 0;
+    w->allocator = alloc;
+    w->failure = FALSE;
+    w->sink = NULL;
+    w->sink_v = NULL;
+    w->sink_user = NULL;
+    w->fixed = FALSE;
+    w->depth = 0;
+    w->scopes[0] = 0;
+}
+
+// writer whose output goes to write_fn (and writev_fn when given) in large chunks
+static inline void json_writer_init_sink(json_writer* w, json_write_fn write_fn, json_writev_fn writev_fn, void* user, const json_allocator* alloc) {
+    json_writer_init(w, alloc);
+    w->sink = write_fn;
+    w->sink_v = writev_fn;
+    w->sink_user = user;
+}
+
+// writer over a caller provided buffer, writes past capacity mark it as failed
+static inline void json_writer_init_fixed(json_writer* w, char* buffer, size_t capacity) {
+    json_writer_init(w, NULL);
+    w->data = buffer;
+    w->capacity = capacity;
+    w->fixed = TRUE;
+}
+
+// push buffered output to the sink, no-op for a growable writer
+static inline bool_t json_writer_flush(json_writer* w) {
+    if (w->failure) return FALSE;
+    if (!w->sink || w->length == 0) return TRUE;
+    if (!w->sink(w->sink_user, w->data, w->length)) {
+        w->failure = TRUE;
+        return FALSE;
+    }
+    w->length = 0;
+    return TRUE;
+}
+
+// make room for extra bytes plus a null terminator
+static inline bool_t json_writer_reserve(json_writer* w, size_t extra) {
+    if (w->failure) return FALSE;
+    size_t needed = w->length + extra + 1;
+    if (needed <= w->capacity) return TRUE;
+
+    if (w->fixed) {
+        // the terminator is optional here, finish only adds it when it fits
+        if (w->length + extra <= w->capacity) return TRUE;
+        w->failure = TRUE;
+        return FALSE;
+    }
+
+    if (w->sink) {
+        if (w->data == NULL) {
+            w->data = (char*)json_alloc(w->allocator, JSON_WRITER_FLUSH_SIZE);
+            if (w->data == NULL) {
+                w->failure = TRUE;
+                return FALSE;
+            }
+            w->capacity = JSON_WRITER_FLUSH_SIZE;
+        } else if (!json_writer_flush(w)) {
+            return FALSE;
+        }
+        if (extra + 1 <= w->capacity) return TRUE;
+        w->failure = TRUE;
+        return FALSE;
+    }
+
+    size_t capacity = w->capacity ? w->capacity : JSON_WRITER_INITIAL_CAPACITY;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    char* data = (char*)json_realloc(w->allocator, w->data, capacity);
+    if (data == NULL) {
+        w->failure = TRUE;
+        return FALSE;
+    }
+    w->data = data;
+    w->capacity = capacity;
+    return TRUE;
+}
+
+// hand a large chunk straight to the sink, batched with pending output when possible
+static inline void json_writer_write_through(json_writer* w, const char* src, size_t len) {
+    if (w->sink_v && w->length > 0) {
+        json_iovec chunks[2] = {
+            { w->data, w->length },
+            { src, len }
+        };
+        if (!w->sink_v(w->sink_user, chunks, 2)) {
+            w->failure = TRUE;
+            return;
+        }
+        w->length = 0;
+        return;
+    }
+    if (!json_writer_flush(w)) return;
+    if (!w->sink(w->sink_user, src, len)) {
+        w->failure = TRUE;
+    }
+}
+
+static inline void json_writer_write(json_writer* w, const char* src, size_t len) {
+    if (w->sink && len >= JSON_WRITER_FLUSH_SIZE / 2) {
+        if (!w->failure) json_writer_write_through(w, src, len);
+        return;
+    }
+    if (!json_writer_reserve(w, len)) return;
+    memcpy(w->data + w->length, src, len);
+    w->length += len;
+}
+
+static inline void json_writer_putc(json_writer* w, char c) {
+    if (!json_writer_reserve(w, 1)) return;
+    w->data[w->length++] = c;
+}
+
+static inline void json_writer_puts(json_writer* w, const char* str) {
+    json_writer_write(w, str, strlen(str));
+}
+
+static inline void json_writer_free(json_writer* w) {
+    if (!w->fixed) json_dealloc(w->allocator, w->data);
+    w->data = NULL;
+    w->length = 0;
+    w->capacity = 0;
+}
+
+// hand the null terminated buffer to the caller, NULL if any write failed.
+// A writer with a sink is flushed and released instead, and always returns NULL.
+static inline char* json_writer_finish(json_writer* w) {
+    if (w->depth != 0) {
+        // unterminated json_w_begin_object / json_w_begin_array
+        w->failure = TRUE;
+    }
+    if (w->sink) {
+        json_writer_flush(w);
+        json_writer_free(w);
+        return NULL;
+    }
+    if (w->fixed) {
+        // hand back the caller's buffer, terminated when there is room
+        char* result = w->failure ? NULL : w->data;
+        if (result && w->length < w->capacity) result[w->length] = '\0';
+        return result;
+    }
+    if (!json_writer_reserve(w, 0)) {
+        json_writer_free(w);
+        return NULL;
+    }
+    w->data[w->length] = '\0';
+    char* result = w->data;
+    w->data = NULL;
+    w->length = 0;
+    w->capacity = 0;
+    return result;
+}
+
+static inline void serialize_value(json_writer* w, const json_object* obj);
+
+// string escaping. Clean runs are found a block at a time and copied in bulk,
+// only '"', '\\' and control characters are rewritten.
+static inline bool_t json_needs_escape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+#define JSON_SWAR_ONES 0x0101010101010101ULL
+#define JSON_SWAR_HIGHS 0x8080808080808080ULL
+
+// portable fallback, eight bytes per step using SWAR tricks
+static inline size_t json_escape_scan_scalar(const char* str, size_t len) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, str + i, sizeof(word));
+        uint64_t quote = word ^ (JSON_SWAR_ONES * '"');
+        uint64_t backslash = word ^ (JSON_SWAR_ONES * '\\');
+        uint64_t flagged = ((word - JSON_SWAR_ONES * 0x20) & ~word)
+                         | ((quote - JSON_SWAR_ONES) & ~quote)
+                         | ((backslash - JSON_SWAR_ONES) & ~backslash);
+        if (flagged & JSON_SWAR_HIGHS) break;
+    }
+    while (i < len && !json_needs_escape((unsigned char)str[i])) {
+        i++;
+    }
+    return i;
+}
+
+// length of the leading run of str that can be copied without escaping
+static inline size_t json_escape_scan(const char* str, size_t len) {
+    size_t i = 0;
+#ifdef CERIALIZE_AVX2
+    const __m256i quote32 = _mm256_set1_epi8('"');
+    const __m256i backslash32 = _mm256_set1_epi8('\\');
+    const __m256i control32 = _mm256_set1_epi8(0x1F);
+    for (; i + 32 <= len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(str + i));
+        __m256i hits = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, quote32), _mm256_cmpeq_epi8(block, backslash32)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(block, control32), block));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(hits);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+#endif
+#ifdef CERIALIZE_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(block, control), block));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(hits);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+#endif
+    return i + json_escape_scan_scalar(str + i, len - i);
+}
+
+// append str as escaped JSON string content, without the surrounding quotes
+static inline void json_write_escaped(json_writer* w, const char* str, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    size_t i = 0;
+    while (i < len) {
+        size_t run = json_escape_scan(str + i, len - i);
+        if (run > 0) {
+            json_writer_write(w, str + i, run);
+            i += run;
+            if (i >= len) break;
+        }
+
+        unsigned char c = (unsigned char)str[i++];
+        char escaped[6] = { '\\', 0, 0, 0, 0, 0 };
+        size_t escaped_len = 2;
+        switch (c) {
+            case '"': escaped[1] = '"'; break;
+            case '\\': escaped[1] = '\\'; break;
+            case '\b': escaped[1] = 'b'; break;
+            case '\f': escaped[1] = 'f'; break;
+            case '\n': escaped[1] = 'n'; break;
+            case '\r': escaped[1] = 'r'; break;
+            case '\t': escaped[1] = 't'; break;
+            default:
+                escaped[1] = 'u';
+                escaped[2] = '0';
+                escaped[3] = '0';
+                escaped[4] = hex[c >> 4];
+                escaped[5] = hex[c & 0xF];
+                escaped_len = 6;
+                break;
+        }
+        json_writer_write(w, escaped, escaped_len);
+    }
+}
+
+// used for both keys and string values
+static inline void serialize_string_len(json_writer* w, const char* str, size_t len) {
+    if (!str) {
+        w->failure = TRUE;
+        return;
+    }
+    json_writer_putc(w, '"');
+    json_write_escaped(w, str, len);
+    json_writer_putc(w, '"');
+}
+
+static inline void serialize_string(json_writer* w, const char* str) {
+    serialize_string_len(w, str, str ? strlen(str) : 0);
+}
+
+static inline void serialize_null(json_writer* w) {
+    json_writer_write(w, "null", 4);
+}
+
+// numbers are formatted straight into the buffer, which needs the worst case
+// JSON_NUMBER_BUFFER_SIZE free. A fixed buffer close to full formats into
+// scratch instead, so only the real length has to fit.
+static inline char* json_writer_number_slot(json_writer* w, char* scratch) {
+    if (w->failure) return NULL;
+    if (w->fixed && w->capacity - w->length < JSON_NUMBER_BUFFER_SIZE) return scratch;
+    if (!json_writer_reserve(w, JSON_NUMBER_BUFFER_SIZE)) return NULL;
+    return w->data + w->length;
+}
+
+static inline void json_writer_commit_number(json_writer* w, const char* slot, size_t len) {
+    if (slot == w->data + w->length) {
+        w->length += len;
+    } else {
+        json_writer_write(w, slot, len);
+    }
+}
+
+static inline void serialize_number(json_writer* w, float number) { 
+    char scratch[JSON_NUMBER_BUFFER_SIZE];
+    char* slot = json_writer_number_slot(w, scratch);
+    if (!slot) return;
+    json_writer_commit_number(w, slot, (size_t)json_format_float(number, slot));
+}
+
+static inline int json_format_int64(int64_t number, char* out) {
+    uint64_t magnitude = (uint64_t)number;
+    int len = 0;
+    if (number < 0) {
+        out[len++] = '-';
+        magnitude = 0 - magnitude;
+    }
+    return len + json_format_uint(magnitude, out + len);
+}
+
+static inline void serialize_double(json_writer* w, double number) {
+    char scratch[JSON_NUMBER_BUFFER_SIZE];
+    char* slot = json_writer_number_slot(w, scratch);
+    if (!slot) return;
+    json_writer_commit_number(w, slot, (size_t)json_format_double(number, slot));
+}
+
+static inline void serialize_int64(json_writer* w, int64_t number) {
+    char scratch[JSON_NUMBER_BUFFER_SIZE];
+    char* slot = json_writer_number_slot(w, scratch);
+    if (!slot) return;
+    json_writer_commit_number(w, slot, (size_t)json_format_int64(number, slot));
+}
+
+static inline void serialize_bool(json_writer* w, bool_t value) {
+    if (value) {
+        json_writer_write(w, "true", 4);
+    } else {
+        json_writer_write(w, "false", 5);
+    }
+}
+
+static inline void serialize_packed_list(json_writer* w, const json_object* list) {
+    json_packed_view view = json_list_packed(list);
+    json_writer_putc(w, '[');
+    for (cereal_size_t i = 0; i < view.count; i++) {
+        if (i > 0) {
+            json_writer_putc(w, ',');
+        }
+        switch (view.packing) {
+            case JSON_PACKED_DOUBLE:
+                serialize_double(w, ((const double*)view.data)[i]);
+                break;
+            case JSON_PACKED_INT64:
+                serialize_int64(w, ((const int64_t*)view.data)[i]);
+                break;
+            default:
+                serialize_bool(w, json_packed_bit(view.data, i));
+                break;
+        }
+    }
+    json_writer_putc(w, ']');
+}
+
+static inline void serialize_list(json_writer* w, const json_object* list) { 
+    if (json_list_packing(list) != JSON_PACKED_NONE) {
+        serialize_packed_list(w, list);
+        return;
+    }
+    json_object* items = json_list_items(list);
+    cereal_size_t count = json_list_count(list);
+    json_writer_putc(w, '[');
+    for (cereal_size_t i = 0; i < count; i++) {
+        if (i > 0) {
+            json_writer_putc(w, ',');
+        }
+        serialize_value(w, &items[i]);
+    }
+    json_writer_putc(w, ']');
+}
+
+static inline void serialize_object(json_writer* w, const json_object* object) { 
+    cereal_size_t count = json_node_count(object);
+    json_writer_putc(w, '{');
+    for (cereal_size_t i = 0; i < count; i++) {
+        if (i > 0) {
+            json_writer_putc(w, ',');
+        }
+        size_t key_len;
+        const char* key = json_object_key_at(object, i, &key_len);
+        serialize_string_len(w, key, key_len);
+        json_writer_putc(w, ':');
+        serialize_value(w, json_object_value_at(object, i));
+    }
+    json_writer_putc(w, '}');
+}
+
+// append obj to the writer, unknown types mark the writer as failed
+static inline void serialize_value(json_writer* w, const json_object* obj) {
+    if (w->failure) return;
+
+    switch (obj->type) {
+        case JSON_STRING: {
+            size_t len;
+            const char* str = json_string_get(obj, &len);
+            serialize_string_len(w, str, len);
+            break;
+        }
+        case JSON_RAW: {
+            size_t len;
+            const char* text = json_raw_get(obj, &len);
+            json_writer_write(w, text, len);
+            break;
+        }
         case JSON_NUMBER:
-            return serialize_number(root.value.number);
+            serialize_number(w, obj->value.number);
+            break;
         case JSON_BOOL:
-            return serialize_bool(root.value.boolean);
+            serialize_bool(w, obj->value.boolean);
+            break;
         case JSON_NULL:
-            return serialize_null();
+            serialize_null(w);
+            break;
         case JSON_LIST:
-            return serialize_list(root.value.list);
+            serialize_list(w, obj);
+            break;
         case JSON_OBJECT:
-            return serialize_object(&root);
+            serialize_object(w, obj);
+            break;
         default:
-            return NULL;
+            w->failure = TRUE;
+            break;
     }
 }
 
-static inline json_object json_get_property(json_object obj, const char* key) {
-    for (cereal_size_t i = 0; i < obj.value.object.node_count; i++) {
-        json_node node = obj.value.object.nodes[i];
-        if (strcmp(node.key, key) == 0) {
-            return node.value;
+// exact output size of the serializer, kept in step with json_write_escaped
+static inline size_t json_escaped_length(const char* str, size_t len) {
+    size_t total = len;
+    size_t i = 0;
+    while (i < len) {
+        i += json_escape_scan(str + i, len - i);
+        if (i >= len) break;
+        switch (str[i++]) {
+            case '"':
+            case '\\':
+            case '\b':
+            case '\f':
+            case '\n':
+            case '\r':
+            case '\t':
+                total += 1;
+                break;
+            default:
+                total += 5; // \u00XX
+                break;
         }
     }
-    return (json_object){ .type = JSON_NULL };
+    return total;
 }
 
-// Memory management function implementations
-static inline void json_object_free(json_object* obj) {
-    if (!obj) return;
-    
+static inline size_t json_value_size(const json_object* obj, bool_t* failure) {
+    char number[JSON_NUMBER_BUFFER_SIZE];
+    const char* str;
+    size_t len;
+    cereal_size_t count;
+    size_t total;
     switch (obj->type) {
         case JSON_STRING:
-            if (obj->value.string) {
-                free(obj->value.string);
-                obj->value.string = NULL;
-            }
-            break;
-            
+            str = json_string_get(obj, &len);
+            if (!str) break;
+            return 2 + json_escaped_length(str, len);
+        case JSON_RAW:
+            json_raw_get(obj, &len);
+            return len;
+        case JSON_NUMBER:
+            return (size_t)json_format_float(obj->value.number, number);
+        case JSON_BOOL:
+            return obj->value.boolean ? 4 : 5;
+        case JSON_NULL:
+            return 4;
         case JSON_LIST:
-            // Free each item in the list
-            for (cereal_size_t i = 0; i < obj->value.list.count; i++) {
-                json_object_free(&obj->value.list.items[i]);
+            // brackets plus a comma between items
+            count = json_list_count(obj);
+            total = count ? 1 + (size_t)count : 2;
+            if (json_list_packing(obj) != JSON_PACKED_NONE) {
+                json_packed_view view = json_list_packed(obj);
+                for (cereal_size_t i = 0; i < count; i++) {
+                    if (view.packing == JSON_PACKED_DOUBLE) {
+                        total += (size_t)json_format_double(((const double*)view.data)[i], number);
+                    } else if (view.packing == JSON_PACKED_INT64) {
+                        total += (size_t)json_format_int64(((const int64_t*)view.data)[i], number);
+                    } else {
+                        total += json_packed_bit(view.data, i) ? 4 : 5;
+                    }
+                }
+                return total;
             }
-            // Free the items array
-            if (obj->value.list.items) {
-                free(obj->value.list.items);
-                obj->value.list.items = NULL;
+            for (cereal_size_t i = 0; i < count; i++) {
+                total += json_value_size(json_list_at(obj, i), failure);
             }
-            obj->value.list.count = 0;
-            break;
-            
+            return total;
         case JSON_OBJECT:
-            // Free each node
-            for (cereal_size_t i = 0; i < obj->value.object.node_count; i++) {
-                // Free the key
-                if (obj->value.object.nodes[i].key) {
-                    free(obj->value.object.nodes[i].key);
-                    obj->value.object.nodes[i].key = NULL;
+            // braces, commas, and quotes plus colon per key
+            count = json_node_count(obj);
+            total = count ? 1 + (size_t)count * 4 : 2;
+            for (cereal_size_t i = 0; i < count; i++) {
+                str = json_object_key_at(obj, i, &len);
+                if (!str) {
+                    *failure = TRUE;
+                    return 0;
                 }
-                // Recursively free the value
-                json_object_free(&obj->value.object.nodes[i].value);
-            }
-            // Free the nodes array
-            if (obj->value.object.nodes) {
-                free(obj->value.object.nodes);
-                obj->value.object.nodes = NULL;
+                total += json_escaped_length(str, len);
+                total += json_value_size(json_object_value_at(obj, i), failure);
             }
-            obj->value.object.node_count = 0;
-            break;
-            
-        case JSON_NUMBER:
-        case JSON_BOOL:
-        case JSON_NULL:
-            // No dynamic memory to free
+            return total;
+        default:
             break;
     }
-    
-    // Reset the object type
-    obj->type = JSON_NULL;
+    *failure = TRUE;
+    return 0;
 }
 
-static inline void json_free(json* j) {
-    if (!j) return;
-    
-    // Free error text if allocated
-    if (j->error_text) {
-        free(j->error_text);
-        j->error_text = NULL;
+// length of serialize_json(j) without the terminator, 0 if j cannot be serialized
+static inline size_t json_serialized_size(const json* j) {
+    if (!j) return 0;
+    bool_t failure = FALSE;
+    size_t size = json_value_size(&j->root, &failure);
+    return failure ? 0 : size;
+}
+
+// streaming builder, writes JSON straight to a writer without building a tree.
+// Commas and colons are inserted from the nesting state, misuse (a key outside
+// an object, a value where a key is expected, unbalanced ends, more than
+// JSON_WRITER_MAX_DEPTH levels) marks the writer as failed.
+#define JSON_W_OBJECT 1     // scope is an object rather than an array
+#define JSON_W_HAS_ITEMS 2  // scope already holds a member, next one needs a comma
+#define JSON_W_AFTER_KEY 4  // object key written, its value comes next
+
+// prepare for a value in the current scope
+static inline bool_t json_w_before_value(json_writer* w) {
+    if (w->failure) return FALSE;
+    unsigned char* scope = &w->scopes[w->depth];
+    if (w->depth == 0) {
+        // a single top level value
+        if (*scope & JSON_W_HAS_ITEMS) {
+            w->failure = TRUE;
+            return FALSE;
+        }
+        *scope |= JSON_W_HAS_ITEMS;
+        return TRUE;
     }
-    
-    // Free the root object
-    json_object_free(&j->root);
-    
-    // Reset the structure
-    j->error_length = 0;
-    j->failure = FALSE;
+    if (*scope & JSON_W_OBJECT) {
+        if (!(*scope & JSON_W_AFTER_KEY)) {
+            w->failure = TRUE;
+            return FALSE;
+        }
+        *scope &= (unsigned char)~JSON_W_AFTER_KEY;
+        return TRUE;
+    }
+    if (*scope & JSON_W_HAS_ITEMS) {
+        json_writer_putc(w, ',');
+    }
+    *scope |= JSON_W_HAS_ITEMS;
+    return TRUE;
+}
+
+static inline void json_w_begin(json_writer* w, unsigned char kind, char open) {
+    if (!json_w_before_value(w)) return;
+    if (w->depth >= JSON_WRITER_MAX_DEPTH) {
+        w->failure = TRUE;
+        return;
+    }
+    w->scopes[++w->depth] = kind;
+    json_writer_putc(w, open);
+}
+
+static inline void json_w_end(json_writer* w, unsigned char kind, char close) {
+    if (w->failure) return;
+    unsigned char scope = w->scopes[w->depth];
+    if (w->depth == 0 || (scope & JSON_W_OBJECT) != kind || (scope & JSON_W_AFTER_KEY)) {
+        w->failure = TRUE;
+        return;
+    }
+    w->depth--;
+    json_writer_putc(w, close);
+}
+
+static inline void json_w_begin_object(json_writer* w) {
+    json_w_begin(w, JSON_W_OBJECT, '{');
+}
+
+static inline void json_w_end_object(json_writer* w) {
+    json_w_end(w, JSON_W_OBJECT, '}');
+}
+
+static inline void json_w_begin_array(json_writer* w) {
+    json_w_begin(w, 0, '[');
+}
+
+static inline void json_w_end_array(json_writer* w) {
+    json_w_end(w, 0, ']');
+}
+
+static inline void json_w_key_len(json_writer* w, const char* key, size_t len) {
+    if (w->failure) return;
+    unsigned char* scope = &w->scopes[w->depth];
+    if (w->depth == 0 || !(*scope & JSON_W_OBJECT) || (*scope & JSON_W_AFTER_KEY) || !key) {
+        w->failure = TRUE;
+        return;
+    }
+    if (*scope & JSON_W_HAS_ITEMS) {
+        json_writer_putc(w, ',');
+    }
+    *scope |= JSON_W_HAS_ITEMS | JSON_W_AFTER_KEY;
+    json_writer_putc(w, '"');
+    json_write_escaped(w, key, len);
+    json_writer_write(w, "\":", 2);
+}
+
+static inline void json_w_key(json_writer* w, const char* key) {
+    json_w_key_len(w, key, key ? strlen(key) : 0);
+}
+
+static inline void json_w_string_len(json_writer* w, const char* str, size_t len) {
+    if (!str) {
+        w->failure = TRUE;
+        return;
+    }
+    if (!json_w_before_value(w)) return;
+    json_writer_putc(w, '"');
+    json_write_escaped(w, str, len);
+    json_writer_putc(w, '"');
+}
+
+static inline void json_w_string(json_writer* w, const char* str) {
+    json_w_string_len(w, str, str ? strlen(str) : 0);
+}
+
+static inline void json_w_number(json_writer* w, double number) {
+    if (!json_w_before_value(w)) return;
+    serialize_double(w, number);
+}
+
+static inline void json_w_int(json_writer* w, int64_t number) {
+    if (!json_w_before_value(w)) return;
+    serialize_int64(w, number);
+}
+
+static inline void json_w_bool(json_writer* w, bool_t value) {
+    if (!json_w_before_value(w)) return;
+    serialize_bool(w, value);
+}
+
+static inline void json_w_null(json_writer* w) {
+    if (!json_w_before_value(w)) return;
+    serialize_null(w);
+}
+
+// text that is already one JSON value, such as a JSON_RAW, written unchanged
+static inline void json_w_raw(json_writer* w, const char* text, size_t len) {
+    if (!text) {
+        w->failure = TRUE;
+        return;
+    }
+    if (!json_w_before_value(w)) return;
+    json_writer_write(w, text, len);
+}
+
+// embed an existing tree as the next value
+static inline void json_w_value(json_writer* w, const json_object* obj) {
+    if (!obj) {
+        w->failure = TRUE;
+        return;
+    }
+    if (!json_w_before_value(w)) return;
+    serialize_value(w, obj);
+}
+
+// serialize json, the returned string is allocated with j->allocator
+static inline char* serialize_json(const json* j) { 
+    if (!j) return NULL;
+    return serialize_json_with_allocator(j, j->allocator);
+}
+
+static inline char* serialize_json_with_allocator(const json* j, const json_allocator* alloc) {
+    if (!j) return NULL;
+
+    json_writer w;
+    json_writer_init(&w, alloc);
+    serialize_value(&w, &j->root);
+    return json_writer_finish(&w);
+}
+
+// serialize into buffer without allocating. Returns the output length, null
+// terminated when capacity allows, or 0 if the output does not fit; size the
+// buffer with json_serialized_size.
+static inline size_t serialize_json_into(const json* j, char* buffer, size_t capacity) {
+    if (!j || !buffer) return 0;
+    json_writer w;
+    json_writer_init_fixed(&w, buffer, capacity);
+    serialize_value(&w, &j->root);
+    if (!json_writer_finish(&w)) return 0;
+    return w.length;
+}
+
+// stream j to write_fn through a fixed JSON_WRITER_FLUSH_SIZE buffer,
+// memory use stays bounded regardless of document size
+static inline bool_t serialize_json_to(const json* j, json_write_fn write_fn, void* user) {
+    return serialize_json_to_sink(j, write_fn, NULL, user);
+}
+
+// serialize_json_to with an optional writev_fn, which receives large chunks
+// together with the pending buffer in one call
+static inline bool_t serialize_json_to_sink(const json* j, json_write_fn write_fn, json_writev_fn writev_fn, void* user) {
+    if (!j || !write_fn) return FALSE;
+
+    json_writer w;
+    json_writer_init_sink(&w, write_fn, writev_fn, user, j->allocator);
+    serialize_value(&w, &j->root);
+    json_writer_flush(&w);
+    json_writer_free(&w);
+    return !w.failure;
+}
+
+static inline bool_t json_file_write(void* user, const char* data, size_t length) {
+    return fwrite(data, 1, length, (FILE*)user) == length;
+}
+
+static inline bool_t serialize_json_to_file(const json* j, FILE* file) {
+    if (!file) return FALSE;
+    return serialize_json_to(j, json_file_write, file);
+}
+
+#ifdef CERIALIZE_POSIX
+#define JSON_FD_IOV 16 // chunks handed to one writev
+
+// writes every chunk to the fd pointed to by user, JSON_FD_IOV at a time,
+// retrying short writes
+static inline bool_t json_fd_writev(void* user, const json_iovec* chunks, int count) {
+    int fd = *(const int*)user;
+    struct iovec iov[JSON_FD_IOV];
+    int c = 0;
+    while (c < count) {
+        int remaining = 0;
+        for (; c < count && remaining < JSON_FD_IOV; c++) {
+            if (chunks[c].length == 0) continue;
+            iov[remaining].iov_base = (void*)chunks[c].data;
+            iov[remaining].iov_len = chunks[c].length;
+            remaining++;
+        }
+        struct iovec* cur = iov;
+        while (remaining > 0) {
+            ssize_t written = writev(fd, cur, remaining);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return FALSE;
+            }
+            size_t done = (size_t)written;
+            while (remaining > 0 && done >= cur->iov_len) {
+                done -= cur->iov_len;
+                cur++;
+                remaining--;
+            }
+            if (remaining > 0) {
+                cur->iov_base = (char*)cur->iov_base + done;
+                cur->iov_len -= done;
+            }
+        }
+    }
+    return TRUE;
+}
+
+static inline bool_t json_fd_write(void* user, const char* data, size_t length) {
+    json_iovec chunk = { data, length };
+    return json_fd_writev(user, &chunk, 1);
+}
+
+// stream j to a raw file descriptor, large strings are batched with the buffer in one writev
+static inline bool_t serialize_json_to_fd(const json* j, int fd) {
+    if (!j || fd < 0) return FALSE;
+    return serialize_json_to_sink(j, json_fd_write, json_fd_writev, &fd);
+}
+#endif
+
+// text level reformatting, works on the byte stream without building a tree.
+// Input is assumed to be JSON; nothing is validated and numbers, escapes and
+// key order pass through untouched.
+
+// first index in str of whitespace or a quote
+static inline size_t json_scan_structural(const char* str, size_t len) {
+    size_t i = 0;
+#ifdef CERIALIZE_SSE2
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriage = _mm_set1_epi8('\r');
+    const __m128i quote = _mm_set1_epi8('"');
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, newline), _mm_cmpeq_epi8(block, carriage)),
+                         _mm_cmpeq_epi8(block, quote)));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(hits);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+#endif
+    while (i < len && !is_whitespace(str[i]) && str[i] != LEX_QUOTE) {
+        i++;
+    }
+    return i;
+}
+
+// first index in str that is not whitespace
+static inline size_t json_scan_whitespace(const char* str, size_t len) {
+    size_t i = 0;
+#ifdef CERIALIZE_SSE2
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriage = _mm_set1_epi8('\r');
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(block, newline), _mm_cmpeq_epi8(block, carriage)));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(hits) ^ 0xFFFFu;
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+#endif
+    while (i < len && is_whitespace(str[i])) {
+        i++;
+    }
+    return i;
+}
+
+// first index in str of a quote or backslash, i.e. where string content may end
+static inline size_t json_scan_string_content(const char* str, size_t len) {
+    size_t i = 0;
+#ifdef CERIALIZE_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(hits);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+#endif
+    while (i < len && str[i] != LEX_QUOTE && str[i] != '\\') {
+        i++;
+    }
+    return i;
+}
+
+// length of the string token starting at the opening quote in str, including both quotes
+static inline size_t json_string_token_length(const char* str, size_t len) {
+    size_t i = 1;
+    while (i < len) {
+        i += json_scan_string_content(str + i, len - i);
+        if (i >= len) break;
+        if (str[i] == LEX_QUOTE) return i + 1;
+        i += 2; // backslash and the escaped byte
+    }
+    return len;
+}
+
+// strip all insignificant whitespace. output needs room for length bytes and may
+// equal input; returns the minified length, no null terminator is written.
+static inline size_t json_minify(const char* input, size_t length, char* output) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < length) {
+        size_t run = json_scan_structural(input + in, length - in);
+        if (run > 0) {
+            memmove(output + out, input + in, run);
+            out += run;
+            in += run;
+            continue;
+        }
+        if (input[in] == LEX_QUOTE) {
+            size_t token = json_string_token_length(input + in, length - in);
+            memmove(output + out, input + in, token);
+            out += token;
+            in += token;
+            continue;
+        }
+        in += json_scan_whitespace(input + in, length - in);
+    }
+    return out;
+}
+
+static inline size_t json_minify_inplace(char* buffer, size_t length) {
+    size_t minified = json_minify(buffer, length, buffer);
+    if (minified < length) buffer[minified] = '\0';
+    return minified;
+}
+
+static inline void json_pretty_newline(json_writer* w, cereal_size_t indent, cereal_size_t depth) {
+    size_t spaces = (size_t)indent * depth;
+    if (w->sink && spaces + 2 > JSON_WRITER_FLUSH_SIZE) {
+        // too deep for a sink buffer in one go, fall back to single bytes
+        json_writer_putc(w, '\n');
+        for (size_t k = 0; k < spaces; k++) json_writer_putc(w, ' ');
+        return;
+    }
+    if (!json_writer_reserve(w, spaces + 1)) return;
+    w->data[w->length++] = '\n';
+    memset(w->data + w->length, ' ', spaces);
+    w->length += spaces;
+}
+
+// re-indent input with indent spaces per level, empty containers stay on one line
+static inline bool_t json_prettify(const char* input, size_t length, cereal_size_t indent, json_writer* output) {
+    if (!input || !output) return FALSE;
+    cereal_size_t depth = 0;
+    size_t i = 0;
+    while (i < length && !output->failure) {
+        i += json_scan_whitespace(input + i, length - i);
+        if (i >= length) break;
+
+        char c = input[i];
+        switch (c) {
+            case LEX_QUOTE: {
+                size_t token = json_string_token_length(input + i, length - i);
+                json_writer_write(output, input + i, token);
+                i += token;
+                break;
+            }
+            case LEX_OPEN_BRACE:
+            case LEX_OPEN_SQUARE: {
+                char close = c == LEX_OPEN_BRACE ? LEX_CLOSE_BRACE : LEX_CLOSE_SQUARE;
+                size_t next = i + 1 + json_scan_whitespace(input + i + 1, length - i - 1);
+                json_writer_putc(output, c);
+                if (next < length && input[next] == close) {
+                    json_writer_putc(output, close);
+                    i = next + 1;
+                    break;
+                }
+                depth++;
+                json_pretty_newline(output, indent, depth);
+                i++;
+                break;
+            }
+            case LEX_CLOSE_BRACE:
+            case LEX_CLOSE_SQUARE:
+                if (depth > 0) depth--;
+                json_pretty_newline(output, indent, depth);
+                json_writer_putc(output, c);
+                i++;
+                break;
+            case LEX_COMMA:
+                json_writer_putc(output, c);
+                json_pretty_newline(output, indent, depth);
+                i++;
+                break;
+            case LEX_COLON:
+                json_writer_write(output, ": ", 2);
+                i++;
+                break;
+            default: {
+                // numbers and literals run until the next structural byte
+                size_t run = 1;
+                while (i + run < length) {
+                    char next = input[i + run];
+                    if (is_whitespace(next) || next == LEX_COMMA || next == LEX_COLON || next == LEX_QUOTE
+                        || next == LEX_CLOSE_BRACE || next == LEX_CLOSE_SQUARE
+                        || next == LEX_OPEN_BRACE || next == LEX_OPEN_SQUARE) {
+                        break;
+                    }
+                    run++;
+                }
+                json_writer_write(output, input + i, run);
+                i += run;
+                break;
+            }
+        }
+    }
+    return !output->failure;
+}
+
+static inline json_object json_get_property(json_object obj, const char* key) {
+    if (json_typeof(&obj) != JSON_OBJECT) return (json_object){ .type = JSON_NULL };
+    size_t key_len = strlen(key);
+    for (cereal_size_t i = 0; i < json_node_count(&obj); i++) {
+        size_t len;
+        const char* node_key = json_object_key_at(&obj, i, &len);
+        if (node_key && len == key_len && memcmp(node_key, key, len) == 0) {
+            return *json_object_value_at(&obj, i);
+        }
+    }
+    return (json_object){ .type = JSON_NULL };
+}
+
+// Memory management function implementations
+static inline void json_object_free(json_object* obj) {
+    json_object_free_with_allocator(obj, NULL);
+}
+
+// releases what obj owns itself, its children must already have been freed
+static inline void json_object_free_shallow(json_object* obj, const json_allocator* alloc) {
+    switch (obj->type) {
+        case JSON_STRING:
+        case JSON_RAW:
+            json_dealloc(alloc, json_string_heap(obj));
+            break;
+        case JSON_LIST:
+            // the items array, or the raw buffer of a packed list
+            json_dealloc(alloc, json_container_block(obj, json_list_data(obj)));
+            break;
+        case JSON_OBJECT:
+            if (obj->flags & JSON_FLAG_SHAPED) {
+                // keys belong to the shared shape
+                json_shape_release(obj->value.shaped->shape, alloc);
+                json_dealloc(alloc, json_container_block(obj, obj->value.shaped));
+            } else {
+                json_node* nodes = json_nodes(obj);
+                for (cereal_size_t i = 0; i < json_node_count(obj); i++) {
+                    json_dealloc(alloc, json_node_key_heap(&nodes[i]));
+                }
+                json_dealloc(alloc, json_container_block(obj, nodes));
+            }
+            break;
+        default:
+            // No dynamic memory to free
+            break;
+    }
+    json_set_null(obj);
+    obj->flags = 0;
+}
+
+// values nested directly in obj, 0 for scalars and packed lists
+static inline cereal_size_t json_child_count(const json_object* obj) {
+    if (obj->type == JSON_LIST) return json_list_packing(obj) == JSON_PACKED_NONE ? json_list_count(obj) : 0;
+    if (obj->type == JSON_OBJECT) return json_node_count(obj);
+    return 0;
+}
+
+static inline json_object* json_child_at(const json_object* obj, cereal_size_t index) {
+    return obj->type == JSON_LIST ? &json_list_items(obj)[index] : json_object_value_at(obj, index);
+}
+
+// Drop obj's reference to a shared container. TRUE while other trees still
+// hold it, and obj is then reset without touching its contents.
+static inline bool_t json_share_drop(json_object* obj) {
+    if (!json_is_shared(obj)) return FALSE;
+    json_share_header* header = (json_share_header*)json_container_storage(obj) - 1;
+    if (JSON_REF_DEC(header->refs) == 0) return FALSE;
+    json_set_null(obj);
+    obj->flags = 0;
+    return TRUE;
+}
+
+#define JSON_FREE_STACK 64
+
+typedef struct json_free_frame {
+    json_object* obj;
+    cereal_size_t next; // first child not freed yet
+} json_free_frame;
+
+// Depth first with an explicit stack, so the depth of a document never reaches
+// the C stack. Frames past JSON_FREE_STACK levels come from alloc; if that
+// fails the subtree is handed to a nested call with a fresh local stack.
+static inline void json_object_free_with_allocator(json_object* obj, const json_allocator* alloc) {
+    if (!obj || json_share_drop(obj)) return;
+
+    json_free_frame local[JSON_FREE_STACK];
+    json_free_frame* stack = local;
+    size_t capacity = JSON_FREE_STACK;
+    size_t depth = 1;
+    stack[0].obj = obj;
+    stack[0].next = 0;
+    while (depth > 0) {
+        json_free_frame* top = &stack[depth - 1];
+        if (top->next == json_child_count(top->obj)) {
+            json_object_free_shallow(top->obj, alloc);
+            depth--;
+            continue;
+        }
+        json_object* child = json_child_at(top->obj, top->next++);
+        if (json_share_drop(child)) continue;
+        if (json_child_count(child) == 0) {
+            json_object_free_shallow(child, alloc);
+            continue;
+        }
+        if (depth == capacity) {
+            json_free_frame* grown = (json_free_frame*)json_alloc(alloc, sizeof(json_free_frame) * capacity * 2);
+            if (!grown) {
+                json_object_free_with_allocator(child, alloc);
+                continue;
+            }
+            memcpy(grown, stack, sizeof(json_free_frame) * depth);
+            if (stack != local) json_dealloc(alloc, stack);
+            stack = grown;
+            capacity *= 2;
+        }
+        stack[depth].obj = child;
+        stack[depth].next = 0;
+        depth++;
+    }
+    if (stack != local) json_dealloc(alloc, stack);
+}
+
+// frees everything with the allocator the json was parsed with
+static inline void json_free(json* j) {
+    if (!j) return;
+    
+    // Free error text if allocated
+    if (j->error_text && j->error_text != json_alloc_error_text()) {
+        json_dealloc(j->allocator, j->error_text);
+    }
+    j->error_text = NULL;
+    
+    // Free the root object, or the block it was compacted into
+    if (j->block) {
+        json_dealloc(j->allocator, j->block);
+        j->block = NULL;
+        json_set_null(&j->root);
+    } else {
+        json_object_free_with_allocator(&j->root, j->allocator);
+    }
+    
+    // Reset the structure
+    j->error_length = 0;
+    j->failure = FALSE;
+}
+
+// Mutation. Lists and objects grown through these functions keep spare room
+// and double when they fill up, so n appends cost O(n) copies in total rather
+// than a realloc per element. Parsed containers start exact and take their
+// first growth on the first insert. Packed lists and shaped objects are turned
+// back into plain ones before a change that needs it. Shared containers and
+// those in a compact block are read only and make every one of these fail,
+// see json_share_set instead.
+
+// slots allocated for obj's items or nodes, count when it holds exactly count
+static inline cereal_size_t json_capacity_of(const json_object* obj, cereal_size_t count) {
+    unsigned char code = json_capacity_code(obj);
+    return code ? (cereal_size_t)1 << (code - 1) : count;
+}
+
+// smallest power of two that fits needed, at least 4 and twice current. 0 when
+// that is more than a cereal_size_t count can address.
+static inline unsigned char json_capacity_grow(cereal_size_t current, cereal_size_t needed) {
+    size_t target = (size_t)current * 2 > needed ? (size_t)current * 2 : needed;
+    unsigned char code = 3; // 4 slots
+    while (((size_t)1 << (code - 1)) < target) code++;
+    return code <= 8 * sizeof(cereal_size_t) ? code : 0;
+}
+
+// replace a packed list with one json_object per element
+static inline bool_t json_list_unpack(json_object* list, const json_allocator* alloc) {
+    if (json_list_packing(list) == JSON_PACKED_NONE) return TRUE;
+    cereal_size_t count = json_list_count(list);
+    unsigned char code = json_capacity_grow(0, count);
+    if (!code) return FALSE;
+    json_object* items = (json_object*)json_alloc(alloc, sizeof(json_object) * ((size_t)1 << (code - 1)));
+    if (!items) return FALSE;
+    for (cereal_size_t i = 0; i < count; i++) {
+        items[i] = json_list_get(list, i);
+    }
+    json_dealloc(alloc, json_list_data(list));
+    json_set_list(list, items, count);
+    json_set_capacity_code(list, code);
+    return TRUE;
+}
+
+// give a shaped object its own nodes, the keys are copied out of the shape
+static inline bool_t json_object_unshape(json_object* obj, const json_allocator* alloc) {
+    if (!(obj->flags & JSON_FLAG_SHAPED)) return TRUE;
+    json_shaped* shaped = obj->value.shaped;
+    cereal_size_t count = shaped->shape->count;
+    unsigned char code = json_capacity_grow(0, count);
+    if (!code) return FALSE;
+    json_node* nodes = (json_node*)json_alloc(alloc, sizeof(json_node) * ((size_t)1 << (code - 1)));
+    if (!nodes) return FALSE;
+    for (cereal_size_t i = 0; i < count; i++) {
+        const json_shape_key* key = &shaped->shape->keys[i];
+        if (!json_node_set_key_copy(&nodes[i], key->text, key->length, alloc)) {
+            while (i-- > 0) json_dealloc(alloc, json_node_key_heap(&nodes[i]));
+            json_dealloc(alloc, nodes);
+            return FALSE;
+        }
+        nodes[i].value = shaped->values[i];
+    }
+    json_shape_release(shaped->shape, alloc);
+    json_dealloc(alloc, shaped);
+    json_set_object(obj, nodes, count);
+    json_set_capacity_code(obj, code);
+    return TRUE;
+}
+
+// make room for capacity items without further allocations
+static inline bool_t json_list_reserve(json_object* list, cereal_size_t capacity, const json_allocator* alloc) {
+    if (json_typeof(list) != JSON_LIST || json_is_read_only(list) || !json_list_unpack(list, alloc)) return FALSE;
+    cereal_size_t count = json_list_count(list);
+    cereal_size_t current = json_capacity_of(list, count);
+    if (capacity <= current) return TRUE;
+    unsigned char code = json_capacity_grow(current, capacity);
+    if (!code) return FALSE;
+    json_object* items = (json_object*)json_realloc(alloc, json_list_items(list), sizeof(json_object) * ((size_t)1 << (code - 1)));
+    if (!items) return FALSE;
+    json_set_list(list, items, count);
+    json_set_capacity_code(list, code);
+    return TRUE;
+}
+
+// move value into list before index, the list owns it on success
+static inline bool_t json_list_insert(json_object* list, cereal_size_t index, json_object value, const json_allocator* alloc) {
+    if (json_typeof(list) != JSON_LIST || !json_list_reserve(list, json_list_count(list) + 1, alloc)) return FALSE;
+    cereal_size_t count = json_list_count(list);
+    if (index > count) return FALSE;
+    json_object* items = json_list_items(list);
+    unsigned char code = json_capacity_code(list);
+    memmove(&items[index + 1], &items[index], sizeof(json_object) * (count - index));
+    items[index] = value;
+    json_set_list(list, items, count + 1);
+    json_set_capacity_code(list, code);
+    return TRUE;
+}
+
+static inline bool_t json_list_append(json_object* list, json_object value, const json_allocator* alloc) {
+    return json_list_insert(list, json_typeof(list) == JSON_LIST ? json_list_count(list) : 0, value, alloc);
+}
+
+// free the item at index and close the gap, O(1) for the last item
+static inline bool_t json_list_remove(json_object* list, cereal_size_t index, const json_allocator* alloc) {
+    if (json_typeof(list) != JSON_LIST || json_is_read_only(list) || index >= json_list_count(list)) return FALSE;
+    if (!json_list_unpack(list, alloc)) return FALSE;
+    cereal_size_t count = json_list_count(list);
+    json_object* items = json_list_items(list);
+    unsigned char code = json_capacity_code(list);
+    json_object_free_with_allocator(&items[index], alloc);
+    memmove(&items[index], &items[index + 1], sizeof(json_object) * (count - index - 1));
+    // an exact list stays exact, its freed slot is simply not counted
+    json_set_list(list, items, count - 1);
+    json_set_capacity_code(list, code);
+    return TRUE;
+}
+
+// make room for capacity members without further allocations
+static inline bool_t json_object_reserve(json_object* obj, cereal_size_t capacity, const json_allocator* alloc) {
+    if (json_typeof(obj) != JSON_OBJECT || json_is_read_only(obj) || !json_object_unshape(obj, alloc)) return FALSE;
+    cereal_size_t count = json_node_count(obj);
+    cereal_size_t current = json_capacity_of(obj, count);
+    if (capacity <= current) return TRUE;
+    unsigned char code = json_capacity_grow(current, capacity);
+    if (!code) return FALSE;
+    json_node* nodes = (json_node*)json_realloc(alloc, json_nodes(obj), sizeof(json_node) * ((size_t)1 << (code - 1)));
+    if (!nodes) return FALSE;
+    json_set_object(obj, nodes, count);
+    json_set_capacity_code(obj, code);
+    return TRUE;
+}
+
+// index of key among obj's members, json_node_count when it is not there
+static inline cereal_size_t json_object_index(const json_object* obj, const char* key, size_t length) {
+    cereal_size_t count = json_node_count(obj);
+    for (cereal_size_t i = 0; i < count; i++) {
+        size_t len;
+        const char* member = json_object_key_at(obj, i, &len);
+        if (member && len == length && memcmp(member, key, len) == 0) return i;
+    }
+    return count;
+}
+
+// Move value into obj under key, freeing the value it replaces. A new key is
+// copied and appended; replacing a value keeps a shaped object shaped. On
+// failure obj is unchanged and the caller still owns value.
+static inline bool_t json_object_set(json_object* obj, const char* key, json_object value, const json_allocator* alloc) {
+    if (json_typeof(obj) != JSON_OBJECT || json_is_read_only(obj)) return FALSE;
+    size_t length = strlen(key);
+    cereal_size_t index = json_object_index(obj, key, length);
+    if (index < json_node_count(obj)) {
+        json_object* slot = json_object_value_at(obj, index);
+        json_object_free_with_allocator(slot, alloc);
+        *slot = value;
+        return TRUE;
+    }
+    if (!json_object_reserve(obj, index + 1, alloc)) return FALSE;
+    json_node* nodes = json_nodes(obj);
+    if (!json_node_set_key_copy(&nodes[index], key, length, alloc)) return FALSE;
+    nodes[index].value = value;
+    unsigned char code = json_capacity_code(obj);
+    json_set_object(obj, nodes, index + 1);
+    json_set_capacity_code(obj, code);
+    return TRUE;
+}
+
+// free key and its value, keeping the other members in order. FALSE when obj
+// has no such key.
+static inline bool_t json_object_remove(json_object* obj, const char* key, const json_allocator* alloc) {
+    if (json_typeof(obj) != JSON_OBJECT || json_is_read_only(obj)) return FALSE;
+    size_t length = strlen(key);
+    cereal_size_t index = json_object_index(obj, key, length);
+    cereal_size_t count = json_node_count(obj);
+    if (index == count || !json_object_unshape(obj, alloc)) return FALSE;
+    json_node* nodes = json_nodes(obj);
+    unsigned char code = json_capacity_code(obj);
+    json_dealloc(alloc, json_node_key_heap(&nodes[index]));
+    json_object_free_with_allocator(&nodes[index].value, alloc);
+    memmove(&nodes[index], &nodes[index + 1], sizeof(json_node) * (count - index - 1));
+    json_set_object(obj, nodes, count - 1);
+    json_set_capacity_code(obj, code);
+    return TRUE;
+}
+
+// Shared immutable trees. json_share turns every list and object of a tree
+// into a reference counted, read only container. json_share_set and
+// json_share_remove then derive a new version along one JSON Pointer path:
+// only the containers on the path are copied, every other subtree is shared
+// with the old version, so an update costs the depth of the path times the
+// width of the containers on it rather than the size of the tree. Versions are
+// freed with json_object_free or json_free like any tree, from any thread, and
+// subtrees go away with the last version that holds them.
+
+#define JSON_SHARE_STACK 64
+
+// one list or object in place, its children are left as they are
+static inline bool_t json_share_container(json_object* obj, const json_allocator* alloc) {
+    if ((obj->type != JSON_LIST && obj->type != JSON_OBJECT) || json_is_shared(obj)) return TRUE;
+    if (json_capacity_code(obj) == JSON_CAPACITY_BLOCK) return FALSE;
+    void* storage = json_container_storage(obj);
+    if (!storage) return TRUE;
+    cereal_size_t count = obj->type == JSON_LIST ? json_list_count(obj) : json_node_count(obj);
+    size_t size;
+    if (obj->type == JSON_LIST) {
+        json_packing packing = json_list_packing(obj);
+        size = packing == JSON_PACKED_NONE ? sizeof(json_object) * count : json_packed_size(packing, count);
+    } else if (obj->flags & JSON_FLAG_SHAPED) {
+        size = sizeof(json_shaped) + sizeof(json_object) * count;
+    } else {
+        size = sizeof(json_node) * count;
+    }
+    json_share_header* header = (json_share_header*)json_alloc(alloc, sizeof(json_share_header) + size);
+    if (!header) return FALSE;
+    header->refs = 1;
+    header->reserved = 0;
+    memcpy(header + 1, storage, size);
+    json_dealloc(alloc, json_container_block(obj, storage));
+    if (obj->type == JSON_LIST) {
+        json_packing packing = json_list_packing(obj);
+        if (packing == JSON_PACKED_NONE) json_set_list(obj, (json_object*)(header + 1), count);
+        else json_set_packed_list(obj, packing, header + 1, count);
+    } else if (obj->flags & JSON_FLAG_SHAPED) {
+        json_set_shaped_object(obj, (json_shaped*)(header + 1));
+    } else {
+        json_set_object(obj, (json_node*)(header + 1), count);
+    }
+    json_set_capacity_code(obj, JSON_CAPACITY_SHARED);
+    return TRUE;
+}
+
+// Make every list and object under obj shareable. Subtrees that already are
+// stay as they are. On failure the tree is still valid and partly converted.
+static inline bool_t json_object_share(json_object* obj, const json_allocator* alloc) {
+    json_object* local[JSON_SHARE_STACK];
+    json_object** stack = local;
+    size_t capacity = JSON_SHARE_STACK;
+    size_t depth = 0;
+    bool_t ok = TRUE;
+    if (!json_is_shared(obj)) stack[depth++] = obj;
+    while (depth > 0 && ok) {
+        json_object* top = stack[--depth];
+        if (!json_share_container(top, alloc)) {
+            ok = FALSE;
+            break;
+        }
+        for (cereal_size_t i = 0; i < json_child_count(top); i++) {
+            json_object* child = json_child_at(top, i);
+            if ((child->type != JSON_LIST && child->type != JSON_OBJECT) || json_is_shared(child)) continue;
+            if (!json_container_storage(child)) continue;
+            if (depth == capacity) {
+                json_object** grown = (json_object**)json_alloc(alloc, sizeof(json_object*) * capacity * 2);
+                if (!grown) {
+                    ok = FALSE;
+                    break;
+                }
+                memcpy(grown, stack, sizeof(json_object*) * depth);
+                if (stack != local) json_dealloc(alloc, stack);
+                stack = grown;
+                capacity *= 2;
+            }
+            stack[depth++] = child;
+        }
+    }
+    if (stack != local) json_dealloc(alloc, stack);
+    return ok;
+}
+
+// json_object_share on a parsed document. Fails for a compacted one, whose
+// containers all live in one block.
+static inline bool_t json_share(json* j) {
+    if (!j || j->failure || j->block) return FALSE;
+    return json_object_share(&j->root, j->allocator);
+}
+
+// Another reference to src in dst: shared containers are counted, heap strings
+// copied, everything else is a plain value. FALSE for a list or object that
+// json_share has not converted, or when the string copy fails.
+static inline bool_t json_share_retain(json_object* dst, const json_object* src, const json_allocator* alloc) {
+    if (src->type == JSON_LIST || src->type == JSON_OBJECT) {
+        void* storage = json_container_storage(src);
+        if (!storage) {
+            *dst = *src;
+            return TRUE;
+        }
+        if (!json_is_shared(src)) return FALSE;
+        JSON_REF_INC(((json_share_header*)storage - 1)->refs);
+        *dst = *src;
+        return TRUE;
+    }
+    if ((src->type == JSON_STRING || src->type == JSON_RAW) && json_string_heap(src)) {
+        size_t len;
+        const char* str = json_string_get(src, &len);
+        if (!json_set_string_copy(dst, str, len, alloc)) return FALSE;
+        dst->type = src->type;
+        return TRUE;
+    }
+    *dst = *src;
+    return TRUE;
+}
+
+// JSON Pointer (RFC 6901) reference token starting after the '/' at pointer
+// and ending at the next '/' or at end, *length bytes long, still escaped
+static inline const char* json_pointer_token(const char* pointer, const char* end, size_t* length) {
+    const char* slash = (const char*)memchr(pointer + 1, '/', (size_t)(end - pointer - 1));
+    *length = (size_t)((slash ? slash : end) - pointer - 1);
+    return pointer + 1;
+}
+
+// escaped token against a raw key, ~0 is '~' and ~1 is '/'
+static inline bool_t json_pointer_token_equals(const char* token, size_t token_len, const char* key, size_t key_len) {
+    size_t k = 0;
+    for (size_t t = 0; t < token_len; t++, k++) {
+        char c = token[t];
+        if (c == '~' && t + 1 < token_len) {
+            c = token[t + 1] == '0' ? '~' : token[t + 1] == '1' ? '/' : 0;
+            if (!c) return FALSE;
+            t++;
+        }
+        if (k >= key_len || key[k] != c) return FALSE;
+    }
+    return k == key_len;
+}
+
+// list index named by token, count for "-", a value past count when invalid
+static inline cereal_size_t json_pointer_index(const char* token, size_t length, cereal_size_t count) {
+    if (length == 1 && token[0] == '-') return count;
+    if (length == 0 || length > 9 || (length > 1 && token[0] == '0')) return (cereal_size_t)-1;
+    cereal_size_t index = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (token[i] < '0' || token[i] > '9') return (cereal_size_t)-1;
+        index = index * 10 + (cereal_size_t)(token[i] - '0');
+    }
+    return index;
+}
+
+// member index of an object named by token, the count when there is none
+static inline cereal_size_t json_pointer_member(const json_object* obj, const char* token, size_t length) {
+    cereal_size_t count = json_node_count(obj);
+    for (cereal_size_t i = 0; i < count; i++) {
+        size_t key_len;
+        const char* key = json_object_key_at(obj, i, &key_len);
+        if (json_pointer_token_equals(token, length, key ? key : "", key_len)) return i;
+    }
+    return count;
+}
+
+// value at the JSON Pointer of length bytes at pointer, root for an empty one.
+// NULL when a step is missing or lands inside a packed list.
+static inline json_object* json_pointer_get_length(const json_object* root, const char* pointer, size_t length) {
+    const json_object* current = root;
+    const char* end = pointer + length;
+    while (pointer < end) {
+        if (*pointer != '/') return NULL;
+        const char* token = json_pointer_token(pointer, end, &length);
+        if (current->type == JSON_OBJECT) {
+            cereal_size_t index = json_pointer_member(current, token, length);
+            if (index == json_node_count(current)) return NULL;
+            current = json_object_value_at(current, index);
+        } else if (current->type == JSON_LIST && json_list_packing(current) == JSON_PACKED_NONE) {
+            cereal_size_t index = json_pointer_index(token, length, json_list_count(current));
+            if (index >= json_list_count(current)) return NULL;
+            current = json_list_at(current, index);
+        } else {
+            return NULL;
+        }
+        pointer = token + length;
+    }
+    return (json_object*)current;
+}
+
+// value at a JSON Pointer such as "/servers/0/port", see json_pointer_get_length
+static inline json_object* json_pointer_get(const json_object* root, const char* pointer) {
+    return json_pointer_get_length(root, pointer, strlen(pointer));
+}
+
+typedef enum {
+    JSON_SHARE_REPLACE, // value takes the place of member index
+    JSON_SHARE_INSERT, // value goes in before index, under key for objects
+    JSON_SHARE_REMOVE // member index is left out
+} json_share_op;
+
+// Shared copy of container src in dst with one change at index. Untouched
+// members and value are retained, value must already be shared.
+static inline bool_t json_share_rebuild(json_object* dst, const json_object* src, json_share_op op, cereal_size_t index,
+        const char* token, size_t token_len, const json_object* value, const json_allocator* alloc) {
+    cereal_size_t count = src->type == JSON_LIST ? json_list_count(src) : json_node_count(src);
+    cereal_size_t new_count = count + (op == JSON_SHARE_INSERT) - (op == JSON_SHARE_REMOVE);
+    const json_shape* shape = json_object_shape(src);
+    size_t slot = src->type == JSON_LIST || (shape && op == JSON_SHARE_REPLACE) ? sizeof(json_object) : sizeof(json_node);
+    size_t head = shape && op == JSON_SHARE_REPLACE ? sizeof(json_shaped) : 0;
+    json_share_header* header = (json_share_header*)json_alloc(alloc, sizeof(json_share_header) + head + slot * new_count);
+    if (!header) return FALSE;
+    header->refs = 1;
+    header->reserved = 0;
+    char* storage = (char*)(header + 1);
+    json_object* items = src->type == JSON_LIST || head ? (json_object*)(storage + head) : NULL;
+    json_node* nodes = items ? NULL : (json_node*)storage;
+
+    cereal_size_t out = 0;
+    bool_t ok = TRUE;
+    for (cereal_size_t i = 0; i <= count && ok; i++) {
+        if (i == index && op == JSON_SHARE_INSERT) {
+            if (nodes) {
+                // the new key, unescaped from its pointer token
+                char small[64];
+                char* key = token_len < sizeof(small) ? small : (char*)json_alloc(alloc, token_len + 1);
+                size_t key_len = 0;
+                if (!key) {
+                    ok = FALSE;
+                    break;
+                }
+                for (size_t t = 0; t < token_len; t++) {
+                    char c = token[t];
+                    if (c == '~' && t + 1 < token_len) c = token[++t] == '0' ? '~' : '/';
+                    key[key_len++] = c;
+                }
+                ok = json_node_set_key_copy(&nodes[out], key, key_len, alloc);
+                if (key != small) json_dealloc(alloc, key);
+                if (!ok) break;
+                if (!json_share_retain(&nodes[out].value, value, alloc)) {
+                    json_dealloc(alloc, json_node_key_heap(&nodes[out]));
+                    ok = FALSE;
+                    break;
+                }
+                out++;
+            } else {
+                ok = json_share_retain(&items[out], value, alloc);
+                if (!ok) break;
+                out++;
+            }
+        }
+        if (i == count) break;
+        if (i == index && op == JSON_SHARE_REMOVE) continue;
+        json_object* target = nodes ? &nodes[out].value : &items[out];
+        if (nodes) {
+            size_t key_len;
+            const char* key = json_object_key_at(src, i, &key_len);
+            if (!json_node_set_key_copy(&nodes[out], key ? key : "", key_len, alloc)) {
+                ok = FALSE;
+                break;
+            }
+        }
+        const json_object* member = i == index && op == JSON_SHARE_REPLACE ? value : NULL;
+        if (!member && src->type == JSON_LIST && json_list_packing(src) != JSON_PACKED_NONE) {
+            // a packed list on the path comes out unpacked
+            *target = json_list_get(src, i);
+        } else if (!member) {
+            member = src->type == JSON_LIST ? json_list_at(src, i) : json_object_value_at(src, i);
+        }
+        if (member && !json_share_retain(target, member, alloc)) {
+            if (nodes) json_dealloc(alloc, json_node_key_heap(&nodes[out]));
+            ok = FALSE;
+            break;
+        }
+        out++;
+    }
+    if (!ok) {
+        // drop the references taken so far
+        for (cereal_size_t k = 0; k < out; k++) {
+            json_object_free_with_allocator(nodes ? &nodes[k].value : &items[k], alloc);
+            if (nodes) json_dealloc(alloc, json_node_key_heap(&nodes[k]));
+        }
+        json_dealloc(alloc, header);
+        return FALSE;
+    }
+
+    if (src->type == JSON_LIST) {
+        json_set_list(dst, items, new_count);
+    } else if (head) {
+        json_shaped* shaped = (json_shaped*)storage;
+        shaped->shape = (json_shape*)shape;
+        JSON_REF_INC(shaped->shape->refs);
+        json_set_shaped_object(dst, shaped);
+    } else {
+        json_set_object(dst, nodes, new_count);
+    }
+    json_set_capacity_code(dst, JSON_CAPACITY_SHARED);
+    return TRUE;
+}
+
+// new version of root in dst with the change at pointer, value already shared
+static inline bool_t json_share_path(json_object* dst, const json_object* root, const char* pointer, const char* end,
+        bool_t remove, const json_object* value, const json_allocator* alloc) {
+    if (*pointer != '/') return FALSE;
+    size_t length;
+    const char* token = json_pointer_token(pointer, end, &length);
+    const char* rest = token + length;
+    cereal_size_t count, index;
+    const json_object* child;
+    if (root->type == JSON_OBJECT) {
+        count = json_node_count(root);
+        index = json_pointer_member(root, token, length);
+        child = index < count ? json_object_value_at(root, index) : NULL;
+    } else if (root->type == JSON_LIST) {
+        count = json_list_count(root);
+        index = json_pointer_index(token, length, count);
+        if (index > count) return FALSE;
+        child = index < count && json_list_packing(root) == JSON_PACKED_NONE ? json_list_at(root, index) : NULL;
+    } else {
+        return FALSE;
+    }
+    if (rest < end) {
+        if (!child) return FALSE;
+        json_object updated;
+        if (!json_share_path(&updated, child, rest, end, remove, value, alloc)) return FALSE;
+        // dst takes its own reference to updated
+        bool_t ok = json_share_rebuild(dst, root, JSON_SHARE_REPLACE, index, NULL, 0, &updated, alloc);
+        json_object_free_with_allocator(&updated, alloc);
+        return ok;
+    }
+    if (remove) {
+        if (index == count) return FALSE;
+        return json_share_rebuild(dst, root, JSON_SHARE_REMOVE, index, NULL, 0, NULL, alloc);
+    }
+    json_share_op op = index < count ? JSON_SHARE_REPLACE : JSON_SHARE_INSERT;
+    return json_share_rebuild(dst, root, op, index, token, length, value, alloc);
+}
+
+// whether json_share_path can reach pointer in root, checked without allocating
+static inline bool_t json_share_reachable(const json_object* root, const char* pointer, const char* end, bool_t remove) {
+    while (pointer < end) {
+        if (*pointer != '/') return FALSE;
+        size_t length;
+        const char* token = json_pointer_token(pointer, end, &length);
+        const char* rest = token + length;
+        cereal_size_t count, index;
+        const json_object* child;
+        if (root->type == JSON_OBJECT) {
+            count = json_node_count(root);
+            index = json_pointer_member(root, token, length);
+            child = index < count ? json_object_value_at(root, index) : NULL;
+        } else if (root->type == JSON_LIST) {
+            count = json_list_count(root);
+            index = json_pointer_index(token, length, count);
+            if (index > count) return FALSE;
+            child = index < count && json_list_packing(root) == JSON_PACKED_NONE ? json_list_at(root, index) : NULL;
+        } else {
+            return FALSE;
+        }
+        if (rest == end) return !remove || index < count;
+        if (!child) return FALSE;
+        root = child;
+        pointer = rest;
+    }
+    return TRUE;
+}
+
+// Derive a new version of shared tree root in dst with *value stored at
+// pointer: an existing member or item is replaced, a new key is added, and
+// index count or "-" appends to a list. root is left as it was. *value is
+// shared and moved in on success, leaving a null behind. A pointer that does
+// not resolve fails before value is touched; when memory runs out, *value
+// stays with the caller, possibly already in shared form.
+static inline bool_t json_share_set(json_object* dst, const json_object* root, const char* pointer, json_object* value, const json_allocator* alloc) {
+    const char* end = pointer + strlen(pointer);
+    if (!json_share_reachable(root, pointer, end, FALSE)) return FALSE;
+    if (!json_object_share(value, alloc)) return FALSE;
+    if (*pointer == '\0') {
+        *dst = *value;
+        json_set_null(value);
+        return TRUE;
+    }
+    if (!json_share_path(dst, root, pointer, end, FALSE, value, alloc)) return FALSE;
+    // the new version holds its own reference
+    json_object_free_with_allocator(value, alloc);
+    return TRUE;
+}
+
+// new version of shared tree root in dst without the member or item at pointer
+static inline bool_t json_share_remove(json_object* dst, const json_object* root, const char* pointer, const json_allocator* alloc) {
+    return json_share_path(dst, root, pointer, pointer + strlen(pointer), TRUE, NULL, alloc);
+}
+
+// Contiguous copies. json_clone_compact measures a tree, then copies it into
+// one block in depth first order: each container's items or nodes are placed
+// right before the subtrees of its first child, so a traversal walks memory
+// forward. Strings and keys follow in a byte area after the values. Shapes are
+// copied once per block and stay shared by the objects in it.
+
+#define JSON_CLONE_ALIGN (sizeof(void*) > sizeof(double) ? sizeof(void*) : sizeof(double))
+
+typedef struct json_clone_shape {
+    const json_shape* source;
+    json_shape* copy;
+} json_clone_shape;
+
+// offsets into the block, base stays NULL while measuring
+typedef struct json_clone_state {
+    char* base;
+    size_t values; // next aligned offset in the value area
+    size_t bytes; // next offset in the byte area
+    size_t bytes_start;
+    json_clone_shape shapes[JSON_SHAPE_TABLE_MAX];
+    cereal_size_t shape_count;
+} json_clone_state;
+
+static inline void* json_clone_take(json_clone_state* state, size_t size) {
+    size_t offset = state->values;
+    state->values += (size + JSON_CLONE_ALIGN - 1) & ~(JSON_CLONE_ALIGN - 1);
+    return state->base ? state->base + offset : NULL;
+}
+
+static inline char* json_clone_text(json_clone_state* state, const char* text, size_t len) {
+    size_t offset = state->bytes_start + state->bytes;
+    state->bytes += len + 1;
+    if (!state->base) return NULL;
+    char* copy = state->base + offset;
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+// node keys start at an even offset, an odd address reads as an inline key
+static inline char* json_clone_key(json_clone_state* state, const char* text, size_t len) {
+    state->bytes += (state->bytes_start + state->bytes) & 1;
+    return json_clone_text(state, text, len);
+}
+
+// copy of shape in the block, NULL once the table is full
+static inline json_shape* json_clone_shape_of(json_clone_state* state, const json_shape* shape, bool_t* found) {
+    for (cereal_size_t k = 0; k < state->shape_count; k++) {
+        if (state->shapes[k].source == shape) {
+            *found = TRUE;
+            return state->shapes[k].copy;
+        }
+    }
+    *found = FALSE;
+    if (state->shape_count == JSON_SHAPE_TABLE_MAX) return NULL;
+    json_shape* copy = (json_shape*)json_clone_take(state, sizeof(json_shape) + sizeof(json_shape_key) * shape->count);
+    if (copy) {
+        copy->count = shape->count;
+        copy->refs = 1; // freed with the block, never released
+        copy->hash = shape->hash;
+    }
+    for (cereal_size_t k = 0; k < shape->count; k++) {
+        char* text = json_clone_text(state, shape->keys[k].text, shape->keys[k].length);
+        if (copy) {
+            copy->keys[k].text = text;
+            copy->keys[k].length = shape->keys[k].length;
+        }
+    }
+    state->shapes[state->shape_count].source = shape;
+    state->shapes[state->shape_count].copy = copy;
+    state->shape_count++;
+    *found = TRUE;
+    return copy;
+}
+
+// copy src into dst, reserving but not filling the storage for its children.
+// dst is NULL while measuring.
+static inline void json_clone_value(json_clone_state* state, const json_object* src, json_object* dst) {
+    if (dst) *dst = *src;
+    switch (json_typeof(src)) {
+        case JSON_STRING:
+        case JSON_RAW: {
+            size_t len;
+            const char* str = json_string_get(src, &len);
+            if (!json_string_heap(src)) break;
+            char* text = json_clone_text(state, str, len);
+            if (dst) {
+                json_set_string(dst, text);
+                dst->type = src->type;
+            }
+            break;
+        }
+        case JSON_LIST: {
+            cereal_size_t count = json_list_count(src);
+            json_packing packing = json_list_packing(src);
+            if (count == 0) {
+                if (dst) json_set_list(dst, NULL, 0);
+            } else if (packing != JSON_PACKED_NONE) {
+                size_t size = json_packed_size(packing, count);
+                void* data = json_clone_take(state, size);
+                if (dst) {
+                    memcpy(data, json_list_data(src), size);
+                    json_set_packed_list(dst, packing, data, count);
+                }
+            } else {
+                json_object* items = (json_object*)json_clone_take(state, sizeof(json_object) * count);
+                if (dst) json_set_list(dst, items, count);
+            }
+            break;
+        }
+        case JSON_OBJECT: {
+            cereal_size_t count = json_node_count(src);
+            const json_shape* shape = json_object_shape(src);
+            if (count == 0 && !shape) {
+                if (dst) json_set_object(dst, NULL, 0);
+                break;
+            }
+            if (shape) {
+                bool_t found;
+                json_shape* copy = json_clone_shape_of(state, shape, &found);
+                if (found) {
+                    json_shaped* shaped = (json_shaped*)json_clone_take(state, sizeof(json_shaped) + sizeof(json_object) * count);
+                    if (dst) {
+                        shaped->shape = copy;
+                        json_set_shaped_object(dst, shaped);
+                    }
+                    break;
+                }
+            }
+            // objects with their own keys, and shaped ones past the shape table
+            json_node* nodes = (json_node*)json_clone_take(state, sizeof(json_node) * count);
+            for (cereal_size_t k = 0; k < count; k++) {
+                size_t len;
+                const char* key = json_object_key_at(src, k, &len);
+                bool_t heap = shape || json_node_key_heap(&json_nodes(src)[k]) != NULL;
+                char* text = heap ? json_clone_key(state, key, len) : NULL;
+                if (!nodes) continue;
+                if (heap) {
+                    json_node_set_key(&nodes[k], text);
+                } else {
+                    nodes[k].key = json_nodes(src)[k].key;
+                }
+            }
+            if (dst) json_set_object(dst, nodes, count);
+            break;
+        }
+        default:
+            break;
+    }
+    if (dst && (dst->type == JSON_LIST || dst->type == JSON_OBJECT)) json_set_capacity_code(dst, JSON_CAPACITY_BLOCK);
+}
+
+typedef struct json_clone_frame {
+    const json_object* src;
+    json_object* dst; // NULL while measuring
+    cereal_size_t next;
+} json_clone_frame;
+
+// one pass over src, measuring when state->base is NULL and copying otherwise.
+// Explicit stack as in json_object_free_with_allocator.
+static inline bool_t json_clone_walk(json_clone_state* state, const json_object* src, json_object* dst, const json_allocator* alloc) {
+    json_clone_frame local[JSON_FREE_STACK];
+    json_clone_frame* stack = local;
+    size_t capacity = JSON_FREE_STACK;
+    size_t depth = 0;
+    bool_t ok = TRUE;
+
+    json_clone_value(state, src, dst);
+    if (json_child_count(src) > 0) {
+        stack[0].src = src;
+        stack[0].dst = dst;
+        stack[0].next = 0;
+        depth = 1;
+    }
+    while (depth > 0) {
+        json_clone_frame* top = &stack[depth - 1];
+        if (top->next == json_child_count(top->src)) {
+            depth--;
+            continue;
+        }
+        cereal_size_t index = top->next++;
+        const json_object* child = json_child_at(top->src, index);
+        json_object* copy = top->dst ? json_child_at(top->dst, index) : NULL;
+        json_clone_value(state, child, copy);
+        if (json_child_count(child) == 0) continue;
+        if (depth == capacity) {
+            json_clone_frame* grown = (json_clone_frame*)json_alloc(alloc, sizeof(json_clone_frame) * capacity * 2);
+            if (!grown) {
+                ok = FALSE;
+                break;
+            }
+            memcpy(grown, stack, sizeof(json_clone_frame) * depth);
+            if (stack != local) json_dealloc(alloc, stack);
+            stack = grown;
+            capacity *= 2;
+        }
+        stack[depth].src = child;
+        stack[depth].dst = copy;
+        stack[depth].next = 0;
+        depth++;
+    }
+    if (stack != local) json_dealloc(alloc, stack);
+    return ok;
+}
+
+// Deep copy of src in a single block whose first value is the copied root.
+// Release it with one json_dealloc(alloc, root), not json_object_free. The
+// copy is read only: its lists and objects carry JSON_CAPACITY_BLOCK and the
+// mutation functions refuse them.
+static inline json_object* json_clone_compact_with_allocator(const json_object* src, const json_allocator* alloc) {
+    if (!src) return NULL;
+    json_clone_state state;
+    memset(&state, 0, sizeof(state));
+    json_clone_take(&state, sizeof(json_object));
+    if (!json_clone_walk(&state, src, NULL, alloc)) return NULL;
+
+    size_t values = state.values;
+    size_t bytes = state.bytes;
+    char* block = (char*)json_alloc(alloc, values + bytes);
+    if (!block) return NULL;
+    if ((uintptr_t)block & 1) {
+        // keys would sit at odd addresses, see json_allocator
+        json_dealloc(alloc, block);
+        return NULL;
+    }
+    memset(&state, 0, sizeof(state));
+    state.base = block;
+    state.bytes_start = values;
+    json_object* root = (json_object*)json_clone_take(&state, sizeof(json_object));
+    if (!json_clone_walk(&state, src, root, alloc)) {
+        json_dealloc(alloc, block);
+        return NULL;
+    }
+    return root;
+}
+
+static inline json_object* json_clone_compact(const json_object* src) {
+    return json_clone_compact_with_allocator(src, NULL);
+}
+
+// Move j's tree into one block as json_clone_compact does and free the old
+// nodes, so a document that went through many edits is traversed sequentially
+// again. The result is read only like a compact clone; json_object_copy gives
+// an editable tree again. json_free releases the block. FALSE leaves j as it was.
+static inline bool_t json_compact(json* j) {
+    if (!j || j->failure) return FALSE;
+    json_object* root = json_clone_compact_with_allocator(&j->root, j->allocator);
+    if (!root) return FALSE;
+    if (j->block) {
+        json_dealloc(j->allocator, j->block);
+    } else {
+        json_object_free_with_allocator(&j->root, j->allocator);
+    }
+    j->block = root;
+    j->root = *root;
+    return TRUE;
+}
+
+// Structural hashing and equality. Objects compare as sets of members, so key
+// order does not matter, and numbers compare by value whether they sit in a
+// json_object or a packed list. A packed double matches a json_object number
+// at float precision, the precision the json_object keeps, and two packed
+// lists compare in full. json_hash is one post-order pass. A
+// json_hash_cache remembers the hash of every list and object it has seen, so
+// json_equal_cached rejects differing subtrees with one compare. Cached hashes
+// are keyed by container storage: clear the cache after editing or freeing a
+// tree it has seen.
+
+#define JSON_HASH_CACHE_MIN 64 // initial cache slots
+
+typedef struct json_hash_entry {
+    const void* storage; // list data or object nodes, NULL for an empty slot
+    cereal_size_t count;
+    uint64_t hash;
+} json_hash_entry;
+
+typedef struct json_hash_cache {
+    json_hash_entry* entries;
+    size_t capacity; // power of two
+    size_t used;
+    const json_allocator* alloc;
+    size_t hits;
+    size_t misses;
+} json_hash_cache;
+
+static inline void json_hash_cache_init(json_hash_cache* cache, const json_allocator* alloc) {
+    memset(cache, 0, sizeof(json_hash_cache));
+    cache->alloc = alloc;
+}
+
+// forget every hash, keeping the table
+static inline void json_hash_cache_clear(json_hash_cache* cache) {
+    if (cache->entries) memset(cache->entries, 0, sizeof(json_hash_entry) * cache->capacity);
+    cache->used = 0;
+}
+
+static inline void json_hash_cache_free(json_hash_cache* cache) {
+    json_dealloc(cache->alloc, cache->entries);
+    cache->entries = NULL;
+    cache->capacity = 0;
+    cache->used = 0;
+}
+
+// splitmix64 finalizer
+static inline uint64_t json_hash_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static inline uint64_t json_hash_bytes(const char* bytes, size_t len) {
+    uint64_t hash = 14695981039346656037ULL; // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)bytes[i]) * 1099511628211ULL;
+    }
+    return json_hash_mix(hash ^ len);
+}
+
+static inline uint64_t json_hash_number(double d) {
+    uint64_t bits;
+    if (d == 0) d = 0; // -0 equals 0
+    memcpy(&bits, &d, sizeof(bits));
+    return json_hash_mix(bits ^ ((uint64_t)JSON_NUMBER << 56));
+}
+
+static inline uint64_t json_hash_bool(bool_t b) {
+    return json_hash_mix(((uint64_t)JSON_BOOL << 56) | (b ? 1 : 0));
+}
+
+// items of a list, packed or not, or members of an object
+static inline cereal_size_t json_hash_count(const json_object* obj) {
+    if (obj->type == JSON_LIST) return json_list_count(obj);
+    return obj->type == JSON_OBJECT ? json_node_count(obj) : 0;
+}
+
+// storage that identifies a container in the cache, NULL for scalars and empty containers
+static inline const void* json_hash_storage(const json_object* obj) {
+    if (obj->type == JSON_LIST && json_list_count(obj) > 0) return json_list_data(obj);
+    if (obj->type == JSON_OBJECT && json_node_count(obj) > 0) {
+        return (obj->flags & JSON_FLAG_SHAPED) ? (const void*)obj->value.shaped : (const void*)json_nodes(obj);
+    }
+    return NULL;
+}
+
+static inline json_hash_entry* json_hash_cache_slot(const json_hash_cache* cache, const void* storage) {
+    size_t mask = cache->capacity - 1;
+    size_t i = (size_t)json_hash_mix((uint64_t)(uintptr_t)storage) & mask;
+    while (cache->entries[i].storage && cache->entries[i].storage != storage) i = (i + 1) & mask;
+    return &cache->entries[i];
+}
+
+static inline bool_t json_hash_cache_get(json_hash_cache* cache, const json_object* obj, const void* storage, uint64_t* hash) {
+    if (!cache || !cache->entries) return FALSE;
+    json_hash_entry* entry = json_hash_cache_slot(cache, storage);
+    if (entry->storage != storage || entry->count != json_hash_count(obj)) return FALSE;
+    cache->hits++;
+    *hash = entry->hash;
+    return TRUE;
+}
+
+// a full table just stops caching, hashes stay correct without it
+static inline void json_hash_cache_put(json_hash_cache* cache, const json_object* obj, const void* storage, uint64_t hash) {
+    cache->misses++;
+    if (cache->used * 2 >= cache->capacity) {
+        size_t capacity = cache->capacity ? cache->capacity * 2 : JSON_HASH_CACHE_MIN;
+        json_hash_entry* entries = (json_hash_entry*)json_alloc(cache->alloc, sizeof(json_hash_entry) * capacity);
+        if (!entries) return;
+        memset(entries, 0, sizeof(json_hash_entry) * capacity);
+        json_hash_entry* old = cache->entries;
+        size_t old_capacity = cache->capacity;
+        cache->entries = entries;
+        cache->capacity = capacity;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old[i].storage) *json_hash_cache_slot(cache, old[i].storage) = old[i];
+        }
+        json_dealloc(cache->alloc, old);
+    }
+    json_hash_entry* entry = json_hash_cache_slot(cache, storage);
+    if (!entry->storage) cache->used++;
+    entry->storage = storage;
+    entry->count = json_hash_count(obj);
+    entry->hash = hash;
+}
+
+// number or bool at index of a list in full precision, FALSE for other items
+static inline bool_t json_list_scalar_at(const json_object* list, cereal_size_t index, json_type* type, double* value) {
+    const void* data = json_list_data(list);
+    switch (json_list_packing(list)) {
+        case JSON_PACKED_DOUBLE: *type = JSON_NUMBER; *value = ((const double*)data)[index]; return TRUE;
+        case JSON_PACKED_INT64: *type = JSON_NUMBER; *value = (double)((const int64_t*)data)[index]; return TRUE;
+        case JSON_PACKED_BOOL: *type = JSON_BOOL; *value = json_packed_bit(data, index) ? 1 : 0; return TRUE;
+        default: break;
+    }
+    const json_object* item = json_list_at(list, index);
+    *type = json_typeof(item);
+    if (*type == JSON_NUMBER) *value = json_number_value(item);
+    else if (*type == JSON_BOOL) *value = json_bool_value(item) ? 1 : 0;
+    else return FALSE;
+    return TRUE;
+}
+
+// scalars read by json_list_scalar_at. A json_object number is a float, so
+// when either list is unpacked both numbers are compared at that precision.
+static inline bool_t json_equal_scalar(const json_object* a, json_type a_type, double a_value, const json_object* b, json_type b_type, double b_value) {
+    if (a_type != b_type) return FALSE;
+    if (a_type == JSON_NUMBER && (json_list_packing(a) == JSON_PACKED_NONE || json_list_packing(b) == JSON_PACKED_NONE)) {
+        return (float)a_value == (float)b_value;
+    }
+    return a_value == b_value;
+}
+
+static inline uint64_t json_hash_value(const json_object* obj, json_hash_cache* cache);
+
+static inline uint64_t json_hash_item(const json_object* list, cereal_size_t index, json_hash_cache* cache) {
+    if (json_list_packing(list) == JSON_PACKED_NONE) return json_hash_value(json_list_at(list, index), cache);
+    json_type type;
+    double value;
+    json_list_scalar_at(list, index, &type, &value);
+    // hashed as float, like the same number in a json_object
+    return type == JSON_BOOL ? json_hash_bool(value != 0) : json_hash_number((float)value);
+}
+
+static inline uint64_t json_hash_value(const json_object* obj, json_hash_cache* cache) {
+    const void* storage = json_hash_storage(obj);
+    uint64_t hash;
+    if (storage && json_hash_cache_get(cache, obj, storage, &hash)) return hash;
+    switch (json_typeof(obj)) {
+        case JSON_NUMBER:
+            return json_hash_number(json_number_value(obj));
+        case JSON_BOOL:
+            return json_hash_bool(json_bool_value(obj));
+        case JSON_STRING: {
+            size_t len;
+            const char* str = json_string_get(obj, &len);
+            return json_hash_bytes(str ? str : "", len);
+        }
+        case JSON_RAW: {
+            // raw text is compared byte for byte, not as the value it spells
+            size_t len;
+            const char* text = json_raw_get(obj, &len);
+            return json_hash_mix(json_hash_bytes(text ? text : "", len) ^ ((uint64_t)JSON_RAW << 56));
+        }
+        case JSON_LIST: {
+            hash = (uint64_t)JSON_LIST << 56;
+            for (cereal_size_t i = 0; i < json_list_count(obj); i++) {
+                hash = json_hash_mix(hash ^ json_hash_item(obj, i, cache));
+            }
+            hash = json_hash_mix(hash ^ json_list_count(obj));
+            break;
+        }
+        case JSON_OBJECT: {
+            // members are summed, so their order does not matter
+            uint64_t sum = 0;
+            for (cereal_size_t i = 0; i < json_node_count(obj); i++) {
+                size_t len;
+                const char* key = json_object_key_at(obj, i, &len);
+                uint64_t value = json_hash_value(json_object_value_at(obj, i), cache);
+                sum += json_hash_mix(json_hash_bytes(key ? key : "", len) ^ (value * 0x9e3779b97f4a7c15ULL));
+            }
+            hash = json_hash_mix(sum ^ ((uint64_t)JSON_OBJECT << 56) ^ json_node_count(obj));
+            break;
+        }
+        default:
+            return json_hash_mix((uint64_t)JSON_NULL << 56);
+    }
+    if (storage && cache) json_hash_cache_put(cache, obj, storage, hash);
+    return hash;
+}
+
+// hash of obj that ignores object key order, equal trees hash equal
+static inline uint64_t json_hash(const json_object* obj) {
+    return json_hash_value(obj, NULL);
+}
+
+// json_hash, reusing and recording the hashes of containers in cache
+static inline uint64_t json_hash_cached(const json_object* obj, json_hash_cache* cache) {
+    return json_hash_value(obj, cache);
+}
+
+static inline bool_t json_equal_value(const json_object* a, const json_object* b, json_hash_cache* cache);
+
+static inline bool_t json_equal_items(const json_object* a, const json_object* b, json_hash_cache* cache) {
+    if (json_list_packing(a) == JSON_PACKED_NONE && json_list_packing(b) == JSON_PACKED_NONE) {
+        for (cereal_size_t i = 0; i < json_list_count(a); i++) {
+            if (!json_equal_value(json_list_at(a, i), json_list_at(b, i), cache)) return FALSE;
+        }
+        return TRUE;
+    }
+    for (cereal_size_t i = 0; i < json_list_count(a); i++) {
+        json_type a_type, b_type;
+        double a_value, b_value;
+        if (!json_list_scalar_at(a, i, &a_type, &a_value) || !json_list_scalar_at(b, i, &b_type, &b_value)) return FALSE;
+        if (!json_equal_scalar(a, a_type, a_value, b, b_type, b_value)) return FALSE;
+    }
+    return TRUE;
+}
+
+static inline bool_t json_equal_keys(const json_object* a, cereal_size_t i, const json_object* b, cereal_size_t j) {
+    size_t a_len, b_len;
+    const char* a_key = json_object_key_at(a, i, &a_len);
+    const char* b_key = json_object_key_at(b, j, &b_len);
+    return a_len == b_len && (a_len == 0 || memcmp(a_key, b_key, a_len) == 0);
+}
+
+static inline bool_t json_equal_members(const json_object* a, const json_object* b, json_hash_cache* cache) {
+    cereal_size_t count = json_node_count(a);
+    cereal_size_t start = 0;
+    if (!json_object_shape(a) || json_object_shape(a) != json_object_shape(b)) {
+        // members in the same order, the common case
+        while (start < count && json_equal_keys(a, start, b, start)) start++;
+    } else {
+        start = count;
+    }
+    for (cereal_size_t i = 0; i < start; i++) {
+        if (!json_equal_value(json_object_value_at(a, i), json_object_value_at(b, i), cache)) return FALSE;
+    }
+    // the rest in any order: the nth copy of a key in a pairs with the nth copy in b
+    for (cereal_size_t i = start; i < count; i++) {
+        cereal_size_t nth = 0;
+        for (cereal_size_t k = start; k < i; k++) {
+            if (json_equal_keys(a, k, a, i)) nth++;
+        }
+        cereal_size_t j = start;
+        for (; j < count; j++) {
+            if (json_equal_keys(b, j, a, i) && nth-- == 0) break;
+        }
+        if (j == count || !json_equal_value(json_object_value_at(a, i), json_object_value_at(b, j), cache)) return FALSE;
+    }
+    return TRUE;
+}
+
+static inline bool_t json_equal_value(const json_object* a, const json_object* b, json_hash_cache* cache) {
+    if (a == b) return TRUE;
+    if (json_typeof(a) != json_typeof(b)) return FALSE;
+    switch (json_typeof(a)) {
+        case JSON_NUMBER:
+            return json_number_value(a) == json_number_value(b);
+        case JSON_BOOL:
+            return !json_bool_value(a) == !json_bool_value(b);
+        case JSON_STRING:
+        case JSON_RAW: {
+            size_t a_len, b_len;
+            const char* a_str = json_string_get(a, &a_len);
+            const char* b_str = json_string_get(b, &b_len);
+            return a_len == b_len && (a_len == 0 || memcmp(a_str, b_str, a_len) == 0);
+        }
+        case JSON_LIST:
+        case JSON_OBJECT:
+            if (json_hash_count(a) != json_hash_count(b)) return FALSE;
+            if (json_hash_count(a) == 0) return TRUE;
+            if (json_hash_storage(a) == json_hash_storage(b)) return TRUE;
+            if (cache) {
+                if (json_hash_value(a, cache) != json_hash_value(b, cache)) return FALSE;
+                // matching hashes only leave the full compare, which needs no more lookups
+                cache = NULL;
+            }
+            return json_typeof(a) == JSON_LIST ? json_equal_items(a, b, cache) : json_equal_members(a, b, cache);
+        default:
+            return TRUE;
+    }
+}
+
+// deep equality, ignoring object key order and how numbers are stored
+static inline bool_t json_equal(const json_object* a, const json_object* b) {
+    return json_equal_value(a, b, NULL);
+}
+
+// json_equal that first compares the cached hashes of a and b, so a mismatch
+// costs one compare once both sides have been hashed
+static inline bool_t json_equal_cached(const json_object* a, const json_object* b, json_hash_cache* cache) {
+    return json_equal_value(a, b, cache);
+}
+
+// Diff and patch. json_object_copy makes an ordinary deep copy of a tree.
+// json_diff describes how to turn a into b as a JSON Patch (RFC 6902): equal
+// list ends are trimmed so an insertion or removal is one operation, the rest
+// is walked in step, and containers with the same storage, as versions made
+// by json_share_set have, are skipped without looking inside. json_patch_apply
+// and json_merge_patch (RFC 7396) change a document in place, touching only
+// the containers the patch leads through.
+
+// src's own value in dst with its children left null. FALSE leaves dst null.
+static inline bool_t json_copy_value(json_object* dst, const json_object* src, const json_allocator* alloc) {
+    switch (json_typeof(src)) {
+        case JSON_STRING:
+        case JSON_RAW: {
+            size_t len;
+            const char* str = json_string_get(src, &len);
+            *dst = *src;
+            if (json_string_heap(src) && !json_set_string_copy(dst, str, len, alloc)) {
+                json_set_null(dst);
+                return FALSE;
+            }
+            dst->type = src->type;
+            return TRUE;
+        }
+        case JSON_LIST: {
+            cereal_size_t count = json_list_count(src);
+            json_packing packing = json_list_packing(src);
+            size_t size = packing == JSON_PACKED_NONE ? sizeof(json_object) * count : json_packed_size(packing, count);
+            void* data = count > 0 ? json_alloc(alloc, size) : NULL;
+            if (count > 0 && !data) {
+                json_set_null(dst);
+                return FALSE;
+            }
+            if (packing != JSON_PACKED_NONE) {
+                memcpy(data, json_list_data(src), size);
+                json_set_packed_list(dst, packing, data, count);
+                return TRUE;
+            }
+            for (cereal_size_t i = 0; i < count; i++) json_set_null(&((json_object*)data)[i]);
+            json_set_list(dst, (json_object*)data, count);
+            return TRUE;
+        }
+        case JSON_OBJECT: {
+            cereal_size_t count = json_node_count(src);
+            json_shape* shape = (json_shape*)json_object_shape(src);
+            // a shape in a compact block goes away with the block, so its keys are copied
+            if (shape && json_capacity_code(src) != JSON_CAPACITY_BLOCK) {
+                json_shaped* shaped = (json_shaped*)json_alloc(alloc, sizeof(json_shaped) + sizeof(json_object) * count);
+                if (!shaped) {
+                    json_set_null(dst);
+                    return FALSE;
+                }
+                JSON_REF_INC(shape->refs);
+                shaped->shape = shape;
+                for (cereal_size_t i = 0; i < count; i++) json_set_null(&shaped->values[i]);
+                json_set_shaped_object(dst, shaped);
+                return TRUE;
+            }
+            json_node* nodes = count > 0 ? (json_node*)json_alloc(alloc, sizeof(json_node) * count) : NULL;
+            if (count > 0 && !nodes) {
+                json_set_null(dst);
+                return FALSE;
+            }
+            for (cereal_size_t k = 0; k < count; k++) {
+                const json_node* node = shape ? NULL : &json_nodes(src)[k];
+                if (!node || json_node_key_heap(node)) {
+                    size_t len;
+                    const char* key = json_object_key_at(src, k, &len);
+                    if (!json_node_set_key_copy(&nodes[k], key, len, alloc)) {
+                        while (k-- > 0) json_dealloc(alloc, json_node_key_heap(&nodes[k]));
+                        json_dealloc(alloc, nodes);
+                        json_set_null(dst);
+                        return FALSE;
+                    }
+                } else {
+                    nodes[k].key = node->key;
+                }
+                json_set_null(&nodes[k].value);
+            }
+            json_set_object(dst, nodes, count);
+            return TRUE;
+        }
+        default:
+            *dst = *src;
+            return TRUE;
+    }
+}
+
+// Deep copy of src in dst that owns all of its storage, so it can be edited
+// and freed on its own. Shared containers come out unshared. On failure dst is
+// left null. Explicit stack as in json_object_free_with_allocator.
+static inline bool_t json_object_copy(json_object* dst, const json_object* src, const json_allocator* alloc) {
+    json_clone_frame local[JSON_FREE_STACK];
+    json_clone_frame* stack = local;
+    size_t capacity = JSON_FREE_STACK;
+    size_t depth = 0;
+    bool_t ok = TRUE;
+
+    if (!json_copy_value(dst, src, alloc)) return FALSE;
+    if (json_child_count(src) > 0) {
+        stack[0].src = src;
+        stack[0].dst = dst;
+        stack[0].next = 0;
+        depth = 1;
+    }
+    while (depth > 0) {
+        json_clone_frame* top = &stack[depth - 1];
+        if (top->next == json_child_count(top->src)) {
+            depth--;
+            continue;
+        }
+        cereal_size_t index = top->next++;
+        const json_object* child = json_child_at(top->src, index);
+        json_object* copy = json_child_at(top->dst, index);
+        if (!json_copy_value(copy, child, alloc)) {
+            ok = FALSE;
+            break;
+        }
+        if (json_child_count(child) == 0) continue;
+        if (depth == capacity) {
+            json_clone_frame* grown = (json_clone_frame*)json_alloc(alloc, sizeof(json_clone_frame) * capacity * 2);
+            if (!grown) {
+                ok = FALSE;
+                break;
+            }
+            memcpy(grown, stack, sizeof(json_clone_frame) * depth);
+            if (stack != local) json_dealloc(alloc, stack);
+            stack = grown;
+            capacity *= 2;
+        }
+        stack[depth].src = child;
+        stack[depth].dst = copy;
+        stack[depth].next = 0;
+        depth++;
+    }
+    if (stack != local) json_dealloc(alloc, stack);
+    if (!ok) {
+        // the children not reached yet are still null
+        json_object_free_with_allocator(dst, alloc);
+        json_set_null(dst);
+    }
+    return ok;
+}
+
+typedef struct json_diff_state {
+    json_object patch; // list of operations
+    char* path; // JSON Pointer of the values being compared
+    size_t length;
+    size_t capacity;
+    json_hash_cache* cache;
+    const json_allocator* alloc;
+    bool_t failed;
+} json_diff_state;
+
+// append "/" and token to the path, ~ and / escaped; returns the length to restore
+static inline size_t json_diff_push(json_diff_state* s, const char* token, size_t len) {
+    size_t mark = s->length;
+    if (s->length + 2 * len + 2 > s->capacity) {
+        size_t capacity = s->capacity ? s->capacity : 64;
+        while (capacity < s->length + 2 * len + 2) capacity *= 2;
+        char* grown = (char*)json_realloc(s->alloc, s->path, capacity);
+        if (!grown) {
+            s->failed = TRUE;
+            return mark;
+        }
+        s->path = grown;
+        s->capacity = capacity;
+    }
+    s->path[s->length++] = '/';
+    for (size_t i = 0; i < len; i++) {
+        if (token[i] == '~' || token[i] == '/') {
+            s->path[s->length++] = '~';
+            s->path[s->length++] = token[i] == '~' ? '0' : '1';
+        } else {
+            s->path[s->length++] = token[i];
+        }
+    }
+    return mark;
+}
+
+static inline size_t json_diff_push_index(json_diff_state* s, cereal_size_t index) {
+    char digits[24];
+    int len = snprintf(digits, sizeof(digits), "%lu", (unsigned long)index);
+    return json_diff_push(s, digits, (size_t)len);
+}
+
+// move value into obj under key, freeing it when that fails
+static inline bool_t json_diff_member(json_object* obj, const char* key, json_object value, const json_allocator* alloc) {
+    if (json_object_set(obj, key, value, alloc)) return TRUE;
+    json_object_free_with_allocator(&value, alloc);
+    return FALSE;
+}
+
+// append {"op":op,"path":path} to the patch, with a copy of value when given
+static inline void json_diff_emit(json_diff_state* s, const char* op, const json_object* value) {
+    if (s->failed) return;
+    json_object entry, text, copy;
+    json_set_object(&entry, NULL, 0);
+    bool_t ok = json_set_string_copy(&text, op, strlen(op), s->alloc) && json_diff_member(&entry, "op", text, s->alloc);
+    ok = ok && json_set_string_copy(&text, s->path ? s->path : "", s->length, s->alloc) && json_diff_member(&entry, "path", text, s->alloc);
+    if (value) ok = ok && json_object_copy(&copy, value, s->alloc) && json_diff_member(&entry, "value", copy, s->alloc);
+    if (!ok || !json_list_append(&s->patch, entry, s->alloc)) {
+        json_object_free_with_allocator(&entry, s->alloc);
+        s->failed = TRUE;
+    }
+}
+
+// items i of a and j of b, two packed ones compared in full precision
+static inline bool_t json_diff_items_equal(const json_object* a, cereal_size_t i, const json_object* b, cereal_size_t j, json_hash_cache* cache) {
+    if (json_list_packing(a) == JSON_PACKED_NONE && json_list_packing(b) == JSON_PACKED_NONE) {
+        return json_equal_value(json_list_at(a, i), json_list_at(b, j), cache);
+    }
+    json_type a_type, b_type;
+    double a_value, b_value;
+    if (!json_list_scalar_at(a, i, &a_type, &a_value) || !json_list_scalar_at(b, j, &b_type, &b_value)) return FALSE;
+    return json_equal_scalar(a, a_type, a_value, b, b_type, b_value);
+}
+
+static inline void json_diff_value(json_diff_state* s, const json_object* a, const json_object* b);
+
+static inline void json_diff_items(json_diff_state* s, const json_object* a, const json_object* b) {
+    cereal_size_t a_count = json_list_count(a);
+    cereal_size_t b_count = json_list_count(b);
+    cereal_size_t shorter = a_count < b_count ? a_count : b_count;
+    cereal_size_t start = 0, tail = 0;
+    while (start < shorter && json_diff_items_equal(a, start, b, start, s->cache)) start++;
+    while (tail < shorter - start && json_diff_items_equal(a, a_count - 1 - tail, b, b_count - 1 - tail, s->cache)) tail++;
+    cereal_size_t a_middle = a_count - start - tail;
+    cereal_size_t b_middle = b_count - start - tail;
+    for (cereal_size_t k = 0; k < a_middle && k < b_middle && !s->failed; k++) {
+        size_t mark = json_diff_push_index(s, start + k);
+        json_object a_item = json_list_get(a, start + k);
+        json_object b_item = json_list_get(b, start + k);
+        json_diff_value(s, &a_item, &b_item);
+        s->length = mark;
+    }
+    // removals from the back, so each index is still valid when it is applied
+    for (cereal_size_t k = a_middle; k-- > b_middle && !s->failed;) {
+        size_t mark = json_diff_push_index(s, start + k);
+        json_diff_emit(s, "remove", NULL);
+        s->length = mark;
+    }
+    for (cereal_size_t k = a_middle; k < b_middle && !s->failed; k++) {
+        size_t mark = json_diff_push_index(s, start + k);
+        json_object b_item = json_list_get(b, start + k);
+        json_diff_emit(s, "add", &b_item);
+        s->length = mark;
+    }
+}
+
+static inline void json_diff_members(json_diff_state* s, const json_object* a, const json_object* b) {
+    cereal_size_t a_count = json_node_count(a);
+    cereal_size_t b_count = json_node_count(b);
+    // members of b already paired with one of a
+    unsigned char local[256];
+    unsigned char* paired = b_count <= sizeof(local) ? local : (unsigned char*)json_alloc(s->alloc, b_count);
+    if (!paired) {
+        s->failed = TRUE;
+        return;
+    }
+    memset(paired, 0, b_count);
+    for (cereal_size_t i = 0; i < a_count && !s->failed; i++) {
+        // members usually keep their position, so that is tried first
+        cereal_size_t j = i;
+        if (j >= b_count || paired[j] || !json_equal_keys(a, i, b, j)) {
+            for (j = 0; j < b_count; j++) {
+                if (!paired[j] && json_equal_keys(a, i, b, j)) break;
+            }
+        }
+        size_t len;
+        const char* key = json_object_key_at(a, i, &len);
+        size_t mark = json_diff_push(s, key, len);
+        if (j == b_count) {
+            json_diff_emit(s, "remove", NULL);
+        } else {
+            paired[j] = 1;
+            json_diff_value(s, json_object_value_at(a, i), json_object_value_at(b, j));
+        }
+        s->length = mark;
+    }
+    for (cereal_size_t j = 0; j < b_count && !s->failed; j++) {
+        if (paired[j]) continue;
+        size_t len;
+        const char* key = json_object_key_at(b, j, &len);
+        size_t mark = json_diff_push(s, key, len);
+        json_diff_emit(s, "add", json_object_value_at(b, j));
+        s->length = mark;
+    }
+    if (paired != local) json_dealloc(s->alloc, paired);
+}
+
+static inline void json_diff_value(json_diff_state* s, const json_object* a, const json_object* b) {
+    json_type type = json_typeof(a);
+    if (type != json_typeof(b) || (type != JSON_LIST && type != JSON_OBJECT)) {
+        if (!json_equal_value(a, b, NULL)) json_diff_emit(s, "replace", b);
+        return;
+    }
+    // the same storage holds the same values
+    cereal_size_t count = json_hash_count(a);
+    if (count == json_hash_count(b) && (count == 0 || json_hash_storage(a) == json_hash_storage(b))) return;
+    if (type == JSON_LIST) json_diff_items(s, a, b);
+    else json_diff_members(s, a, b);
+}
+
+// JSON Patch turning a into b, a list of operations returned as a document.
+// failure is set when memory runs out. cache may be NULL; with one, list items
+// that differ are told apart by their cached hashes.
+static inline json json_diff_with_allocator(const json_object* a, const json_object* b, json_hash_cache* cache, const json_allocator* alloc) {
+    json_diff_state s;
+    memset(&s, 0, sizeof(s));
+    json_set_list(&s.patch, NULL, 0);
+    s.cache = cache;
+    s.alloc = alloc;
+    json_diff_value(&s, a, b);
+    json_dealloc(alloc, s.path);
+    json result = { .root = s.patch, .error_text = NULL, .error_length = 0, .failure = FALSE, .allocator = alloc, .block = NULL };
+    if (s.failed) {
+        json_object_free_with_allocator(&result.root, alloc);
+        json_set_null(&result.root);
+        result.failure = TRUE;
+        result.error_text = json_alloc_error_text();
+        result.error_length = (cereal_size_t)strlen(result.error_text);
+    }
+    return result;
+}
+
+static inline json json_diff(const json_object* a, const json_object* b) {
+    return json_diff_with_allocator(a, b, NULL, NULL);
+}
+
+// take the member or item at index out of container, the rest keep their order
+static inline bool_t json_patch_detach(json_object* container, cereal_size_t index, json_node* out, const json_allocator* alloc) {
+    if (json_is_read_only(container)) return FALSE;
+    memset(out, 0, sizeof(json_node));
+    unsigned char code;
+    if (container->type == JSON_LIST) {
+        if (!json_list_unpack(container, alloc)) return FALSE;
+        cereal_size_t count = json_list_count(container);
+        json_object* items = json_list_items(container);
+        code = json_capacity_code(container);
+        out->value = items[index];
+        memmove(&items[index], &items[index + 1], sizeof(json_object) * (count - index - 1));
+        json_set_list(container, items, count - 1);
+    } else {
+        if (!json_object_unshape(container, alloc)) return FALSE;
+        cereal_size_t count = json_node_count(container);
+        json_node* nodes = json_nodes(container);
+        code = json_capacity_code(container);
+        *out = nodes[index];
+        memmove(&nodes[index], &nodes[index + 1], sizeof(json_node) * (count - index - 1));
+        json_set_object(container, nodes, count - 1);
+    }
+    json_set_capacity_code(container, code);
+    return TRUE;
+}
+
+// put node back at index, in storage that still has room for it
+static inline void json_patch_insert(json_object* container, cereal_size_t index, const json_node* node) {
+    unsigned char code = json_capacity_code(container);
+    if (container->type == JSON_LIST) {
+        cereal_size_t count = json_list_count(container);
+        json_object* items = json_list_items(container);
+        memmove(&items[index + 1], &items[index], sizeof(json_object) * (count - index));
+        items[index] = node->value;
+        json_set_list(container, items, count + 1);
+    } else {
+        cereal_size_t count = json_node_count(container);
+        json_node* nodes = json_nodes(container);
+        memmove(&nodes[index + 1], &nodes[index], sizeof(json_node) * (count - index));
+        nodes[index] = *node;
+        json_set_object(container, nodes, count + 1);
+    }
+    json_set_capacity_code(container, code);
+}
+
+// put node in at index, with its key when container is an object
+static inline bool_t json_patch_attach(json_object* container, cereal_size_t index, const json_node* node, const json_allocator* alloc) {
+    if (container->type == JSON_LIST) return json_list_insert(container, index, node->value, alloc);
+    if (!json_object_reserve(container, json_node_count(container) + 1, alloc)) return FALSE;
+    json_patch_insert(container, index, node);
+    return TRUE;
+}
+
+typedef enum {
+    JSON_UNDO_DETACH, // a member or item was put in at index
+    JSON_UNDO_ATTACH, // saved was taken out from index
+    JSON_UNDO_REPLACE, // the value at index replaced saved
+    JSON_UNDO_ROOT // the document replaced saved
+} json_undo_kind;
+
+// one step of json_patch_apply, undone in reverse when a later one fails
+typedef struct json_patch_undo {
+    json_undo_kind kind;
+    bool_t moved; // the value put in, or taken out, lives on elsewhere
+    const char* parent; // pointer to the container, into the patch
+    size_t parent_length;
+    cereal_size_t index;
+    json_node saved;
+} json_patch_undo;
+
+typedef struct json_patch_state {
+    json* doc;
+    const json_allocator* alloc;
+    json_patch_undo* undo;
+    size_t count;
+    size_t capacity;
+} json_patch_state;
+
+// the container holding path's last token, NULL for "" or a missing parent
+static inline json_object* json_patch_parent(const json_object* root, const char* path, size_t length, const char** token, size_t* token_length) {
+    const char* slash = path + length;
+    while (slash > path && *--slash != '/') {}
+    if (length == 0 || *slash != '/') return NULL;
+    *token = slash + 1;
+    *token_length = (size_t)(path + length - slash - 1);
+    json_object* parent = json_pointer_get_length(root, path, (size_t)(slash - path));
+    if (!parent || (parent->type != JSON_LIST && parent->type != JSON_OBJECT)) return NULL;
+    return parent;
+}
+
+// index of token in parent, past the end when it names nothing there
+static inline cereal_size_t json_patch_index(const json_object* parent, const char* token, size_t token_length) {
+    if (parent->type == JSON_LIST) return json_pointer_index(token, token_length, json_list_count(parent));
+    return json_pointer_member(parent, token, token_length);
+}
+
+static inline void json_patch_record(json_patch_state* st, json_undo_kind kind, bool_t moved, const char* parent, size_t parent_length,
+        cereal_size_t index, const json_node* saved) {
+    json_patch_undo* u = &st->undo[st->count++];
+    u->kind = kind;
+    u->moved = moved;
+    u->parent = parent;
+    u->parent_length = parent_length;
+    u->index = index;
+    if (saved) u->saved = *saved;
+    else memset(&u->saved, 0, sizeof(json_node));
+}
+
+// room in the undo log for the steps of one operation
+static inline bool_t json_patch_reserve(json_patch_state* st, size_t steps) {
+    if (st->count + steps <= st->capacity) return TRUE;
+    size_t capacity = st->capacity ? st->capacity * 2 : 16;
+    json_patch_undo* grown = (json_patch_undo*)json_realloc(st->alloc, st->undo, sizeof(json_patch_undo) * capacity);
+    if (!grown) return FALSE;
+    st->undo = grown;
+    st->capacity = capacity;
+    return TRUE;
+}
+
+// read the value at path without taking it, packed items come back as numbers
+static inline bool_t json_patch_value_at(const json_object* root, const char* path, size_t length, json_object* out) {
+    if (length == 0) {
+        *out = *root;
+        return TRUE;
+    }
+    const char* token = NULL;
+    size_t token_length = 0;
+    json_object* parent = json_patch_parent(root, path, length, &token, &token_length);
+    if (!parent) return FALSE;
+    cereal_size_t index = json_patch_index(parent, token, token_length);
+    if (index >= json_hash_count(parent)) return FALSE;
+    *out = parent->type == JSON_LIST ? json_list_get(parent, index) : *json_object_value_at(parent, index);
+    return TRUE;
+}
+
+static inline bool_t json_patch_replace_at(json_patch_state* st, json_object* parent, const char* path, size_t parent_length,
+        cereal_size_t index, json_object value, bool_t moved) {
+    if (json_is_read_only(parent)) return FALSE;
+    json_object* slot;
+    if (parent->type == JSON_LIST) {
+        if (!json_list_unpack(parent, st->alloc)) return FALSE;
+        slot = json_list_at(parent, index);
+    } else {
+        slot = json_object_value_at(parent, index);
+    }
+    json_node saved;
+    memset(&saved, 0, sizeof(saved));
+    saved.value = *slot;
+    *slot = value;
+    json_patch_record(st, JSON_UNDO_REPLACE, moved, path, parent_length, index, &saved);
+    return TRUE;
+}
+
+// store value at path: replaces the whole document for "", an existing member,
+// or goes in before a list index. value is moved in on success.
+static inline bool_t json_patch_add(json_patch_state* st, const char* path, size_t length, json_object value, bool_t moved) {
+    if (length == 0) {
+        json_node saved;
+        memset(&saved, 0, sizeof(saved));
+        saved.value = st->doc->root;
+        st->doc->root = value;
+        json_patch_record(st, JSON_UNDO_ROOT, moved, NULL, 0, 0, &saved);
+        return TRUE;
+    }
+    const char* token = NULL;
+    size_t token_length = 0;
+    json_object* parent = json_patch_parent(&st->doc->root, path, length, &token, &token_length);
+    if (!parent) return FALSE;
+    size_t parent_length = (size_t)(token - 1 - path);
+    cereal_size_t count = json_hash_count(parent);
+    cereal_size_t index = json_patch_index(parent, token, token_length);
+    json_node node;
+    memset(&node, 0, sizeof(node));
+    node.value = value;
+    if (parent->type == JSON_OBJECT) {
+        if (index < count) return json_patch_replace_at(st, parent, path, parent_length, index, value, moved);
+        // the key is the token unescaped
+        char local[64] = { 0 };
+        char* key = token_length <= sizeof(local) ? local : (char*)json_alloc(st->alloc, token_length);
+        size_t key_length = 0;
+        if (!key) return FALSE;
+        for (size_t t = 0; t < token_length; t++) {
+            char c = token[t];
+            if (c == '~' && t + 1 < token_length && (token[t + 1] == '0' || token[t + 1] == '1')) c = token[++t] == '0' ? '~' : '/';
+            key[key_length++] = c;
+        }
+        bool_t ok = json_node_set_key_copy(&node, key, key_length, st->alloc);
+        if (key != local) json_dealloc(st->alloc, key);
+        if (!ok) return FALSE;
+    } else if (index > count) {
+        return FALSE;
+    }
+    if (!json_patch_attach(parent, index, &node, st->alloc)) {
+        if (parent->type == JSON_OBJECT) json_dealloc(st->alloc, json_node_key_heap(&node));
+        return FALSE;
+    }
+    json_patch_record(st, JSON_UNDO_DETACH, moved, path, parent_length, index, NULL);
+    return TRUE;
+}
+
+// take the value at path out, into *out when it moves elsewhere
+static inline bool_t json_patch_take(json_patch_state* st, const char* path, size_t length, json_object* out) {
+    const char* token = NULL;
+    size_t token_length = 0;
+    json_object* parent = json_patch_parent(&st->doc->root, path, length, &token, &token_length);
+    if (!parent) return FALSE;
+    cereal_size_t index = json_patch_index(parent, token, token_length);
+    json_node node;
+    if (index >= json_hash_count(parent) || !json_patch_detach(parent, index, &node, st->alloc)) return FALSE;
+    json_patch_record(st, JSON_UNDO_ATTACH, out != NULL, path, (size_t)(token - 1 - path), index, &node);
+    if (out) *out = node.value;
+    return TRUE;
+}
+
+// member of an operation that must be a string
+static inline const char* json_patch_string(const json_object* op, const char* key, size_t* length) {
+    cereal_size_t index = json_object_index(op, key, strlen(key));
+    if (index == json_node_count(op)) return NULL;
+    const json_object* value = json_object_value_at(op, index);
+    if (json_typeof(value) != JSON_STRING) return NULL;
+    const char* str = json_string_get(value, length);
+    return str ? str : "";
+}
+
+static inline bool_t json_patch_operation(json_patch_state* st, const json_object* op) {
+    if (json_typeof(op) != JSON_OBJECT || !json_patch_reserve(st, 2)) return FALSE;
+    size_t name_length = 0, length = 0, from_length = 0;
+    const char* name = json_patch_string(op, "op", &name_length);
+    const char* path = json_patch_string(op, "path", &length);
+    const char* from = json_patch_string(op, "from", &from_length);
+    cereal_size_t value_index = json_object_index(op, "value", 5);
+    const json_object* value = value_index < json_node_count(op) ? json_object_value_at(op, value_index) : NULL;
+    if (!name || !path || (length > 0 && path[0] != '/') || (from && from_length > 0 && from[0] != '/')) return FALSE;
+    json_object target, copy;
+
+    if (name_length == 3 && memcmp(name, "add", 3) == 0) {
+        if (!value || !json_object_copy(&copy, value, st->alloc)) return FALSE;
+    } else if (name_length == 7 && memcmp(name, "replace", 7) == 0) {
+        if (!value || !json_patch_value_at(&st->doc->root, path, length, &target)) return FALSE;
+        if (!json_object_copy(&copy, value, st->alloc)) return FALSE;
+        if (length > 0) {
+            const char* token = NULL;
+            size_t token_length = 0;
+            json_object* parent = json_patch_parent(&st->doc->root, path, length, &token, &token_length);
+            cereal_size_t index = json_patch_index(parent, token, token_length);
+            if (json_patch_replace_at(st, parent, path, (size_t)(token - 1 - path), index, copy, FALSE)) return TRUE;
+            json_object_free_with_allocator(&copy, st->alloc);
+            return FALSE;
+        }
+    } else if (name_length == 6 && memcmp(name, "remove", 6) == 0) {
+        return json_patch_take(st, path, length, NULL);
+    } else if (name_length == 4 && memcmp(name, "move", 4) == 0) {
+        if (!from || !json_patch_value_at(&st->doc->root, from, from_length, &target)) return FALSE;
+        if (from_length == length && memcmp(from, path, length) == 0) return TRUE;
+        // a value cannot move into itself
+        if (length > from_length && memcmp(from, path, from_length) == 0 && path[from_length] == '/') return FALSE;
+        json_object moved;
+        if (!json_patch_take(st, from, from_length, &moved)) return FALSE;
+        return json_patch_add(st, path, length, moved, TRUE);
+    } else if (name_length == 4 && memcmp(name, "copy", 4) == 0) {
+        if (!from || !json_patch_value_at(&st->doc->root, from, from_length, &target)) return FALSE;
+        if (!json_object_copy(&copy, &target, st->alloc)) return FALSE;
+    } else if (name_length == 4 && memcmp(name, "test", 4) == 0) {
+        return value && json_patch_value_at(&st->doc->root, path, length, &target) && json_equal(&target, value);
+    } else {
+        return FALSE;
+    }
+    if (json_patch_add(st, path, length, copy, FALSE)) return TRUE;
+    json_object_free_with_allocator(&copy, st->alloc);
+    return FALSE;
+}
+
+// free what the applied steps replaced or took out
+static inline void json_patch_commit(json_patch_state* st) {
+    for (size_t i = 0; i < st->count; i++) {
+        json_patch_undo* u = &st->undo[i];
+        if (u->kind == JSON_UNDO_ATTACH) {
+            json_dealloc(st->alloc, json_node_key_heap(&u->saved));
+            if (!u->moved) json_object_free_with_allocator(&u->saved.value, st->alloc);
+        } else if (u->kind == JSON_UNDO_REPLACE || u->kind == JSON_UNDO_ROOT) {
+            json_object_free_with_allocator(&u->saved.value, st->alloc);
+        }
+    }
+}
+
+// undo the applied steps, newest first, so each parent path resolves again.
+// Nothing here allocates: every container was unpacked and unshaped on the
+// way forward.
+static inline void json_patch_rollback(json_patch_state* st) {
+    json_object* root = &st->doc->root;
+    while (st->count > 0) {
+        json_patch_undo* u = &st->undo[--st->count];
+        if (u->kind == JSON_UNDO_ROOT) {
+            if (!u->moved) json_object_free_with_allocator(root, st->alloc);
+            *root = u->saved.value;
+            continue;
+        }
+        json_object* parent = json_pointer_get_length(root, u->parent, u->parent_length);
+        if (u->kind == JSON_UNDO_DETACH) {
+            json_node node;
+            json_patch_detach(parent, u->index, &node, st->alloc);
+            json_dealloc(st->alloc, json_node_key_heap(&node));
+            if (!u->moved) json_object_free_with_allocator(&node.value, st->alloc);
+        } else if (u->kind == JSON_UNDO_ATTACH) {
+            // the storage it was taken from is still there or has grown
+            json_patch_insert(parent, u->index, &u->saved);
+        } else {
+            json_object* slot = parent->type == JSON_LIST ? json_list_at(parent, u->index) : json_object_value_at(parent, u->index);
+            if (!u->moved) json_object_free_with_allocator(slot, st->alloc);
+            *slot = u->saved.value;
+        }
+    }
+}
+
+// Apply a JSON Patch (RFC 6902), a list of operations, to doc in place. Each
+// operation costs the depth of its paths times the width of the containers
+// they lead through, never the size of the document. When one fails the
+// operations before it are undone and doc is left as it was. Shared
+// containers are not changed, and a compacted doc is refused as json_share
+// refuses it.
+static inline bool_t json_patch_apply(json* doc, const json_object* patch) {
+    if (!doc || doc->failure || doc->block || json_typeof(patch) != JSON_LIST || json_list_packing(patch) != JSON_PACKED_NONE) return FALSE;
+    json_patch_state st;
+    memset(&st, 0, sizeof(st));
+    st.doc = doc;
+    st.alloc = doc->allocator;
+    bool_t ok = TRUE;
+    for (cereal_size_t i = 0; i < json_list_count(patch) && ok; i++) {
+        ok = json_patch_operation(&st, json_list_at(patch, i));
+    }
+    if (ok) json_patch_commit(&st);
+    else json_patch_rollback(&st);
+    json_dealloc(st.alloc, st.undo);
+    return ok;
+}
+
+static inline bool_t json_merge_patch_value(json_object* target, const json_object* patch, const json_allocator* alloc) {
+    if (json_typeof(patch) != JSON_OBJECT) {
+        json_object copy;
+        if (!json_object_copy(&copy, patch, alloc)) return FALSE;
+        json_object_free_with_allocator(target, alloc);
+        *target = copy;
+        return TRUE;
+    }
+    if (json_typeof(target) != JSON_OBJECT) {
+        json_object_free_with_allocator(target, alloc);
+        json_set_object(target, NULL, 0);
+    }
+    if (json_is_read_only(target)) return FALSE;
+    for (cereal_size_t i = 0; i < json_node_count(patch); i++) {
+        size_t len;
+        const char* key = json_object_key_at(patch, i, &len);
+        const json_object* value = json_object_value_at(patch, i);
+        cereal_size_t count = json_node_count(target);
+        cereal_size_t index = json_object_index(target, key ? key : "", len);
+        json_node node;
+        if (json_typeof(value) == JSON_NULL) {
+            if (index == count) continue;
+            if (!json_patch_detach(target, index, &node, alloc)) return FALSE;
+            json_dealloc(alloc, json_node_key_heap(&node));
+            json_object_free_with_allocator(&node.value, alloc);
+            continue;
+        }
+        if (index == count) {
+            memset(&node, 0, sizeof(node));
+            json_set_null(&node.value);
+            if (!json_node_set_key_copy(&node, key ? key : "", len, alloc)) return FALSE;
+            if (!json_patch_attach(target, index, &node, alloc)) {
+                json_dealloc(alloc, json_node_key_heap(&node));
+                return FALSE;
+            }
+        }
+        if (!json_merge_patch_value(json_object_value_at(target, index), value, alloc)) return FALSE;
+    }
+    return TRUE;
+}
+
+// Apply a JSON Merge Patch (RFC 7396) to doc in place: an object patch merges
+// member by member and a null member removes one, anything else replaces the
+// value it lands on. FALSE when memory runs out or a container on the way is
+// shared, with doc merged up to that point, and for a compacted doc.
+static inline bool_t json_merge_patch(json* doc, const json_object* patch) {
+    if (!doc || doc->failure || doc->block) return FALSE;
+    return json_merge_patch_value(&doc->root, patch, doc->allocator);
+}
+
+// columnar form of a list of objects: one typed buffer per key plus a validity
+// bitmap, for scans and aggregation that touch one field across many rows.
+typedef enum json_column_type {
+    JSON_COLUMN_NULL,   // no row had a scalar value
+    JSON_COLUMN_NUMBER, // double[row_count]
+    JSON_COLUMN_BOOL,   // bitset
+    JSON_COLUMN_STRING  // offsets[row_count + 1] into heap
+} json_column_type;
+
+typedef struct json_column {
+    char* name;
+    size_t name_length;
+    json_column_type type; // from the first non-null value
+    unsigned char* validity; // bit set where the row holds a value of type
+    cereal_size_t null_count; // rows without a value of type, mismatched included
+    cereal_size_t mismatched; // rows whose value had another type or was nested
+    double* numbers;
+    unsigned char* bools;
+    size_t* offsets;
+    char* heap;
+    size_t heap_length;
+} json_column;
+
+typedef struct json_columns {
+    json_column* columns;
+    cereal_size_t column_count;
+    cereal_size_t row_count;
+    bool_t failure;
+    const json_allocator* allocator;
+} json_columns;
+
+typedef struct json_columns_options {
+    const json_allocator* allocator;
+    const char* const* keys; // NULL for every key, in first seen order
+    cereal_size_t key_count;
+} json_columns_options;
+
+static inline bool_t json_column_valid(const json_column* column, cereal_size_t row) {
+    return (bool_t)((column->validity[row >> 3] >> (row & 7)) & 1);
+}
+
+static inline const char* json_column_string(const json_column* column, cereal_size_t row, size_t* len) {
+    if (column->type != JSON_COLUMN_STRING || !json_column_valid(column, row)) {
+        if (len) *len = 0;
+        return NULL;
+    }
+    if (len) *len = column->offsets[row + 1] - column->offsets[row];
+    return column->heap + column->offsets[row];
+}
+
+static inline json_column* json_columns_find(const json_columns* cols, const char* name) {
+    size_t len = strlen(name);
+    for (cereal_size_t i = 0; i < cols->column_count; i++) {
+        json_column* column = &cols->columns[i];
+        if (column->name_length == len && memcmp(column->name, name, len) == 0) return column;
+    }
+    return NULL;
+}
+
+static inline void json_columns_free(json_columns* cols) {
+    if (!cols) return;
+    for (cereal_size_t i = 0; i < cols->column_count; i++) {
+        json_column* column = &cols->columns[i];
+        json_dealloc(cols->allocator, column->name);
+        json_dealloc(cols->allocator, column->validity);
+        json_dealloc(cols->allocator, column->numbers);
+        json_dealloc(cols->allocator, column->bools);
+        json_dealloc(cols->allocator, column->offsets);
+        json_dealloc(cols->allocator, column->heap);
+    }
+    json_dealloc(cols->allocator, cols->columns);
+    cols->columns = NULL;
+    cols->column_count = 0;
+    cols->row_count = 0;
+}
+
+// index of the column named key, checking hint first since rows of the same
+// shape list their keys in the same order. column_count if there is none.
+static inline cereal_size_t json_columns_index(const json_columns* cols, const char* key, size_t len, cereal_size_t hint) {
+    if (hint < cols->column_count) {
+        const json_column* column = &cols->columns[hint];
+        if (column->name_length == len && memcmp(column->name, key, len) == 0) return hint;
+    }
+    for (cereal_size_t i = 0; i < cols->column_count; i++) {
+        const json_column* column = &cols->columns[i];
+        if (column->name_length == len && memcmp(column->name, key, len) == 0) return i;
+    }
+    return cols->column_count;
+}
+
+static inline bool_t json_columns_add(json_columns* cols, const char* key, size_t len) {
+    json_column* grown = (json_column*)json_realloc(cols->allocator, cols->columns, sizeof(json_column) * (cols->column_count + 1));
+    if (!grown) return FALSE;
+    cols->columns = grown;
+    json_column* column = &grown[cols->column_count];
+    memset(column, 0, sizeof(json_column));
+    column->name = (char*)json_alloc(cols->allocator, len + 1);
+    if (!column->name) return FALSE;
+    memcpy(column->name, key, len);
+    column->name[len] = '\0';
+    column->name_length = len;
+    cols->column_count++;
+    return TRUE;
+}
+
+static inline json_column_type json_column_type_of(const json_object* value) {
+    switch (json_typeof(value)) {
+        case JSON_NUMBER: return JSON_COLUMN_NUMBER;
+        case JSON_BOOL: return JSON_COLUMN_BOOL;
+        case JSON_STRING: return JSON_COLUMN_STRING;
+        default: return JSON_COLUMN_NULL;
+    }
+}
+
+// Pivot a list of objects into columns. Keys missing from a row, null values,
+// nested values and values whose type differs from the column's are all left
+// unset in the validity bitmap. Rows that are not objects have no values.
+static inline json_columns json_to_columns(const json_object* list, const json_columns_options* options) {
+    json_columns cols = { NULL, 0, 0, FALSE, options ? options->allocator : NULL };
+    if (json_typeof(list) != JSON_LIST || json_list_packing(list) != JSON_PACKED_NONE) {
+        cols.failure = TRUE;
+        return cols;
+    }
+    json_object* rows = json_list_items(list);
+    cereal_size_t row_count = json_list_count(list);
+    cols.row_count = row_count;
+
+    // first pass: columns, their types, and the string bytes to reserve
+    size_t* string_bytes = NULL;
+    if (options && options->keys) {
+        for (cereal_size_t k = 0; k < options->key_count; k++) {
+            if (!json_columns_add(&cols, options->keys[k], strlen(options->keys[k]))) goto fail;
+        }
+    }
+    for (cereal_size_t r = 0; r < row_count; r++) {
+        if (json_typeof(&rows[r]) != JSON_OBJECT) continue;
+        for (cereal_size_t n = 0; n < json_node_count(&rows[r]); n++) {
+            size_t len;
+            const char* key = json_object_key_at(&rows[r], n, &len);
+            const json_object* value = json_object_value_at(&rows[r], n);
+            cereal_size_t c = json_columns_index(&cols, key, len, n);
+            if (c == cols.column_count) {
+                if (options && options->keys) continue;
+                if (!json_columns_add(&cols, key, len)) goto fail;
+            }
+            json_column* column = &cols.columns[c];
+            if (column->type == JSON_COLUMN_NULL) column->type = json_column_type_of(value);
+        }
+    }
+    string_bytes = (size_t*)json_alloc(cols.allocator, sizeof(size_t) * (cols.column_count + 1));
+    if (!string_bytes) goto fail;
+    memset(string_bytes, 0, sizeof(size_t) * (cols.column_count + 1));
+    for (cereal_size_t r = 0; r < row_count; r++) {
+        if (json_typeof(&rows[r]) != JSON_OBJECT) continue;
+        for (cereal_size_t n = 0; n < json_node_count(&rows[r]); n++) {
+            const json_object* value = json_object_value_at(&rows[r], n);
+            if (json_typeof(value) != JSON_STRING) continue;
+            size_t len, value_len;
+            const char* key = json_object_key_at(&rows[r], n, &len);
+            cereal_size_t c = json_columns_index(&cols, key, len, n);
+            if (c == cols.column_count || cols.columns[c].type != JSON_COLUMN_STRING) continue;
+            json_string_get(value, &value_len);
+            string_bytes[c] += value_len;
+        }
+    }
+
+    // buffers, all rows start out null
+    size_t bitmap_size = ((size_t)row_count + 7) / 8;
+    for (cereal_size_t c = 0; c < cols.column_count; c++) {
+        json_column* column = &cols.columns[c];
+        column->validity = (unsigned char*)json_alloc(cols.allocator, bitmap_size ? bitmap_size : 1);
+        if (!column->validity) goto fail;
+        memset(column->validity, 0, bitmap_size);
+        if (column->type == JSON_COLUMN_NUMBER) {
+            column->numbers = (double*)json_alloc(cols.allocator, sizeof(double) * (row_count ? row_count : 1));
+            if (!column->numbers) goto fail;
+            memset(column->numbers, 0, sizeof(double) * row_count);
+        } else if (column->type == JSON_COLUMN_BOOL) {
+            column->bools = (unsigned char*)json_alloc(cols.allocator, bitmap_size ? bitmap_size : 1);
+            if (!column->bools) goto fail;
+            memset(column->bools, 0, bitmap_size);
+        } else if (column->type == JSON_COLUMN_STRING) {
+            column->offsets = (size_t*)json_alloc(cols.allocator, sizeof(size_t) * ((size_t)row_count + 1));
+            column->heap = (char*)json_alloc(cols.allocator, string_bytes[c] + 1);
+            if (!column->offsets || !column->heap) goto fail;
+            column->offsets[0] = 0;
+            column->heap[0] = '\0';
+        }
+    }
+
+    // second pass: scatter values into their columns
+    for (cereal_size_t r = 0; r < row_count; r++) {
+        for (cereal_size_t c = 0; c < cols.column_count; c++) {
+            json_column* column = &cols.columns[c];
+            if (column->offsets) column->offsets[r + 1] = column->heap_length;
+        }
+        if (json_typeof(&rows[r]) != JSON_OBJECT) continue;
+        for (cereal_size_t n = 0; n < json_node_count(&rows[r]); n++) {
+            size_t len;
+            const char* key = json_object_key_at(&rows[r], n, &len);
+            const json_object* value = json_object_value_at(&rows[r], n);
+            cereal_size_t c = json_columns_index(&cols, key, len, n);
+            if (c == cols.column_count) continue;
+            json_column* column = &cols.columns[c];
+            if (json_column_valid(column, r)) continue; // duplicate key, the first one wins
+            if (json_typeof(value) == JSON_NULL) continue;
+            if (column->type == JSON_COLUMN_NULL || json_column_type_of(value) != column->type) {
+                column->mismatched++;
+                continue;
+            }
+            switch (column->type) {
+                case JSON_COLUMN_NUMBER:
+                    column->numbers[r] = (double)json_number_value(value);
+                    break;
+                case JSON_COLUMN_BOOL:
+                    if (json_bool_value(value)) column->bools[r >> 3] |= (unsigned char)(1u << (r & 7));
+                    break;
+                default: {
+                    size_t value_len;
+                    const char* str = json_string_get(value, &value_len);
+                    memcpy(column->heap + column->heap_length, str, value_len);
+                    column->heap_length += value_len;
+                    column->offsets[r + 1] = column->heap_length;
+                    break;
+                }
+            }
+            column->validity[r >> 3] |= (unsigned char)(1u << (r & 7));
+        }
+    }
+    for (cereal_size_t c = 0; c < cols.column_count; c++) {
+        json_column* column = &cols.columns[c];
+        cereal_size_t valid = 0;
+        for (size_t b = 0; b < bitmap_size; b++) {
+            for (unsigned char bits = column->validity[b]; bits; bits &= (unsigned char)(bits - 1)) valid++;
+        }
+        column->null_count = row_count - valid;
+        if (column->heap) column->heap[column->heap_length] = '\0';
+    }
+    json_dealloc(cols.allocator, string_bytes);
+    return cols;
+
+fail:
+    json_dealloc(cols.allocator, string_bytes);
+    json_columns_free(&cols);
+    cols.failure = TRUE;
+    return cols;
+}
+
+// parse input and pivot its root list, the tree is freed before returning
+static inline json_columns deserialize_json_columns(const char* input, cereal_size_t length, const json_columns_options* options) {
+    json doc = deserialize_json_with_allocator(input, length, options ? options->allocator : NULL);
+    if (doc.failure) {
+        json_free(&doc);
+        json_columns cols = { NULL, 0, 0, TRUE, options ? options->allocator : NULL };
+        return cols;
+    }
+    json_columns cols = json_to_columns(&doc.root, options);
+    json_free(&doc);
+    return cols;
 }
 
 #endif
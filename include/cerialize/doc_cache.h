@@ -0,0 +1,276 @@
+#ifndef CERIALIZE_DOC_CACHE_H
+#define CERIALIZE_DOC_CACHE_H
+
+#include "cerialize.h"
+#include <pthread.h>
+
+// Parsed document cache. json_doc_cache_parse hashes the input bytes and hands
+// back a shared, reference counted document when the same bytes were parsed
+// before, so repeated bodies are parsed once. A hash match is confirmed by
+// comparing the bytes. Documents are immutable while cached: read them through
+// the const json and release every reference with json_doc_cache_release.
+// Entries are spread over JSON_DOC_CACHE_SHARDS shards, each with its own lock
+// and least recently used list, and a miss parses outside the lock. The parse
+// allocator must be safe to call from every thread using the cache. POSIX
+// threads only; link with -pthread.
+
+#define JSON_DOC_CACHE_SHARDS 16 // power of two
+
+typedef struct json_cached_doc {
+    json doc; // parsed from input, read only
+    char* input; // copy of the parsed bytes, compared on lookup
+    size_t length;
+    uint64_t hash;
+    size_t refs; // callers holding the document, guarded by the shard lock
+    bool_t cached; // still in the table; otherwise freed by the last release
+    struct json_doc_cache_shard* shard; // NULL for a failed parse handed out uncached
+    struct json_cached_doc* next_in_bucket;
+    struct json_cached_doc* newer; // least recently used list
+    struct json_cached_doc* older;
+} json_cached_doc;
+
+typedef struct json_doc_cache_shard {
+    pthread_mutex_t lock;
+    json_cached_doc** buckets;
+    size_t bucket_mask;
+    json_cached_doc* newest;
+    json_cached_doc* oldest;
+    size_t count;
+    size_t capacity; // documents kept before the oldest is evicted
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+} json_doc_cache_shard;
+
+typedef struct json_doc_cache {
+    json_doc_cache_shard shards[JSON_DOC_CACHE_SHARDS];
+    json_parse_options options;
+} json_doc_cache;
+
+typedef struct json_doc_cache_stats {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t entries;
+} json_doc_cache_stats;
+
+// 8 bytes a step, then the splitmix64 finalizer
+static inline uint64_t json_doc_cache_hash(const char* input, size_t length) {
+    uint64_t hash = 0x9e3779b97f4a7c15ULL ^ length;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, input + i, sizeof(word));
+        hash = (hash ^ word) * 0x9fb21c651e98df25ULL;
+        hash = (hash << 29) | (hash >> 35);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, input + i, length - i);
+    hash = (hash ^ tail) * 0x9fb21c651e98df25ULL;
+    return json_hash_mix(hash);
+}
+
+// Set up a cache for about capacity documents, split evenly over the shards.
+// options is copied and used for every parse, NULL for the defaults.
+static inline bool_t json_doc_cache_init(json_doc_cache* cache, size_t capacity, const json_parse_options* options) {
+    memset(cache, 0, sizeof(json_doc_cache));
+    if (options) cache->options = *options;
+    size_t per_shard = (capacity + JSON_DOC_CACHE_SHARDS - 1) / JSON_DOC_CACHE_SHARDS;
+    if (per_shard == 0) per_shard = 1;
+    size_t buckets = 1;
+    while (buckets < per_shard * 2) buckets *= 2;
+    for (size_t s = 0; s < JSON_DOC_CACHE_SHARDS; s++) {
+        json_doc_cache_shard* shard = &cache->shards[s];
+        shard->buckets = (json_cached_doc**)json_alloc(cache->options.allocator, sizeof(json_cached_doc*) * buckets);
+        if (!shard->buckets) {
+            for (size_t k = 0; k < s; k++) {
+                pthread_mutex_destroy(&cache->shards[k].lock);
+                json_dealloc(cache->options.allocator, cache->shards[k].buckets);
+            }
+            return FALSE;
+        }
+        memset(shard->buckets, 0, sizeof(json_cached_doc*) * buckets);
+        shard->bucket_mask = buckets - 1;
+        shard->capacity = per_shard;
+        pthread_mutex_init(&shard->lock, NULL);
+    }
+    return TRUE;
+}
+
+static inline void json_doc_cache_free_entry(const json_doc_cache* cache, json_cached_doc* entry) {
+    json_free(&entry->doc);
+    json_dealloc(cache->options.allocator, entry->input);
+    json_dealloc(cache->options.allocator, entry);
+}
+
+// take entry out of the bucket chain and the recency list, with the shard locked
+static inline void json_doc_cache_unlink(json_doc_cache_shard* shard, json_cached_doc* entry) {
+    json_cached_doc** link = &shard->buckets[entry->hash & shard->bucket_mask];
+    while (*link != entry) link = &(*link)->next_in_bucket;
+    *link = entry->next_in_bucket;
+    if (entry->newer) entry->newer->older = entry->older;
+    else shard->newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else shard->oldest = entry->newer;
+    entry->newer = entry->older = NULL;
+    entry->cached = FALSE;
+    shard->count--;
+}
+
+static inline void json_doc_cache_push_newest(json_doc_cache_shard* shard, json_cached_doc* entry) {
+    entry->older = shard->newest;
+    entry->newer = NULL;
+    if (shard->newest) shard->newest->newer = entry;
+    shard->newest = entry;
+    if (!shard->oldest) shard->oldest = entry;
+}
+
+static inline json_cached_doc* json_doc_cache_find(json_doc_cache_shard* shard, uint64_t hash, const char* input, size_t length) {
+    for (json_cached_doc* entry = shard->buckets[hash & shard->bucket_mask]; entry; entry = entry->next_in_bucket) {
+        if (entry->hash == hash && entry->length == length && memcmp(entry->input, input, length) == 0) return entry;
+    }
+    return NULL;
+}
+
+// move a found entry to the front and take a reference, with the shard locked
+static inline json_cached_doc* json_doc_cache_use(json_doc_cache_shard* shard, json_cached_doc* entry) {
+    if (shard->newest != entry) {
+        entry->newer->older = entry->older;
+        if (entry->older) entry->older->newer = entry->newer;
+        else shard->oldest = entry->newer;
+        json_doc_cache_push_newest(shard, entry);
+    }
+    entry->refs++;
+    return entry;
+}
+
+// Parse input, or share the document parsed from the same bytes before. The
+// result holds one reference; NULL only when memory runs out. A failed parse
+// comes back uncached, with failure and error_text set on its doc.
+static inline json_cached_doc* json_doc_cache_parse(json_doc_cache* cache, const char* input, size_t length) {
+    uint64_t hash = json_doc_cache_hash(input, length);
+    json_doc_cache_shard* shard = &cache->shards[(hash >> 32) & (JSON_DOC_CACHE_SHARDS - 1)];
+    pthread_mutex_lock(&shard->lock);
+    json_cached_doc* found = json_doc_cache_find(shard, hash, input, length);
+    if (found) {
+        shard->hits++;
+        json_doc_cache_use(shard, found);
+        pthread_mutex_unlock(&shard->lock);
+        return found;
+    }
+    shard->misses++;
+    pthread_mutex_unlock(&shard->lock);
+
+    const json_allocator* alloc = cache->options.allocator;
+    json_cached_doc* entry = (json_cached_doc*)json_alloc(alloc, sizeof(json_cached_doc));
+    if (!entry) return NULL;
+    memset(entry, 0, sizeof(json_cached_doc));
+    entry->doc = deserialize_json_with_options(input, (cereal_size_t)length, &cache->options);
+    entry->hash = hash;
+    entry->length = length;
+    entry->refs = 1;
+    if (entry->doc.failure) return entry;
+    entry->input = (char*)json_alloc(alloc, length ? length : 1);
+    if (!entry->input) {
+        json_doc_cache_free_entry(cache, entry);
+        return NULL;
+    }
+    memcpy(entry->input, input, length);
+    entry->shard = shard;
+
+    pthread_mutex_lock(&shard->lock);
+    // another thread may have parsed the same bytes meanwhile
+    found = json_doc_cache_find(shard, hash, input, length);
+    if (found) {
+        json_doc_cache_use(shard, found);
+        pthread_mutex_unlock(&shard->lock);
+        json_doc_cache_free_entry(cache, entry);
+        return found;
+    }
+    json_cached_doc** bucket = &shard->buckets[hash & shard->bucket_mask];
+    entry->next_in_bucket = *bucket;
+    *bucket = entry;
+    entry->cached = TRUE;
+    json_doc_cache_push_newest(shard, entry);
+    shard->count++;
+    // evicted documents still in use are freed by their last release
+    json_cached_doc* evicted = NULL;
+    if (shard->count > shard->capacity) {
+        evicted = shard->oldest;
+        json_doc_cache_unlink(shard, evicted);
+        shard->evictions++;
+        if (evicted->refs > 0) evicted = NULL;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    if (evicted) json_doc_cache_free_entry(cache, evicted);
+    return entry;
+}
+
+// the parsed document behind a reference
+static inline const json* json_cached_doc_json(const json_cached_doc* entry) {
+    return &entry->doc;
+}
+
+// drop a reference from json_doc_cache_parse
+static inline void json_doc_cache_release(json_doc_cache* cache, json_cached_doc* entry) {
+    if (!entry) return;
+    json_doc_cache_shard* shard = entry->shard;
+    if (!shard) {
+        json_doc_cache_free_entry(cache, entry);
+        return;
+    }
+    pthread_mutex_lock(&shard->lock);
+    bool_t unused = --entry->refs == 0 && !entry->cached;
+    pthread_mutex_unlock(&shard->lock);
+    if (unused) json_doc_cache_free_entry(cache, entry);
+}
+
+// sums over all shards, each read under its own lock
+static inline json_doc_cache_stats json_doc_cache_get_stats(json_doc_cache* cache) {
+    json_doc_cache_stats stats = { 0, 0, 0, 0 };
+    for (size_t s = 0; s < JSON_DOC_CACHE_SHARDS; s++) {
+        json_doc_cache_shard* shard = &cache->shards[s];
+        pthread_mutex_lock(&shard->lock);
+        stats.hits += shard->hits;
+        stats.misses += shard->misses;
+        stats.evictions += shard->evictions;
+        stats.entries += shard->count;
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return stats;
+}
+
+// free every cached document; references still held are freed by their release
+static inline void json_doc_cache_clear(json_doc_cache* cache) {
+    for (size_t s = 0; s < JSON_DOC_CACHE_SHARDS; s++) {
+        json_doc_cache_shard* shard = &cache->shards[s];
+        pthread_mutex_lock(&shard->lock);
+        json_cached_doc* unused = NULL;
+        while (shard->oldest) {
+            json_cached_doc* entry = shard->oldest;
+            json_doc_cache_unlink(shard, entry);
+            if (entry->refs == 0) {
+                entry->next_in_bucket = unused;
+                unused = entry;
+            }
+        }
+        pthread_mutex_unlock(&shard->lock);
+        while (unused) {
+            json_cached_doc* next = unused->next_in_bucket;
+            json_doc_cache_free_entry(cache, unused);
+            unused = next;
+        }
+    }
+}
+
+// clear the cache and free its tables, every reference must be released first
+static inline void json_doc_cache_destroy(json_doc_cache* cache) {
+    json_doc_cache_clear(cache);
+    for (size_t s = 0; s < JSON_DOC_CACHE_SHARDS; s++) {
+        pthread_mutex_destroy(&cache->shards[s].lock);
+        json_dealloc(cache->options.allocator, cache->shards[s].buckets);
+        cache->shards[s].buckets = NULL;
+    }
+}
+
+#endif
@@ -0,0 +1,370 @@
+#ifndef CERIALIZE_MSGPACK_H
+#define CERIALIZE_MSGPACK_H
+
+#include "cerialize.h"
+
+// MessagePack encoding of json trees, for services that exchange documents
+// without paying for text on either end. Output goes through json_writer, so
+// it can be collected in a buffer or streamed to a sink, and decoded trees use
+// the same allocator hooks as deserialize_json.
+//
+// Numbers that hold an integer are written as the smallest msgpack int, other
+// numbers as float32, which is exact since json_object numbers are floats.
+// Packed double lists are written as float64 and packed int64 lists as ints.
+// Decoding accepts nil, bool, int, float, str, array and map with string keys;
+// bin and ext values are rejected.
+
+#define JSON_MSGPACK_MAX_DEPTH 1024 // deeper input is rejected rather than recursed into
+
+static inline void json_msgpack_put_be(json_writer* w, unsigned char tag, uint64_t value, int bytes) {
+    unsigned char buf[9];
+    buf[0] = tag;
+    for (int k = 0; k < bytes; k++) {
+        buf[1 + k] = (unsigned char)(value >> (8 * (bytes - 1 - k)));
+    }
+    json_writer_write(w, (const char*)buf, (size_t)bytes + 1);
+}
+
+static inline void json_msgpack_write_int(json_writer* w, int64_t value) {
+    if (value >= 0) {
+        uint64_t u = (uint64_t)value;
+        if (u < 128) json_writer_putc(w, (char)u);
+        else if (u <= 0xff) json_msgpack_put_be(w, 0xcc, u, 1);
+        else if (u <= 0xffff) json_msgpack_put_be(w, 0xcd, u, 2);
+        else if (u <= 0xffffffffu) json_msgpack_put_be(w, 0xce, u, 4);
+        else json_msgpack_put_be(w, 0xcf, u, 8);
+    } else if (value >= -32) {
+        json_writer_putc(w, (char)(unsigned char)(0xe0 | (value + 32)));
+    } else if (value >= INT8_MIN) {
+        json_msgpack_put_be(w, 0xd0, (uint64_t)value, 1);
+    } else if (value >= INT16_MIN) {
+        json_msgpack_put_be(w, 0xd1, (uint64_t)value, 2);
+    } else if (value >= INT32_MIN) {
+        json_msgpack_put_be(w, 0xd2, (uint64_t)value, 4);
+    } else {
+        json_msgpack_put_be(w, 0xd3, (uint64_t)value, 8);
+    }
+}
+
+static inline void json_msgpack_write_float(json_writer* w, float value) {
+    // integral floats below 2^63 in magnitude convert to int64 exactly
+    if (value > -9.2233720e18f && value < 9.2233720e18f && (float)(int64_t)value == value) {
+        json_msgpack_write_int(w, (int64_t)value);
+        return;
+    }
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    json_msgpack_put_be(w, 0xca, bits, 4);
+}
+
+static inline void json_msgpack_write_double(json_writer* w, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    json_msgpack_put_be(w, 0xcb, bits, 8);
+}
+
+static inline void json_msgpack_write_str(json_writer* w, const char* str, size_t len) {
+    if (len < 32) json_writer_putc(w, (char)(unsigned char)(0xa0 | len));
+    else if (len <= 0xff) json_msgpack_put_be(w, 0xd9, len, 1);
+    else if (len <= 0xffff) json_msgpack_put_be(w, 0xda, len, 2);
+    else json_msgpack_put_be(w, 0xdb, len, 4);
+    json_writer_write(w, str, len);
+}
+
+// array and map headers, fix formats below 16 entries
+static inline void json_msgpack_write_header(json_writer* w, unsigned char fix, unsigned char tag16, cereal_size_t count) {
+    if (count < 16) json_writer_putc(w, (char)(unsigned char)(fix | count));
+    else if (count <= 0xffff) json_msgpack_put_be(w, tag16, count, 2);
+    else json_msgpack_put_be(w, (unsigned char)(tag16 + 1), count, 4);
+}
+
+static inline void json_msgpack_write_value(json_writer* w, const json_object* obj) {
+    if (w->failure) return;
+
+    switch (obj->type) {
+        case JSON_STRING: {
+            size_t len;
+            const char* str = json_string_get(obj, &len);
+            json_msgpack_write_str(w, str ? str : "", len);
+            break;
+        }
+        case JSON_NUMBER:
+            json_msgpack_write_float(w, obj->value.number);
+            break;
+        case JSON_BOOL:
+            json_writer_putc(w, (char)(unsigned char)(obj->value.boolean ? 0xc3 : 0xc2));
+            break;
+        case JSON_NULL:
+            json_writer_putc(w, (char)(unsigned char)0xc0);
+            break;
+        case JSON_LIST: {
+            cereal_size_t count = json_list_count(obj);
+            const void* data = json_list_data(obj);
+            json_msgpack_write_header(w, 0x90, 0xdc, count);
+            switch (json_list_packing(obj)) {
+                case JSON_PACKED_DOUBLE:
+                    for (cereal_size_t i = 0; i < count; i++) json_msgpack_write_double(w, ((const double*)data)[i]);
+                    break;
+                case JSON_PACKED_INT64:
+                    for (cereal_size_t i = 0; i < count; i++) json_msgpack_write_int(w, ((const int64_t*)data)[i]);
+                    break;
+                case JSON_PACKED_BOOL:
+                    for (cereal_size_t i = 0; i < count; i++) {
+                        json_writer_putc(w, (char)(unsigned char)(json_packed_bit(data, i) ? 0xc3 : 0xc2));
+                    }
+                    break;
+                default:
+                    for (cereal_size_t i = 0; i < count; i++) json_msgpack_write_value(w, &json_list_items(obj)[i]);
+                    break;
+            }
+            break;
+        }
+        case JSON_OBJECT: {
+            cereal_size_t count = json_node_count(obj);
+            json_msgpack_write_header(w, 0x80, 0xde, count);
+            for (cereal_size_t i = 0; i < count; i++) {
+                size_t key_len;
+                const char* key = json_object_key_at(obj, i, &key_len);
+                json_msgpack_write_str(w, key ? key : "", key_len);
+                json_msgpack_write_value(w, json_object_value_at(obj, i));
+            }
+            break;
+        }
+        default:
+            w->failure = TRUE;
+            break;
+    }
+}
+
+// encode j into a new buffer from alloc and store its size in length. NULL on
+// failure; the buffer is released with json_dealloc(alloc, buffer).
+static inline unsigned char* json_to_msgpack_with_allocator(const json* j, size_t* length, const json_allocator* alloc) {
+    if (!j) return NULL;
+    json_writer w;
+    json_writer_init(&w, alloc);
+    json_msgpack_write_value(&w, &j->root);
+    size_t size = w.length;
+    unsigned char* result = (unsigned char*)json_writer_finish(&w);
+    if (result && length) *length = size;
+    return result;
+}
+
+static inline unsigned char* json_to_msgpack(const json* j, size_t* length) {
+    return json_to_msgpack_with_allocator(j, length, NULL);
+}
+
+// stream the encoding of j to write_fn, see serialize_json_to
+static inline bool_t json_to_msgpack_to(const json* j, json_write_fn write_fn, void* user) {
+    if (!j || !write_fn) return FALSE;
+    json_writer w;
+    json_writer_init_sink(&w, write_fn, NULL, user, j->allocator);
+    json_msgpack_write_value(&w, &j->root);
+    json_writer_flush(&w);
+    json_writer_free(&w);
+    return !w.failure;
+}
+
+typedef struct json_msgpack_reader {
+    const unsigned char* data;
+    size_t length;
+    size_t pos;
+    cereal_size_t depth;
+    bool_t failure;
+    char* error_text;
+    const json_allocator* alloc;
+} json_msgpack_reader;
+
+static inline bool_t json_msgpack_fail(json_msgpack_reader* r, const char* message) {
+    if (!r->failure && r->error_text) strcat(r->error_text, message);
+    r->failure = TRUE;
+    return FALSE;
+}
+
+// big endian unsigned of bytes length at the read position
+static inline bool_t json_msgpack_read_be(json_msgpack_reader* r, int bytes, uint64_t* value) {
+    if (r->length - r->pos < (size_t)bytes) return json_msgpack_fail(r, "cerialize ERROR: Truncated msgpack input.\n");
+    uint64_t v = 0;
+    for (int k = 0; k < bytes; k++) v = (v << 8) | r->data[r->pos + k];
+    r->pos += (size_t)bytes;
+    *value = v;
+    return TRUE;
+}
+
+// length of the str starting at the read position, which moves past its header
+static inline bool_t json_msgpack_read_str_header(json_msgpack_reader* r, size_t* len) {
+    unsigned char tag = r->data[r->pos++];
+    uint64_t value;
+    if ((tag & 0xe0) == 0xa0) {
+        value = tag & 0x1f;
+    } else if (tag == 0xd9 || tag == 0xda || tag == 0xdb) {
+        if (!json_msgpack_read_be(r, 1 << (tag - 0xd9), &value)) return FALSE;
+    } else {
+        return json_msgpack_fail(r, "cerialize ERROR: Expected a msgpack string.\n");
+    }
+    if (value > r->length - r->pos) return json_msgpack_fail(r, "cerialize ERROR: Truncated msgpack input.\n");
+    *len = (size_t)value;
+    return TRUE;
+}
+
+static inline bool_t json_msgpack_read_value(json_msgpack_reader* r, json_object* out);
+
+// count children, each at least one byte, allocated up front and filled in order
+static inline bool_t json_msgpack_read_list(json_msgpack_reader* r, uint64_t count, json_object* out) {
+    if (count > r->length - r->pos) return json_msgpack_fail(r, "cerialize ERROR: Truncated msgpack input.\n");
+    json_set_list(out, NULL, 0);
+    if (count == 0) return TRUE;
+    json_object* items = (json_object*)json_alloc(r->alloc, sizeof(json_object) * (size_t)count);
+    if (!items) return json_msgpack_fail(r, "cerialize ERROR: Failed to allocate memory for list.\n");
+    for (uint64_t i = 0; i < count; i++) json_set_null(&items[i]);
+    json_set_list(out, items, (cereal_size_t)count);
+    for (uint64_t i = 0; i < count; i++) {
+        if (!json_msgpack_read_value(r, &items[i])) return FALSE;
+    }
+    return TRUE;
+}
+
+static inline bool_t json_msgpack_read_map(json_msgpack_reader* r, uint64_t count, json_object* out) {
+    if (count > (r->length - r->pos) / 2) return json_msgpack_fail(r, "cerialize ERROR: Truncated msgpack input.\n");
+    json_set_object(out, NULL, 0);
+    if (count == 0) return TRUE;
+    json_node* nodes = (json_node*)json_alloc(r->alloc, sizeof(json_node) * (size_t)count);
+    if (!nodes) return json_msgpack_fail(r, "cerialize ERROR: Failed to allocate memory for object.\n");
+    memset(nodes, 0, sizeof(json_node) * (size_t)count);
+    for (uint64_t i = 0; i < count; i++) json_set_null(&nodes[i].value);
+    json_set_object(out, nodes, (cereal_size_t)count);
+    for (uint64_t i = 0; i < count; i++) {
+        size_t len;
+        if (r->pos >= r->length) return json_msgpack_fail(r, "cerialize ERROR: Truncated msgpack input.\n");
+        if (!json_msgpack_read_str_header(r, &len)) return FALSE;
+        if (!json_node_set_key_copy(&nodes[i], (const char*)r->data + r->pos, len, r->alloc)) {
+            return json_msgpack_fail(r, "cerialize ERROR: Failed to allocate memory for key.\n");
+        }
+        r->pos += len;
+        if (!json_msgpack_read_value(r, &nodes[i].value)) return FALSE;
+    }
+    return TRUE;
+}
+
+// decode one value into out. On failure out may hold a partial tree, which is
+// still safe to free.
+static inline bool_t json_msgpack_read_value(json_msgpack_reader* r, json_object* out) {
+    json_set_null(out);
+    if (r->pos >= r->length) return json_msgpack_fail(r, "cerialize ERROR: Truncated msgpack input.\n");
+    unsigned char tag = r->data[r->pos];
+    uint64_t value;
+
+    if (tag <= 0x7f) {
+        r->pos++;
+        json_set_number(out, (float)tag);
+        return TRUE;
+    }
+    if (tag >= 0xe0) {
+        r->pos++;
+        json_set_number(out, (float)((int)tag - 256));
+        return TRUE;
+    }
+    if ((tag & 0xe0) == 0xa0 || tag == 0xd9 || tag == 0xda || tag == 0xdb) {
+        size_t len;
+        if (!json_msgpack_read_str_header(r, &len)) return FALSE;
+        if (!json_set_string_copy(out, (const char*)r->data + r->pos, len, r->alloc)) {
+            return json_msgpack_fail(r, "cerialize ERROR: Failed to allocate memory for string.\n");
+        }
+        r->pos += len;
+        return TRUE;
+    }
+
+    bool_t nested = (tag & 0xf0) == 0x90 || (tag & 0xf0) == 0x80 || (tag >= 0xdc && tag <= 0xdf);
+    if (nested && r->depth == JSON_MSGPACK_MAX_DEPTH) {
+        return json_msgpack_fail(r, "cerialize ERROR: msgpack input nested too deeply.\n");
+    }
+    r->pos++;
+    bool_t ok;
+    switch (tag) {
+        case 0xc0:
+            return TRUE;
+        case 0xc2:
+        case 0xc3:
+            json_set_bool(out, tag == 0xc3);
+            return TRUE;
+        case 0xcc: case 0xcd: case 0xce: case 0xcf:
+            if (!json_msgpack_read_be(r, 1 << (tag - 0xcc), &value)) return FALSE;
+            json_set_number(out, (float)value);
+            return TRUE;
+        case 0xd0: case 0xd1: case 0xd2: case 0xd3: {
+            int bytes = 1 << (tag - 0xd0);
+            if (!json_msgpack_read_be(r, bytes, &value)) return FALSE;
+            // sign extend from the encoded width
+            if (bytes < 8 && (value >> (8 * bytes - 1))) value |= ~(uint64_t)0 << (8 * bytes);
+            json_set_number(out, (float)(int64_t)value);
+            return TRUE;
+        }
+        case 0xca: {
+            float f;
+            uint32_t bits;
+            if (!json_msgpack_read_be(r, 4, &value)) return FALSE;
+            bits = (uint32_t)value;
+            memcpy(&f, &bits, sizeof(f));
+            json_set_number(out, f);
+            return TRUE;
+        }
+        case 0xcb: {
+            double d;
+            if (!json_msgpack_read_be(r, 8, &value)) return FALSE;
+            memcpy(&d, &value, sizeof(d));
+            json_set_number(out, (float)d);
+            return TRUE;
+        }
+        case 0xdc: case 0xdd:
+            if (!json_msgpack_read_be(r, tag == 0xdc ? 2 : 4, &value)) return FALSE;
+            r->depth++;
+            ok = json_msgpack_read_list(r, value, out);
+            r->depth--;
+            return ok;
+        case 0xde: case 0xdf:
+            if (!json_msgpack_read_be(r, tag == 0xde ? 2 : 4, &value)) return FALSE;
+            r->depth++;
+            ok = json_msgpack_read_map(r, value, out);
+            r->depth--;
+            return ok;
+        default:
+            break;
+    }
+    if ((tag & 0xf0) == 0x90 || (tag & 0xf0) == 0x80) {
+        r->depth++;
+        ok = (tag & 0xf0) == 0x90 ? json_msgpack_read_list(r, tag & 0x0f, out) : json_msgpack_read_map(r, tag & 0x0f, out);
+        r->depth--;
+        return ok;
+    }
+    return json_msgpack_fail(r, "cerialize ERROR: Unsupported msgpack type.\n");
+}
+
+// decode a msgpack buffer holding exactly one value, reporting errors the way
+// deserialize_json does
+static inline json json_from_msgpack_with_allocator(const void* data, size_t length, const json_allocator* alloc) {
+    json result = { .failure = FALSE, .error_text = NULL, .allocator = alloc };
+    json_set_null(&result.root);
+    char* error_text = (char*)json_alloc(alloc, JSON_MAX_ERROR_LENGTH);
+    if (error_text == NULL) {
+        result.failure = TRUE;
+        result.error_text = json_alloc_error_text();
+        result.error_length = (cereal_size_t)strlen(result.error_text);
+        return result;
+    }
+    error_text[0] = '\0';
+
+    json_msgpack_reader r = { (const unsigned char*)data, data ? length : 0, 0, 0, FALSE, error_text, alloc };
+    if (json_msgpack_read_value(&r, &result.root) && r.pos != r.length) {
+        json_msgpack_fail(&r, "cerialize ERROR: Trailing bytes after msgpack value.\n");
+    }
+    if (r.failure) json_object_free_with_allocator(&result.root, alloc);
+    result.failure = r.failure;
+    result.error_text = error_text;
+    result.error_length = (cereal_size_t)strlen(error_text);
+    return result;
+}
+
+static inline json json_from_msgpack(const void* data, size_t length) {
+    return json_from_msgpack_with_allocator(data, length, NULL);
+}
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef CERIALIZE_PUBLISH_H
+#define CERIALIZE_PUBLISH_H
+
+#include "cerialize.h"
+#include "reclaim.h"
+#include <pthread.h>
+#include <sched.h>
+
+// Publishing a document to readers on other threads. json_publish swaps in a
+// new parsed document with one atomic exchange; readers bracket their reads
+// with json_reader_enter and json_reader_exit, which are wait-free and never
+// touch a lock. Old documents are reclaimed by epoch: each reader announces
+// the epoch it entered in, every replaced document is stamped with the epoch it
+// was retired in, and it is freed once no reader is still inside an epoch at
+// or before that stamp. Writers are serialized by a mutex. Needs the GCC or
+// Clang __atomic builtins and POSIX threads; link with -pthread.
+
+#define JSON_PUBLISH_READERS 64 // reader slots per publisher
+
+// one reader's announced epoch, on its own cache line so readers do not
+// contend with each other
+typedef struct json_publish_slot {
+    uint64_t epoch; // 0 while outside a read
+    uint32_t claimed;
+    char pad[64 - sizeof(uint64_t) - sizeof(uint32_t)];
+} json_publish_slot;
+
+typedef struct json_publish_entry {
+    json doc;
+    const json_allocator* allocator; // the entry's own, doc's allocator when taken
+    uint64_t retired; // epoch the entry was replaced in
+    struct json_publish_entry* next; // retired list, newest first
+} json_publish_entry;
+
+typedef struct json_publisher {
+    json_publish_slot slots[JSON_PUBLISH_READERS];
+    json_publish_entry* current; // read atomically
+    uint64_t epoch; // starts at 1, advanced by each publish
+    pthread_mutex_t lock; // writers, the retired list and the counters
+    json_publish_entry* retired;
+    json_reclaimer* reclaimer; // frees old documents off the writer when set
+    size_t published;
+    size_t freed;
+    size_t pending; // retired but still visible to some reader
+} json_publisher;
+
+typedef struct json_publish_reader {
+    json_publisher* publisher;
+    json_publish_slot* slot;
+} json_publish_reader;
+
+// move doc into a new entry, allocated like doc itself, and reset it as
+// json_free_deferred_to does
+static inline json_publish_entry* json_publish_take(json* doc) {
+    json_publish_entry* entry = (json_publish_entry*)json_alloc(doc->allocator, sizeof(json_publish_entry));
+    if (!entry) return NULL;
+    memset(entry, 0, sizeof(json_publish_entry));
+    entry->doc = *doc;
+    entry->allocator = doc->allocator;
+    json_set_null(&doc->root);
+    doc->block = NULL;
+    doc->error_text = NULL;
+    doc->error_length = 0;
+    doc->failure = FALSE;
+    return entry;
+}
+
+// Set up p with doc as its first document, which it takes over; doc is reset
+// like json_free. doc may be NULL to start with nothing published.
+static inline bool_t json_publisher_init(json_publisher* p, json* doc) {
+    memset(p, 0, sizeof(json_publisher));
+    p->epoch = 1;
+    if (doc) {
+        if (doc->failure) return FALSE;
+        json_publish_entry* entry = json_publish_take(doc);
+        if (!entry) return FALSE;
+        p->current = entry;
+        p->published = 1;
+    }
+    pthread_mutex_init(&p->lock, NULL);
+    return TRUE;
+}
+
+// Claim a reader slot for the calling thread. FALSE when every slot is taken.
+static inline bool_t json_publisher_register(json_publisher* p, json_publish_reader* r) {
+    for (size_t s = 0; s < JSON_PUBLISH_READERS; s++) {
+        uint32_t expected = 0;
+        if (__atomic_compare_exchange_n(&p->slots[s].claimed, &expected, 1, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            r->publisher = p;
+            r->slot = &p->slots[s];
+            return TRUE;
+        }
+    }
+    r->publisher = NULL;
+    r->slot = NULL;
+    return FALSE;
+}
+
+// give the slot back, outside a read
+static inline void json_publisher_unregister(json_publish_reader* r) {
+    if (!r->slot) return;
+    __atomic_store_n(&r->slot->claimed, 0, __ATOMIC_RELEASE);
+    r->slot = NULL;
+    r->publisher = NULL;
+}
+
+// Start a read and return the current document, NULL if none was published.
+// It stays valid until json_reader_exit; reads do not nest.
+static inline const json* json_reader_enter(json_publish_reader* r) {
+    json_publisher* p = r->publisher;
+    // announce before loading, so a publish that retires what we load sees us
+    __atomic_store_n(&r->slot->epoch, __atomic_load_n(&p->epoch, __ATOMIC_ACQUIRE), __ATOMIC_SEQ_CST);
+    json_publish_entry* entry = __atomic_load_n(&p->current, __ATOMIC_SEQ_CST);
+    return entry ? &entry->doc : NULL;
+}
+
+static inline void json_reader_exit(json_publish_reader* r) {
+    __atomic_store_n(&r->slot->epoch, 0, __ATOMIC_RELEASE);
+}
+
+// detach the retired documents no reader can still see, with p->lock held
+static inline json_publish_entry* json_publisher_collect(json_publisher* p) {
+    uint64_t oldest = UINT64_MAX;
+    for (size_t s = 0; s < JSON_PUBLISH_READERS; s++) {
+        uint64_t epoch = __atomic_load_n(&p->slots[s].epoch, __ATOMIC_SEQ_CST);
+        if (epoch != 0 && epoch < oldest) oldest = epoch;
+    }
+    // the list is newest first, so everything past the first free entry is free too
+    json_publish_entry** link = &p->retired;
+    while (*link && (*link)->retired >= oldest) link = &(*link)->next;
+    json_publish_entry* unused = *link;
+    *link = NULL;
+    for (json_publish_entry* e = unused; e; e = e->next) {
+        p->pending--;
+        p->freed++;
+    }
+    return unused;
+}
+
+static inline void json_publisher_free_entries(json_publisher* p, json_publish_entry* entry) {
+    while (entry) {
+        json_publish_entry* next = entry->next;
+        json_free_deferred_to(p->reclaimer, &entry->doc);
+        json_dealloc(entry->allocator, entry);
+        entry = next;
+    }
+}
+
+// Make doc the current document, taking it over and resetting it like
+// json_free. The replaced one is freed once its last reader has left. FALSE
+// leaves doc with the caller when it failed to parse or memory runs out.
+static inline bool_t json_publish(json_publisher* p, json* doc) {
+    if (!doc || doc->failure) return FALSE;
+    json_publish_entry* entry = json_publish_take(doc);
+    if (!entry) return FALSE;
+
+    pthread_mutex_lock(&p->lock);
+    json_publish_entry* old = __atomic_exchange_n(&p->current, entry, __ATOMIC_SEQ_CST);
+    // readers announcing a later epoch load the new entry
+    uint64_t retired = __atomic_fetch_add(&p->epoch, 1, __ATOMIC_SEQ_CST);
+    p->published++;
+    if (old) {
+        old->retired = retired;
+        old->next = p->retired;
+        p->retired = old;
+        p->pending++;
+    }
+    json_publish_entry* unused = json_publisher_collect(p);
+    pthread_mutex_unlock(&p->lock);
+    json_publisher_free_entries(p, unused);
+    return TRUE;
+}
+
+// free what no reader can still see; returns the number still waiting
+static inline size_t json_publisher_reclaim(json_publisher* p) {
+    pthread_mutex_lock(&p->lock);
+    json_publish_entry* unused = json_publisher_collect(p);
+    size_t pending = p->pending;
+    pthread_mutex_unlock(&p->lock);
+    json_publisher_free_entries(p, unused);
+    return pending;
+}
+
+// wait until every replaced document has been freed, yielding while readers
+// are still inside them
+static inline void json_publisher_flush(json_publisher* p) {
+    while (json_publisher_reclaim(p) > 0) sched_yield();
+}
+
+// free the current and every retired document; all readers must have exited
+static inline void json_publisher_destroy(json_publisher* p) {
+    json_publish_entry* current = __atomic_exchange_n(&p->current, NULL, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&p->lock);
+    json_publish_entry* unused = p->retired;
+    p->retired = NULL;
+    p->freed += p->pending;
+    p->pending = 0;
+    pthread_mutex_unlock(&p->lock);
+    if (current) current->next = unused;
+    json_publisher_free_entries(p, current ? current : unused);
+    pthread_mutex_destroy(&p->lock);
+}
+
+#endif
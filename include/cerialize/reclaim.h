@@ -0,0 +1,160 @@
+#ifndef CERIALIZE_RECLAIM_H
+#define CERIALIZE_RECLAIM_H
+
+#include "cerialize.h"
+#include <pthread.h>
+
+// Deferred destruction. json_free_deferred hands a parsed document to a
+// background thread and returns at once, so freeing a large tree never shows
+// up as latency on the calling thread. The queue is bounded: when it is full
+// the caller waits for the reclaimer to catch up instead of letting garbage
+// pile up. A queued document's allocator must be safe to call from the
+// reclaimer thread. POSIX threads only; link with -pthread.
+
+#define JSON_RECLAIM_QUEUE 1024 // capacity of the default reclaimer
+
+typedef struct json_reclaimer {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full; // also signalled whenever the worker goes idle
+    pthread_t thread;
+    json* queue; // ring buffer of documents waiting to be freed
+    const json_allocator* allocator; // holds the queue, NULL for malloc
+    size_t capacity;
+    size_t head;
+    size_t count;
+    bool_t busy; // the worker is freeing a document outside the lock
+    bool_t stopping;
+    bool_t running;
+    size_t freed; // documents freed by the worker
+    size_t stalls; // json_free_deferred_to calls that had to wait for room
+} json_reclaimer;
+
+static inline void* json_reclaimer_main(void* arg) {
+    json_reclaimer* r = (json_reclaimer*)arg;
+    pthread_mutex_lock(&r->lock);
+    for (;;) {
+        while (r->count == 0 && !r->stopping) {
+            pthread_cond_wait(&r->not_empty, &r->lock);
+        }
+        // pending documents are drained before a stop takes effect
+        if (r->count == 0) break;
+        json doc = r->queue[r->head];
+        r->head = (r->head + 1) % r->capacity;
+        r->count--;
+        r->busy = TRUE;
+        pthread_cond_broadcast(&r->not_full);
+        pthread_mutex_unlock(&r->lock);
+
+        json_free(&doc);
+
+        pthread_mutex_lock(&r->lock);
+        r->busy = FALSE;
+        r->freed++;
+        pthread_cond_broadcast(&r->not_full);
+    }
+    pthread_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+// start a reclaimer thread holding up to capacity queued documents, with the
+// queue taken from alloc (NULL for malloc)
+static inline bool_t json_reclaimer_start(json_reclaimer* r, size_t capacity, const json_allocator* alloc) {
+    memset(r, 0, sizeof(json_reclaimer));
+    if (capacity == 0) return FALSE;
+    r->allocator = alloc;
+    r->queue = (json*)json_alloc(alloc, sizeof(json) * capacity);
+    if (!r->queue) return FALSE;
+    r->capacity = capacity;
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->not_empty, NULL);
+    pthread_cond_init(&r->not_full, NULL);
+    if (pthread_create(&r->thread, NULL, json_reclaimer_main, r) != 0) {
+        pthread_cond_destroy(&r->not_full);
+        pthread_cond_destroy(&r->not_empty);
+        pthread_mutex_destroy(&r->lock);
+        json_dealloc(alloc, r->queue);
+        r->queue = NULL;
+        return FALSE;
+    }
+    r->running = TRUE;
+    return TRUE;
+}
+
+// Queue j for freeing and reset it like json_free does. Waits while the queue
+// is full; frees on the calling thread if r is not running.
+static inline void json_free_deferred_to(json_reclaimer* r, json* j) {
+    if (!j) return;
+    if (!r || !r->running) {
+        json_free(j);
+        return;
+    }
+    pthread_mutex_lock(&r->lock);
+    if (r->count == r->capacity) r->stalls++;
+    while (r->count == r->capacity && !r->stopping) {
+        pthread_cond_wait(&r->not_full, &r->lock);
+    }
+    if (r->stopping) {
+        pthread_mutex_unlock(&r->lock);
+        json_free(j);
+        return;
+    }
+    r->queue[(r->head + r->count) % r->capacity] = *j;
+    r->count++;
+    pthread_cond_signal(&r->not_empty);
+    pthread_mutex_unlock(&r->lock);
+
+    json_set_null(&j->root);
+    j->block = NULL;
+    j->error_text = NULL;
+    j->error_length = 0;
+    j->failure = FALSE;
+}
+
+// wait until every document queued so far has been freed
+static inline void json_reclaimer_flush(json_reclaimer* r) {
+    if (!r || !r->running) return;
+    pthread_mutex_lock(&r->lock);
+    while (r->count > 0 || r->busy) {
+        pthread_cond_wait(&r->not_full, &r->lock);
+    }
+    pthread_mutex_unlock(&r->lock);
+}
+
+// free whatever is still queued, then stop and join the thread
+static inline void json_reclaimer_stop(json_reclaimer* r) {
+    if (!r || !r->running) return;
+    pthread_mutex_lock(&r->lock);
+    r->stopping = TRUE;
+    pthread_cond_broadcast(&r->not_empty);
+    pthread_cond_broadcast(&r->not_full);
+    pthread_mutex_unlock(&r->lock);
+    pthread_join(r->thread, NULL);
+    pthread_cond_destroy(&r->not_full);
+    pthread_cond_destroy(&r->not_empty);
+    pthread_mutex_destroy(&r->lock);
+    json_dealloc(r->allocator, r->queue);
+    r->queue = NULL;
+    r->running = FALSE;
+}
+
+static json_reclaimer json_default_reclaimer_state;
+static pthread_once_t json_default_reclaimer_once = PTHREAD_ONCE_INIT;
+
+static inline void json_default_reclaimer_init(void) {
+    json_reclaimer_start(&json_default_reclaimer_state, JSON_RECLAIM_QUEUE, NULL);
+}
+
+// reclaimer used by json_free_deferred, started on first use and kept for the
+// life of the process. Each translation unit that includes this header has its own.
+static inline json_reclaimer* json_default_reclaimer(void) {
+    pthread_once(&json_default_reclaimer_once, json_default_reclaimer_init);
+    return &json_default_reclaimer_state;
+}
+
+// free j on the default reclaimer thread, see json_free_deferred_to
+static inline void json_free_deferred(json* j) {
+    json_free_deferred_to(json_default_reclaimer(), j);
+}
+
+#endif
@@ -0,0 +1,416 @@
+#ifndef CERIALIZE_SNAPSHOT_H
+#define CERIALIZE_SNAPSHOT_H
+
+#include "cerialize.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary snapshots. json_snapshot_write stores a tree as one position
+// independent image: every value is a 16 byte record, and lists, objects and
+// strings refer to their contents by offset from the start of the image.
+// json_snapshot_open maps the file read only and the accessors below read it
+// in place, so opening costs the same for any document size and processes
+// that open the same file share its page cache pages. Each object carries its
+// members in document order plus an index sorted by key for binary search.
+// The image uses the writer's byte order and is rejected elsewhere. POSIX only.
+
+#define JSON_SNAPSHOT_MAGIC "CRLZSNAP"
+#define JSON_SNAPSHOT_VERSION 1
+#define JSON_SNAPSHOT_BYTE_ORDER 0x01020304u
+#define JSON_SNAPSHOT_MAX_DEPTH 4096 // json_snapshot_verify gives up below this
+
+typedef struct json_snapshot_value {
+    uint8_t type; // json_type
+    uint8_t packing; // json_packing of a list
+    uint16_t reserved;
+    uint32_t count; // string bytes, list items or object members
+    uint64_t payload; // double bits, bool, or offset of the contents
+} json_snapshot_value;
+
+// object member; the members are followed by uint32_t[count] member indexes
+// sorted by key
+typedef struct json_snapshot_member {
+    uint64_t key; // offset of the null terminated key
+    uint32_t key_length;
+    uint32_t reserved;
+    json_snapshot_value value;
+} json_snapshot_member;
+
+typedef struct json_snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t size; // bytes in the image, header included
+    json_snapshot_value root;
+} json_snapshot_header;
+
+typedef struct json_snapshot {
+    const unsigned char* base; // start of the mapping
+    size_t size;
+} json_snapshot;
+
+// accessors, v must point into snap
+static inline const json_snapshot_value* json_snapshot_root(const json_snapshot* snap) {
+    return &((const json_snapshot_header*)snap->base)->root;
+}
+
+static inline json_type json_snapshot_type(const json_snapshot_value* v) {
+    return (json_type)v->type;
+}
+
+static inline double json_snapshot_number(const json_snapshot_value* v) {
+    double d;
+    memcpy(&d, &v->payload, sizeof(d));
+    return d;
+}
+
+static inline bool_t json_snapshot_bool(const json_snapshot_value* v) {
+    return v->payload != 0;
+}
+
+static inline const char* json_snapshot_string(const json_snapshot* snap, const json_snapshot_value* v, size_t* length) {
+    if (length) *length = v->count;
+    return (const char*)snap->base + v->payload;
+}
+
+// list items or object members
+static inline cereal_size_t json_snapshot_count(const json_snapshot_value* v) {
+    return v->count;
+}
+
+static inline json_packing json_snapshot_packing(const json_snapshot_value* v) {
+    return (json_packing)v->packing;
+}
+
+// item i of an unpacked list, NULL for packed lists
+static inline const json_snapshot_value* json_snapshot_at(const json_snapshot* snap, const json_snapshot_value* v, cereal_size_t index) {
+    if (v->packing != JSON_PACKED_NONE) return NULL;
+    return &((const json_snapshot_value*)(snap->base + v->payload))[index];
+}
+
+// raw data of a packed list, laid out as in json_list_packed
+static inline json_packed_view json_snapshot_packed(const json_snapshot* snap, const json_snapshot_value* v) {
+    json_packed_view view = { (json_packing)v->packing, v->count, snap->base + v->payload, 0 };
+    view.size = json_packed_size(view.packing, view.count);
+    return view;
+}
+
+static inline const json_snapshot_member* json_snapshot_members(const json_snapshot* snap, const json_snapshot_value* v) {
+    return (const json_snapshot_member*)(snap->base + v->payload);
+}
+
+static inline const char* json_snapshot_key_at(const json_snapshot* snap, const json_snapshot_value* v, cereal_size_t index, size_t* length) {
+    const json_snapshot_member* member = &json_snapshot_members(snap, v)[index];
+    if (length) *length = member->key_length;
+    return (const char*)snap->base + member->key;
+}
+
+static inline const json_snapshot_value* json_snapshot_value_at(const json_snapshot* snap, const json_snapshot_value* v, cereal_size_t index) {
+    return &json_snapshot_members(snap, v)[index].value;
+}
+
+// byte order first, shorter key first on a common prefix
+static inline int json_snapshot_key_compare(const char* a, size_t a_len, const char* b, size_t b_len) {
+    int c = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (c != 0) return c;
+    return a_len < b_len ? -1 : (a_len > b_len ? 1 : 0);
+}
+
+// member named key through the sorted index, the first one in document order
+// when a key repeats. NULL when obj is not an object or lacks the key.
+static inline const json_snapshot_value* json_snapshot_find(const json_snapshot* snap, const json_snapshot_value* obj, const char* key, size_t length) {
+    if (obj->type != JSON_OBJECT) return NULL;
+    const json_snapshot_member* members = json_snapshot_members(snap, obj);
+    const uint32_t* index = (const uint32_t*)(members + obj->count);
+    size_t lo = 0, hi = obj->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const json_snapshot_member* m = &members[index[mid]];
+        if (json_snapshot_key_compare((const char*)snap->base + m->key, m->key_length, key, length) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == obj->count) return NULL;
+    const json_snapshot_member* m = &members[index[lo]];
+    if (json_snapshot_key_compare((const char*)snap->base + m->key, m->key_length, key, length) != 0) return NULL;
+    return &m->value;
+}
+
+// image layout while writing, base stays NULL while measuring
+typedef struct json_snapshot_state {
+    unsigned char* base;
+    uint64_t values; // next 8 byte aligned offset for records and packed data
+    uint64_t bytes; // next offset in the byte area
+    uint64_t bytes_start;
+    uint32_t* scratch; // merge buffer for the key sort
+    cereal_size_t scratch_size;
+    const json_allocator* alloc;
+    bool_t failure;
+} json_snapshot_state;
+
+static inline uint64_t json_snapshot_take(json_snapshot_state* state, size_t size) {
+    uint64_t offset = state->values;
+    state->values += (size + 7) & ~(size_t)7;
+    return offset;
+}
+
+static inline uint64_t json_snapshot_text(json_snapshot_state* state, const char* text, size_t len) {
+    uint64_t offset = state->bytes_start + state->bytes;
+    state->bytes += len + 1;
+    if (state->base) {
+        memcpy(state->base + offset, text, len);
+        state->base[offset + len] = '\0';
+    }
+    return offset;
+}
+
+// stable bottom up merge sort of member indexes by key
+static inline void json_snapshot_sort_keys(json_snapshot_state* state, const json_object* obj, uint32_t* index, cereal_size_t count) {
+    for (cereal_size_t i = 0; i < count; i++) index[i] = i;
+    if (count < 2) return;
+    if (state->scratch_size < count) {
+        uint32_t* grown = (uint32_t*)json_realloc(state->alloc, state->scratch, sizeof(uint32_t) * count);
+        if (!grown) {
+            state->failure = TRUE;
+            return;
+        }
+        state->scratch = grown;
+        state->scratch_size = count;
+    }
+    uint32_t* src = index;
+    uint32_t* dst = state->scratch;
+    for (cereal_size_t width = 1; width < count; width *= 2) {
+        for (cereal_size_t lo = 0; lo < count; lo += 2 * width) {
+            cereal_size_t mid = lo + width < count ? lo + width : count;
+            cereal_size_t hi = lo + 2 * width < count ? lo + 2 * width : count;
+            cereal_size_t a = lo, b = mid, out = lo;
+            while (a < mid && b < hi) {
+                size_t a_len, b_len;
+                const char* a_key = json_object_key_at(obj, src[a], &a_len);
+                const char* b_key = json_object_key_at(obj, src[b], &b_len);
+                dst[out++] = json_snapshot_key_compare(b_key, b_len, a_key, a_len) < 0 ? src[b++] : src[a++];
+            }
+            while (a < mid) dst[out++] = src[a++];
+            while (b < hi) dst[out++] = src[b++];
+        }
+        uint32_t* swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != index) memcpy(index, src, sizeof(uint32_t) * count);
+}
+
+// fill the record at out from obj and lay out its contents, out is NULL while measuring
+static inline void json_snapshot_place(json_snapshot_state* state, const json_object* obj, json_snapshot_value* out) {
+    json_snapshot_value v;
+    memset(&v, 0, sizeof(v));
+    v.type = (uint8_t)json_typeof(obj);
+    switch (json_typeof(obj)) {
+        case JSON_STRING:
+        case JSON_RAW: {
+            size_t len;
+            const char* str = json_string_get(obj, &len);
+            v.count = (uint32_t)len;
+            v.payload = json_snapshot_text(state, str ? str : "", len);
+            break;
+        }
+        case JSON_NUMBER: {
+            double d = (double)json_number_value(obj);
+            memcpy(&v.payload, &d, sizeof(d));
+            break;
+        }
+        case JSON_BOOL:
+            v.payload = json_bool_value(obj) ? 1 : 0;
+            break;
+        case JSON_LIST: {
+            cereal_size_t count = json_list_count(obj);
+            v.count = count;
+            v.packing = (uint8_t)json_list_packing(obj);
+            if (v.packing != JSON_PACKED_NONE) {
+                size_t size = json_packed_size((json_packing)v.packing, count);
+                v.payload = json_snapshot_take(state, size);
+                if (state->base) memcpy(state->base + v.payload, json_list_data(obj), size);
+                break;
+            }
+            v.payload = json_snapshot_take(state, sizeof(json_snapshot_value) * count);
+            json_snapshot_value* items = state->base ? (json_snapshot_value*)(state->base + v.payload) : NULL;
+            for (cereal_size_t i = 0; i < count; i++) {
+                json_snapshot_place(state, json_list_at(obj, i), items ? &items[i] : NULL);
+            }
+            break;
+        }
+        case JSON_OBJECT: {
+            cereal_size_t count = json_node_count(obj);
+            v.count = count;
+            v.payload = json_snapshot_take(state, sizeof(json_snapshot_member) * count + sizeof(uint32_t) * count);
+            json_snapshot_member* members = state->base ? (json_snapshot_member*)(state->base + v.payload) : NULL;
+            if (members) json_snapshot_sort_keys(state, obj, (uint32_t*)(members + count), count);
+            for (cereal_size_t i = 0; i < count; i++) {
+                size_t len;
+                const char* key = json_object_key_at(obj, i, &len);
+                uint64_t key_offset = json_snapshot_text(state, key ? key : "", len);
+                if (members) {
+                    memset(&members[i], 0, sizeof(json_snapshot_member));
+                    members[i].key = key_offset;
+                    members[i].key_length = (uint32_t)len;
+                }
+                json_snapshot_place(state, json_object_value_at(obj, i), members ? &members[i].value : NULL);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    if (out) *out = v;
+}
+
+// Write doc to path as a snapshot. The image goes to path.tmp first and is
+// renamed over path, so processes that have the old file mapped keep a
+// consistent view.
+static inline bool_t json_snapshot_write(const json* doc, const char* path) {
+    if (!doc || doc->failure || !path) return FALSE;
+    json_snapshot_state state;
+    memset(&state, 0, sizeof(state));
+    state.alloc = doc->allocator;
+    state.values = sizeof(json_snapshot_header);
+    json_snapshot_place(&state, &doc->root, NULL);
+
+    uint64_t values = state.values;
+    uint64_t size = values + state.bytes;
+    size_t path_len = strlen(path);
+    char* tmp_path = (char*)json_alloc(doc->allocator, path_len + 5);
+    unsigned char* image = (unsigned char*)json_alloc(doc->allocator, (size_t)size);
+    bool_t ok = tmp_path != NULL && image != NULL;
+    if (ok) {
+        memset(image, 0, (size_t)values);
+        memset(&state, 0, sizeof(state));
+        state.alloc = doc->allocator;
+        state.base = image;
+        state.values = sizeof(json_snapshot_header);
+        state.bytes_start = values;
+        json_snapshot_header* header = (json_snapshot_header*)image;
+        memcpy(header->magic, JSON_SNAPSHOT_MAGIC, sizeof(header->magic));
+        header->version = JSON_SNAPSHOT_VERSION;
+        header->byte_order = JSON_SNAPSHOT_BYTE_ORDER;
+        header->size = size;
+        json_snapshot_place(&state, &doc->root, &header->root);
+        json_dealloc(doc->allocator, state.scratch);
+        ok = !state.failure;
+    }
+    if (ok) {
+        memcpy(tmp_path, path, path_len);
+        memcpy(tmp_path + path_len, ".tmp", 5);
+        FILE* file = fopen(tmp_path, "wb");
+        ok = file != NULL;
+        if (ok) {
+            ok = fwrite(image, 1, (size_t)size, file) == size;
+            if (fclose(file) != 0) ok = FALSE;
+            if (ok) ok = rename(tmp_path, path) == 0;
+            if (!ok) remove(tmp_path);
+        }
+    }
+    json_dealloc(doc->allocator, image);
+    json_dealloc(doc->allocator, tmp_path);
+    return ok;
+}
+
+// Map the snapshot at path. Only the header is checked, the contents are
+// trusted; run json_snapshot_verify on files from elsewhere.
+static inline bool_t json_snapshot_open(const char* path, json_snapshot* snap) {
+    memset(snap, 0, sizeof(*snap));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return FALSE;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(json_snapshot_header)) {
+        close(fd);
+        return FALSE;
+    }
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return FALSE;
+    const json_snapshot_header* header = (const json_snapshot_header*)base;
+    if (memcmp(header->magic, JSON_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0
+        || header->version != JSON_SNAPSHOT_VERSION
+        || header->byte_order != JSON_SNAPSHOT_BYTE_ORDER
+        || header->size != (uint64_t)st.st_size) {
+        munmap(base, (size_t)st.st_size);
+        return FALSE;
+    }
+    snap->base = (const unsigned char*)base;
+    snap->size = (size_t)st.st_size;
+    return TRUE;
+}
+
+static inline void json_snapshot_close(json_snapshot* snap) {
+    if (!snap || !snap->base) return;
+    munmap((void*)snap->base, snap->size);
+    snap->base = NULL;
+    snap->size = 0;
+}
+
+// next is the offset where the writer put the next contents: lists and
+// objects are laid out depth first, so each one must start exactly there and
+// no two records can share, or loop back to, the same contents
+static inline bool_t json_snapshot_verify_value(const json_snapshot* snap, const json_snapshot_value* v, uint64_t* next, int depth) {
+    uint64_t size = snap->size;
+    if (depth > JSON_SNAPSHOT_MAX_DEPTH) return FALSE;
+    switch (v->type) {
+        case JSON_NULL:
+        case JSON_NUMBER:
+        case JSON_BOOL:
+            return TRUE;
+        case JSON_STRING:
+        case JSON_RAW:
+            return v->payload < size && v->count < size - v->payload && snap->base[v->payload + v->count] == '\0';
+        case JSON_LIST: {
+            if (v->payload != *next || v->payload > size) return FALSE;
+            if (v->packing != JSON_PACKED_NONE) {
+                if (v->packing > JSON_PACKED_BOOL) return FALSE;
+                size_t packed = json_packed_size((json_packing)v->packing, v->count);
+                if (packed > size - v->payload) return FALSE;
+                *next += (packed + 7) & ~(uint64_t)7;
+                return TRUE;
+            }
+            if ((uint64_t)v->count > (size - v->payload) / sizeof(json_snapshot_value)) return FALSE;
+            *next += sizeof(json_snapshot_value) * (uint64_t)v->count;
+            const json_snapshot_value* items = (const json_snapshot_value*)(snap->base + v->payload);
+            for (uint32_t i = 0; i < v->count; i++) {
+                if (!json_snapshot_verify_value(snap, &items[i], next, depth + 1)) return FALSE;
+            }
+            return TRUE;
+        }
+        case JSON_OBJECT: {
+            if (v->payload != *next || v->payload > size) return FALSE;
+            if ((uint64_t)v->count > (size - v->payload) / (sizeof(json_snapshot_member) + sizeof(uint32_t))) return FALSE;
+            *next += ((sizeof(json_snapshot_member) + sizeof(uint32_t)) * (uint64_t)v->count + 7) & ~(uint64_t)7;
+            const json_snapshot_member* members = (const json_snapshot_member*)(snap->base + v->payload);
+            const uint32_t* index = (const uint32_t*)(members + v->count);
+            for (uint32_t i = 0; i < v->count; i++) {
+                const json_snapshot_member* m = &members[i];
+                if (index[i] >= v->count) return FALSE;
+                if (m->key >= size || m->key_length >= size - m->key || snap->base[m->key + m->key_length] != '\0') return FALSE;
+                if (!json_snapshot_verify_value(snap, &m->value, next, depth + 1)) return FALSE;
+            }
+            for (uint32_t i = 1; i < v->count; i++) {
+                const json_snapshot_member* a = &members[index[i - 1]];
+                const json_snapshot_member* b = &members[index[i]];
+                if (json_snapshot_key_compare((const char*)snap->base + a->key, a->key_length,
+                        (const char*)snap->base + b->key, b->key_length) > 0) return FALSE;
+            }
+            return TRUE;
+        }
+        default:
+            return FALSE;
+    }
+}
+
+// walk the whole image and check every offset, length and key index against
+// the mapping. O(size), for snapshots that did not come from a trusted writer.
+static inline bool_t json_snapshot_verify(const json_snapshot* snap) {
+    if (!snap || !snap->base) return FALSE;
+    uint64_t next = sizeof(json_snapshot_header);
+    return json_snapshot_verify_value(snap, json_snapshot_root(snap), &next, 0);
+}
+
+#endif
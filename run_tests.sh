@@ -11,3 +11,6 @@ cd ..
 
 echo "Running tests..."
 ./build/tests
+
+echo "Running tests with the compact layout..."
+./build/tests_compact
@@ -0,0 +1,110 @@
+#ifndef TEST_ALLOCATOR_H
+#define TEST_ALLOCATOR_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    const char* input;
+    int should_fail; // 1 if parsing should fail, allocations must still balance
+    int odd; // odd sized blocks start at odd addresses, see odd_alloc
+} allocator_test_case_t;
+
+// the compact layout refuses heap keys at odd addresses instead of misreading them
+#ifdef CERIALIZE_COMPACT
+#define ALLOCATOR_ODD_KEYS_FAIL 1
+#else
+#define ALLOCATOR_ODD_KEYS_FAIL 0
+#endif
+
+// odd sized blocks, such as key copies, start at an odd address, as packed by a
+// byte granular arena; the rest stay aligned for the structs they hold
+static void* odd_alloc(void* ctx, size_t size) {
+    if (!(size & 1)) return counting_alloc(ctx, size);
+    char* block = (char*)counting_alloc(ctx, size + 1);
+    return block ? block + 1 : NULL;
+}
+
+static void odd_free(void* ctx, void* ptr) {
+    counting_free(ctx, ((uintptr_t)ptr & 1) ? (char*)ptr - 1 : ptr);
+}
+
+static void* odd_realloc(void* ctx, void* ptr, size_t size) {
+    if (ptr == NULL) return odd_alloc(ctx, size);
+    if (!((uintptr_t)ptr & 1)) return counting_realloc(ctx, ptr, size);
+    char* block = (char*)counting_realloc(ctx, (char*)ptr - 1, size + 1);
+    return block ? block + 1 : NULL;
+}
+
+test_summary_t run_allocator_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    allocator_test_case_t allocator_tests[] = {
+        // Positive cases
+        {"\"hello\"", 0, 0},
+        {"42", 0, 0},
+        {"[1,\"a\",true,null]", 0, 0},
+        {"{\"key\":\"value\",\"list\":[1,2,3]}", 0, 0},
+        {"{\"users\":[{\"name\":\"John\"},{\"name\":\"Jane\"}]}", 0, 0},
+        {"[\"a string long enough for the heap!\",{\"k\":2}]", 0, 1},
+        // Negative cases
+        {"\"unclosed", 1, 0},
+        {"{\"key\" 1}", 1, 0},
+        {"{\"a_long_key_name1\":1}", ALLOCATOR_ODD_KEYS_FAIL, 1},
+    };
+    size_t total = sizeof(allocator_tests)/sizeof(allocator_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(allocator_tests)/sizeof(allocator_tests[0])];
+    printf("Running allocator tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const allocator_test_case_t *tc = &allocator_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        json_allocator odd = { odd_alloc, odd_realloc, odd_free, &counts };
+        if (tc->odd) alloc = odd;
+
+        json result = deserialize_json_with_allocator(tc->input, strlen(tc->input), &alloc);
+        int pass = (result.failure == (tc->should_fail ? TRUE : FALSE));
+        if (!result.failure) {
+            // serialize_json picks up the allocator recorded in the result
+            char* out = serialize_json(&result);
+            if (out == NULL) pass = 0;
+            json_dealloc(&alloc, out);
+        }
+        json_free(&result);
+
+        // every allocation must have gone through the hooks and been released
+        if (counts.allocs == 0 || counts.allocs != counts.frees) pass = 0;
+
+        char result_str[32];
+        snprintf(result_str, sizeof(result_str), "%zu/%zu", counts.allocs, counts.frees);
+        format_input_display(tc->input, rows[i].input_display, 21);
+        strcpy(rows[i].expected, tc->should_fail ? "Error+balanced" : "balanced");
+        strcpy(rows[i].result, result_str);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"Input", "Expected", "Allocs/Frees", "Status"};
+    int col_widths[] = {20, 16, 12, 10};
+    print_test_table("Allocator Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Allocator tests completed.\n");
+    return summary;
+}
+
+#endif
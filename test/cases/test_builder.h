@@ -0,0 +1,159 @@
+#ifndef TEST_BUILDER_H
+#define TEST_BUILDER_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include <stdio.h>
+#include <string.h>
+
+// Each case drives the json_w_* calls on a fresh writer
+typedef struct {
+    const char* name;
+    void (*build)(json_writer* w);
+    const char* expected;  // NULL when the calls are invalid and finish must fail
+} builder_test_case_t;
+
+static void build_scalar(json_writer* w) {
+    json_w_number(w, 2.5);
+}
+
+static void build_empty_containers(json_writer* w) {
+    json_w_begin_array(w);
+    json_w_begin_object(w);
+    json_w_end_object(w);
+    json_w_begin_array(w);
+    json_w_end_array(w);
+    json_w_end_array(w);
+}
+
+static void build_record(json_writer* w) {
+    json_w_begin_object(w);
+    json_w_key(w, "id");
+    json_w_int(w, -42);
+    json_w_key(w, "name");
+    json_w_string(w, "a \"quoted\" name");
+    json_w_key(w, "active");
+    json_w_bool(w, TRUE);
+    json_w_key(w, "score");
+    json_w_number(w, 0.1);
+    json_w_key(w, "parent");
+    json_w_null(w);
+    json_w_key(w, "tags");
+    json_w_begin_array(w);
+    json_w_string(w, "x");
+    json_w_string(w, "y");
+    json_w_end_array(w);
+    json_w_end_object(w);
+}
+
+static void build_embedded_tree(json_writer* w) {
+    json parsed = deserialize_json("{\"a\":[1,2]}", 11);
+    json_w_begin_array(w);
+    json_w_value(w, &parsed.root);
+    json_w_int(w, 3);
+    json_w_end_array(w);
+    json_free(&parsed);
+}
+
+static void build_key_in_array(json_writer* w) {
+    json_w_begin_array(w);
+    json_w_key(w, "oops");
+    json_w_end_array(w);
+}
+
+static void build_value_without_key(json_writer* w) {
+    json_w_begin_object(w);
+    json_w_int(w, 1);
+    json_w_end_object(w);
+}
+
+static void build_dangling_key(json_writer* w) {
+    json_w_begin_object(w);
+    json_w_key(w, "a");
+    json_w_end_object(w);
+}
+
+static void build_mismatched_end(json_writer* w) {
+    json_w_begin_object(w);
+    json_w_end_array(w);
+}
+
+static void build_unterminated(json_writer* w) {
+    json_w_begin_array(w);
+    json_w_int(w, 1);
+}
+
+static void build_two_roots(json_writer* w) {
+    json_w_int(w, 1);
+    json_w_int(w, 2);
+}
+
+static void build_too_deep(json_writer* w) {
+    for (int i = 0; i <= JSON_WRITER_MAX_DEPTH; i++) json_w_begin_array(w);
+    for (int i = 0; i <= JSON_WRITER_MAX_DEPTH; i++) json_w_end_array(w);
+}
+
+test_summary_t run_builder_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    builder_test_case_t builder_tests[] = {
+        // Positive cases
+        {"Scalar root", build_scalar, "2.5"},
+        {"Empty containers", build_empty_containers, "[{},[]]"},
+        {"Record", build_record, "{\"id\":-42,\"name\":\"a \\\"quoted\\\" name\",\"active\":true,\"score\":0.1,\"parent\":null,\"tags\":[\"x\",\"y\"]}"},
+        {"Embedded tree", build_embedded_tree, "[{\"a\":[1,2]},3]"},
+        // Negative cases
+        {"Key in array", build_key_in_array, NULL},
+        {"Value without key", build_value_without_key, NULL},
+        {"Dangling key", build_dangling_key, NULL},
+        {"Mismatched end", build_mismatched_end, NULL},
+        {"Unterminated", build_unterminated, NULL},
+        {"Two roots", build_two_roots, NULL},
+        {"Too deep", build_too_deep, NULL},
+    };
+    size_t total = sizeof(builder_tests)/sizeof(builder_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(builder_tests)/sizeof(builder_tests[0])];
+    printf("Running builder tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const builder_test_case_t *tc = &builder_tests[i];
+        json_writer w;
+        json_writer_init(&w, NULL);
+        tc->build(&w);
+        char* out = json_writer_finish(&w);
+
+        int pass;
+        if (tc->expected) {
+            pass = out != NULL && strcmp(out, tc->expected) == 0;
+        } else {
+            pass = out == NULL;
+        }
+
+        snprintf(rows[i].input_display, sizeof(rows[i].input_display), "%s", tc->name);
+        snprintf(rows[i].expected, sizeof(rows[i].expected), "%s", tc->expected ? tc->expected : "Error");
+        snprintf(rows[i].result, sizeof(rows[i].result), "%s", out ? out : "Error");
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->expected) {
+            if (pass) ++positive_passed; else ++positive_failed;
+        } else {
+            if (pass) ++negative_passed; else ++negative_failed;
+        }
+        free(out);
+    }
+
+    const char *headers[] = {"Input", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 24, 24, 10};
+    print_test_table("Builder Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Builder tests completed.\n");
+    return summary;
+}
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef TEST_CLONE_H
+#define TEST_CLONE_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Each input is parsed, optionally grown with json_list_append, then both
+// cloned with json_clone_compact and compacted in place with json_compact.
+// The clone must be one allocation that outlives the source, with container
+// storage laid out in depth first order, and both must serialize back to the
+// expected text. Every list and object in either copy must refuse edits.
+// Long keys placed after text of odd length must still read back as keys, and
+// a json_object_copy of the compacted tree must be editable and outlive it.
+typedef struct {
+    const char* input;
+    int pack; // parse with pack_arrays
+    int share; // parse with share_shapes
+    int appends; // numbers appended to the root list before copying
+    const char* expected_output; // NULL to expect the input back
+    int should_fail;
+} clone_test_case_t;
+
+// storage of every container in obj lies inside the block and follows the
+// storage visited before it
+static int clone_in_order(const json_object* obj, const char* block, size_t size, const char** last) {
+    const char* storage = NULL;
+    if (json_typeof(obj) == JSON_LIST) {
+        storage = (const char*)json_list_data(obj);
+    } else if (json_typeof(obj) == JSON_OBJECT) {
+        storage = json_object_shape(obj) ? (const char*)obj->value.shaped : (const char*)json_nodes(obj);
+    } else if (json_typeof(obj) == JSON_STRING && json_string_heap(obj)) {
+        const char* text = json_string_heap(obj);
+        return text >= block && text < block + size;
+    }
+    if (storage) {
+        if (storage < block || storage >= block + size || storage <= *last) return 0;
+        *last = storage;
+    }
+    for (cereal_size_t i = 0; i < json_child_count(obj); i++) {
+        if (!clone_in_order(json_child_at(obj, i), block, size, last)) return 0;
+    }
+    return 1;
+}
+
+// every container under obj refuses to be edited
+static int clone_read_only(json_object* obj, const json_allocator* alloc) {
+    json_object item;
+    json_set_number(&item, 1.0f);
+    if (json_typeof(obj) == JSON_LIST) {
+        if (json_list_append(obj, item, alloc) || json_list_reserve(obj, 64, alloc)) return 0;
+        if (json_list_count(obj) > 0 && json_list_remove(obj, 0, alloc)) return 0;
+    } else if (json_typeof(obj) == JSON_OBJECT) {
+        if (json_object_set(obj, "added", item, alloc)) return 0;
+        size_t len;
+        const char* key = json_node_count(obj) > 0 ? json_object_key_at(obj, 0, &len) : NULL;
+        if (key && (json_object_set(obj, key, item, alloc) || json_object_remove(obj, key, alloc))) return 0;
+    }
+    for (cereal_size_t i = 0; i < json_child_count(obj); i++) {
+        if (!clone_read_only(json_child_at(obj, i), alloc)) return 0;
+    }
+    return 1;
+}
+
+static char* clone_serialize(const json_object* root, const json_allocator* alloc) {
+    json tmp = { .root = *root, .failure = FALSE, .error_text = NULL };
+    return serialize_json_with_allocator(&tmp, alloc);
+}
+
+test_summary_t run_clone_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    // deeper than the walk's local stack
+    static char deep[256];
+    for (int k = 0; k < 100; k++) {
+        deep[k] = '[';
+        deep[100 + k] = ']';
+    }
+    deep[200] = '\0';
+
+    clone_test_case_t clone_tests[] = {
+        // Positive cases
+        {"{\"a\":1,\"b\":[true,null,\"x\"],\"c\":{\"d\":\"a string long enough for the heap\"}}", 0, 0, 0, NULL, 0},
+        {"[[1,2],[3,[4,[5]]],{\"k\":[]}]", 0, 0, 0, NULL, 0},
+        {"[1,2,3.5]", 1, 0, 0, NULL, 0},
+        {"[[true,false],[7,8,9]]", 1, 0, 0, NULL, 0},
+        {"[{\"id\":1,\"name\":\"ann\"},{\"id\":2,\"name\":\"bob\"}]", 0, 1, 0, NULL, 0},
+        {"[{\"a_long_key_name\":\"v\"},{\"a_long_key_name\":\"w\"},{\"b\":1}]", 0, 1, 0, NULL, 0},
+        {"{\"abcdefgh\":1,\"ijklmnopq\":2,\"rstuvwxyz1\":3}", 0, 0, 0, NULL, 0},
+        {"[\"a string long enough for the heap\",{\"odd\":\"nine byte\",\"another_long_key\":1}]", 0, 0, 0, NULL, 0},
+        {"[]", 0, 0, 5, "[0,1,2,3,4]", 0},
+        {"[\"s\"]", 0, 0, 2, "[\"s\",0,1]", 0},
+        {"{}", 0, 0, 0, NULL, 0},
+        {"\"just a string at the root\"", 0, 0, 0, NULL, 0},
+        {"42", 0, 0, 0, NULL, 0},
+        {deep, 0, 0, 0, NULL, 0},
+        // Negative cases
+        {"[1,", 0, 0, 0, NULL, 1},
+        {"{\"a\":}", 0, 0, 0, NULL, 1},
+    };
+    size_t total = sizeof(clone_tests)/sizeof(clone_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(clone_tests)/sizeof(clone_tests[0])];
+    printf("Running compact clone tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const clone_test_case_t *tc = &clone_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        json_parse_options options = { &alloc, tc->pack ? TRUE : FALSE, tc->share ? TRUE : FALSE, 0, NULL, 0 };
+        json doc = deserialize_json_with_options(tc->input, strlen(tc->input), &options);
+        const char* expected = tc->expected_output ? tc->expected_output : tc->input;
+        char result_str[64];
+        int pass = 1;
+
+        if (tc->should_fail) {
+            pass = doc.failure && !json_compact(&doc);
+            strcpy(result_str, doc.failure ? "Error" : "parsed");
+        } else if (doc.failure) {
+            pass = 0;
+            strcpy(result_str, "parse error");
+        } else {
+            for (int k = 0; k < tc->appends; k++) {
+                json_object item;
+                json_set_number(&item, (float)k);
+                if (!json_list_append(&doc.root, item, &alloc)) pass = 0;
+            }
+
+            // the clone is one live block and does not depend on the source
+            size_t live = counts.allocs - counts.frees;
+            json_object* clone = json_clone_compact_with_allocator(&doc.root, &alloc);
+            size_t block_size = counting_block_size(&counts, clone);
+            if (!clone || counts.allocs - counts.frees != live + 1) pass = 0;
+            const char* last = (const char*)clone;
+            if (clone && !clone_in_order(clone, (const char*)clone, block_size, &last)) pass = 0;
+            if (clone && !clone_read_only(clone, &alloc)) pass = 0;
+            if (clone && json_typeof(clone) == JSON_LIST && json_list_packing(clone) == JSON_PACKED_NONE
+                && json_list_count(clone) > 1 && json_object_shape(json_list_at(clone, 0))) {
+                // records keep sharing one copied shape
+                if (json_object_shape(json_list_at(clone, 0)) != json_object_shape(json_list_at(clone, 1))) pass = 0;
+            }
+
+            // compaction in place, then the old tree is gone
+            if (!json_compact(&doc) || doc.block == NULL) pass = 0;
+            last = (const char*)doc.block;
+            if (doc.block && !clone_in_order(&doc.root, (const char*)doc.block, counting_block_size(&counts, doc.block), &last)) pass = 0;
+            if (!clone_read_only(&doc.root, &alloc) || json_share(&doc)) pass = 0;
+            char* compacted = serialize_json_with_allocator(&doc, &alloc);
+            if (!compacted || strcmp(compacted, expected) != 0) pass = 0;
+            json_dealloc(&alloc, compacted);
+            // compacting twice replaces the block
+            if (!json_compact(&doc)) pass = 0;
+            // an ordinary copy is editable and outlives the block
+            json_object copy;
+            if (!json_object_copy(&copy, &doc.root, &alloc) || json_is_read_only(&copy)) pass = 0;
+            json_free(&doc);
+            char* copied = clone_serialize(&copy, &alloc);
+            if (!copied || strcmp(copied, expected) != 0) pass = 0;
+            json_dealloc(&alloc, copied);
+            json_object_free_with_allocator(&copy, &alloc);
+
+            char* out = clone ? clone_serialize(clone, &alloc) : NULL;
+            if (!out || strcmp(out, expected) != 0) pass = 0;
+            snprintf(result_str, sizeof(result_str), "%s", out ? out : "(null)");
+            json_dealloc(&alloc, out);
+            json_dealloc(&alloc, clone);
+        }
+        json_free(&doc);
+        if (!tc->should_fail && counts.allocs != counts.frees) pass = 0;
+
+        format_input_display(tc->input, rows[i].input_display, 21);
+        format_input_display(tc->should_fail ? "Error" : expected, rows[i].expected, 21);
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"Input", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 20, 20, 10};
+    print_test_table("Compact Clone Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Compact clone tests completed.\n");
+    return summary;
+}
+
+#endif
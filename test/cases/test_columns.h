@@ -0,0 +1,128 @@
+#ifndef TEST_COLUMNS_H
+#define TEST_COLUMNS_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include <stdio.h>
+#include <string.h>
+
+// Each input is pivoted with deserialize_json_columns and one column is
+// rendered row by row, with "null" for rows the validity bitmap leaves unset.
+typedef struct {
+    const char* input;
+    const char* only_key; // restricts the columns through options.keys, NULL for all
+    cereal_size_t column_count;
+    const char* column;
+    json_column_type type;
+    const char* expected_rows;
+    cereal_size_t null_count;
+    cereal_size_t mismatched;
+    int should_fail;
+} columns_test_case_t;
+
+static void render_column(const json_column* column, cereal_size_t rows, char* out, size_t out_size) {
+    size_t used = 0;
+    out[0] = '\0';
+    for (cereal_size_t r = 0; r < rows && used < out_size; r++) {
+        const char* sep = r > 0 ? "|" : "";
+        int n;
+        if (!json_column_valid(column, r)) {
+            n = snprintf(out + used, out_size - used, "%snull", sep);
+        } else if (column->type == JSON_COLUMN_NUMBER) {
+            n = snprintf(out + used, out_size - used, "%s%g", sep, column->numbers[r]);
+        } else if (column->type == JSON_COLUMN_BOOL) {
+            n = snprintf(out + used, out_size - used, "%s%s", sep, json_packed_bit(column->bools, r) ? "true" : "false");
+        } else {
+            size_t len;
+            const char* str = json_column_string(column, r, &len);
+            n = snprintf(out + used, out_size - used, "%s%.*s", sep, (int)len, str);
+        }
+        if (n < 0) break;
+        used += (size_t)n;
+    }
+}
+
+test_summary_t run_columns_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    columns_test_case_t columns_tests[] = {
+        // Positive cases
+        {"[{\"id\":1,\"name\":\"ann\"},{\"id\":2,\"name\":\"bob\"}]", NULL, 2, "id", JSON_COLUMN_NUMBER, "1|2", 0, 0, 0},
+        {"[{\"id\":1,\"name\":\"ann\"},{\"id\":2,\"name\":\"bob\"}]", NULL, 2, "name", JSON_COLUMN_STRING, "ann|bob", 0, 0, 0},
+        {"[{\"name\":\"x\",\"id\":1},{\"id\":2,\"name\":\"yz\"}]", NULL, 2, "name", JSON_COLUMN_STRING, "x|yz", 0, 0, 0},
+        {"[{\"a\":1},{\"b\":true},{\"b\":false}]", NULL, 2, "b", JSON_COLUMN_BOOL, "null|true|false", 1, 0, 0},
+        {"[{\"a\":1},{\"a\":null},{\"a\":3.5}]", NULL, 1, "a", JSON_COLUMN_NUMBER, "1|null|3.5", 1, 0, 0},
+        {"[{\"a\":1},{\"a\":\"s\"}]", NULL, 1, "a", JSON_COLUMN_NUMBER, "1|null", 1, 1, 0},
+        {"[{\"a\":[1]},{\"a\":2}]", NULL, 1, "a", JSON_COLUMN_NUMBER, "null|2", 1, 1, 0},
+        {"[{\"a\":null},{}]", NULL, 1, "a", JSON_COLUMN_NULL, "null|null", 2, 0, 0},
+        {"[{\"a\":{\"b\":1}},{\"a\":[2]}]", NULL, 1, "a", JSON_COLUMN_NULL, "null|null", 2, 2, 0},
+        {"[{\"a\":1},5,{\"a\":3}]", NULL, 1, "a", JSON_COLUMN_NUMBER, "1|null|3", 1, 0, 0},
+        {"[{\"a\":1,\"a\":2}]", NULL, 1, "a", JSON_COLUMN_NUMBER, "1", 0, 0, 0},
+        {"[{\"a\":1,\"b\":\"x\"},{\"b\":\"y\"}]", "b", 1, "b", JSON_COLUMN_STRING, "x|y", 0, 0, 0},
+        {"[{\"a\":1}]", "c", 1, "c", JSON_COLUMN_NULL, "null", 1, 0, 0},
+        {"[]", NULL, 0, NULL, JSON_COLUMN_NULL, "", 0, 0, 0},
+        // Negative cases
+        {"{\"a\":1}", NULL, 0, NULL, JSON_COLUMN_NULL, NULL, 0, 0, 1},
+        {"[{\"a\":1}", NULL, 0, NULL, JSON_COLUMN_NULL, NULL, 0, 0, 1},
+    };
+    size_t total = sizeof(columns_tests)/sizeof(columns_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(columns_tests)/sizeof(columns_tests[0])];
+    printf("Running columnar tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const columns_test_case_t *tc = &columns_tests[i];
+        const char* keys[1] = { tc->only_key };
+        json_columns_options options = { NULL, tc->only_key ? keys : NULL, tc->only_key ? 1 : 0 };
+        json_columns cols = deserialize_json_columns(tc->input, (cereal_size_t)strlen(tc->input), &options);
+        char result_str[128];
+        int pass;
+
+        if (tc->should_fail) {
+            pass = cols.failure == TRUE && cols.columns == NULL;
+            strcpy(result_str, cols.failure ? "Error" : "pivoted");
+        } else if (cols.failure || cols.column_count != tc->column_count) {
+            pass = 0;
+            snprintf(result_str, sizeof(result_str), "%s, %u columns", cols.failure ? "Error" : "ok", cols.column_count);
+        } else if (tc->column == NULL) {
+            pass = cols.row_count == 0;
+            strcpy(result_str, "");
+        } else {
+            const json_column* column = json_columns_find(&cols, tc->column);
+            if (!column) {
+                pass = 0;
+                strcpy(result_str, "missing");
+            } else {
+                render_column(column, cols.row_count, result_str, sizeof(result_str));
+                pass = column->type == tc->type && strcmp(result_str, tc->expected_rows) == 0
+                    && column->null_count == tc->null_count && column->mismatched == tc->mismatched;
+            }
+        }
+        json_columns_free(&cols);
+
+        format_input_display(tc->input, rows[i].input_display, 21);
+        format_input_display(tc->should_fail ? "Error" : tc->expected_rows, rows[i].expected, 21);
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"Input", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 20, 20, 10};
+    print_test_table("Columnar Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Columnar tests completed.\n");
+    return summary;
+}
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef TEST_DOC_CACHE_H
+#define TEST_DOC_CACHE_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../../include/cerialize/doc_cache.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Each case sends a '|' separated list of bodies through one cache and checks
+// the hit, miss and eviction counters afterwards. $0 to $9 stand for numbers
+// that land in the same shard, so evictions do not depend on the hash. Every
+// returned document must serialize back to its body, a hit must return the
+// same reference as the parse it repeats, and everything must be freed once
+// the cache is destroyed. Threaded cases repeat the list from several threads
+// and only check the totals. Negative cases expect a body to fail to parse.
+typedef struct {
+    const char* requests;
+    size_t capacity;
+    int hold; // keep every reference until the end rather than releasing at once
+    int threads; // 0 to run on the calling thread
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    int should_fail;
+} doc_cache_test_case_t;
+
+// ten numbers whose text hashes to the same shard
+static void doc_cache_same_shard(char bodies[10][16]) {
+    size_t found = 0;
+    uint64_t shard = 0;
+    for (int n = 0; found < 10; n++) {
+        char body[16];
+        snprintf(body, sizeof(body), "%d", n);
+        uint64_t s = (json_doc_cache_hash(body, strlen(body)) >> 32) & (JSON_DOC_CACHE_SHARDS - 1);
+        if (found == 0) shard = s;
+        if (s == shard) strcpy(bodies[found++], body);
+    }
+}
+
+typedef struct {
+    json_doc_cache* cache;
+    const char* requests;
+    char (*bodies)[16];
+    int hold;
+    int check_shared; // a repeated body must return the reference it repeats
+    int ok; // 1 when each document came back as expected, -1 on a parse error
+} doc_cache_run_t;
+
+// send every request once
+static void* doc_cache_run(void* arg) {
+    doc_cache_run_t* run = (doc_cache_run_t*)arg;
+    json_cached_doc* held[64];
+    const char* seen_bodies[64];
+    json_cached_doc* seen_refs[64];
+    size_t held_count = 0, seen = 0;
+    const char* op = run->requests;
+    run->ok = 1;
+    while (*op) {
+        const char* end = strchr(op, '|');
+        size_t token_len = end ? (size_t)(end - op) : strlen(op);
+        const char* body = op;
+        size_t len = token_len;
+        if (token_len == 2 && op[0] == '$') {
+            body = run->bodies[op[1] - '0'];
+            len = strlen(body);
+        }
+        json_cached_doc* entry = json_doc_cache_parse(run->cache, body, len);
+        if (!entry) {
+            run->ok = 0;
+        } else if (json_cached_doc_json(entry)->failure) {
+            run->ok = -1;
+        } else {
+            char* out = serialize_json(json_cached_doc_json(entry));
+            if (!out || strlen(out) != len || memcmp(out, body, len) != 0) run->ok = 0;
+            json_dealloc(json_cached_doc_json(entry)->allocator, out);
+            for (size_t k = 0; k < seen; k++) {
+                if (run->check_shared && strlen(seen_bodies[k]) == len && memcmp(seen_bodies[k], body, len) == 0 && seen_refs[k] != entry) run->ok = 0;
+            }
+            if (seen < 64) {
+                seen_bodies[seen] = body;
+                seen_refs[seen++] = entry;
+            }
+        }
+        if (run->hold && held_count < 64) held[held_count++] = entry;
+        else json_doc_cache_release(run->cache, entry);
+        op += token_len + (end ? 1 : 0);
+    }
+    for (size_t k = 0; k < held_count; k++) json_doc_cache_release(run->cache, held[k]);
+    return NULL;
+}
+
+test_summary_t run_doc_cache_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    static char bodies[10][16];
+    doc_cache_same_shard(bodies);
+
+    doc_cache_test_case_t doc_cache_tests[] = {
+        // Positive cases
+        {"{\"a\":1}", 64, 0, 0, 0, 1, 0, 0},
+        {"{\"a\":1}|{\"a\":1}|{\"a\":1}", 64, 0, 0, 2, 1, 0, 0},
+        {"{\"a\":1}|{\"a\":2}|{\"a\":1}|{\"a\":2}", 64, 1, 0, 2, 2, 0, 0},
+        {"[1,2]|[2,1]|[1,2]", 64, 0, 0, 1, 2, 0, 0},
+        {"$0|$1|$0", 16, 0, 0, 0, 3, 2, 0},
+        {"$0|$1|$0", 32, 0, 0, 1, 2, 0, 0},
+        {"$0|$1|$2|$0|$2", 32, 0, 0, 1, 4, 2, 0},
+        {"$0|$1|$0|$1", 16, 1, 0, 0, 4, 3, 0},
+        {"{\"a\":1}|{\"b\":2}|{\"c\":3}|{\"a\":1}|{\"b\":2}|{\"c\":3}", 64, 0, 4, 0, 0, 0, 0},
+        {"{\"k\":[1,2,3]}|$0|$1|$2|{\"k\":[1,2,3]}|$0", 16, 1, 4, 0, 0, 0, 0},
+        // Negative cases
+        {"[1,", 64, 0, 0, 0, 1, 0, 1},
+        {"[1,|[1,", 64, 0, 0, 0, 2, 0, 1},
+    };
+    size_t total = sizeof(doc_cache_tests)/sizeof(doc_cache_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(doc_cache_tests)/sizeof(doc_cache_tests[0])];
+    printf("Running document cache tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const doc_cache_test_case_t *tc = &doc_cache_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        json_parse_options options = { &alloc, FALSE, FALSE, 0, NULL, 0 };
+        json_doc_cache cache;
+        char result_str[64];
+        int pass = json_doc_cache_init(&cache, tc->capacity, &options);
+        json_doc_cache_stats stats = { 0, 0, 0, 0 };
+
+        if (pass) {
+            int threads = tc->threads > 0 ? tc->threads : 1;
+            doc_cache_run_t runs[8];
+            pthread_t ids[8];
+            for (int t = 0; t < threads; t++) {
+                doc_cache_run_t run = { &cache, tc->requests, bodies, tc->hold, tc->hold && tc->threads == 0 && tc->evictions == 0, 0 };
+                runs[t] = run;
+            }
+            if (tc->threads > 0) {
+                for (int t = 0; t < threads; t++) pthread_create(&ids[t], NULL, doc_cache_run, &runs[t]);
+                for (int t = 0; t < threads; t++) pthread_join(ids[t], NULL);
+            } else {
+                doc_cache_run(&runs[0]);
+            }
+            stats = json_doc_cache_get_stats(&cache);
+            size_t requests = 1;
+            for (const char* c = tc->requests; *c; c++) requests += *c == '|';
+            for (int t = 0; t < threads; t++) {
+                if (tc->should_fail ? runs[t].ok != -1 : runs[t].ok != 1) pass = 0;
+            }
+            if (stats.hits + stats.misses != requests * (size_t)threads) pass = 0;
+            if (tc->threads == 0 && (stats.hits != tc->hits || stats.misses != tc->misses || stats.evictions != tc->evictions)) pass = 0;
+            if (tc->should_fail && stats.entries != 0) pass = 0;
+            snprintf(result_str, sizeof(result_str), "h=%zu m=%zu e=%zu", stats.hits, stats.misses, stats.evictions);
+            json_doc_cache_destroy(&cache);
+        } else {
+            strcpy(result_str, "init failed");
+        }
+        if (counts.allocs != counts.frees) pass = 0;
+
+        char expected[64];
+        if (tc->should_fail) snprintf(expected, sizeof(expected), "Error");
+        else if (tc->threads > 0) snprintf(expected, sizeof(expected), "%d threads", tc->threads);
+        else snprintf(expected, sizeof(expected), "h=%zu m=%zu e=%zu", tc->hits, tc->misses, tc->evictions);
+        format_input_display(tc->requests, rows[i].input_display, 21);
+        format_input_display(expected, rows[i].expected, 21);
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"Requests", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 20, 20, 10};
+    print_test_table("Document Cache Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Document cache tests completed.\n");
+    return summary;
+}
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef TEST_ESCAPE_H
+#define TEST_ESCAPE_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    const char* name;
+    const char* input;     // raw string value
+    const char* expected;  // serialized form, including quotes
+} escape_test_case_t;
+
+// parsed, serialized and parsed again: escapes are decoded into the tree, so
+// the output is stable and holds the same text. NULL output expects an error.
+typedef struct {
+    const char* input;
+    int share; // parse with share_shapes
+    const char* expected;
+} escape_round_trip_case_t;
+
+test_summary_t run_escape_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    escape_test_case_t escape_tests[] = {
+        {"Plain", "hello", "\"hello\""},
+        {"Quote", "say \"hi\"", "\"say \\\"hi\\\"\""},
+        {"Backslash", "C:\\temp", "\"C:\\\\temp\""},
+        {"Short escapes", "\b\f\n\r\t", "\"\\b\\f\\n\\r\\t\""},
+        {"Control chars", "\x01\x1f", "\"\\u0001\\u001f\""},
+        {"UTF-8 untouched", "caf\xc3\xa9", "\"caf\xc3\xa9\""},
+        {"Escape after 16B", "0123456789abcdef\"", "\"0123456789abcdef\\\"\""},
+        {"Escape after 32B", "0123456789abcdef0123456789abcdef\n", "\"0123456789abcdef0123456789abcdef\\n\""},
+        {"Escape at 40B", "0123456789abcdef0123456789abcdef0123456\t!", "\"0123456789abcdef0123456789abcdef0123456\\t!\""},
+        {"Long clean run", "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789", "\"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789\""},
+        {"Every byte escaped", "\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"", "\"\\\"\\\"\\\"\\\"\\\"\\\"\\\"\\\"\\\"\\\"\\\"\\\"\\\"\\\"\\\"\\\"\\\"\\\"\""},
+    };
+    escape_round_trip_case_t round_trips[] = {
+        {"\"a\\nb\"", 0, "\"a\\nb\""},
+        {"\"\\u0041\\/\"", 0, "\"A/\""},
+        {"\"C:\\\\x\"", 0, "\"C:\\\\x\""},
+        {"\"caf\\u00e9 \\u20ac\"", 0, "\"caf\xc3\xa9 \xe2\x82\xac\""},
+        {"\"\\ud83d\\ude00\"", 0, "\"\xf0\x9f\x98\x80\""},
+        {"\"say \\\"hi\\\"\"", 0, "\"say \\\"hi\\\"\""},
+        {"{\"a\\\"b\":\"\\t\",\"\\u006bey_long_enough\":1}", 0, "{\"a\\\"b\":\"\\t\",\"key_long_enough\":1}"},
+        {"[{\"k\\u0031\":1},{\"k1\":2},{\"k\\u0031\":3}]", 1, "[{\"k1\":1},{\"k1\":2},{\"k1\":3}]"},
+        {"\"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef\\n\"", 0, "\"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef\\n\""},
+        {"\"\\q\"", 0, NULL},
+        {"\"\\u12g4\"", 0, NULL},
+        {"\"\\ud800\"", 0, NULL},
+        {"\"\\udc00\\ud800\"", 0, NULL},
+        {"\"\\u0000\"", 0, NULL},
+        {"\"ends in \\", 0, NULL},
+    };
+    size_t total = sizeof(escape_tests)/sizeof(escape_tests[0]);
+    size_t trips = sizeof(round_trips)/sizeof(round_trips[0]);
+    int passed = 0, failed = 0;
+    test_row_t rows[sizeof(escape_tests)/sizeof(escape_tests[0]) + sizeof(round_trips)/sizeof(round_trips[0]) + 2];
+    printf("Running escape tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const escape_test_case_t *tc = &escape_tests[i];
+        json j = { .failure = FALSE, .error_text = NULL };
+        json_set_string(&j.root, (char*)tc->input);
+        char* out = serialize_json(&j);
+        int pass = out != NULL && strcmp(out, tc->expected) == 0;
+
+        snprintf(rows[i].input_display, sizeof(rows[i].input_display), "%s", tc->name);
+        snprintf(rows[i].expected, sizeof(rows[i].expected), "%zu B", strlen(tc->expected));
+        snprintf(rows[i].result, sizeof(rows[i].result), "%zu B", out ? strlen(out) : (size_t)0);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (pass) ++passed; else ++failed;
+        free(out);
+    }
+
+    // Keys go through the same escaper
+    {
+        char* key = (char*)malloc(8);
+        strcpy(key, "a\"b");
+        json_node node;
+        json_node_set_key(&node, key);
+        json_set_null(&node.value);
+        json j = { .root = { .type = JSON_OBJECT }, .failure = FALSE, .error_text = NULL };
+        json_set_object(&j.root, &node, 1);
+        char* out = serialize_json(&j);
+        const char* expected = "{\"a\\\"b\":null}";
+        int pass = out != NULL && strcmp(out, expected) == 0;
+        size_t row = total;
+        strcpy(rows[row].input_display, "Escaped key");
+        strcpy(rows[row].expected, expected);
+        snprintf(rows[row].result, sizeof(rows[row].result), "%s", out ? out : "NULL");
+        strcpy(rows[row].status, pass ? "PASS" : "FAIL");
+        rows[row].color = pass ? GREEN : RED;
+        rows[row].reset = RESET;
+        if (pass) ++passed; else ++failed;
+        free(out);
+        free(key);
+    }
+
+    // Vector and scalar scanners must agree on every prefix of pseudo-random text
+    {
+        char text[256];
+        uint32_t state = 12345;
+        int mismatches = 0;
+        for (int round = 0; round < 2000; round++) {
+            size_t len = (size_t)(round % 200) + 1;
+            for (size_t k = 0; k < len; k++) {
+                state = state * 1103515245u + 12345u;
+                unsigned char c = (unsigned char)(state >> 16);
+                // keep escapes rare so long clean runs get exercised
+                text[k] = (char)((c % 64 == 0) ? (c % 3 == 0 ? '"' : (c % 3 == 1 ? '\\' : '\n')) : (c | 0x20));
+                if (text[k] == '"' && c % 64 != 0) text[k] = 'x';
+                if (text[k] == '\\' && c % 64 != 0) text[k] = 'y';
+            }
+            if (json_escape_scan(text, len) != json_escape_scan_scalar(text, len)) mismatches++;
+        }
+        size_t row = total + 1;
+        int pass = mismatches == 0;
+        strcpy(rows[row].input_display, "SIMD vs scalar scan");
+        strcpy(rows[row].expected, "0 mismatches");
+        snprintf(rows[row].result, sizeof(rows[row].result), "%d mismatches", mismatches);
+        strcpy(rows[row].status, pass ? "PASS" : "FAIL");
+        rows[row].color = pass ? GREEN : RED;
+        rows[row].reset = RESET;
+        if (pass) ++passed; else ++failed;
+    }
+
+    int negative_passed = 0, negative_failed = 0;
+    for (size_t i = 0; i < trips; ++i) {
+        const escape_round_trip_case_t *tc = &round_trips[i];
+        json_parse_options options = { NULL, FALSE, tc->share ? TRUE : FALSE, 0, NULL, 0 };
+        json doc = deserialize_json_with_options(tc->input, strlen(tc->input), &options);
+        char* out = doc.failure ? NULL : serialize_json(&doc);
+        int pass;
+        if (!tc->expected) {
+            pass = doc.failure;
+        } else {
+            pass = out != NULL && strcmp(out, tc->expected) == 0;
+            if (pass) {
+                json again = deserialize_json_with_options(out, strlen(out), &options);
+                pass = !again.failure && json_equal(&again.root, &doc.root);
+                json_free(&again);
+            }
+        }
+
+        size_t row = total + 2 + i;
+        format_input_display(tc->input, rows[row].input_display, 21);
+        format_input_display(tc->expected ? tc->expected : "Error", rows[row].expected, 17);
+        format_input_display(out ? out : "Error", rows[row].result, 17);
+        strcpy(rows[row].status, pass ? "PASS" : "FAIL");
+        rows[row].color = pass ? GREEN : RED;
+        rows[row].reset = RESET;
+        if (!tc->expected) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++passed; else ++failed;
+        }
+        free(out);
+        json_free(&doc);
+    }
+
+    const char *headers[] = {"Input", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 16, 16, 10};
+    print_test_table("Escape Tests", headers, 4, col_widths, rows, total + 2 + trips);
+    print_test_summary(passed, failed, negative_passed, negative_failed, total + 2 + trips);
+    test_summary_t summary = {passed + negative_passed, failed + negative_failed, total + 2 + trips};
+    printf("Escape tests completed.\n");
+    return summary;
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef TEST_FORMAT_TEXT_H
+#define TEST_FORMAT_TEXT_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef enum {
+    FORMAT_MINIFY,
+    FORMAT_MINIFY_INPLACE,
+    FORMAT_PRETTIFY,
+} format_text_mode_t;
+
+typedef struct {
+    format_text_mode_t mode;
+    const char* input;
+    const char* expected;
+} format_text_test_case_t;
+
+static char* format_text_run(const format_text_test_case_t* tc) {
+    size_t len = strlen(tc->input);
+    if (tc->mode == FORMAT_PRETTIFY) {
+        json_writer w;
+        json_writer_init(&w, NULL);
+        json_prettify(tc->input, len, 2, &w);
+        return json_writer_finish(&w);
+    }
+    char* out = (char*)malloc(len + 1);
+    if (tc->mode == FORMAT_MINIFY_INPLACE) {
+        memcpy(out, tc->input, len + 1);
+        json_minify_inplace(out, len);
+    } else {
+        // fill with junk so a missing byte shows up in the comparison
+        memset(out, '#', len + 1);
+        out[json_minify(tc->input, len, out)] = '\0';
+    }
+    return out;
+}
+
+test_summary_t run_format_text_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    format_text_test_case_t format_tests[] = {
+        {FORMAT_MINIFY, "{ \"a\" : 1 ,\n\t\"b\" : [ true , null ] }", "{\"a\":1,\"b\":[true,null]}"},
+        {FORMAT_MINIFY, "  \"keep  these   spaces\"  ", "\"keep  these   spaces\""},
+        {FORMAT_MINIFY, "[ \"esc \\\" quote\" , \"back\\\\\" ]", "[\"esc \\\" quote\",\"back\\\\\"]"},
+        {FORMAT_MINIFY, "[ 1.50000 , -0.0 , 1e+10 ]", "[1.50000,-0.0,1e+10]"},
+        {FORMAT_MINIFY, "{\"long\":\"0123456789abcdef0123456789abcdef\",   \"k\":                 2}", "{\"long\":\"0123456789abcdef0123456789abcdef\",\"k\":2}"},
+        {FORMAT_MINIFY, "", ""},
+        {FORMAT_MINIFY_INPLACE, "{ \"x\" : [ 1 , 2 ] }", "{\"x\":[1,2]}"},
+        {FORMAT_MINIFY_INPLACE, "[\"a b\" ,\r\n \"c\"]", "[\"a b\",\"c\"]"},
+        {FORMAT_PRETTIFY, "{\"a\":1,\"b\":[true,null]}", "{\n  \"a\": 1,\n  \"b\": [\n    true,\n    null\n  ]\n}"},
+        {FORMAT_PRETTIFY, "  [ {} , [ ] ]  ", "[\n  {},\n  []\n]"},
+        {FORMAT_PRETTIFY, "{\"s\":\"a, b: {c}\"}", "{\n  \"s\": \"a, b: {c}\"\n}"},
+        {FORMAT_PRETTIFY, "42", "42"},
+    };
+    size_t total = sizeof(format_tests)/sizeof(format_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(format_tests)/sizeof(format_tests[0])];
+    printf("Running text format tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const format_text_test_case_t *tc = &format_tests[i];
+        char* out = format_text_run(tc);
+        int pass = out != NULL && strcmp(out, tc->expected) == 0;
+
+        // pretty output minifies back to the compact form
+        if (pass && tc->mode == FORMAT_PRETTIFY) {
+            char* flat = (char*)malloc(strlen(tc->input) + 1);
+            size_t flat_len = json_minify(tc->input, strlen(tc->input), flat);
+            size_t back_len = json_minify_inplace(out, strlen(out));
+            pass = back_len == flat_len && memcmp(out, flat, flat_len) == 0;
+            free(flat);
+        }
+
+        format_input_display(tc->input, rows[i].input_display, 21);
+        format_input_display(tc->expected, rows[i].expected, 21);
+        strcpy(rows[i].result, out ? "ok" : "Error");
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (pass) ++positive_passed; else ++positive_failed;
+        free(out);
+    }
+
+    const char *headers[] = {"Input", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 20, 10, 10};
+    print_test_table("Text Format Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Text format tests completed.\n");
+    return summary;
+}
+
+#endif
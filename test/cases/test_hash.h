@@ -0,0 +1,142 @@
+#ifndef TEST_HASH_H
+#define TEST_HASH_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Each case parses two documents and compares their roots both ways with
+// json_equal, with json_equal_cached on a fresh cache and again on the warm
+// one, and by json_hash and json_hash_cached. Equal pairs must hash equal,
+// including a packed list against the same list of json_object numbers.
+// Negative cases are pairs that must compare unequal, and for these the
+// hashes are expected to differ too.
+typedef struct {
+    const char* a;
+    const char* b;
+    int pack; // 1 to parse both with pack_arrays, 2 for a only
+    int share; // parse both with share_shapes
+    int should_fail; // the pair is not equal
+} hash_test_case_t;
+
+test_summary_t run_hash_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    // the same wide object with its keys in opposite orders
+    static char forward[2048];
+    static char backward[2048];
+    size_t f_len = 0, b_len = 0;
+    forward[f_len++] = '{';
+    backward[b_len++] = '{';
+    for (int k = 0; k < 100; k++) {
+        f_len += (size_t)snprintf(forward + f_len, sizeof(forward) - f_len, "\"k%d\":[%d]%s", k, k, k < 99 ? "," : "}");
+        b_len += (size_t)snprintf(backward + b_len, sizeof(backward) - b_len, "\"k%d\":[%d]%s", 99 - k, 99 - k, k < 99 ? "," : "}");
+    }
+
+    hash_test_case_t hash_tests[] = {
+        // Positive cases
+        {"null", "null", 0, 0, 0},
+        {"1.5", "1.5", 0, 0, 0},
+        {"0", "-0", 0, 0, 0},
+        {"\"abc\"", "\"abc\"", 0, 0, 0},
+        {"[1,\"a\",null]", "[1,\"a\",null]", 0, 0, 0},
+        {"{\"a\":1,\"b\":2}", "{\"b\":2,\"a\":1}", 0, 0, 0},
+        {"{\"x\":{\"a\":[1,{\"c\":true,\"d\":false}],\"b\":\"s\"}}", "{\"x\":{\"b\":\"s\",\"a\":[1,{\"d\":false,\"c\":true}]}}", 0, 0, 0},
+        {"{\"a\":1,\"b\":2,\"a\":3}", "{\"b\":2,\"a\":1,\"a\":3}", 0, 0, 0},
+        {"[1,2,3]", "[1,2,3]", 1, 0, 0},
+        {"[1.5,2]", "[1.5,2]", 1, 0, 0},
+        {"[true,false]", "[true,false]", 1, 0, 0},
+        {"[{\"id\":1,\"n\":\"a\"},{\"id\":2,\"n\":\"b\"}]", "[{\"id\":1,\"n\":\"a\"},{\"n\":\"b\",\"id\":2}]", 0, 1, 0},
+        {forward, backward, 0, 0, 0},
+        {"[]", "[]", 0, 0, 0},
+        {"{}", "{}", 0, 0, 0},
+        {"[0.1,2.5]", "[0.1,2.5]", 2, 0, 0},
+        {"{\"v\":[-3.7,1e-5,7]}", "{\"v\":[-3.7,1e-5,7]}", 2, 0, 0},
+        // Negative cases
+        {"1", "\"1\"", 0, 0, 1},
+        {"1", "2", 0, 0, 1},
+        {"true", "false", 0, 0, 1},
+        {"null", "false", 0, 0, 1},
+        {"[1,2]", "[2,1]", 0, 0, 1},
+        {"[1,2]", "[1,2,3]", 0, 0, 1},
+        {"[1,2]", "[2,1]", 1, 0, 1},
+        {"[true]", "[1]", 1, 0, 1},
+        {"[0.1,2.5]", "[0.2,2.5]", 2, 0, 1},
+        {"[]", "{}", 0, 0, 1},
+        {"\"ab\"", "\"abc\"", 0, 0, 1},
+        {"{\"a\":1}", "{\"b\":1}", 0, 0, 1},
+        {"{\"a\":1,\"b\":2}", "{\"a\":2,\"b\":1}", 0, 0, 1},
+        {"{\"a\":1,\"a\":2}", "{\"a\":2,\"a\":2}", 0, 0, 1},
+        {"{\"a\":[1]}", "{\"a\":[1,1]}", 0, 0, 1},
+        {"[{\"id\":1,\"n\":\"a\"},{\"id\":2,\"n\":\"b\"}]", "[{\"id\":1,\"n\":\"a\"},{\"id\":2,\"n\":\"c\"}]", 0, 1, 1},
+    };
+    size_t total = sizeof(hash_tests)/sizeof(hash_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(hash_tests)/sizeof(hash_tests[0])];
+    printf("Running hash and equality tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const hash_test_case_t *tc = &hash_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        json_parse_options options = { &alloc, tc->pack ? TRUE : FALSE, tc->share ? TRUE : FALSE, 0, NULL, 0 };
+        json a = deserialize_json_with_options(tc->a, strlen(tc->a), &options);
+        if (tc->pack == 2) options.pack_arrays = FALSE;
+        json b = deserialize_json_with_options(tc->b, strlen(tc->b), &options);
+        int expect_equal = !tc->should_fail;
+        char result_str[64];
+        int pass = !a.failure && !b.failure;
+
+        if (pass) {
+            bool_t equal = json_equal(&a.root, &b.root);
+            bool_t reverse = json_equal(&b.root, &a.root);
+            json_hash_cache cache;
+            json_hash_cache_init(&cache, &alloc);
+            bool_t cold = json_equal_cached(&a.root, &b.root, &cache);
+            bool_t warm = json_equal_cached(&b.root, &a.root, &cache);
+            uint64_t a_hash = json_hash(&a.root);
+            uint64_t b_hash = json_hash(&b.root);
+            if (json_hash_cached(&a.root, &cache) != a_hash || json_hash_cached(&b.root, &cache) != b_hash) pass = 0;
+            // a warm cache answers for the roots without walking them again
+            if (json_hash_count(&a.root) > 0 && json_hash_count(&a.root) == json_hash_count(&b.root) && cache.hits == 0) pass = 0;
+            json_hash_cache_free(&cache);
+
+            if (!equal != !expect_equal || !reverse != !expect_equal) pass = 0;
+            if (!cold != !expect_equal || !warm != !expect_equal) pass = 0;
+            if ((a_hash == b_hash) != expect_equal) pass = 0;
+            snprintf(result_str, sizeof(result_str), "%s", equal ? "equal" : "different");
+        } else {
+            strcpy(result_str, "parse error");
+        }
+        json_free(&a);
+        json_free(&b);
+        if (counts.allocs != counts.frees) pass = 0;
+
+        format_input_display(tc->a, rows[i].input_display, 21);
+        format_input_display(tc->b, rows[i].expected, 21);
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"A", "B", "Result", "Status"};
+    int col_widths[] = {20, 20, 20, 10};
+    print_test_table("Hash and Equality Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Hash and equality tests completed.\n");
+    return summary;
+}
+
+#endif
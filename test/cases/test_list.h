@@ -59,13 +59,13 @@ test_summary_t run_list_tests() {
             } else {
                 // Check type and use correct count field
                 if (result.root.type == JSON_LIST) {
-                    snprintf(result_str, sizeof(result_str), "%u", result.root.value.list.count);
-                    if ((int)result.root.value.list.count != tc->expected_count) {
+                    snprintf(result_str, sizeof(result_str), "%u", json_list_count(&result.root));
+                    if ((int)json_list_count(&result.root) != tc->expected_count) {
                         pass = 0;
                     }
                 } else if (result.root.type == JSON_OBJECT) {
-                    snprintf(result_str, sizeof(result_str), "%u", result.root.value.object.node_count);
-                    if ((int)result.root.value.object.node_count != tc->expected_count) {
+                    snprintf(result_str, sizeof(result_str), "%u", json_node_count(&result.root));
+                    if ((int)json_node_count(&result.root) != tc->expected_count) {
                         pass = 0;
                     }
                 } else {
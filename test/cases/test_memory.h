@@ -162,9 +162,9 @@ test_summary_t run_memory_edge_case_tests() {
     manual_json.error_text = (char*)malloc(100);
     strcpy(manual_json.error_text, "test error");
     manual_json.failure = TRUE;
-    manual_json.root.type = JSON_STRING;
-    manual_json.root.value.string = (char*)malloc(10);
-    strcpy(manual_json.root.value.string, "test");
+    char* manual_string = (char*)malloc(10);
+    strcpy(manual_string, "test");
+    json_set_string(&manual_json.root, manual_string);
     
     json_free(&manual_json);
     
@@ -0,0 +1,160 @@
+#ifndef TEST_MSGPACK_H
+#define TEST_MSGPACK_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../../include/cerialize/msgpack.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Positive cases parse input, encode it with json_to_msgpack, compare the
+// bytes against hex when given, then decode them and expect the serialized
+// tree back. Negative cases decode hex directly and expect an error.
+typedef struct {
+    const char* input; // NULL for decode only cases
+    int pack; // parse with pack_arrays
+    const char* hex; // expected encoding, or the bytes to decode
+    const char* expected_output; // NULL to expect the input back
+    int should_fail;
+} msgpack_test_case_t;
+
+static size_t msgpack_from_hex(const char* hex, unsigned char* out, size_t capacity) {
+    size_t n = 0;
+    for (size_t i = 0; hex[i] && hex[i + 1] && n < capacity; i += 2) {
+        unsigned int byte;
+        if (sscanf(hex + i, "%2x", &byte) != 1) break;
+        out[n++] = (unsigned char)byte;
+    }
+    return n;
+}
+
+static void msgpack_to_hex(const unsigned char* bytes, size_t len, char* out, size_t capacity) {
+    size_t used = 0;
+    out[0] = '\0';
+    for (size_t i = 0; i < len && used + 3 <= capacity; i++) {
+        used += (size_t)snprintf(out + used, capacity - used, "%02x", bytes[i]);
+    }
+}
+
+test_summary_t run_msgpack_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    // nesting past JSON_MSGPACK_MAX_DEPTH
+    static char deep[2 * (JSON_MSGPACK_MAX_DEPTH + 10) + 3];
+    size_t len = 0;
+    for (int k = 0; k < JSON_MSGPACK_MAX_DEPTH + 10; k++) {
+        deep[len++] = '9';
+        deep[len++] = '1';
+    }
+    strcpy(deep + len, "c0");
+
+    msgpack_test_case_t msgpack_tests[] = {
+        // Positive cases
+        {"null", 0, "c0", NULL, 0},
+        {"true", 0, "c3", NULL, 0},
+        {"false", 0, "c2", NULL, 0},
+        {"127", 0, "7f", NULL, 0},
+        {"128", 0, "cc80", NULL, 0},
+        {"-1", 0, "ff", NULL, 0},
+        {"-33", 0, "d0df", NULL, 0},
+        {"65536", 0, "ce00010000", NULL, 0},
+        {"1.5", 0, "ca3fc00000", NULL, 0},
+        {"\"hi\"", 0, "a26869", NULL, 0},
+        {"[1,\"a\"]", 0, "9201a161", NULL, 0},
+        {"{\"a\":1}", 0, "81a16101", NULL, 0},
+        {"[]", 0, "90", NULL, 0},
+        {"[1,2]", 1, "920102", NULL, 0},
+        {"[1.5,2]", 1, "92cb3ff8000000000000cb4000000000000000", NULL, 0},
+        {"[true,false]", 1, "92c3c2", NULL, 0},
+        {"\"a string that is longer than thirty one bytes\"", 0, NULL, NULL, 0},
+        {"[0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16]", 0, NULL, NULL, 0},
+        {"{\"a\":[{\"b\":null}],\"c\":\"long string over the inline size\"}", 0, NULL, NULL, 0},
+        {NULL, 0, "cb3ff8000000000000", "1.5", 0},
+        {NULL, 0, "d3fffffffffffffffe", "-2", 0},
+        {NULL, 0, "da000161", "\"a\"", 0},
+        // Negative cases
+        {NULL, 0, "c1", NULL, 1},
+        {NULL, 0, "9201", NULL, 1},
+        {NULL, 0, "c0c0", NULL, 1},
+        {NULL, 0, "810101", NULL, 1},
+        {NULL, 0, "c40100", NULL, 1},
+        {NULL, 0, "dcffff", NULL, 1},
+        {NULL, 0, "a4616263", NULL, 1},
+        {NULL, 0, deep, NULL, 1},
+        {NULL, 0, "", NULL, 1},
+    };
+    size_t total = sizeof(msgpack_tests)/sizeof(msgpack_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(msgpack_tests)/sizeof(msgpack_tests[0])];
+    printf("Running msgpack tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const msgpack_test_case_t *tc = &msgpack_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        static unsigned char bytes[4096];
+        size_t size = 0;
+        unsigned char* encoded = NULL;
+        char result_str[64] = "";
+        int pass = 1;
+
+        if (tc->input) {
+            json_parse_options options = { &alloc, tc->pack ? TRUE : FALSE, FALSE, 0, NULL, 0 };
+            json doc = deserialize_json_with_options(tc->input, strlen(tc->input), &options);
+            encoded = doc.failure ? NULL : json_to_msgpack_with_allocator(&doc, &size, &alloc);
+            if (!encoded) pass = 0;
+            json_free(&doc);
+            if (encoded && tc->hex) {
+                char hex[128];
+                msgpack_to_hex(encoded, size, hex, sizeof(hex));
+                if (strcmp(hex, tc->hex) != 0) pass = 0;
+            }
+        } else {
+            size = msgpack_from_hex(tc->hex, bytes, sizeof(bytes));
+        }
+
+        json decoded = json_from_msgpack_with_allocator(encoded ? encoded : bytes, size, &alloc);
+        if (tc->should_fail) {
+            pass = decoded.failure && decoded.error_length > 0;
+            strcpy(result_str, decoded.failure ? "Error" : "decoded");
+        } else if (decoded.failure) {
+            pass = 0;
+            strcpy(result_str, "Error");
+        } else {
+            char* out = serialize_json(&decoded);
+            const char* expected = tc->expected_output ? tc->expected_output : tc->input;
+            if (!out || strcmp(out, expected) != 0) pass = 0;
+            snprintf(result_str, sizeof(result_str), "%s", out ? out : "(null)");
+            json_dealloc(&alloc, out);
+        }
+        json_free(&decoded);
+        json_dealloc(&alloc, encoded);
+        if (counts.allocs != counts.frees) pass = 0;
+
+        format_input_display(tc->input ? tc->input : tc->hex, rows[i].input_display, 21);
+        format_input_display(tc->should_fail ? "Error" : tc->hex ? tc->hex : "round trip", rows[i].expected, 21);
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"Input", "Encoding", "Decoded", "Status"};
+    int col_widths[] = {20, 20, 20, 10};
+    print_test_table("MessagePack Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("MessagePack tests completed.\n");
+    return summary;
+}
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef TEST_MUTATE_H
+#define TEST_MUTATE_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Each input is parsed, then a script of ';' separated edits is applied to the
+// root and the result serialized. Edits:
+//   +V     json_list_append         iN:V   json_list_insert at N
+//   -N     json_list_remove at N    rN     json_list_reserve N
+//   sK=V   json_object_set          xK     json_object_remove
+// V is JSON text parsed on its own. Negative cases expect an edit to fail.
+typedef struct {
+    const char* input;
+    int pack; // parse with pack_arrays
+    int share; // parse with share_shapes
+    const char* script;
+    const char* expected_output;
+    int max_grows; // reallocs of existing blocks allowed, -1 for any
+    int should_fail;
+} mutate_test_case_t;
+
+static int mutate_parse_value(const char* text, size_t len, json_object* out, const json_allocator* alloc) {
+    json doc = deserialize_json_with_allocator(text, (cereal_size_t)len, alloc);
+    int ok = !doc.failure;
+    if (ok) {
+        *out = doc.root;
+        json_set_null(&doc.root);
+    }
+    json_free(&doc);
+    return ok;
+}
+
+// 1 when every edit succeeded
+static int mutate_apply(json_object* root, const char* script, const json_allocator* alloc) {
+    const char* op = script;
+    while (*op) {
+        const char* end = strchr(op, ';');
+        size_t len = end ? (size_t)(end - op) : strlen(op);
+        char arg[64];
+        json_object value;
+        int ok;
+        if (len == 0 || len >= sizeof(arg)) return 0;
+        memcpy(arg, op + 1, len - 1);
+        arg[len - 1] = '\0';
+        switch (op[0]) {
+            case '+':
+                if (!mutate_parse_value(arg, len - 1, &value, alloc)) return 0;
+                ok = json_list_append(root, value, alloc);
+                if (!ok) json_object_free_with_allocator(&value, alloc);
+                break;
+            case 'i': {
+                char* colon = strchr(arg, ':');
+                if (!colon || !mutate_parse_value(colon + 1, strlen(colon + 1), &value, alloc)) return 0;
+                ok = json_list_insert(root, (cereal_size_t)atoi(arg), value, alloc);
+                if (!ok) json_object_free_with_allocator(&value, alloc);
+                break;
+            }
+            case '-':
+                ok = json_list_remove(root, (cereal_size_t)atoi(arg), alloc);
+                break;
+            case 'r':
+                ok = json_list_reserve(root, (cereal_size_t)atoi(arg), alloc);
+                break;
+            case 's': {
+                char* eq = strchr(arg, '=');
+                if (!eq) return 0;
+                *eq = '\0';
+                if (!mutate_parse_value(eq + 1, strlen(eq + 1), &value, alloc)) return 0;
+                ok = json_object_set(root, arg, value, alloc);
+                if (!ok) json_object_free_with_allocator(&value, alloc);
+                break;
+            }
+            case 'x':
+                ok = json_object_remove(root, arg, alloc);
+                break;
+            default:
+                return 0;
+        }
+        if (!ok) return 0;
+        op += len + (end ? 1 : 0);
+    }
+    return 1;
+}
+
+test_summary_t run_mutate_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    // a thousand appends to an empty list, then the list they build
+    static char appends[4096];
+    static char appended[4096];
+    size_t script_len = 0, out_len = 0;
+    appended[out_len++] = '[';
+    for (int k = 0; k < 1000; k++) {
+        script_len += (size_t)snprintf(appends + script_len, sizeof(appends) - script_len, "%s+%d", k > 0 ? ";" : "", k % 10);
+        out_len += (size_t)snprintf(appended + out_len, sizeof(appended) - out_len, "%s%d", k > 0 ? "," : "", k % 10);
+    }
+    appended[out_len++] = ']';
+    appended[out_len] = '\0';
+
+    mutate_test_case_t mutate_tests[] = {
+        // Positive cases
+        {"[]", 0, 0, "+1;+2;+3", "[1,2,3]", -1, 0},
+        {"[1,2]", 0, 0, "i0:0;i3:3;i2:\"x\"", "[0,1,\"x\",2,3]", -1, 0},
+        {"[1,2,3]", 0, 0, "-1", "[1,3]", -1, 0},
+        {"[1,2,3]", 0, 0, "-2;-0;-0;+4", "[4]", -1, 0},
+        {"[\"a string too long to be inline\",[1,[2]],{\"k\":\"v\"}]", 0, 0, "-1;-0;-0", "[]", -1, 0},
+        {"[]", 0, 0, appends, appended, 9, 0},
+        {"[]", 0, 0, "r1000;+true;+null", "[true,null]", 0, 0},
+        {"[1,2,3]", 1, 0, "+\"s\"", "[1,2,3,\"s\"]", -1, 0},
+        {"[true,false,true]", 1, 0, "-0", "[false,true]", -1, 0},
+        {"{}", 0, 0, "sa=1;sb=2", "{\"a\":1,\"b\":2}", -1, 0},
+        {"{\"a\":1}", 0, 0, "sa=[2,{\"c\":null}]", "{\"a\":[2,{\"c\":null}]}", -1, 0},
+        {"{\"a\":1,\"b\":2,\"c\":3}", 0, 0, "xb;sd=4", "{\"a\":1,\"c\":3,\"d\":4}", -1, 0},
+        {"{\"a\":1,\"b\":2}", 0, 1, "sa=5", "{\"a\":5,\"b\":2}", -1, 0},
+        {"{\"a\":1,\"b\":2}", 0, 1, "sc=3;xa", "{\"b\":2,\"c\":3}", -1, 0},
+        {"{}", 0, 0, "sa_key_longer_than_inline=1;xa_key_longer_than_inline", "{}", -1, 0},
+        // Negative cases
+        {"[1]", 0, 0, "-5", NULL, -1, 1},
+        {"[1]", 0, 0, "i3:2", NULL, -1, 1},
+        {"{\"a\":1}", 0, 0, "xz", NULL, -1, 1},
+        {"[1]", 0, 0, "sa=1", NULL, -1, 1},
+        {"{}", 0, 0, "+1", NULL, -1, 1},
+    };
+    size_t total = sizeof(mutate_tests)/sizeof(mutate_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(mutate_tests)/sizeof(mutate_tests[0])];
+    printf("Running mutation tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const mutate_test_case_t *tc = &mutate_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        json_parse_options options = { &alloc, tc->pack ? TRUE : FALSE, tc->share ? TRUE : FALSE, 0, NULL, 0 };
+        json doc = deserialize_json_with_options(tc->input, strlen(tc->input), &options);
+        char result_str[64];
+        int pass;
+
+        if (doc.failure) {
+            pass = 0;
+            strcpy(result_str, "parse error");
+        } else {
+            size_t grows_before = counts.grows;
+            int applied = mutate_apply(&doc.root, tc->script, &alloc);
+            size_t grows = counts.grows - grows_before;
+            if (tc->should_fail) {
+                pass = !applied;
+                strcpy(result_str, applied ? "applied" : "Error");
+            } else {
+                char* out = serialize_json(&doc);
+                pass = applied && out && strcmp(out, tc->expected_output) == 0
+                    && json_serialized_size(&doc) == strlen(out);
+                if (tc->max_grows >= 0 && grows > (size_t)tc->max_grows) pass = 0;
+                snprintf(result_str, sizeof(result_str), "%s", !applied ? "Error" : out ? out : "(null)");
+                json_dealloc(&alloc, out);
+            }
+        }
+        json_free(&doc);
+        // replaced and removed values go back through the same hooks
+        if (counts.allocs != counts.frees) pass = 0;
+
+        format_input_display(tc->script, rows[i].input_display, 21);
+        format_input_display(tc->should_fail ? "Error" : tc->expected_output, rows[i].expected, 21);
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"Script", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 20, 20, 10};
+    print_test_table("Mutation Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Mutation tests completed.\n");
+    return summary;
+}
+
+#endif
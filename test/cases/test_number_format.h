@@ -0,0 +1,120 @@
+#ifndef TEST_NUMBER_FORMAT_H
+#define TEST_NUMBER_FORMAT_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    double value;
+    int is_float;          // 1 to format through json_format_float
+    const char* expected;  // shortest round-trip text
+} number_format_test_case_t;
+
+// Format a value with the matching formatter into a null terminated buffer
+static void format_test_number(const number_format_test_case_t* tc, char* out) {
+    int len = tc->is_float ? json_format_float((float)tc->value, out) : json_format_double(tc->value, out);
+    out[len] = '\0';
+}
+
+test_summary_t run_number_format_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    number_format_test_case_t number_format_tests[] = {
+        // Integer fast path
+        {42, 1, "42"},
+        {-7, 1, "-7"},
+        {0, 1, "0"},
+        {16777215, 1, "16777215"},
+        {9007199254740991.0, 0, "9007199254740991"},
+        // Shortest digits
+        {3.14, 1, "3.14"},
+        {0.1, 1, "0.1"},
+        {0.1, 0, "0.1"},
+        {0.3, 0, "0.3"},
+        {-2.25, 0, "-2.25"},
+        {123456.789, 0, "123456.789"},
+        {0.001, 1, "0.001"},
+        // Exponent notation
+        {1e-7, 1, "1e-7"},
+        {1e10, 1, "1e10"},
+        {1e21, 0, "1e21"},
+        {1.5e-10, 0, "1.5e-10"},
+        {5e-324, 0, "5e-324"},
+        {1.7976931348623157e308, 0, "1.7976931348623157e308"},
+        {3.4028234663852886e38, 1, "3.4028235e38"},
+    };
+    size_t total = sizeof(number_format_tests)/sizeof(number_format_tests[0]);
+    int passed = 0, failed = 0;
+    test_row_t rows[sizeof(number_format_tests)/sizeof(number_format_tests[0]) + 2];
+    printf("Running number format tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const number_format_test_case_t *tc = &number_format_tests[i];
+        char out[JSON_NUMBER_BUFFER_SIZE + 1];
+        format_test_number(tc, out);
+        int pass = strcmp(out, tc->expected) == 0;
+
+        snprintf(rows[i].input_display, sizeof(rows[i].input_display), "%s %.9g", tc->is_float ? "float" : "double", tc->value);
+        snprintf(rows[i].expected, sizeof(rows[i].expected), "%s", tc->expected);
+        snprintf(rows[i].result, sizeof(rows[i].result), "%.31s", out);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (pass) ++passed; else ++failed;
+    }
+
+    // Round-trip sweep over pseudo-random bit patterns
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    int float_misses = 0, double_misses = 0;
+    for (int i = 0; i < 100000; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        char out[JSON_NUMBER_BUFFER_SIZE + 1];
+
+        uint32_t fbits = (uint32_t)state;
+        float f;
+        memcpy(&f, &fbits, sizeof(f));
+        if (f == f && f - f == 0) {
+            out[json_format_float(f, out)] = '\0';
+            float back = strtof(out, NULL);
+            if (memcmp(&back, &f, sizeof(f)) != 0) float_misses++;
+        }
+
+        double d;
+        memcpy(&d, &state, sizeof(d));
+        if (d == d && d - d == 0) {
+            out[json_format_double(d, out)] = '\0';
+            double back = strtod(out, NULL);
+            if (memcmp(&back, &d, sizeof(d)) != 0) double_misses++;
+        }
+    }
+    int misses[2] = { float_misses, double_misses };
+    const char* sweep_names[2] = { "100k random floats", "100k random doubles" };
+    for (int k = 0; k < 2; k++) {
+        size_t row = total + (size_t)k;
+        int pass = misses[k] == 0;
+        snprintf(rows[row].input_display, sizeof(rows[row].input_display), "%s", sweep_names[k]);
+        strcpy(rows[row].expected, "0 mismatches");
+        snprintf(rows[row].result, sizeof(rows[row].result), "%d mismatches", misses[k]);
+        strcpy(rows[row].status, pass ? "PASS" : "FAIL");
+        rows[row].color = pass ? GREEN : RED;
+        rows[row].reset = RESET;
+        if (pass) ++passed; else ++failed;
+    }
+
+    const char *headers[] = {"Input", "Expected", "Result", "Status"};
+    int col_widths[] = {36, 24, 24, 10};
+    print_test_table("Number Format Tests", headers, 4, col_widths, rows, total + 2);
+    print_test_summary(passed, failed, 0, 0, total + 2);
+    test_summary_t summary = {passed, failed, total + 2};
+    printf("Number format tests completed.\n");
+    return summary;
+}
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef TEST_PACKED_H
+#define TEST_PACKED_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Each input is parsed with pack_arrays set. Lists of only integers, only
+// numbers or only bools come back packed, anything else takes the generic path.
+typedef struct {
+    const char* input;
+    json_packing packing; // expected packing of the root list
+    cereal_size_t count;
+    const char* expected_output; // NULL to expect the input back
+    int should_fail;
+} packed_test_case_t;
+
+static const char* packed_name(json_packing packing) {
+    switch (packing) {
+        case JSON_PACKED_DOUBLE: return "double";
+        case JSON_PACKED_INT64: return "int64";
+        case JSON_PACKED_BOOL: return "bool";
+        default: return "none";
+    }
+}
+
+// elements read back through json_list_get must match the packed view
+static int packed_elements_match(const json_object* list) {
+    json_packed_view view = json_list_packed(list);
+    for (cereal_size_t i = 0; i < view.count; i++) {
+        json_object item = json_list_get(list, i);
+        switch (view.packing) {
+            case JSON_PACKED_DOUBLE:
+                if (json_typeof(&item) != JSON_NUMBER || json_number_value(&item) != (float)json_list_doubles(list)[i]) return 0;
+                break;
+            case JSON_PACKED_INT64:
+                if (json_typeof(&item) != JSON_NUMBER || json_number_value(&item) != (float)json_list_int64s(list)[i]) return 0;
+                break;
+            case JSON_PACKED_BOOL:
+                if (json_typeof(&item) != JSON_BOOL || json_bool_value(&item) != json_packed_bit(view.data, i)) return 0;
+                break;
+            default:
+                return 0;
+        }
+    }
+    return view.size == json_packed_size(view.packing, view.count);
+}
+
+test_summary_t run_packed_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    packed_test_case_t packed_tests[] = {
+        // Positive cases
+        {"[1,2,3]", JSON_PACKED_INT64, 3, NULL, 0},
+        {"[-7,0,123456789012345678]", JSON_PACKED_INT64, 3, NULL, 0},
+        {"[1.5,2.25,-3]", JSON_PACKED_DOUBLE, 3, NULL, 0},
+        {"[1,2,3.5]", JSON_PACKED_DOUBLE, 3, NULL, 0},
+        {"[0.1,1e21]", JSON_PACKED_DOUBLE, 2, NULL, 0},
+        {"[ 4 , 5 ]", JSON_PACKED_INT64, 2, "[4,5]", 0},
+        {"[1,2,]", JSON_PACKED_INT64, 2, "[1,2]", 0},
+        {"[true,false,true,true,false,false,false,false,true]", JSON_PACKED_BOOL, 9, NULL, 0},
+        {"[1,\"two\",3]", JSON_PACKED_NONE, 3, NULL, 0},
+        {"[true,1]", JSON_PACKED_NONE, 2, NULL, 0},
+        {"[[1,2],[3.5]]", JSON_PACKED_NONE, 2, NULL, 0},
+        {"[]", JSON_PACKED_NONE, 0, NULL, 0},
+        {"[null]", JSON_PACKED_NONE, 1, NULL, 0},
+        // Negative cases
+        {"[1,2", JSON_PACKED_NONE, 0, NULL, 1},
+        {"[1,-]", JSON_PACKED_NONE, 0, NULL, 1},
+        {"[true,tru]", JSON_PACKED_NONE, 0, NULL, 1},
+    };
+    size_t total = sizeof(packed_tests)/sizeof(packed_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(packed_tests)/sizeof(packed_tests[0])];
+    printf("Running packed array tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const packed_test_case_t *tc = &packed_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        json_parse_options options = { &alloc, TRUE, FALSE, 0, NULL, 0 };
+        json result = deserialize_json_with_options(tc->input, strlen(tc->input), &options);
+        int pass;
+        char result_str[64];
+
+        if (tc->should_fail) {
+            pass = result.failure == TRUE;
+            snprintf(result_str, sizeof(result_str), "%s", result.failure ? "Error" : "parsed");
+        } else if (result.failure || json_typeof(&result.root) != JSON_LIST) {
+            pass = 0;
+            snprintf(result_str, sizeof(result_str), "Error");
+        } else {
+            json_packing packing = json_list_packing(&result.root);
+            pass = packing == tc->packing && json_list_count(&result.root) == tc->count;
+            if (pass && packing != JSON_PACKED_NONE) {
+                pass = packed_elements_match(&result.root) && json_list_items(&result.root) == NULL;
+            }
+
+            // output and its predicted size agree with the generic path
+            char* out = serialize_json(&result);
+            const char* expected = tc->expected_output ? tc->expected_output : tc->input;
+            if (!out || strcmp(out, expected) != 0 || json_serialized_size(&result) != strlen(out)) pass = 0;
+            snprintf(result_str, sizeof(result_str), "%s %s", packed_name(packing), out ? out : "(null)");
+            json_dealloc(&alloc, out);
+        }
+        json_free(&result);
+        // packed buffers go back through the same hooks
+        if (!tc->should_fail && counts.allocs != counts.frees) pass = 0;
+
+        format_input_display(tc->input, rows[i].input_display, 21);
+        if (tc->should_fail) {
+            strcpy(rows[i].expected, "Error");
+        } else {
+            snprintf(rows[i].expected, sizeof(rows[i].expected), "%s", packed_name(tc->packing));
+        }
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"Input", "Packing", "Result", "Status"};
+    int col_widths[] = {20, 10, 20, 10};
+    print_test_table("Packed Array Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Packed array tests completed.\n");
+    return summary;
+}
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef TEST_PATCH_H
+#define TEST_PATCH_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Three kinds of case, all on documents parsed with a counting allocator:
+//   diff   json_diff(input, other) must serialize to expected, and applying
+//          it to input must give other. With shared, input is made
+//          shareable and other is "P:V", a json_share_set of V at P.
+//   patch  json_patch_apply(input, other) must leave expected.
+//   merge  json_merge_patch(input, other) must leave expected.
+// With shared, patch and merge cases run on input after json_compact, which
+// must be refused. Every allocation must be freed at the end. Negative patch
+// and merge cases expect the change to fail and the document to serialize
+// exactly as before.
+typedef enum { PATCH_DIFF, PATCH_APPLY, PATCH_MERGE } patch_test_kind;
+
+typedef struct {
+    patch_test_kind kind;
+    const char* input;
+    const char* other; // second document, patch or merge patch
+    int pack; // parse with pack_arrays
+    int shared; // diff: other is a shared version, patch and merge: input is compacted
+    const char* expected_output;
+    int should_fail;
+} patch_test_case_t;
+
+// "P:V" applied to the shared root of doc, the new version in *out
+static int patch_share_update(json_object* out, json* doc, const char* update, const json_allocator* alloc) {
+    char pointer[64];
+    const char* colon = strchr(update, ':');
+    if (!colon || (size_t)(colon - update) >= sizeof(pointer) || !json_share(doc)) return 0;
+    memcpy(pointer, update, (size_t)(colon - update));
+    pointer[colon - update] = '\0';
+    json value = deserialize_json_with_allocator(colon + 1, (cereal_size_t)strlen(colon + 1), alloc);
+    if (value.failure) {
+        json_free(&value);
+        return 0;
+    }
+    json_object root = value.root;
+    json_set_null(&value.root);
+    json_free(&value);
+    if (json_share_set(out, &doc->root, pointer, &root, alloc)) return 1;
+    json_object_free_with_allocator(&root, alloc);
+    return 0;
+}
+
+test_summary_t run_patch_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    patch_test_case_t patch_tests[] = {
+        // Positive cases
+        {PATCH_DIFF, "{\"a\":1,\"b\":[1,2]}", "{\"a\":1,\"b\":[1,2]}", 0, 0, "[]", 0},
+        {PATCH_DIFF, "{\"a\":1,\"b\":2}", "{\"a\":3,\"c\":4}", 0, 0, "[{\"op\":\"replace\",\"path\":\"/a\",\"value\":3},{\"op\":\"remove\",\"path\":\"/b\"},{\"op\":\"add\",\"path\":\"/c\",\"value\":4}]", 0},
+        {PATCH_DIFF, "{\"a\":{\"x\":[1,2,3]},\"b\":true}", "{\"b\":true,\"a\":{\"x\":[1,2,3,4]}}", 0, 0, "[{\"op\":\"add\",\"path\":\"/a/x/3\",\"value\":4}]", 0},
+        {PATCH_DIFF, "[1,2,3,4,5]", "[1,9,2,3,4,5]", 0, 0, "[{\"op\":\"add\",\"path\":\"/1\",\"value\":9}]", 0},
+        {PATCH_DIFF, "[1,2,3,4,5]", "[1,4,5]", 0, 0, "[{\"op\":\"remove\",\"path\":\"/2\"},{\"op\":\"remove\",\"path\":\"/1\"}]", 0},
+        {PATCH_DIFF, "[1.5,2,3]", "[1.5,7,3]", 1, 0, "[{\"op\":\"replace\",\"path\":\"/1\",\"value\":7}]", 0},
+        {PATCH_DIFF, "[{\"id\":1},{\"id\":2}]", "{\"id\":1}", 0, 0, "[{\"op\":\"replace\",\"path\":\"\",\"value\":{\"id\":1}}]", 0},
+        {PATCH_DIFF, "{\"a/b\":1,\"m~n\":[]}", "{\"a/b\":2,\"m~n\":[null]}", 0, 0, "[{\"op\":\"replace\",\"path\":\"/a~1b\",\"value\":2},{\"op\":\"add\",\"path\":\"/m~0n/0\",\"value\":null}]", 0},
+        {PATCH_DIFF, "{\"cfg\":{\"n\":1},\"big\":[[1,2],[3,4]]}", "/cfg/n:2", 0, 1, "[{\"op\":\"replace\",\"path\":\"/cfg/n\",\"value\":2}]", 0},
+        {PATCH_APPLY, "{\"a\":1}", "[{\"op\":\"add\",\"path\":\"/b\",\"value\":[1,{\"c\":\"a string long enough for the heap\"}]}]", 0, 0, "{\"a\":1,\"b\":[1,{\"c\":\"a string long enough for the heap\"}]}", 0},
+        {PATCH_APPLY, "[1,2,3]", "[{\"op\":\"add\",\"path\":\"/1\",\"value\":\"x\"},{\"op\":\"add\",\"path\":\"/-\",\"value\":4},{\"op\":\"remove\",\"path\":\"/0\"}]", 1, 0, "[\"x\",2,3,4]", 0},
+        {PATCH_APPLY, "{\"a\":{\"b\":1},\"c\":[]}", "[{\"op\":\"move\",\"from\":\"/a/b\",\"path\":\"/c/0\"},{\"op\":\"copy\",\"from\":\"/c\",\"path\":\"/d\"}]", 0, 0, "{\"a\":{},\"c\":[1],\"d\":[1]}", 0},
+        {PATCH_APPLY, "{\"a\":[1,2],\"v\":1}", "[{\"op\":\"test\",\"path\":\"/a\",\"value\":[1,2]},{\"op\":\"replace\",\"path\":\"/v\",\"value\":2}]", 0, 0, "{\"a\":[1,2],\"v\":2}", 0},
+        {PATCH_APPLY, "{\"l\":[1,2,3]}", "[{\"op\":\"replace\",\"path\":\"/l/2\",\"value\":[true]}]", 1, 0, "{\"l\":[1,2,[true]]}", 0},
+        {PATCH_APPLY, "{\"a\":1}", "[{\"op\":\"add\",\"path\":\"/x~1y\",\"value\":2},{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a\"}]", 0, 0, "{\"a\":1,\"x/y\":2}", 0},
+        {PATCH_MERGE, "{\"a\":\"b\",\"c\":{\"d\":\"e\",\"f\":\"g\"}}", "{\"a\":\"z\",\"c\":{\"f\":null}}", 0, 0, "{\"a\":\"z\",\"c\":{\"d\":\"e\"}}", 0},
+        {PATCH_MERGE, "{\"a\":[1,2]}", "{\"a\":[3],\"b\":{\"c\":{\"d\":null,\"e\":1}}}", 0, 0, "{\"a\":[3],\"b\":{\"c\":{\"e\":1}}}", 0},
+        {PATCH_MERGE, "[1,2]", "{\"a\":1}", 0, 0, "{\"a\":1}", 0},
+        {PATCH_MERGE, "{\"a\":1}", "null", 0, 0, "null", 0},
+        // Negative cases
+        {PATCH_APPLY, "{\"a\":1}", "[{\"op\":\"remove\",\"path\":\"/b\"}]", 0, 0, NULL, 1},
+        {PATCH_APPLY, "{\"a\":1,\"b\":[1,2]}", "[{\"op\":\"add\",\"path\":\"/c\",\"value\":3},{\"op\":\"remove\",\"path\":\"/b/0\"},{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/b/-\"},{\"op\":\"test\",\"path\":\"/c\",\"value\":4}]", 0, 0, NULL, 1},
+        {PATCH_APPLY, "[1,2]", "[{\"op\":\"replace\",\"path\":\"/0\",\"value\":5},{\"op\":\"add\",\"path\":\"/5\",\"value\":1}]", 1, 0, NULL, 1},
+        {PATCH_APPLY, "{\"a\":{\"b\":1}}", "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a/b/c\"}]", 0, 0, NULL, 1},
+        {PATCH_APPLY, "{\"a\":1}", "[{\"op\":\"copy\",\"from\":\"/a\",\"path\":\"b\"}]", 0, 0, NULL, 1},
+        {PATCH_APPLY, "{\"a\":1}", "[{\"op\":\"jump\",\"path\":\"/a\"}]", 0, 0, NULL, 1},
+        {PATCH_APPLY, "{\"a\":[1,2],\"b\":\"a string long enough for the heap\"}", "[{\"op\":\"replace\",\"path\":\"/b\",\"value\":1}]", 0, 1, NULL, 1},
+        {PATCH_MERGE, "{\"a\":[1,2],\"b\":1}", "{\"a\":null}", 0, 1, NULL, 1},
+        {PATCH_MERGE, "{\"a\":[1,2]}", "[3]", 0, 1, NULL, 1},
+    };
+    size_t total = sizeof(patch_tests)/sizeof(patch_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(patch_tests)/sizeof(patch_tests[0])];
+    printf("Running patch tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const patch_test_case_t *tc = &patch_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        json_parse_options options = { &alloc, tc->pack ? TRUE : FALSE, FALSE, 0, NULL, 0 };
+        json doc = deserialize_json_with_options(tc->input, strlen(tc->input), &options);
+        char result_str[256] = "";
+        int pass = !doc.failure;
+
+        if (pass && tc->kind == PATCH_DIFF) {
+            json other = { .root = { 0 }, .failure = FALSE, .allocator = &alloc };
+            json_set_null(&other.root);
+            if (tc->shared) pass = patch_share_update(&other.root, &doc, tc->other, &alloc);
+            else other = deserialize_json_with_options(tc->other, strlen(tc->other), &options);
+            pass = pass && !other.failure;
+            json patch = json_diff_with_allocator(&doc.root, &other.root, NULL, &alloc);
+            char* out = patch.failure ? NULL : serialize_json_with_allocator(&patch, &alloc);
+            snprintf(result_str, sizeof(result_str), "%s", out ? out : "Error");
+            if (!out || strcmp(out, tc->expected_output) != 0) pass = 0;
+            json_dealloc(&alloc, out);
+            // the patch turns a fresh copy of input into other
+            json target = deserialize_json_with_options(tc->input, strlen(tc->input), &options);
+            if (!json_patch_apply(&target, &patch.root) || !json_equal(&target.root, &other.root)) pass = 0;
+            json_free(&target);
+            json_free(&patch);
+            json_free(&other);
+        } else if (pass) {
+            json change = deserialize_json_with_allocator(tc->other, (cereal_size_t)strlen(tc->other), &alloc);
+            if (tc->shared && !json_compact(&doc)) pass = 0;
+            char* before = serialize_json_with_allocator(&doc, &alloc);
+            int applied = !change.failure && (tc->kind == PATCH_APPLY ? json_patch_apply(&doc, &change.root) : json_merge_patch(&doc, &change.root));
+            char* out = serialize_json_with_allocator(&doc, &alloc);
+            if (tc->should_fail) {
+                // a failed patch leaves no trace
+                pass = !applied && out && before && strcmp(out, before) == 0;
+                strcpy(result_str, applied ? "applied" : "Error");
+            } else {
+                snprintf(result_str, sizeof(result_str), "%s", out ? out : "(null)");
+                pass = applied && out && strcmp(out, tc->expected_output) == 0;
+            }
+            json_dealloc(&alloc, before);
+            json_dealloc(&alloc, out);
+            json_free(&change);
+        }
+        json_free(&doc);
+        if (counts.allocs != counts.frees) pass = 0;
+
+        format_input_display(tc->other, rows[i].input_display, 21);
+        format_input_display(tc->should_fail ? "Error" : tc->expected_output, rows[i].expected, 21);
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"Change", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 20, 20, 10};
+    print_test_table("Patch Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Patch tests completed.\n");
+    return summary;
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef TEST_PROJECTED_H
+#define TEST_PROJECTED_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Each input is parsed with deserialize_json_projected_with_options on the
+// ';' separated paths and must serialize to the expected text. The projection
+// may not allocate more than parsing that text directly, so skipped values
+// cost nothing, and every allocation must be freed. Cases with stop_early end
+// in text that only parses because it is never read, and a repeated key must
+// not count as a second path found. Negative cases expect the parse to fail,
+// mostly on text that is only ever skipped.
+typedef struct {
+    const char* input;
+    const char* paths; // ';' separated JSON Pointers, NULL for none
+    int pack; // parse with pack_arrays
+    int share; // parse with share_shapes
+    int stop_early;
+    const char* expected_output;
+    int should_fail;
+} projected_test_case_t;
+
+test_summary_t run_projected_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    projected_test_case_t projected_tests[] = {
+        // Positive cases
+        {"{\"id\":7,\"name\":\"x\",\"tags\":[\"a\",\"b\"],\"meta\":{\"k\":1,\"j\":2}}", "/id;/meta/k", 0, 0, 0, "{\"id\":7,\"meta\":{\"k\":1}}", 0},
+        {"{\"a\":{\"b\":[1,2,{\"c\":null}]},\"z\":false}", "/a", 0, 0, 0, "{\"a\":{\"b\":[1,2,{\"c\":null}]}}", 0},
+        {"{\"items\":[{\"a\":1},{\"a\":2,\"b\":3},{\"a\":4}]}", "/items/1/a", 0, 0, 0, "{\"items\":[null,{\"a\":2}]}", 0},
+        {"[10,[20,21],30,40]", "/1/1;/2", 0, 0, 0, "[null,[null,21],30]", 0},
+        {" [1, {\"x\":2}] ", "", 0, 0, 0, "[1,{\"x\":2}]", 0},
+        {"{\"a\":1}", "/b", 0, 0, 0, "{}", 0},
+        {"{\"a\":1}", NULL, 0, 0, 0, "{}", 0},
+        {"{\"a\":1,\"b\":\"two\"}", "/a/x;/b", 0, 0, 0, "{\"b\":\"two\"}", 0},
+        {"{\"a/b\":1,\"m~n\":2,\"c\":3}", "/a~1b;/m~0n", 0, 0, 0, "{\"a/b\":1,\"m~n\":2}", 0},
+        {"{\"a\\/b\":1,\"\\u006d~n\":2,\"c\":3}", "/a~1b;/m~0n", 0, 0, 0, "{\"a/b\":1,\"m~n\":2}", 0},
+        {"[{\"id\":1,\"x\":\"a\"},{\"id\":2,\"x\":\"b\"}]", "/0/id;/1/id", 0, 1, 0, "[{\"id\":1},{\"id\":2}]", 0},
+        {"{\"skip\":[1,2,3],\"v\":[4,5,6]}", "/v", 1, 0, 0, "{\"v\":[4,5,6]}", 0},
+        {"{\"a\":1,\"b\":{\"c\":2,\"d\":3},\"rest\":[1,2", "/a;/b/c", 0, 0, 1, "{\"a\":1,\"b\":{\"c\":2}}", 0},
+        {"{\"a\":{\"b\":1,\"c\":2},\"d\":[tru", "/a;/a/b", 0, 1, 1, "{\"a\":{\"b\":1,\"c\":2}}", 0},
+        {"[0,1,2,3", "/1", 0, 0, 1, "[null,1]", 0},
+        {"{\"a\":1,\"a\":2,\"b\":3,\"c\":[", "/a;/b", 0, 0, 1, "{\"a\":1,\"a\":2,\"b\":3}", 0},
+        {"{\"a\":1,\"a\":2,\"b\":3}", "/a;/b", 0, 1, 1, "{\"a\":1,\"a\":2,\"b\":3}", 0},
+        {"{\"a\":1,\"b\":[", "/a;/a", 0, 0, 1, "{\"a\":1}", 0},
+        // Negative cases
+        {"{\"rest\":[1,2", "/a", 0, 0, 0, NULL, 1},
+        {"{\"skip\":1,\"rest\":[1,2", "/none", 0, 0, 1, NULL, 1},
+        {"{\"bad\":[tru],\"a\":1}", "/a", 0, 0, 0, NULL, 1},
+        {"{\"bad\":{\"x\":\"\"},\"a\":1}", "/a", 0, 0, 0, NULL, 1},
+        {"{\"bad\" 1,\"a\":1}", "/a", 0, 0, 0, NULL, 1},
+        {"{\"a\":{\"b\" 1}}", "/a", 0, 0, 0, NULL, 1},
+    };
+    size_t total = sizeof(projected_tests)/sizeof(projected_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(projected_tests)/sizeof(projected_tests[0])];
+    printf("Running projected parse tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const projected_test_case_t *tc = &projected_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        // split the paths in place
+        char path_text[128] = "";
+        const char* paths[8];
+        cereal_size_t path_count = 0;
+        if (tc->paths) {
+            snprintf(path_text, sizeof(path_text), "%s", tc->paths);
+            char* p = path_text;
+            for (;;) {
+                paths[path_count++] = p;
+                char* end = strchr(p, ';');
+                if (!end) break;
+                *end = '\0';
+                p = end + 1;
+            }
+        }
+        json_parse_options options = { &alloc, tc->pack ? TRUE : FALSE, tc->share ? TRUE : FALSE, 0, NULL, 0 };
+        json doc = deserialize_json_projected_with_options(tc->input, strlen(tc->input), paths, path_count, &options, tc->stop_early ? TRUE : FALSE);
+        size_t parse_allocs = counts.allocs;
+        char result_str[256] = "";
+        int pass;
+
+        if (tc->should_fail) {
+            pass = doc.failure;
+            strcpy(result_str, doc.failure ? "Error" : "parsed");
+        } else if (doc.failure) {
+            pass = 0;
+            strcpy(result_str, "Error");
+        } else {
+            char* out = serialize_json(&doc);
+            snprintf(result_str, sizeof(result_str), "%s", out ? out : "(null)");
+            pass = out && strcmp(out, tc->expected_output) == 0;
+            json_dealloc(&alloc, out);
+            // no more allocations than for the projected text itself
+            counting_allocator_ctx_t direct_counts = { 0 };
+            json_allocator direct_alloc = { counting_alloc, counting_realloc, counting_free, &direct_counts };
+            json_parse_options direct_options = options;
+            direct_options.allocator = &direct_alloc;
+            json direct = deserialize_json_with_options(tc->expected_output, strlen(tc->expected_output), &direct_options);
+            if (direct.failure || !json_equal(&direct.root, &doc.root) || parse_allocs > direct_counts.allocs) pass = 0;
+            json_free(&direct);
+        }
+        json_free(&doc);
+        if (counts.allocs != counts.frees) pass = 0;
+
+        format_input_display(tc->input, rows[i].input_display, 21);
+        format_input_display(tc->should_fail ? "Error" : tc->expected_output, rows[i].expected, 21);
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"Input", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 20, 20, 10};
+    print_test_table("Projected Parse Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Projected parse tests completed.\n");
+    return summary;
+}
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef TEST_PUBLISH_H
+#define TEST_PUBLISH_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../../include/cerialize/publish.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Reader threads loop over json_reader_enter and json_reader_exit while the
+// calling thread publishes {"version":v,"items":[v,...]} for v = 1..publishes.
+// Freed blocks are overwritten, so a reader still inside a reclaimed document
+// sees items that disagree with its version. Every reader must see intact
+// documents with versions that never go back, the last version must be
+// current at the end, and every allocation must be freed once the publisher
+// is destroyed. With hold, one reader stays inside the first document while
+// the rest are published, which must keep every replaced document pending
+// until it leaves. Negative cases expect a registration or a publish to be
+// refused.
+typedef struct {
+    const char* name;
+    int readers;
+    int publishes;
+    int hold;
+    int reclaimer; // free old documents on a json_reclaimer thread
+    int overfill; // register one reader more than there are slots
+    int bad_doc; // publish a document that failed to parse
+    int should_fail;
+} publish_test_case_t;
+
+static json publish_make_version(int version, const json_allocator* alloc) {
+    char text[512];
+    size_t len = (size_t)snprintf(text, sizeof(text), "{\"version\":%d,\"items\":[", version);
+    for (int i = 0; i < 32; i++) len += (size_t)snprintf(text + len, sizeof(text) - len, "%s%d", i ? "," : "", version);
+    snprintf(text + len, sizeof(text) - len, "]}");
+    return deserialize_json_with_allocator(text, (cereal_size_t)strlen(text), alloc);
+}
+
+// the version of doc, or -1 when its items disagree with it
+static int publish_check(const json* doc) {
+    json_object version = json_get_property(doc->root, "version");
+    json_object items = json_get_property(doc->root, "items");
+    if (json_typeof(&version) != JSON_NUMBER || json_typeof(&items) != JSON_LIST || json_list_count(&items) != 32) return -1;
+    float v = json_number_value(&version);
+    for (cereal_size_t i = 0; i < 32; i++) {
+        json_object item = json_list_get(&items, i);
+        if (json_typeof(&item) != JSON_NUMBER || json_number_value(&item) != v) return -1;
+    }
+    return (int)v;
+}
+
+typedef struct {
+    json_publisher* publisher;
+    int stop;
+    int hold; // stay inside the first document until stop
+    int holding;
+    size_t reads;
+    int ok;
+} publish_reader_t;
+
+static void* publish_reader(void* arg) {
+    publish_reader_t* run = (publish_reader_t*)arg;
+    json_publish_reader reader;
+    if (!json_publisher_register(run->publisher, &reader)) {
+        run->ok = 0;
+        return NULL;
+    }
+    int last = 0;
+    if (run->hold) {
+        const json* doc = json_reader_enter(&reader);
+        last = doc ? publish_check(doc) : -1;
+        __atomic_store_n(&run->holding, 1, __ATOMIC_RELEASE);
+        while (!__atomic_load_n(&run->stop, __ATOMIC_ACQUIRE)) sched_yield();
+        // still intact after every later publish
+        if (last != 1 || publish_check(doc) != 1) run->ok = 0;
+        json_reader_exit(&reader);
+    }
+    while (!__atomic_load_n(&run->stop, __ATOMIC_ACQUIRE)) {
+        const json* doc = json_reader_enter(&reader);
+        int version = doc ? publish_check(doc) : -1;
+        json_reader_exit(&reader);
+        if (version < last) run->ok = 0;
+        last = version;
+        run->reads++;
+    }
+    json_publisher_unregister(&reader);
+    return NULL;
+}
+
+test_summary_t run_publish_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    publish_test_case_t publish_tests[] = {
+        // Positive cases
+        {"no readers", 0, 20, 0, 0, 0, 0, 0},
+        {"one reader", 1, 200, 0, 0, 0, 0, 0},
+        {"8 readers", 8, 2000, 0, 0, 0, 0, 0},
+        {"8 readers, reclaimer", 8, 2000, 0, 1, 0, 0, 0},
+        {"held reader", 4, 200, 1, 0, 0, 0, 0},
+        {"held reader, reclaimer", 4, 200, 1, 1, 0, 0, 0},
+        // Negative cases
+        {"slots exhausted", 0, 1, 0, 0, 1, 0, 1},
+        {"unparsed document", 2, 10, 0, 0, 0, 1, 1},
+    };
+    size_t total = sizeof(publish_tests)/sizeof(publish_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(publish_tests)/sizeof(publish_tests[0])];
+    printf("Running publish tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const publish_test_case_t *tc = &publish_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        counts.poison = TRUE;
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        json_publisher publisher;
+        json_reclaimer reclaimer;
+        char result_str[64] = "";
+        json first = publish_make_version(1, &alloc);
+        size_t parsed_allocs = counts.allocs;
+        int pass = json_publisher_init(&publisher, &first);
+        // the entry comes from the document's allocator
+        if (counts.allocs != parsed_allocs + 1) pass = 0;
+        if (tc->reclaimer) pass = pass && json_reclaimer_start(&reclaimer, 16, &alloc);
+        if (tc->reclaimer) publisher.reclaimer = &reclaimer;
+
+        publish_reader_t runs[8];
+        pthread_t ids[8];
+        memset(runs, 0, sizeof(runs));
+        for (int t = 0; t < tc->readers && pass; t++) {
+            runs[t].publisher = &publisher;
+            runs[t].hold = tc->hold && t == 0;
+            runs[t].ok = 1;
+            pthread_create(&ids[t], NULL, publish_reader, &runs[t]);
+        }
+        if (tc->hold && pass) {
+            while (!__atomic_load_n(&runs[0].holding, __ATOMIC_ACQUIRE)) sched_yield();
+        }
+
+        int refused = 0;
+        if (tc->overfill && pass) {
+            json_publish_reader extra[JSON_PUBLISH_READERS + 1];
+            int claimed = 0;
+            while (claimed <= JSON_PUBLISH_READERS && json_publisher_register(&publisher, &extra[claimed])) claimed++;
+            refused = claimed == JSON_PUBLISH_READERS;
+            for (int k = 0; k < claimed; k++) json_publisher_unregister(&extra[k]);
+        }
+        for (int v = 2; v <= tc->publishes && pass; v++) {
+            json next = publish_make_version(v, &alloc);
+            if (tc->bad_doc && v == tc->publishes) {
+                json bad = deserialize_json_with_allocator("{\"version\":", 11, &alloc);
+                if (!json_publish(&publisher, &bad)) refused = 1;
+                json_free(&bad);
+            }
+            if (!json_publish(&publisher, &next)) pass = 0;
+            if (v % 8 == 0) sched_yield();
+        }
+        if (tc->hold && pass) {
+            // the held reader's epoch keeps everything retired since
+            if (json_publisher_reclaim(&publisher) != (size_t)(tc->publishes - 1)) pass = 0;
+        }
+
+        for (int t = 0; t < tc->readers; t++) __atomic_store_n(&runs[t].stop, 1, __ATOMIC_RELEASE);
+        size_t reads = 0;
+        for (int t = 0; t < tc->readers; t++) {
+            pthread_join(ids[t], NULL);
+            if (!runs[t].ok) pass = 0;
+            reads += runs[t].reads;
+        }
+        if (pass) {
+            json_publisher_flush(&publisher);
+            if (publisher.pending != 0 || publisher.freed + 1 != publisher.published) pass = 0;
+            json_publish_reader check;
+            json_publisher_register(&publisher, &check);
+            const json* doc = json_reader_enter(&check);
+            if (!doc || publish_check(doc) != (tc->publishes > 1 ? tc->publishes : 1)) pass = 0;
+            json_reader_exit(&check);
+            json_publisher_unregister(&check);
+        }
+        if (tc->should_fail) pass = pass && refused;
+        snprintf(result_str, sizeof(result_str), "%s%zu reads", tc->should_fail ? (refused ? "refused, " : "accepted, ") : "", reads);
+        json_publisher_destroy(&publisher);
+        if (tc->reclaimer) json_reclaimer_stop(&reclaimer);
+        if (counts.allocs != counts.frees) pass = 0;
+
+        format_input_display(tc->name, rows[i].input_display, 21);
+        format_input_display(tc->should_fail ? "Error" : "intact versions", rows[i].expected, 21);
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"Case", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 20, 20, 10};
+    print_test_table("Publish Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Publish tests completed.\n");
+    return summary;
+}
+
+#endif
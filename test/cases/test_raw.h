@@ -0,0 +1,143 @@
+#ifndef TEST_RAW_H
+#define TEST_RAW_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Each input is parsed with raw_depth and the ';' separated raw_paths, and
+// must serialize to the expected text with the expected number of JSON_RAW
+// values in the tree. json_serialized_size must agree with the output, and a
+// json_object_copy and a json_clone_compact of the tree must serialize the same
+// and compare equal. Every allocation must be freed. Negative cases expect
+// the parse to fail, most of them on text that is only ever skipped.
+typedef struct {
+    const char* input;
+    cereal_size_t raw_depth;
+    const char* raw_paths; // ';' separated JSON Pointers, NULL for none
+    int pack; // parse with pack_arrays
+    int share; // parse with share_shapes
+    const char* expected_output;
+    size_t raw_count;
+    int should_fail;
+} raw_test_case_t;
+
+static size_t raw_count_values(const json_object* obj) {
+    if (json_typeof(obj) == JSON_RAW) return 1;
+    size_t total = 0;
+    for (cereal_size_t k = 0; k < json_child_count(obj); k++) total += raw_count_values(json_child_at(obj, k));
+    return total;
+}
+
+test_summary_t run_raw_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    raw_test_case_t raw_tests[] = {
+        // Positive cases
+        {"{\"id\":1,\"body\":{\"a\":[1,2]}}", 1, NULL, 0, 0, "{\"id\":1,\"body\":{\"a\":[1,2]}}", 1, 0},
+        {"{\"id\":1,\"body\":{ \"a\" : [1, 2] }}", 1, NULL, 0, 0, "{\"id\":1,\"body\":{ \"a\" : [1, 2] }}", 1, 0},
+        {"{\"v\":{\"x\":0.1000000000000000055511151231257827,\"y\":12345678901234567890}}", 1, NULL, 0, 0, "{\"v\":{\"x\":0.1000000000000000055511151231257827,\"y\":12345678901234567890}}", 1, 0},
+        {"[{\"a\":{\"b\":1}},{\"c\":[]}]", 2, NULL, 0, 0, "[{\"a\":{\"b\":1}},{\"c\":[]}]", 2, 0},
+        {"{\"a\":[[1],[2,[3]]],\"b\":{}}", 3, NULL, 0, 0, "{\"a\":[[1],[2,[3]]],\"b\":{}}", 1, 0},
+        {"{\"env\":{\"to\":\"x\"},\"data\":[1,2,3]}", 0, "/data", 0, 0, "{\"env\":{\"to\":\"x\"},\"data\":[1,2,3]}", 1, 0},
+        {"{\"env\":{\"to\":\"x\",\"n\":1.5},\"data\":[1,{\"k\":2}]}", 0, "/env/n;/data/1;/none", 0, 0, "{\"env\":{\"to\":\"x\",\"n\":1.5},\"data\":[1,{\"k\":2}]}", 2, 0},
+        {"{\"a/b\":{\"m~n\":[true,false,null]}}", 0, "/a~1b/m~0n", 0, 0, "{\"a/b\":{\"m~n\":[true,false,null]}}", 1, 0},
+        {"[1,2,3,4]", 0, "/2", 1, 0, "[1,2,3,4]", 1, 0},
+        {"[{\"id\":1,\"p\":{\"q\":1}},{\"id\":2,\"p\":{\"q\":2}}]", 0, "/1/p", 0, 1, "[{\"id\":1,\"p\":{\"q\":1}},{\"id\":2,\"p\":{\"q\":2}}]", 1, 0},
+        {" {\"a\":1} ", 0, "", 0, 0, "{\"a\":1}", 1, 0},
+        {"{\"a\":\"text\",\"b\":2}", 1, NULL, 0, 0, "{\"a\":\"text\",\"b\":2}", 0, 0},
+        // Negative cases
+        {"{\"body\":{\"a\":[1,2}},\"id\":1}", 1, NULL, 0, 0, NULL, 0, 1},
+        {"{\"body\":{\"a\" 1}}", 1, NULL, 0, 0, NULL, 0, 1},
+        {"{\"body\":[tru]}", 1, NULL, 0, 0, NULL, 0, 1},
+        {"{\"body\":{\"a\":\"\"}}", 1, NULL, 0, 0, NULL, 0, 1},
+        {"{\"body\":[1,2", 0, "/body", 0, 0, NULL, 0, 1},
+        {"{\"body\":[1 2]}", 0, "/body", 0, 0, NULL, 0, 1},
+    };
+    size_t total = sizeof(raw_tests)/sizeof(raw_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(raw_tests)/sizeof(raw_tests[0])];
+    printf("Running raw value tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const raw_test_case_t *tc = &raw_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        // split the paths in place
+        char path_text[128] = "";
+        const char* paths[8];
+        cereal_size_t path_count = 0;
+        if (tc->raw_paths) {
+            snprintf(path_text, sizeof(path_text), "%s", tc->raw_paths);
+            char* p = path_text;
+            for (;;) {
+                paths[path_count++] = p;
+                char* end = strchr(p, ';');
+                if (!end) break;
+                *end = '\0';
+                p = end + 1;
+            }
+        }
+        json_parse_options options = { &alloc, tc->pack ? TRUE : FALSE, tc->share ? TRUE : FALSE, tc->raw_depth, paths, path_count };
+        json doc = deserialize_json_with_options(tc->input, strlen(tc->input), &options);
+        char result_str[256] = "";
+        int pass;
+
+        if (tc->should_fail) {
+            pass = doc.failure;
+            strcpy(result_str, doc.failure ? "Error" : "parsed");
+        } else if (doc.failure) {
+            pass = 0;
+            strcpy(result_str, "Error");
+        } else {
+            char* out = serialize_json(&doc);
+            size_t raw_count = raw_count_values(&doc.root);
+            snprintf(result_str, sizeof(result_str), "%s", out ? out : "(null)");
+            pass = out && strcmp(out, tc->expected_output) == 0 && raw_count == tc->raw_count;
+            if (out && json_serialized_size(&doc) != strlen(out)) pass = 0;
+            // copies keep the raw text
+            json copy = { .root = { 0 }, .failure = FALSE, .allocator = &alloc };
+            if (!json_object_copy(&copy.root, &doc.root, &alloc)) pass = 0;
+            char* again = serialize_json(&copy);
+            if (!again || !out || strcmp(again, out) != 0 || !json_equal(&copy.root, &doc.root)) pass = 0;
+            json_dealloc(&alloc, again);
+            json_free(&copy);
+            json_object* compact = json_clone_compact(&doc.root);
+            json tmp = { .root = compact ? *compact : doc.root, .failure = FALSE, .allocator = NULL };
+            again = compact ? serialize_json(&tmp) : NULL;
+            if (!again || !out || strcmp(again, out) != 0) pass = 0;
+            free(again);
+            free(compact);
+            json_dealloc(&alloc, out);
+        }
+        json_free(&doc);
+        if (counts.allocs != counts.frees) pass = 0;
+
+        format_input_display(tc->input, rows[i].input_display, 21);
+        format_input_display(tc->should_fail ? "Error" : tc->expected_output, rows[i].expected, 21);
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"Input", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 20, 20, 10};
+    print_test_table("Raw Value Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Raw value tests completed.\n");
+    return summary;
+}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef TEST_RECLAIM_H
+#define TEST_RECLAIM_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../../include/cerialize/reclaim.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Deep documents freed without recursion, and documents handed to a reclaimer
+// thread. Every case checks that each allocation was freed exactly once.
+typedef struct {
+    const char* name;
+    cereal_size_t depth; // nesting of a built document freed inline, 0 for none
+    int objects; // nest objects rather than lists
+    size_t documents; // parsed documents passed to json_free_deferred_to
+    size_t capacity; // reclaimer queue, 0 leaves the reclaimer stopped
+    int stop_without_flush;
+    int use_default; // json_free_deferred on the default reclaimer
+} reclaim_test_case_t;
+
+// a chain of depth single element containers ending in a string
+static int reclaim_build_deep(json_object* root, cereal_size_t depth, int objects, const json_allocator* alloc) {
+    json_object* current = root;
+    for (cereal_size_t d = 0; d < depth; d++) {
+        if (objects) {
+            json_node* node = (json_node*)json_alloc(alloc, sizeof(json_node));
+            if (!node || !json_node_set_key_copy(node, "k", 1, alloc)) return 0;
+            json_set_object(current, node, 1);
+            current = &node->value;
+        } else {
+            json_object* items = (json_object*)json_alloc(alloc, sizeof(json_object));
+            if (!items) return 0;
+            json_set_list(current, items, 1);
+            current = items;
+        }
+        json_set_null(current);
+    }
+    return json_set_string_copy(current, "leaf value that is long enough for the heap", 43, alloc);
+}
+
+test_summary_t run_reclaim_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    reclaim_test_case_t reclaim_tests[] = {
+        {"deep list", 200000, 0, 0, 0, 0, 0},
+        {"deep object", 200000, 1, 0, 0, 0, 0},
+        {"shallow list", 3, 0, 0, 0, 0, 0},
+        {"deferred, roomy queue", 0, 0, 50, 64, 0, 0},
+        {"deferred, queue of 1", 0, 0, 50, 1, 0, 0},
+        {"stop drains queue", 0, 0, 20, 32, 1, 0},
+        {"stopped frees inline", 0, 0, 5, 0, 0, 0},
+        {"default reclaimer", 0, 0, 10, 0, 0, 1},
+    };
+    const char* document = "{\"users\":[{\"name\":\"a long enough user name\",\"tags\":[1,2,3]},{\"name\":\"another long user name\"}]}";
+    size_t total = sizeof(reclaim_tests)/sizeof(reclaim_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(reclaim_tests)/sizeof(reclaim_tests[0])];
+    printf("Running reclaim tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const reclaim_test_case_t *tc = &reclaim_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        int pass = 1;
+        char result_str[64];
+
+        if (tc->depth > 0) {
+            json_object root;
+            json_set_null(&root);
+            pass = reclaim_build_deep(&root, tc->depth, tc->objects, &alloc);
+            json_object_free_with_allocator(&root, &alloc);
+            if (json_typeof(&root) != JSON_NULL) pass = 0;
+        } else if (tc->use_default) {
+            for (size_t d = 0; d < tc->documents; d++) {
+                json doc = deserialize_json_with_allocator(document, strlen(document), &alloc);
+                if (doc.failure) pass = 0;
+                json_free_deferred(&doc);
+            }
+            json_reclaimer_flush(json_default_reclaimer());
+            if (!json_default_reclaimer()->running) pass = 0;
+        } else {
+            json_reclaimer reclaimer;
+            int started = tc->capacity > 0 && json_reclaimer_start(&reclaimer, tc->capacity, &alloc);
+            if (tc->capacity > 0 && !started) pass = 0;
+            // the queue comes from the allocator
+            if (started && counts.allocs != 1) pass = 0;
+            for (size_t d = 0; d < tc->documents; d++) {
+                json doc = deserialize_json_with_allocator(document, strlen(document), &alloc);
+                if (doc.failure) pass = 0;
+                json_free_deferred_to(started ? &reclaimer : NULL, &doc);
+                // the caller's handle is reset right away
+                if (json_typeof(&doc.root) != JSON_NULL || doc.error_text != NULL) pass = 0;
+            }
+            if (started) {
+                if (!tc->stop_without_flush) {
+                    json_reclaimer_flush(&reclaimer);
+                    if (reclaimer.freed != tc->documents) pass = 0;
+                }
+                json_reclaimer_stop(&reclaimer);
+                if (reclaimer.freed != tc->documents) pass = 0;
+            }
+        }
+        if (counts.allocs == 0 || counts.allocs != counts.frees) pass = 0;
+
+        snprintf(result_str, sizeof(result_str), "%zu/%zu", counts.allocs, counts.frees);
+        format_input_display(tc->name, rows[i].input_display, 21);
+        strcpy(rows[i].expected, "balanced");
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (pass) ++positive_passed; else ++positive_failed;
+    }
+
+    const char *headers[] = {"Case", "Expected", "Allocs/Frees", "Status"};
+    int col_widths[] = {20, 10, 20, 10};
+    print_test_table("Reclaim Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Reclaim tests completed.\n");
+    return summary;
+}
+
+#endif
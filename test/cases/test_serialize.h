@@ -21,8 +21,7 @@ test_summary_t run_serialize_tests();
 // Helper to build a json object for a string
 static json make_json_string(const char* s) {
     json_object obj;
-    obj.type = JSON_STRING;
-    obj.value.string = (char*)s;
+    json_set_string(&obj, (char*)s);
     json j = { .root = obj, .failure = 0, .error_text = NULL };
     return j;
 }
@@ -56,13 +55,10 @@ static json make_json_null() {
 
 // Helper to build a json object for a list
 static json make_json_list(json* items, size_t count) {
-    json_list l;
-    l.count = count;
-    l.items = (json_object*)malloc(sizeof(json_object) * count);
-    for (size_t i = 0; i < count; ++i) l.items[i] = items[i].root;
+    json_object* list_items = (json_object*)malloc(sizeof(json_object) * count);
+    for (size_t i = 0; i < count; ++i) list_items[i] = items[i].root;
     json_object obj;
-    obj.type = JSON_LIST;
-    obj.value.list = l;
+    json_set_list(&obj, list_items, count);
     json j = { .root = obj, .failure = 0, .error_text = NULL };
     return j;
 }
@@ -75,21 +71,16 @@ static json make_json_object(const char** keys, json* values, size_t count) {
         for (size_t i = 0; i < count; ++i) {
             // Deep copy key
             size_t klen = strlen(keys[i]);
-            nodes[i].key = (char*)malloc(klen + 1);
-            strcpy(nodes[i].key, keys[i]);
+            char* key = (char*)malloc(klen + 1);
+            strcpy(key, keys[i]);
+            json_node_set_key(&nodes[i], key);
             // Deep copy value
-            nodes[i].value.type = values[i].root.type;
-            nodes[i].value.value = values[i].root.value;
+            nodes[i].value = values[i].root;
         }
     }
-    json_body body = {
-        .nodes = nodes,
-        .node_count = count
-    };
 
     json_object obj;
-    obj.type = JSON_OBJECT;
-    obj.value.object = body;
+    json_set_object(&obj, nodes, count);
     json j = { .root = obj, .failure = 0, .error_text = NULL };
     return j;
 }
@@ -103,9 +94,9 @@ test_summary_t run_serialize_tests() {
     // Simple types
     serialize_test_case_t serialize_tests[] = {
         // String
-        { make_json_string("abc"), "abc", 0, NULL },
+        { make_json_string("abc"), "\"abc\"", 0, NULL },
         // Number
-        { make_json_number(3.14f), "3.140000", 0, NULL },
+        { make_json_number(3.14f), "3.14", 0, NULL },
         // Bool true
         { make_json_bool(1), "true", 0, NULL },
         // Bool false
@@ -113,15 +104,15 @@ test_summary_t run_serialize_tests() {
         // Null
         { make_json_null(), "null", 0, NULL },
         // List [1,2]
-        { make_json_list((json[]){ make_json_number(1), make_json_number(2) }, 2), "[1.000000,2.000000]", 0, NULL },
+        { make_json_list((json[]){ make_json_number(1), make_json_number(2) }, 2), "[1,2]", 0, NULL },
         // Empty list
         { make_json_list(NULL, 0), "[]", 0, NULL },
         // Object { \"a\":1, \"b\":2 }
-        { make_json_object((const char*[]){ "a", "b" }, (json[]){ make_json_number(1), make_json_number(2) }, 2), "{a:1.000000,b:2.000000}", 0, NULL },
+        { make_json_object((const char*[]){ "a", "b" }, (json[]){ make_json_number(1), make_json_number(2) }, 2), "{\"a\":1,\"b\":2}", 0, NULL },
         // Empty object
         { make_json_object(NULL, NULL, 0), "{}", 0, NULL },
         // Nested object { \"x\":[true,null] }
-        { make_json_object((const char*[]){ "x" }, (json[]){ make_json_list((json[]){ make_json_bool(1), make_json_null() }, 2) }, 1), "{x:[true,null]}", 0, NULL },
+        { make_json_object((const char*[]){ "x" }, (json[]){ make_json_list((json[]){ make_json_bool(1), make_json_null() }, 2) }, 1), "{\"x\":[true,null]}", 0, NULL },
         // Should fail: unknown type (simulate by passing empty json)
         { { .root = { .type = 99 } }, NULL, 1, NULL },
     };
@@ -0,0 +1,149 @@
+#ifndef TEST_SHAPES_H
+#define TEST_SHAPES_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Each input is parsed with share_shapes set. The root is a list of records
+// (or a single object); the case checks how many distinct shapes the records
+// ended up with, reads one field from each record through a cached json_field,
+// and expects the input back from the serializer.
+typedef struct {
+    const char* input;
+    cereal_size_t expected_shapes;
+    const char* field;
+    const char* expected_values; // field of each record, "-" where it is missing
+    int should_fail;
+} shapes_test_case_t;
+
+// distinct shapes among the records, and the field rendered per record
+static cereal_size_t shapes_render(const json_object* root, const char* field_name, char* out, size_t out_size) {
+    const json_shape* seen[80];
+    cereal_size_t shapes = 0;
+    json_field field = json_field_init(field_name);
+    cereal_size_t count = json_typeof(root) == JSON_LIST ? json_list_count(root) : 1;
+    size_t used = 0;
+    out[0] = '\0';
+    for (cereal_size_t r = 0; r < count; r++) {
+        const json_object* record = json_typeof(root) == JSON_LIST ? json_list_at(root, r) : root;
+        const json_shape* shape = json_object_shape(record);
+        cereal_size_t k = 0;
+        while (k < shapes && seen[k] != shape) k++;
+        if (shape && k == shapes && shapes < 80) seen[shapes++] = shape;
+
+        const json_object* value = json_get_field(record, &field);
+        char text[32] = "-";
+        if (value) {
+            json tmp = { .root = *value, .failure = FALSE, .error_text = NULL };
+            size_t size = serialize_json_into(&tmp, text, sizeof(text));
+            if (size == 0) strcpy(text, "?");
+        }
+        int n = snprintf(out + used, out_size - used, "%s%s", r > 0 ? "|" : "", text);
+        if (n < 0 || (size_t)n >= out_size - used) break;
+        used += (size_t)n;
+    }
+    return shapes;
+}
+
+test_summary_t run_shapes_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    // more distinct key sets than the shape table holds, the rest keep their nodes
+    static char overflow[2048];
+    size_t len = 0;
+    overflow[len++] = '[';
+    for (int k = 0; k < JSON_SHAPE_TABLE_MAX + 6; k++) {
+        len += (size_t)snprintf(overflow + len, sizeof(overflow) - len, "%s{\"k%d\":%d}", k > 0 ? "," : "", k, k);
+    }
+    overflow[len++] = ']';
+    overflow[len] = '\0';
+
+    shapes_test_case_t shapes_tests[] = {
+        // Positive cases
+        {"[{\"a\":1,\"b\":2},{\"a\":3,\"b\":4},{\"a\":5,\"b\":6}]", 1, "b", "2|4|6", 0},
+        {"[{\"a\":1,\"b\":2},{\"b\":3,\"a\":4}]", 2, "a", "1|4", 0},
+        {"[{\"a\":1},{\"a\":2,\"b\":3},{\"a\":4}]", 2, "a", "1|2|4", 0},
+        {"[{\"a\":1},{\"b\":2}]", 2, "b", "-|2", 0},
+        {"[{\"p\":{\"x\":1}},{\"p\":{\"x\":2}}]", 1, "p", "{\"x\":1}|{\"x\":2}", 0},
+        {"[{\"id\":1,\"tags\":[\"x\"]},{\"id\":2,\"tags\":[]}]", 1, "tags", "[\"x\"]|[]", 0},
+        {"[{\"a\":1,\"a\":2}]", 1, "a", "1", 0},
+        {"[{},{}]", 0, "a", "-|-", 0},
+        {"{\"name\":\"ann\",\"role\":\"dev\"}", 1, "role", "\"dev\"", 0},
+        {"[{\"long_key_name_here\":\"v\"},{\"long_key_name_here\":\"w\"}]", 1, "long_key_name_here", "\"v\"|\"w\"", 0},
+        {overflow, JSON_SHAPE_TABLE_MAX, "k69", NULL, 0},
+        // Negative cases
+        {"[{\"a\":1},{\"a\":}]", 0, "a", NULL, 1},
+        {"[{\"a\" 1}]", 0, "a", NULL, 1},
+        {"[{\"a\":1,\"b\":2}", 0, "a", NULL, 1},
+    };
+    size_t total = sizeof(shapes_tests)/sizeof(shapes_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(shapes_tests)/sizeof(shapes_tests[0])];
+    printf("Running shape sharing tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const shapes_test_case_t *tc = &shapes_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        json_parse_options options = { &alloc, FALSE, TRUE, 0, NULL, 0 };
+        json result = deserialize_json_with_options(tc->input, strlen(tc->input), &options);
+        char result_str[256];
+        int pass;
+
+        if (tc->should_fail) {
+            pass = result.failure == TRUE;
+            strcpy(result_str, result.failure ? "Error" : "parsed");
+        } else if (result.failure) {
+            pass = 0;
+            strcpy(result_str, "Error");
+        } else {
+            char values[192];
+            cereal_size_t shapes = shapes_render(&result.root, tc->field, values, sizeof(values));
+            pass = shapes == tc->expected_shapes;
+            if (tc->expected_values && strcmp(values, tc->expected_values) != 0) pass = 0;
+            snprintf(result_str, sizeof(result_str), "%u %s", shapes, values);
+
+            // shaped objects serialize and size like any other
+            char* out = serialize_json(&result);
+            if (!out || strcmp(out, tc->input) != 0 || json_serialized_size(&result) != strlen(out)) pass = 0;
+            json_dealloc(&alloc, out);
+        }
+        json_free(&result);
+        // shapes are released with the last object that uses them
+        if (!tc->should_fail && counts.allocs != counts.frees) pass = 0;
+
+        format_input_display(tc->input, rows[i].input_display, 21);
+        if (tc->should_fail) {
+            strcpy(rows[i].expected, "Error");
+        } else {
+            char expected[64];
+            snprintf(expected, sizeof(expected), "%u %s", tc->expected_shapes, tc->expected_values ? tc->expected_values : "");
+            format_input_display(expected, rows[i].expected, 21);
+        }
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"Input", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 20, 20, 10};
+    print_test_table("Shape Sharing Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Shape sharing tests completed.\n");
+    return summary;
+}
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef TEST_SHARE_H
+#define TEST_SHARE_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+// Each input is parsed and made shareable with json_share, then a script of
+// ';' separated updates derives one version from the last:
+//   =P:V   json_share_set of JSON text V at pointer P
+//   -P     json_share_remove at pointer P
+// The last version must serialize to the expected text while every earlier
+// one, the original included, still serializes as it did. When kept is set,
+// the container at that pointer must be the same storage in the original and
+// the last version. The mutation API must refuse the shared root. With
+// threads, readers take references to the current version while the script
+// is applied many times over. Negative cases expect an update to fail.
+typedef struct {
+    const char* input;
+    int pack; // parse with pack_arrays
+    int share; // parse with share_shapes
+    const char* script;
+    const char* expected_output;
+    const char* kept; // pointer whose container is shared with the original, NULL for none
+    int threads; // reader threads, 0 for none
+    int should_fail;
+} share_test_case_t;
+
+static char* share_serialize(const json_object* root, const json_allocator* alloc) {
+    json tmp = { .root = *root, .failure = FALSE, .error_text = NULL };
+    return serialize_json_with_allocator(&tmp, alloc);
+}
+
+// apply one update to *current, replacing it with the new version; the old
+// version is stored in *old for the caller to release
+static int share_apply(json_object* current, json_object* old, const char* op, size_t len, const json_allocator* alloc) {
+    char buf[128];
+    json_object next;
+    if (len == 0 || len >= sizeof(buf)) return 0;
+    memcpy(buf, op, len);
+    buf[len] = '\0';
+    if (buf[0] == '=') {
+        char* colon = strchr(buf, ':');
+        if (!colon) return 0;
+        *colon = '\0';
+        json doc = deserialize_json_with_allocator(colon + 1, (cereal_size_t)strlen(colon + 1), alloc);
+        if (doc.failure) {
+            json_free(&doc);
+            return 0;
+        }
+        json_object value = doc.root;
+        json_set_null(&doc.root);
+        json_free(&doc);
+        if (!json_share_set(&next, current, buf + 1, &value, alloc)) {
+            json_object_free_with_allocator(&value, alloc);
+            return 0;
+        }
+    } else if (buf[0] == '-') {
+        if (!json_share_remove(&next, current, buf + 1, alloc)) return 0;
+    } else {
+        return 0;
+    }
+    *old = *current;
+    *current = next;
+    return 1;
+}
+
+typedef struct {
+    pthread_mutex_t lock; // guards current, readers only hold it to take a reference
+    json_object current;
+    int stop;
+    const json_allocator* alloc;
+    size_t reads;
+    int ok;
+} share_readers_t;
+
+static void* share_reader(void* arg) {
+    share_readers_t* r = (share_readers_t*)arg;
+    for (;;) {
+        json_object version;
+        pthread_mutex_lock(&r->lock);
+        int stop = r->stop;
+        int ok = stop ? 0 : json_share_retain(&version, &r->current, r->alloc);
+        if (ok) r->reads++;
+        pthread_mutex_unlock(&r->lock);
+        if (stop) break;
+        if (!ok) {
+            r->ok = 0;
+            break;
+        }
+        // read the whole version without any lock
+        char* out = share_serialize(&version, r->alloc);
+        if (!out || out[0] != '{') r->ok = 0;
+        json_dealloc(r->alloc, out);
+        json_object_free_with_allocator(&version, r->alloc);
+    }
+    return NULL;
+}
+
+test_summary_t run_share_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    share_test_case_t share_tests[] = {
+        // Positive cases
+        {"{\"a\":1,\"b\":{\"c\":[1,2]}}", 0, 0, "=/a:2", "{\"a\":2,\"b\":{\"c\":[1,2]}}", "/b", 0, 0},
+        {"{\"a\":{\"x\":1},\"b\":{\"y\":[true,null]}}", 0, 0, "=/a/x:\"s\"", "{\"a\":{\"x\":\"s\"},\"b\":{\"y\":[true,null]}}", "/b/y", 0, 0},
+        {"{\"a\":1}", 0, 0, "=/b:[1,{\"c\":2}]", "{\"a\":1,\"b\":[1,{\"c\":2}]}", NULL, 0, 0},
+        {"{\"a\":1,\"b\":2,\"c\":3}", 0, 0, "-/b", "{\"a\":1,\"c\":3}", NULL, 0, 0},
+        {"[[1],[2],[3]]", 0, 0, "=/1/0:9;=/-:4;-/0", "[[9],[3],4]", NULL, 0, 0},
+        {"[1,2,3]", 1, 0, "=/1:\"x\"", "[1,\"x\",3]", NULL, 0, 0},
+        {"{\"l\":[1,2,3],\"m\":[4]}", 1, 0, "=/m/1:5", "{\"l\":[1,2,3],\"m\":[4,5]}", "/l", 0, 0},
+        {"[{\"id\":1,\"n\":\"a\"},{\"id\":2,\"n\":\"b\"}]", 0, 1, "=/1/n:\"c\";=/0/z:0", "[{\"id\":1,\"n\":\"a\",\"z\":0},{\"id\":2,\"n\":\"c\"}]", NULL, 0, 0},
+        {"{\"a/b\":1,\"m~n\":2}", 0, 0, "=/a~1b:3;-/m~0n", "{\"a/b\":3}", NULL, 0, 0},
+        {"{\"s\":\"a string long enough for the heap\",\"t\":[]}", 0, 0, "=/t/0:\"another long heap string value\"", "{\"s\":\"a string long enough for the heap\",\"t\":[\"another long heap string value\"]}", NULL, 0, 0},
+        {"{\"a\":1}", 0, 0, "=:[2]", "[2]", NULL, 0, 0},
+        {"{\"cfg\":{\"n\":0},\"big\":{\"k\":[1,2,3,4,5,6,7,8]}}", 0, 0, "=/cfg/n:1;=/cfg/n:2;=/cfg/n:3", "{\"cfg\":{\"n\":3},\"big\":{\"k\":[1,2,3,4,5,6,7,8]}}", "/big", 4, 0},
+        // Negative cases
+        {"{\"a\":1}", 0, 0, "=/b/c:1", NULL, NULL, 0, 1},
+        {"{\"a\":1}", 0, 0, "=/missing/x:[1,{\"c\":[2]}]", NULL, NULL, 0, 1},
+        {"{\"a\":1}", 0, 0, "-/b", NULL, NULL, 0, 1},
+        {"[1,2]", 0, 0, "=/5:1", NULL, NULL, 0, 1},
+        {"[1,2]", 0, 0, "=/01:1", NULL, NULL, 0, 1},
+        {"{\"a\":1}", 0, 0, "=/a/b:1", NULL, NULL, 0, 1},
+        {"{\"a\":1}", 0, 0, "=a:1", NULL, NULL, 0, 1},
+        {"[1]", 0, 0, "-/-", NULL, NULL, 0, 1},
+    };
+    size_t total = sizeof(share_tests)/sizeof(share_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(share_tests)/sizeof(share_tests[0])];
+    printf("Running shared tree tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const share_test_case_t *tc = &share_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        json_parse_options options = { &alloc, tc->pack ? TRUE : FALSE, tc->share ? TRUE : FALSE, 0, NULL, 0 };
+        json doc = deserialize_json_with_options(tc->input, strlen(tc->input), &options);
+        char result_str[128] = "";
+        int pass = !doc.failure && json_share(&doc);
+
+        // every version so far, the original first
+        json_object versions[16];
+        char* texts[16];
+        size_t count = 0;
+        int applied = pass;
+        if (pass) {
+            json_object item;
+            json_set_number(&item, 1.0f);
+            if (json_typeof(&doc.root) == JSON_LIST && json_list_append(&doc.root, item, &alloc)) pass = 0;
+            if (json_typeof(&doc.root) == JSON_OBJECT && json_object_set(&doc.root, "k", item, &alloc)) pass = 0;
+            if (!json_share_retain(&versions[0], &doc.root, &alloc)) pass = 0;
+            texts[count++] = share_serialize(&versions[0], &alloc);
+            json_object current = versions[0];
+            const char* op = tc->script;
+            while (*op && count < 16) {
+                const char* end = strchr(op, ';');
+                size_t len = end ? (size_t)(end - op) : strlen(op);
+                json_object old;
+                if (!share_apply(&current, &old, op, len, &alloc)) {
+                    applied = 0;
+                    break;
+                }
+                versions[count] = current;
+                texts[count++] = share_serialize(&current, &alloc);
+                op += len + (end ? 1 : 0);
+            }
+        }
+
+        if (tc->should_fail) {
+            pass = pass && !applied;
+            strcpy(result_str, applied ? "applied" : "Error");
+        } else if (pass && applied) {
+            snprintf(result_str, sizeof(result_str), "%s", texts[count - 1] ? texts[count - 1] : "(null)");
+            if (!texts[count - 1] || strcmp(texts[count - 1], tc->expected_output) != 0) pass = 0;
+            // older versions are untouched
+            for (size_t k = 0; k < count; k++) {
+                char* again = share_serialize(&versions[k], &alloc);
+                if (!again || !texts[k] || strcmp(again, texts[k]) != 0) pass = 0;
+                json_dealloc(&alloc, again);
+            }
+            if (texts[0] && strcmp(texts[0], tc->input) != 0) pass = 0;
+            if (tc->kept) {
+                json_object* before = json_pointer_get(&versions[0], tc->kept);
+                json_object* after = json_pointer_get(&versions[count - 1], tc->kept);
+                if (!before || !after || json_container_storage(before) != json_container_storage(after)) pass = 0;
+            }
+        } else {
+            pass = 0;
+            strcpy(result_str, "Error");
+        }
+
+        if (pass && tc->threads > 0) {
+            // readers take references while updates replace and release versions
+            share_readers_t readers;
+            pthread_t ids[8];
+            pthread_mutex_init(&readers.lock, NULL);
+            readers.stop = 0;
+            readers.alloc = &alloc;
+            readers.reads = 0;
+            readers.ok = 1;
+            json_share_retain(&readers.current, &versions[count - 1], &alloc);
+            for (int t = 0; t < tc->threads; t++) pthread_create(&ids[t], NULL, share_reader, &readers);
+            for (int round = 0; round < 500; round++) {
+                const char* op = tc->script;
+                while (*op) {
+                    const char* end = strchr(op, ';');
+                    size_t len = end ? (size_t)(end - op) : strlen(op);
+                    json_object current, old;
+                    pthread_mutex_lock(&readers.lock);
+                    current = readers.current;
+                    pthread_mutex_unlock(&readers.lock);
+                    // only this thread replaces current, so it can be read outside the lock
+                    if (!share_apply(&current, &old, op, len, &alloc)) pass = 0;
+                    pthread_mutex_lock(&readers.lock);
+                    readers.current = current;
+                    pthread_mutex_unlock(&readers.lock);
+                    json_object_free_with_allocator(&old, &alloc);
+                    op += len + (end ? 1 : 0);
+                }
+            }
+            pthread_mutex_lock(&readers.lock);
+            readers.stop = 1;
+            pthread_mutex_unlock(&readers.lock);
+            for (int t = 0; t < tc->threads; t++) pthread_join(ids[t], NULL);
+            if (!readers.ok) pass = 0;
+            json_object_free_with_allocator(&readers.current, &alloc);
+            pthread_mutex_destroy(&readers.lock);
+        }
+
+        for (size_t k = 0; k < count; k++) {
+            json_object_free_with_allocator(&versions[k], &alloc);
+            json_dealloc(&alloc, texts[k]);
+        }
+        json_free(&doc);
+        if (counts.allocs != counts.frees) pass = 0;
+
+        format_input_display(tc->script, rows[i].input_display, 21);
+        format_input_display(tc->should_fail ? "Error" : tc->expected_output, rows[i].expected, 21);
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+
+    const char *headers[] = {"Script", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 20, 20, 10};
+    print_test_table("Shared Tree Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Shared tree tests completed.\n");
+    return summary;
+}
+
+#endif
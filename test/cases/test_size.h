@@ -0,0 +1,107 @@
+#ifndef TEST_SIZE_H
+#define TEST_SIZE_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    const char* name;
+    const char* input;  // parsed, or when raw is set the root is that string value
+    const char* raw;
+} size_test_case_t;
+
+// precomputed size must match the serializer, and serialize_json_into must
+// fit exactly that many bytes and reject one fewer
+static int size_check(const json* j, size_t* out_size) {
+    char* expected = serialize_json(j);
+    size_t size = json_serialized_size(j);
+    *out_size = size;
+    if (!expected) return size == 0;
+    int pass = size == strlen(expected);
+
+    char* buffer = (char*)malloc(size + 1);
+    memset(buffer, '#', size + 1);
+    // exact fit writes no terminator
+    pass = pass && serialize_json_into(j, buffer, size) == size && memcmp(buffer, expected, size) == 0 && buffer[size] == '#';
+    // one spare byte gets the terminator
+    pass = pass && serialize_json_into(j, buffer, size + 1) == size && strcmp(buffer, expected) == 0;
+    // one byte short fails
+    pass = pass && serialize_json_into(j, buffer, size - 1) == 0;
+    free(buffer);
+    free(expected);
+    return pass;
+}
+
+test_summary_t run_size_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    size_test_case_t size_tests[] = {
+        {"String", "\"hello\"", NULL},
+        {"Number", "3.14", NULL},
+        {"Negative exponent", "-1.5e-7", NULL},
+        {"Bools and null", "[true,false,null]", NULL},
+        {"Empty containers", "[[],{}]", NULL},
+        {"Object", "{\"a\":1,\"b\":[1,2,{\"c\":\"d\"}]}", NULL},
+        {"Number at end", "[\"padding\",123456.7]", NULL},
+        {"Short escapes", NULL, "tab\there \"quoted\" back\\slash\n"},
+        {"Control chars", NULL, "\x01\x02\x1f"},
+        {"Long clean run", NULL, "0123456789abcdef0123456789abcdef0123456789abcdef"},
+    };
+    size_t total = sizeof(size_tests)/sizeof(size_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(size_tests)/sizeof(size_tests[0]) + 1];
+    printf("Running serialized size tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const size_test_case_t *tc = &size_tests[i];
+        json j;
+        if (tc->raw) {
+            j = (json){ .failure = FALSE, .error_text = NULL };
+            json_set_string(&j.root, (char*)tc->raw);
+        } else {
+            j = deserialize_json(tc->input, strlen(tc->input));
+        }
+        size_t size = 0;
+        int pass = !j.failure && size_check(&j, &size);
+        if (!tc->raw) json_free(&j);
+
+        snprintf(rows[i].input_display, sizeof(rows[i].input_display), "%s", tc->name);
+        strcpy(rows[i].expected, "exact fit");
+        snprintf(rows[i].result, sizeof(rows[i].result), "%zu B", size);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (pass) ++positive_passed; else ++positive_failed;
+    }
+
+    // A tree the serializer rejects has no size
+    {
+        json j = { .failure = FALSE, .error_text = NULL };
+        json_set_string(&j.root, NULL);
+        char buffer[16];
+        int pass = json_serialized_size(&j) == 0 && serialize_json_into(&j, buffer, sizeof(buffer)) == 0;
+        strcpy(rows[total].input_display, "NULL string");
+        strcpy(rows[total].expected, "0");
+        strcpy(rows[total].result, pass ? "0" : "non-zero");
+        strcpy(rows[total].status, pass ? "PASS" : "FAIL");
+        rows[total].color = pass ? GREEN : RED;
+        rows[total].reset = RESET;
+        if (pass) ++negative_passed; else ++negative_failed;
+        ++total;
+    }
+
+    const char *headers[] = {"Input", "Expected", "Size", "Status"};
+    int col_widths[] = {20, 12, 10, 10};
+    print_test_table("Serialized Size Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Serialized size tests completed.\n");
+    return summary;
+}
+
+#endif
@@ -0,0 +1,238 @@
+#ifndef TEST_SNAPSHOT_H
+#define TEST_SNAPSHOT_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../../include/cerialize/snapshot.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Positive cases parse input, write it with json_snapshot_write, map it back
+// with json_snapshot_open and print the image through the read only accessors,
+// which must give the input back. When key is set it is looked up on the root
+// with json_snapshot_find and the member printed instead. Negative cases damage
+// the written file and expect open or json_snapshot_verify to reject it,
+// including an image where two records share the same contents.
+typedef enum {
+    SNAPSHOT_INTACT,
+    SNAPSHOT_TRUNCATE, // drop the last byte
+    SNAPSHOT_BAD_MAGIC,
+    SNAPSHOT_BAD_OFFSET, // root contents point past the end
+    SNAPSHOT_BAD_INDEX, // key index entry out of range
+    SNAPSHOT_ALIAS, // second root item points at the first one's contents
+    SNAPSHOT_MISSING // no file at all
+} snapshot_damage_t;
+
+typedef struct {
+    const char* input;
+    int pack; // parse with pack_arrays
+    const char* key; // member of the root to look up, NULL to print the root
+    const char* expected_output; // NULL to expect the input back
+    snapshot_damage_t damage;
+    int should_fail;
+} snapshot_test_case_t;
+
+static void snapshot_print(const json_snapshot* snap, const json_snapshot_value* v, char* out, size_t capacity, size_t* used) {
+    if (*used >= capacity) return;
+    char* at = out + *used;
+    size_t room = capacity - *used;
+    switch (json_snapshot_type(v)) {
+        case JSON_NULL:
+            *used += (size_t)snprintf(at, room, "null");
+            break;
+        case JSON_BOOL:
+            *used += (size_t)snprintf(at, room, "%s", json_snapshot_bool(v) ? "true" : "false");
+            break;
+        case JSON_NUMBER:
+            *used += (size_t)snprintf(at, room, "%g", json_snapshot_number(v));
+            break;
+        case JSON_STRING:
+            *used += (size_t)snprintf(at, room, "\"%s\"", json_snapshot_string(snap, v, NULL));
+            break;
+        case JSON_LIST: {
+            *used += (size_t)snprintf(at, room, "[");
+            json_packed_view packed = json_snapshot_packed(snap, v);
+            for (cereal_size_t i = 0; i < json_snapshot_count(v) && *used < capacity; i++) {
+                if (i > 0) *used += (size_t)snprintf(out + *used, capacity - *used, ",");
+                if (*used >= capacity) return;
+                if (packed.packing == JSON_PACKED_DOUBLE) {
+                    *used += (size_t)snprintf(out + *used, capacity - *used, "%g", ((const double*)packed.data)[i]);
+                } else if (packed.packing == JSON_PACKED_INT64) {
+                    *used += (size_t)snprintf(out + *used, capacity - *used, "%lld", (long long)((const int64_t*)packed.data)[i]);
+                } else if (packed.packing == JSON_PACKED_BOOL) {
+                    int bit = (((const unsigned char*)packed.data)[i / 8] >> (i % 8)) & 1;
+                    *used += (size_t)snprintf(out + *used, capacity - *used, "%s", bit ? "true" : "false");
+                } else {
+                    snapshot_print(snap, json_snapshot_at(snap, v, i), out, capacity, used);
+                }
+            }
+            if (*used < capacity) *used += (size_t)snprintf(out + *used, capacity - *used, "]");
+            break;
+        }
+        case JSON_OBJECT:
+            *used += (size_t)snprintf(at, room, "{");
+            for (cereal_size_t i = 0; i < json_snapshot_count(v) && *used < capacity; i++) {
+                *used += (size_t)snprintf(out + *used, capacity - *used, "%s\"%s\":", i > 0 ? "," : "", json_snapshot_key_at(snap, v, i, NULL));
+                snapshot_print(snap, json_snapshot_value_at(snap, v, i), out, capacity, used);
+            }
+            if (*used < capacity) *used += (size_t)snprintf(out + *used, capacity - *used, "}");
+            break;
+        default:
+            break;
+    }
+}
+
+static void snapshot_damage(const char* path, snapshot_damage_t damage) {
+    FILE* file = fopen(path, "r+b");
+    if (!file) return;
+    json_snapshot_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        return;
+    }
+    if (damage == SNAPSHOT_TRUNCATE) {
+        fclose(file);
+        truncate(path, (off_t)header.size - 1);
+        return;
+    }
+    if (damage == SNAPSHOT_BAD_MAGIC) {
+        header.magic[0] = 'X';
+    } else if (damage == SNAPSHOT_BAD_OFFSET) {
+        header.root.payload = header.size + 64;
+    } else if (damage == SNAPSHOT_BAD_INDEX) {
+        // the index follows the root's members
+        uint32_t bad = header.root.count;
+        fseek(file, (long)(header.root.payload + sizeof(json_snapshot_member) * header.root.count), SEEK_SET);
+        fwrite(&bad, sizeof(bad), 1, file);
+        fclose(file);
+        return;
+    } else if (damage == SNAPSHOT_ALIAS) {
+        json_snapshot_value items[2];
+        fseek(file, (long)header.root.payload, SEEK_SET);
+        if (fread(items, sizeof(items), 1, file) == 1) {
+            items[1].payload = items[0].payload;
+            fseek(file, (long)header.root.payload, SEEK_SET);
+            fwrite(items, sizeof(items), 1, file);
+        }
+        fclose(file);
+        return;
+    }
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+}
+
+test_summary_t run_snapshot_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    // an object with keys in reverse order, so the index is fully reordered
+    static char wide[2048];
+    size_t len = 0;
+    wide[len++] = '{';
+    for (int k = 99; k >= 0; k--) {
+        len += (size_t)snprintf(wide + len, sizeof(wide) - len, "\"k%02d\":%d%s", k, k, k > 0 ? "," : "}");
+    }
+
+    snapshot_test_case_t snapshot_tests[] = {
+        // Positive cases
+        {"null", 0, NULL, NULL, SNAPSHOT_INTACT, 0},
+        {"true", 0, NULL, NULL, SNAPSHOT_INTACT, 0},
+        {"2.5", 0, NULL, NULL, SNAPSHOT_INTACT, 0},
+        {"\"hello\"", 0, NULL, NULL, SNAPSHOT_INTACT, 0},
+        {"[]", 0, NULL, NULL, SNAPSHOT_INTACT, 0},
+        {"{}", 0, NULL, NULL, SNAPSHOT_INTACT, 0},
+        {"[1,\"a\",[false,null],{\"b\":[]}]", 0, NULL, NULL, SNAPSHOT_INTACT, 0},
+        {"{\"name\":\"a string long enough for the heap\",\"tags\":[\"x\",\"y\"]}", 0, NULL, NULL, SNAPSHOT_INTACT, 0},
+        {"[1,2,3]", 1, NULL, NULL, SNAPSHOT_INTACT, 0},
+        {"[1.5,-2]", 1, NULL, NULL, SNAPSHOT_INTACT, 0},
+        {"[true,false,true]", 1, NULL, NULL, SNAPSHOT_INTACT, 0},
+        {"{\"c\":3,\"a\":1,\"b\":2}", 0, "b", "2", SNAPSHOT_INTACT, 0},
+        {"{\"ab\":1,\"a\":2,\"abc\":3}", 0, "a", "2", SNAPSHOT_INTACT, 0},
+        {"{\"k\":1,\"k\":2}", 0, "k", "1", SNAPSHOT_INTACT, 0},
+        {"{\"x\":{\"y\":[1,2]}}", 0, "x", "{\"y\":[1,2]}", SNAPSHOT_INTACT, 0},
+        {"{\"a\":1}", 0, "z", "missing", SNAPSHOT_INTACT, 0},
+        {wide, 0, "k00", "0", SNAPSHOT_INTACT, 0},
+        {wide, 0, "k57", "57", SNAPSHOT_INTACT, 0},
+        {wide, 0, "k99", "99", SNAPSHOT_INTACT, 0},
+        // Negative cases
+        {"[1,", 0, NULL, NULL, SNAPSHOT_INTACT, 1},
+        {"[1,2,3]", 0, NULL, NULL, SNAPSHOT_TRUNCATE, 1},
+        {"[1,2,3]", 0, NULL, NULL, SNAPSHOT_BAD_MAGIC, 1},
+        {"[1,2,3]", 0, NULL, NULL, SNAPSHOT_BAD_OFFSET, 1},
+        {"{\"a\":1,\"b\":2}", 0, NULL, NULL, SNAPSHOT_BAD_INDEX, 1},
+        {"[[1],[2]]", 0, NULL, NULL, SNAPSHOT_ALIAS, 1},
+        {"[{\"a\":[1]},{\"a\":[2]}]", 0, NULL, NULL, SNAPSHOT_ALIAS, 1},
+        {"[1]", 0, NULL, NULL, SNAPSHOT_MISSING, 1},
+    };
+    size_t total = sizeof(snapshot_tests)/sizeof(snapshot_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(snapshot_tests)/sizeof(snapshot_tests[0])];
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/cerialize_snapshot_%ld.bin", (long)getpid());
+    printf("Running snapshot tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const snapshot_test_case_t *tc = &snapshot_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        json_parse_options options = { &alloc, tc->pack ? TRUE : FALSE, FALSE, 0, NULL, 0 };
+        json doc = deserialize_json_with_options(tc->input, strlen(tc->input), &options);
+        const char* expected = tc->expected_output ? tc->expected_output : tc->input;
+        char result_str[512] = "";
+        int pass = 1;
+
+        bool_t doc_failed = doc.failure;
+        remove(path);
+        bool_t written = json_snapshot_write(&doc, path);
+        json_free(&doc);
+        if (tc->damage == SNAPSHOT_MISSING) remove(path);
+        else if (tc->damage != SNAPSHOT_INTACT) snapshot_damage(path, tc->damage);
+
+        json_snapshot snap;
+        bool_t opened = json_snapshot_open(path, &snap);
+        bool_t verified = opened && json_snapshot_verify(&snap);
+        if (tc->should_fail) {
+            pass = !written || !verified;
+            strcpy(result_str, pass ? "Error" : "accepted");
+        } else if (!verified) {
+            pass = 0;
+            strcpy(result_str, written ? "rejected" : "write failed");
+        } else {
+            const json_snapshot_value* v = json_snapshot_root(&snap);
+            size_t used = 0;
+            if (tc->key) v = json_snapshot_find(&snap, v, tc->key, strlen(tc->key));
+            if (v) snapshot_print(&snap, v, result_str, sizeof(result_str), &used);
+            else strcpy(result_str, "missing");
+            if (strcmp(result_str, expected) != 0) pass = 0;
+        }
+        json_snapshot_close(&snap);
+        if (!doc_failed && counts.allocs != counts.frees) pass = 0;
+
+        format_input_display(tc->input, rows[i].input_display, 21);
+        format_input_display(tc->should_fail ? "Error" : expected, rows[i].expected, 21);
+        format_input_display(result_str, rows[i].result, 21);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (tc->should_fail) {
+            if (pass) ++negative_passed; else ++negative_failed;
+        } else {
+            if (pass) ++positive_passed; else ++positive_failed;
+        }
+    }
+    remove(path);
+
+    const char *headers[] = {"Input", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 20, 20, 10};
+    print_test_table("Snapshot Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Snapshot tests completed.\n");
+    return summary;
+}
+
+#endif
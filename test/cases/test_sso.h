@@ -0,0 +1,89 @@
+#ifndef TEST_SSO_H
+#define TEST_SSO_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include "../helpers/test_counting_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+// Each case is an object with one key. With CERIALIZE_COMPACT short keys and
+// values are stored inline, so the only allocation left is the node array.
+typedef struct {
+    const char* input;
+    const char* key;
+    const char* value;
+    size_t compact_allocs;
+    size_t default_allocs;
+} sso_test_case_t;
+
+test_summary_t run_sso_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    sso_test_case_t sso_tests[] = {
+        {"{\"id\":\"a\"}", "id", "a", 1, 3},
+        {"{\"name\":\"user_12345\"}", "name", "user_12345", 1, 3},
+        {"{\"active\":\"twelve_bytes\"}", "active", "twelve_bytes", 1, 3},
+        {"{\"sevenkk\":\"x\"}", "sevenkk", "x", 2, 3},
+        {"{\"k\":\"thirteen_byte\"}", "k", "thirteen_byte", 2, 3},
+        {"{\"a_much_longer_key\":\"and a much longer value\"}", "a_much_longer_key", "and a much longer value", 3, 3},
+    };
+    size_t total = sizeof(sso_tests)/sizeof(sso_tests[0]);
+    int negative_passed = 0, negative_failed = 0;
+    int positive_passed = 0, positive_failed = 0;
+    test_row_t rows[sizeof(sso_tests)/sizeof(sso_tests[0])];
+    printf("Running small string tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const sso_test_case_t *tc = &sso_tests[i];
+        counting_allocator_ctx_t counts = { 0 };
+        json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+        json result = deserialize_json_with_allocator(tc->input, strlen(tc->input), &alloc);
+#ifdef CERIALIZE_COMPACT
+        size_t expected_allocs = tc->compact_allocs;
+#else
+        size_t expected_allocs = tc->default_allocs;
+#endif
+        // the parse allocates the error buffer too, leave it out of the count
+        size_t allocs = counts.allocs - 1;
+        int pass = !result.failure && allocs == expected_allocs;
+
+        if (pass) {
+            // key and value read back through the (ptr, len) accessors
+            size_t key_len, value_len;
+            json_node* node = &json_nodes(&result.root)[0];
+            const char* key = json_node_key(node, &key_len);
+            const char* value = json_string_get(&node->value, &value_len);
+            pass = key_len == strlen(tc->key) && strcmp(key, tc->key) == 0
+                && value_len == strlen(tc->value) && strcmp(value, tc->value) == 0;
+
+            // lookup and serialization see the same bytes
+            json_object found = json_get_property(result.root, tc->key);
+            pass = pass && json_typeof(&found) == JSON_STRING && strcmp(json_string_value(&found), tc->value) == 0;
+            char* out = serialize_json(&result);
+            pass = pass && out != NULL && strcmp(out, tc->input) == 0;
+            json_dealloc(&alloc, out);
+        }
+        json_free(&result);
+
+        format_input_display(tc->input, rows[i].input_display, 21);
+        snprintf(rows[i].expected, sizeof(rows[i].expected), "%zu allocs", expected_allocs);
+        snprintf(rows[i].result, sizeof(rows[i].result), "%zu allocs", allocs);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (pass) ++positive_passed; else ++positive_failed;
+    }
+
+    const char *headers[] = {"Input", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 12, 12, 10};
+    print_test_table("Small String Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(positive_passed, positive_failed, negative_passed, negative_failed, total);
+    test_summary_t summary = {positive_passed + negative_passed, positive_failed + negative_failed, total};
+    printf("Small string tests completed.\n");
+    return summary;
+}
+
+#endif
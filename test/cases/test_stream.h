@@ -0,0 +1,218 @@
+#ifndef TEST_STREAM_H
+#define TEST_STREAM_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include <stdio.h>
+#include <string.h>
+
+// Sink that appends every chunk it receives and tracks the largest one
+typedef struct {
+    char* data;
+    size_t length;
+    size_t calls;
+    size_t largest;
+    size_t batches; // writev calls
+} stream_capture_t;
+
+static bool_t stream_capture_write(void* user, const char* data, size_t length) {
+    stream_capture_t* cap = (stream_capture_t*)user;
+    cap->data = (char*)realloc(cap->data, cap->length + length + 1);
+    memcpy(cap->data + cap->length, data, length);
+    cap->length += length;
+    cap->data[cap->length] = '\0';
+    cap->calls++;
+    if (length > cap->largest) cap->largest = length;
+    return TRUE;
+}
+
+// writev sink: every chunk of a batch, in order
+static bool_t stream_capture_writev(void* user, const json_iovec* chunks, int count) {
+    stream_capture_t* cap = (stream_capture_t*)user;
+    cap->batches++;
+    for (int c = 0; c < count; c++) {
+        if (!stream_capture_write(user, chunks[c].data, chunks[c].length)) return FALSE;
+    }
+    return TRUE;
+}
+
+// Read back everything written to a temporary file
+static char* stream_read_file(FILE* file) {
+    long size = ftell(file);
+    char* data = (char*)malloc((size_t)size + 1);
+    rewind(file);
+    size_t got = fread(data, 1, (size_t)size, file);
+    data[got] = '\0';
+    return data;
+}
+
+typedef struct {
+    const char* name;
+    cereal_size_t items;     // list items to generate
+    size_t min_calls;        // write callback must be hit at least this often
+    size_t string_size;      // 0 for short "value_N" items, otherwise items of this many bytes
+} stream_test_case_t;
+
+test_summary_t run_stream_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    stream_test_case_t stream_tests[] = {
+        {"Single item", 1, 1, 0},
+        {"Under one buffer", 100, 1, 0},
+        {"Many buffers", 50000, 5, 0},
+        {"Large strings", 4, 4, 100000},
+    };
+    size_t total = sizeof(stream_tests)/sizeof(stream_tests[0]);
+    int passed = 0, failed = 0;
+    test_row_t rows[sizeof(stream_tests)/sizeof(stream_tests[0]) * 4 + 1];
+    size_t num_rows = 0;
+    printf("Running stream tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const stream_test_case_t *tc = &stream_tests[i];
+
+        // build a list of strings and its in-memory serialization to compare against
+        json doc = { .failure = FALSE, .error_text = NULL };
+        json_set_list(&doc.root, (json_object*)malloc(sizeof(json_object) * tc->items), tc->items);
+        for (cereal_size_t k = 0; k < tc->items; k++) {
+            char* str;
+            if (tc->string_size) {
+                str = (char*)malloc(tc->string_size + 1);
+                memset(str, 'a' + (char)(k % 26), tc->string_size);
+                str[tc->string_size] = '\0';
+            } else {
+                char buffer[32];
+                snprintf(buffer, sizeof(buffer), "value_%u", k);
+                str = (char*)malloc(strlen(buffer) + 1);
+                strcpy(str, buffer);
+            }
+            json_set_string(json_list_at(&doc.root, k), str);
+        }
+        char* expected = serialize_json(&doc);
+
+        // callback sink: same bytes, bounded chunk size
+        stream_capture_t cap = { NULL, 0, 0, 0, 0 };
+        int pass = serialize_json_to(&doc, stream_capture_write, &cap)
+            && cap.data && strcmp(cap.data, expected) == 0
+            && cap.calls >= tc->min_calls
+            && (tc->string_size || cap.largest <= JSON_WRITER_FLUSH_SIZE);
+        snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s (callback)", tc->name);
+        snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%zu B", strlen(expected));
+        snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%zu B/%zu calls", cap.length, cap.calls);
+        strcpy(rows[num_rows].status, pass ? "PASS" : "FAIL");
+        rows[num_rows].color = pass ? GREEN : RED;
+        rows[num_rows].reset = RESET;
+        num_rows++;
+        if (pass) ++passed; else ++failed;
+        free(cap.data);
+
+        // callback and writev sink: large strings arrive batched with the buffer
+        stream_capture_t vcap = { NULL, 0, 0, 0, 0 };
+        pass = serialize_json_to_sink(&doc, stream_capture_write, stream_capture_writev, &vcap)
+            && vcap.data && strcmp(vcap.data, expected) == 0
+            && (tc->string_size ? vcap.batches > 0 : vcap.batches == 0);
+        snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s (writev)", tc->name);
+        snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%zu B", strlen(expected));
+        snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%zu B/%zu batches", vcap.length, vcap.batches);
+        strcpy(rows[num_rows].status, pass ? "PASS" : "FAIL");
+        rows[num_rows].color = pass ? GREEN : RED;
+        rows[num_rows].reset = RESET;
+        num_rows++;
+        if (pass) ++passed; else ++failed;
+        free(vcap.data);
+
+        // FILE* sink
+        FILE* file = tmpfile();
+        char* from_file = NULL;
+        pass = file != NULL && serialize_json_to_file(&doc, file);
+        if (pass) {
+            fflush(file);
+            from_file = stream_read_file(file);
+            pass = strcmp(from_file, expected) == 0;
+        }
+        snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s (FILE*)", tc->name);
+        snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%zu B", strlen(expected));
+        snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%zu B", from_file ? strlen(from_file) : (size_t)0);
+        strcpy(rows[num_rows].status, pass ? "PASS" : "FAIL");
+        rows[num_rows].color = pass ? GREEN : RED;
+        rows[num_rows].reset = RESET;
+        num_rows++;
+        if (pass) ++passed; else ++failed;
+        free(from_file);
+        if (file) fclose(file);
+
+#ifdef CERIALIZE_POSIX
+        // raw fd sink
+        file = tmpfile();
+        char* from_fd = NULL;
+        pass = file != NULL && serialize_json_to_fd(&doc, fileno(file));
+        if (pass) {
+            fseek(file, 0, SEEK_END);
+            from_fd = stream_read_file(file);
+            pass = strcmp(from_fd, expected) == 0;
+        }
+        snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%s (fd)", tc->name);
+        snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%zu B", strlen(expected));
+        snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%zu B", from_fd ? strlen(from_fd) : (size_t)0);
+        strcpy(rows[num_rows].status, pass ? "PASS" : "FAIL");
+        rows[num_rows].color = pass ? GREEN : RED;
+        rows[num_rows].reset = RESET;
+        num_rows++;
+        if (pass) ++passed; else ++failed;
+        free(from_fd);
+        if (file) fclose(file);
+#endif
+
+        free(expected);
+        json_free(&doc);
+    }
+
+#ifdef CERIALIZE_POSIX
+    // fd writev with more chunks than one writev takes, empty ones skipped
+    {
+        char bytes[JSON_FD_IOV * 2 + 3];
+        char expected[sizeof(bytes) + 1];
+        json_iovec chunks[sizeof(bytes)];
+        int count = (int)sizeof(bytes);
+        size_t length = 0;
+        for (int c = 0; c < count; c++) {
+            bytes[c] = (char)('a' + c % 26);
+            chunks[c].data = &bytes[c];
+            chunks[c].length = c % 5 == 4 ? 0 : 1;
+            if (chunks[c].length) expected[length++] = bytes[c];
+        }
+        expected[length] = '\0';
+        FILE* file = tmpfile();
+        int fd = file ? fileno(file) : -1;
+        char* from_fd = NULL;
+        int pass = file != NULL && json_fd_writev(&fd, chunks, count);
+        if (pass) {
+            fseek(file, 0, SEEK_END);
+            from_fd = stream_read_file(file);
+            pass = strcmp(from_fd, expected) == 0;
+        }
+        snprintf(rows[num_rows].input_display, sizeof(rows[num_rows].input_display), "%d chunks (fd writev)", count);
+        snprintf(rows[num_rows].expected, sizeof(rows[num_rows].expected), "%zu B", length);
+        snprintf(rows[num_rows].result, sizeof(rows[num_rows].result), "%zu B", from_fd ? strlen(from_fd) : (size_t)0);
+        strcpy(rows[num_rows].status, pass ? "PASS" : "FAIL");
+        rows[num_rows].color = pass ? GREEN : RED;
+        rows[num_rows].reset = RESET;
+        num_rows++;
+        if (pass) ++passed; else ++failed;
+        free(from_fd);
+        if (file) fclose(file);
+    }
+#endif
+
+    const char *headers[] = {"Input", "Expected", "Result", "Status"};
+    int col_widths[] = {28, 12, 20, 10};
+    print_test_table("Stream Tests", headers, 4, col_widths, rows, num_rows);
+    print_test_summary(passed, failed, 0, 0, num_rows);
+    test_summary_t summary = {passed, failed, num_rows};
+    printf("Stream tests completed.\n");
+    return summary;
+}
+
+#endif
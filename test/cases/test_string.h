@@ -60,15 +60,15 @@ test_summary_t run_string_tests() {
                 color = RED;
                 pass = 0;
                 strcpy(result_str, "Error");
-            } else if (result.root.type != JSON_STRING || !(result.root.value.string && strcmp(result.root.value.string, tc->expected) == 0)) {
+            } else if (result.root.type != JSON_STRING || !(json_string_value(&result.root) && strcmp(json_string_value(&result.root), tc->expected) == 0)) {
                 strcpy(status, "FAIL");
                 color = RED;
                 pass = 0;
-                snprintf(result_str, sizeof(result_str), "%s", result.root.value.string ? result.root.value.string : "NULL");
+                snprintf(result_str, sizeof(result_str), "%s", json_string_value(&result.root) ? json_string_value(&result.root) : "NULL");
             } else {
                 strcpy(status, "PASS");
                 color = GREEN;
-                snprintf(result_str, sizeof(result_str), "%s", result.root.value.string);
+                snprintf(result_str, sizeof(result_str), "%s", json_string_value(&result.root));
             }
         }
         format_input_display(tc->input, input_display, sizeof(input_display));
@@ -0,0 +1,84 @@
+#ifndef TEST_WRITER_H
+#define TEST_WRITER_H
+
+#include "../../include/cerialize/cerialize.h"
+#include "../helpers/test_utils.h"
+#include "../helpers/test_output_helper.h"
+#include <stdio.h>
+#include <string.h>
+
+// Checks that serialization through json_writer is not bounded by a fixed buffer
+typedef struct {
+    const char* name;
+    cereal_size_t items;      // number of list items (or object keys) to generate
+    int as_object;            // 1 to generate an object instead of a list
+} writer_test_case_t;
+
+// Build "[\"item0\",...]" or "{\"k0\":\"item0\",...}", already in compact serialized form
+static char* make_writer_text(const writer_test_case_t* tc) {
+    size_t cap = 32 + (size_t)tc->items * 32;
+    char* text = (char*)malloc(cap);
+    size_t len = 0;
+    text[len++] = tc->as_object ? '{' : '[';
+    for (cereal_size_t i = 0; i < tc->items; i++) {
+        if (i > 0) text[len++] = ',';
+        if (tc->as_object) {
+            len += (size_t)snprintf(text + len, cap - len, "\"k%u\":", i);
+        }
+        len += (size_t)snprintf(text + len, cap - len, "\"item%u\"", i);
+    }
+    text[len++] = tc->as_object ? '}' : ']';
+    text[len] = '\0';
+    return text;
+}
+
+test_summary_t run_writer_tests() {
+    const char *GREEN = "\033[0;32m";
+    const char *RED = "\033[0;31m";
+    const char *RESET = "\033[0m";
+
+    writer_test_case_t writer_tests[] = {
+        {"Small list", 4, 0},
+        {"List over 1KB", 500, 0},
+        {"List over 64KB", 10000, 0},
+        {"Object over 1KB", 500, 1},
+        {"Object over 64KB", 10000, 1},
+    };
+    size_t total = sizeof(writer_tests)/sizeof(writer_tests[0]);
+    int passed = 0, failed = 0;
+    test_row_t rows[sizeof(writer_tests)/sizeof(writer_tests[0])];
+    printf("Running writer tests...\n");
+    for (size_t i = 0; i < total; ++i) {
+        const writer_test_case_t *tc = &writer_tests[i];
+        // compact input must come back byte for byte
+        char* input = make_writer_text(tc);
+        const char* expected = input;
+        json result = deserialize_json(input, strlen(input));
+        char* output = result.failure ? NULL : serialize_json(&result);
+
+        // the whole tree must come out in one piece, however large
+        int pass = output != NULL && strcmp(output, expected) == 0;
+
+        snprintf(rows[i].input_display, sizeof(rows[i].input_display), "%s", tc->name);
+        snprintf(rows[i].expected, sizeof(rows[i].expected), "%zu B", strlen(expected));
+        snprintf(rows[i].result, sizeof(rows[i].result), "%zu B", output ? strlen(output) : (size_t)0);
+        strcpy(rows[i].status, pass ? "PASS" : "FAIL");
+        rows[i].color = pass ? GREEN : RED;
+        rows[i].reset = RESET;
+        if (pass) ++passed; else ++failed;
+
+        free(output);
+        json_free(&result);
+        free(input);
+    }
+
+    const char *headers[] = {"Input", "Expected", "Result", "Status"};
+    int col_widths[] = {20, 10, 20, 10};
+    print_test_table("Writer Tests", headers, 4, col_widths, rows, total);
+    print_test_summary(passed, failed, 0, 0, total);
+    test_summary_t summary = {passed, failed, total};
+    printf("Writer tests completed.\n");
+    return summary;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef TEST_COUNTING_ALLOC_H
+#define TEST_COUNTING_ALLOC_H
+
+#include "../../include/cerialize/cerialize.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Allocator hooks that count every call routed through them, shared by the
+// test cases:
+//     counting_allocator_ctx_t counts = { 0 };
+//     json_allocator alloc = { counting_alloc, counting_realloc, counting_free, &counts };
+// A realloc of NULL counts as an allocation and a realloc of a live block as a
+// grow. The counters sit behind one lock, so documents can be built and freed
+// on any thread. With poison set before the first allocation, every block
+// carries its size, freed blocks are overwritten and realloc always moves, so
+// a reader still inside freed memory sees garbage.
+typedef struct {
+    size_t allocs;
+    size_t frees;
+    size_t grows;
+    bool_t poison;
+    void* recent[8]; // the last allocations, for counting_block_size
+    size_t recent_sizes[8];
+} counting_allocator_ctx_t;
+
+#define COUNTING_HEADER 16 // size in front of poisoned blocks, keeps them aligned
+
+static pthread_mutex_t counting_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void* counting_alloc(void* ctx, size_t size) {
+    counting_allocator_ctx_t* counts = (counting_allocator_ctx_t*)ctx;
+    void* ptr;
+    if (counts->poison) {
+        size_t* block = (size_t*)malloc(size + COUNTING_HEADER);
+        if (!block) return NULL;
+        block[0] = size;
+        ptr = (char*)block + COUNTING_HEADER;
+    } else {
+        ptr = malloc(size);
+        if (!ptr) return NULL;
+    }
+    pthread_mutex_lock(&counting_lock);
+    counts->recent[counts->allocs % 8] = ptr;
+    counts->recent_sizes[counts->allocs % 8] = size;
+    counts->allocs++;
+    pthread_mutex_unlock(&counting_lock);
+    return ptr;
+}
+
+static void counting_free(void* ctx, void* ptr) {
+    counting_allocator_ctx_t* counts = (counting_allocator_ctx_t*)ctx;
+    if (!ptr) return;
+    pthread_mutex_lock(&counting_lock);
+    counts->frees++;
+    pthread_mutex_unlock(&counting_lock);
+    if (counts->poison) {
+        size_t* block = (size_t*)((char*)ptr - COUNTING_HEADER);
+        memset(ptr, 0xdd, block[0]);
+        free(block);
+    } else {
+        free(ptr);
+    }
+}
+
+static void* counting_realloc(void* ctx, void* ptr, size_t size) {
+    counting_allocator_ctx_t* counts = (counting_allocator_ctx_t*)ctx;
+    if (ptr == NULL) return counting_alloc(ctx, size);
+    pthread_mutex_lock(&counting_lock);
+    counts->grows++;
+    pthread_mutex_unlock(&counting_lock);
+    if (!counts->poison) return realloc(ptr, size);
+    // move, so a stale pointer into the old block reads freed memory
+    size_t old = ((size_t*)((char*)ptr - COUNTING_HEADER))[0];
+    void* moved = counting_alloc(ctx, size);
+    if (!moved) return NULL;
+    memcpy(moved, ptr, old < size ? old : size);
+    counting_free(ctx, ptr);
+    return moved;
+}
+
+// size of block when it is one of the last 8 allocations, 0 otherwise
+static size_t counting_block_size(const counting_allocator_ctx_t* counts, const void* block) {
+    for (int k = 0; k < 8; k++) {
+        if (counts->recent[k] == block) return counts->recent_sizes[k];
+    }
+    return 0;
+}
+
+#endif // TEST_COUNTING_ALLOC_H
@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
 #include "../helpers/test_output_helper.h"
@@ -9,6 +10,30 @@
 #include "cases/test_list.h"
 #include "cases/test_serialize.h"
 #include "cases/test_memory.h"
+#include "cases/test_allocator.h"
+#include "cases/test_writer.h"
+#include "cases/test_stream.h"
+#include "cases/test_number_format.h"
+#include "cases/test_escape.h"
+#include "cases/test_builder.h"
+#include "cases/test_format_text.h"
+#include "cases/test_size.h"
+#include "cases/test_sso.h"
+#include "cases/test_packed.h"
+#include "cases/test_columns.h"
+#include "cases/test_shapes.h"
+#include "cases/test_reclaim.h"
+#include "cases/test_mutate.h"
+#include "cases/test_clone.h"
+#include "cases/test_msgpack.h"
+#include "cases/test_snapshot.h"
+#include "cases/test_hash.h"
+#include "cases/test_doc_cache.h"
+#include "cases/test_share.h"
+#include "cases/test_publish.h"
+#include "cases/test_patch.h"
+#include "cases/test_raw.h"
+#include "cases/test_projected.h"
 
 test_row_t get_aggregate_output_row(const char *type, int passed, int failed, size_t total) {
     test_row_t row;
@@ -42,6 +67,30 @@ int main() {
     test_summary_t serialize_summary = run_serialize_tests();
     test_summary_t memory_summary = run_memory_tests();
     test_summary_t memory_edge_summary = run_memory_edge_case_tests();
+    test_summary_t allocator_summary = run_allocator_tests();
+    test_summary_t writer_summary = run_writer_tests();
+    test_summary_t stream_summary = run_stream_tests();
+    test_summary_t number_format_summary = run_number_format_tests();
+    test_summary_t escape_summary = run_escape_tests();
+    test_summary_t builder_summary = run_builder_tests();
+    test_summary_t format_text_summary = run_format_text_tests();
+    test_summary_t size_summary = run_size_tests();
+    test_summary_t sso_summary = run_sso_tests();
+    test_summary_t packed_summary = run_packed_tests();
+    test_summary_t columns_summary = run_columns_tests();
+    test_summary_t shapes_summary = run_shapes_tests();
+    test_summary_t reclaim_summary = run_reclaim_tests();
+    test_summary_t mutate_summary = run_mutate_tests();
+    test_summary_t clone_summary = run_clone_tests();
+    test_summary_t msgpack_summary = run_msgpack_tests();
+    test_summary_t snapshot_summary = run_snapshot_tests();
+    test_summary_t hash_summary = run_hash_tests();
+    test_summary_t doc_cache_summary = run_doc_cache_tests();
+    test_summary_t share_summary = run_share_tests();
+    test_summary_t publish_summary = run_publish_tests();
+    test_summary_t patch_summary = run_patch_tests();
+    test_summary_t raw_summary = run_raw_tests();
+    test_summary_t projected_summary = run_projected_tests();
     
     int total_passed = string_summary.passed + number_summary.passed + null_summary.passed + bool_summary.passed + object_summary.passed + list_summary.passed;
     int total_failed = string_summary.failed + number_summary.failed + null_summary.failed + bool_summary.failed + object_summary.failed + list_summary.failed;
@@ -55,7 +104,103 @@ int main() {
     total_failed += memory_summary.failed + memory_edge_summary.failed;
     total_tests += memory_summary.total + memory_edge_summary.total;
 
-    test_row_t agg_rows[10];
+    total_passed += allocator_summary.passed;
+    total_failed += allocator_summary.failed;
+    total_tests += allocator_summary.total;
+
+    total_passed += writer_summary.passed;
+    total_failed += writer_summary.failed;
+    total_tests += writer_summary.total;
+
+    total_passed += stream_summary.passed;
+    total_failed += stream_summary.failed;
+    total_tests += stream_summary.total;
+
+    total_passed += number_format_summary.passed;
+    total_failed += number_format_summary.failed;
+    total_tests += number_format_summary.total;
+
+    total_passed += escape_summary.passed;
+    total_failed += escape_summary.failed;
+    total_tests += escape_summary.total;
+
+    total_passed += builder_summary.passed;
+    total_failed += builder_summary.failed;
+    total_tests += builder_summary.total;
+
+    total_passed += format_text_summary.passed;
+    total_failed += format_text_summary.failed;
+    total_tests += format_text_summary.total;
+
+    total_passed += size_summary.passed;
+    total_failed += size_summary.failed;
+    total_tests += size_summary.total;
+
+    total_passed += sso_summary.passed;
+    total_failed += sso_summary.failed;
+    total_tests += sso_summary.total;
+
+    total_passed += packed_summary.passed;
+    total_failed += packed_summary.failed;
+    total_tests += packed_summary.total;
+
+    total_passed += columns_summary.passed;
+    total_failed += columns_summary.failed;
+    total_tests += columns_summary.total;
+
+    total_passed += shapes_summary.passed;
+    total_failed += shapes_summary.failed;
+    total_tests += shapes_summary.total;
+
+    total_passed += reclaim_summary.passed;
+    total_failed += reclaim_summary.failed;
+    total_tests += reclaim_summary.total;
+
+    total_passed += mutate_summary.passed;
+    total_failed += mutate_summary.failed;
+    total_tests += mutate_summary.total;
+
+    total_passed += clone_summary.passed;
+    total_failed += clone_summary.failed;
+    total_tests += clone_summary.total;
+
+    total_passed += msgpack_summary.passed;
+    total_failed += msgpack_summary.failed;
+    total_tests += msgpack_summary.total;
+
+    total_passed += snapshot_summary.passed;
+    total_failed += snapshot_summary.failed;
+    total_tests += snapshot_summary.total;
+
+    total_passed += hash_summary.passed;
+    total_failed += hash_summary.failed;
+    total_tests += hash_summary.total;
+
+    total_passed += doc_cache_summary.passed;
+    total_failed += doc_cache_summary.failed;
+    total_tests += doc_cache_summary.total;
+
+    total_passed += share_summary.passed;
+    total_failed += share_summary.failed;
+    total_tests += share_summary.total;
+
+    total_passed += publish_summary.passed;
+    total_failed += publish_summary.failed;
+    total_tests += publish_summary.total;
+
+    total_passed += patch_summary.passed;
+    total_failed += patch_summary.failed;
+    total_tests += patch_summary.total;
+
+    total_passed += raw_summary.passed;
+    total_failed += raw_summary.failed;
+    total_tests += raw_summary.total;
+
+    total_passed += projected_summary.passed;
+    total_failed += projected_summary.failed;
+    total_tests += projected_summary.total;
+
+    test_row_t agg_rows[34];
     agg_rows[0] = get_aggregate_output_row("String", string_summary.passed, string_summary.failed, string_summary.total);
     agg_rows[1] = get_aggregate_output_row("Number", number_summary.passed, number_summary.failed, number_summary.total);
     agg_rows[2] = get_aggregate_output_row("Null", null_summary.passed, null_summary.failed, null_summary.total);
@@ -65,11 +210,35 @@ int main() {
     agg_rows[6] = get_aggregate_output_row("Serialize", serialize_summary.passed, serialize_summary.failed, serialize_summary.total);
     agg_rows[7] = get_aggregate_output_row("Memory", memory_summary.passed, memory_summary.failed, memory_summary.total);
     agg_rows[8] = get_aggregate_output_row("MemEdge", memory_edge_summary.passed, memory_edge_summary.failed, memory_edge_summary.total);
-    agg_rows[9] = get_aggregate_output_row("Total", total_passed, total_failed, total_tests);
+    agg_rows[9] = get_aggregate_output_row("Allocator", allocator_summary.passed, allocator_summary.failed, allocator_summary.total);
+    agg_rows[10] = get_aggregate_output_row("Writer", writer_summary.passed, writer_summary.failed, writer_summary.total);
+    agg_rows[11] = get_aggregate_output_row("Stream", stream_summary.passed, stream_summary.failed, stream_summary.total);
+    agg_rows[12] = get_aggregate_output_row("NumFormat", number_format_summary.passed, number_format_summary.failed, number_format_summary.total);
+    agg_rows[13] = get_aggregate_output_row("Escape", escape_summary.passed, escape_summary.failed, escape_summary.total);
+    agg_rows[14] = get_aggregate_output_row("Builder", builder_summary.passed, builder_summary.failed, builder_summary.total);
+    agg_rows[15] = get_aggregate_output_row("TextFormat", format_text_summary.passed, format_text_summary.failed, format_text_summary.total);
+    agg_rows[16] = get_aggregate_output_row("Size", size_summary.passed, size_summary.failed, size_summary.total);
+    agg_rows[17] = get_aggregate_output_row("SmallString", sso_summary.passed, sso_summary.failed, sso_summary.total);
+    agg_rows[18] = get_aggregate_output_row("PackedArray", packed_summary.passed, packed_summary.failed, packed_summary.total);
+    agg_rows[19] = get_aggregate_output_row("Columnar", columns_summary.passed, columns_summary.failed, columns_summary.total);
+    agg_rows[20] = get_aggregate_output_row("ShapeSharing", shapes_summary.passed, shapes_summary.failed, shapes_summary.total);
+    agg_rows[21] = get_aggregate_output_row("Reclaim", reclaim_summary.passed, reclaim_summary.failed, reclaim_summary.total);
+    agg_rows[22] = get_aggregate_output_row("Mutation", mutate_summary.passed, mutate_summary.failed, mutate_summary.total);
+    agg_rows[23] = get_aggregate_output_row("Clone", clone_summary.passed, clone_summary.failed, clone_summary.total);
+    agg_rows[24] = get_aggregate_output_row("MessagePack", msgpack_summary.passed, msgpack_summary.failed, msgpack_summary.total);
+    agg_rows[25] = get_aggregate_output_row("Snapshot", snapshot_summary.passed, snapshot_summary.failed, snapshot_summary.total);
+    agg_rows[26] = get_aggregate_output_row("Hash", hash_summary.passed, hash_summary.failed, hash_summary.total);
+    agg_rows[27] = get_aggregate_output_row("Doc cache", doc_cache_summary.passed, doc_cache_summary.failed, doc_cache_summary.total);
+    agg_rows[28] = get_aggregate_output_row("Shared trees", share_summary.passed, share_summary.failed, share_summary.total);
+    agg_rows[29] = get_aggregate_output_row("Publish", publish_summary.passed, publish_summary.failed, publish_summary.total);
+    agg_rows[30] = get_aggregate_output_row("Patch", patch_summary.passed, patch_summary.failed, patch_summary.total);
+    agg_rows[31] = get_aggregate_output_row("Raw", raw_summary.passed, raw_summary.failed, raw_summary.total);
+    agg_rows[32] = get_aggregate_output_row("Projected", projected_summary.passed, projected_summary.failed, projected_summary.total);
+    agg_rows[33] = get_aggregate_output_row("Total", total_passed, total_failed, total_tests);
 
     const char *agg_headers[] = {"Type", "Passed", "Failed", "Total"};
     int agg_col_widths[] = {10, 8, 8, 8};
-    print_test_table("Aggregate Test Results", agg_headers, 4, agg_col_widths, agg_rows, 10);
+    print_test_table("Aggregate Test Results", agg_headers, 4, agg_col_widths, agg_rows, 34);
 
     if (total_failed == 0) {
         printf("%sAll tests passed!%s\n", GREEN, RESET);